@@ -27,6 +27,10 @@
 
 #include "P_AIO.h"
 
+#if TS_USE_LINUX_NATIVE_AIO
+#include <sys/syscall.h>
+#endif
+
 #define MAX_DISKS_POSSIBLE 100
 
 // globals
@@ -44,6 +48,9 @@ Continuation *aio_err_callbck = 0;
 RecInt cache_config_threads_per_disk = 12;
 RecInt api_config_threads_per_disk = 12;
 int thread_is_created = 0;
+/* file descriptors whose requests go through the kernel AIO interface */
+static int aio_native_fds[MAX_DISKS_POSSIBLE];
+static volatile int num_native_fds = 0;
 
 
 // AIO Stats
@@ -416,6 +423,205 @@ cache_op(AIOCallbackInternal *op)
   return 1;
 }
 
+#if TS_USE_LINUX_NATIVE_AIO
+/*
+ * Linux native AIO
+ */
+
+static inline int
+io_setup(unsigned nr, aio_context_t *ctxp)
+{
+  return syscall(__NR_io_setup, nr, ctxp);
+}
+
+static inline int
+io_submit(aio_context_t ctx, long nr, struct iocb **iocbpp)
+{
+  return syscall(__NR_io_submit, ctx, nr, iocbpp);
+}
+
+static inline int
+io_getevents(aio_context_t ctx, long min_nr, long max_nr, struct io_event *events, struct timespec *timeout)
+{
+  return syscall(__NR_io_getevents, ctx, min_nr, max_nr, events, timeout);
+}
+
+static bool
+aio_fd_is_native(int fd)
+{
+  for (int i = 0; i < num_native_fds; i++) {
+    if (aio_native_fds[i] == fd)
+      return true;
+  }
+  return false;
+}
+
+/* start a DiskHandler on every ET_CALL (net) thread; these threads
+   poll their eventfd, so they are woken up by completions */
+static void
+aio_native_start()
+{
+  for (int i = 0; i < eventProcessor.n_threads_for_type[ET_CALL]; i++) {
+    EThread *t = eventProcessor.eventthread[ET_CALL][i];
+    t->schedule_imm(NEW(new DiskHandler));
+  }
+}
+
+/* queue the request on the calling thread's DiskHandler. Returns false
+   if the request has to go through the AIO threads instead: the fd is
+   not in native mode, the caller is not a net thread, or the request
+   is a chained (then) request, which is only used at startup. */
+static bool
+aio_native_queue(AIOCallbackInternal *op)
+{
+  EThread *t = this_ethread();
+  if (op->then || !t || !t->diskHandler || !aio_fd_is_native(op->aiocb.aio_fildes))
+    return false;
+
+  struct iocb *cb = &op->native_cb;
+  memset(cb, 0, sizeof(*cb));
+  cb->aio_data = (uint64_t) (uintptr_t) op;
+  cb->aio_lio_opcode = (op->aiocb.aio_lio_opcode == LIO_READ) ? IOCB_CMD_PREAD : IOCB_CMD_PWRITE;
+  cb->aio_reqprio = 0;
+  cb->aio_fildes = op->aiocb.aio_fildes;
+  cb->aio_buf = (uint64_t) (uintptr_t) op->aiocb.aio_buf;
+  cb->aio_nbytes = op->aiocb.aio_nbytes;
+  cb->aio_offset = op->aiocb.aio_offset;
+#if TS_HAS_EVENTFD
+  cb->aio_flags = IOCB_FLAG_RESFD;
+  cb->aio_resfd = t->evfd;
+#endif
+  op->link.next = NULL;
+  op->link.prev = NULL;
+  t->diskHandler->ready_list.enqueue(op);
+  return true;
+}
+
+int
+DiskHandler::startAIOEvent(int event, Event *e)
+{
+  (void) event;
+  int ret = io_setup(MAX_AIO_EVENTS, &ctx);
+  if (ret < 0) {
+    Warning("io_setup failed: %s, falling back to AIO threads", strerror(errno));
+    delete this;
+    return EVENT_DONE;
+  }
+  SET_HANDLER(&DiskHandler::mainAIOEvent);
+  trigger_event = e;
+  e->ethread->diskHandler = this;
+  e->schedule_every(AIO_PERIOD);
+  return EVENT_CONT;
+}
+
+int
+DiskHandler::mainAIOEvent(int event, Event *e)
+{
+  (void) event;
+  (void) e;
+  AIOCallbackInternal *op = NULL;
+  int ret;
+
+  // reap completions
+  do {
+    ret = io_getevents(ctx, 0, MAX_AIO_EVENTS, events, NULL);
+    for (int i = 0; i < ret; i++) {
+      op = (AIOCallbackInternal *) (uintptr_t) events[i].data;
+      op->aio_result = (int64_t) events[i].res;
+      complete_list.enqueue(op);
+    }
+  } while (ret == MAX_AIO_EVENTS);
+  if (ret < 0)
+    Warning("io_getevents failed: %s", strerror(errno));
+
+  // submit everything queued since the last pass in one batch
+  struct iocb *cbs[MAX_AIO_EVENTS];
+  while (ready_list.head) {
+    int num = 0;
+    for (; num < MAX_AIO_EVENTS && (op = (AIOCallbackInternal *) ready_list.dequeue()); num++)
+      cbs[num] = &op->native_cb;
+    int done = 0;
+    while (done < num) {
+      ret = io_submit(ctx, num - done, cbs + done);
+      if (ret > 0) {
+        done += ret;
+      } else if (ret == 0 || errno == EAGAIN) {
+        // the context is full, retry the rest on the next pass
+        for (int i = num - 1; i >= done; i--)
+          ready_list.push((AIOCallbackInternal *) (uintptr_t) cbs[i]->aio_data);
+        goto Lcomplete;
+      } else {
+        Warning("io_submit failed: %s", strerror(errno));
+        op = (AIOCallbackInternal *) (uintptr_t) cbs[done]->aio_data;
+        op->aio_result = -errno;
+        complete_list.enqueue(op);
+        done++;
+      }
+    }
+  }
+
+Lcomplete:
+  while ((op = (AIOCallbackInternal *) complete_list.dequeue())) {
+    if (op->aiocb.aio_lio_opcode == LIO_WRITE) {
+      aio_num_write++;
+      aio_bytes_written += op->aiocb.aio_nbytes;
+    } else {
+      aio_num_read++;
+      aio_bytes_read += op->aiocb.aio_nbytes;
+    }
+    if (op->aio_result < 0) {
+      Warning("cache disk operation failed %s %" PRId64 " %d\n",
+              (op->aiocb.aio_lio_opcode == LIO_READ) ? "READ" : "WRITE", op->aio_result, (int) -op->aio_result);
+      if (aio_err_callbck) {
+        AIOCallback *callback_op = new AIOCallbackInternal();
+        callback_op->aiocb.aio_fildes = op->aiocb.aio_fildes;
+        callback_op->mutex = aio_err_callbck->mutex;
+        callback_op->action = aio_err_callbck;
+        eventProcessor.schedule_imm(callback_op);
+      }
+    }
+    op->mutex = op->action.mutex;
+    if (op->thread != AIO_CALLBACK_THREAD_ANY && op->thread != AIO_CALLBACK_THREAD_AIO &&
+        op->thread != trigger_event->ethread) {
+      op->thread->schedule_imm_signal(op);
+    } else {
+      MUTEX_TRY_LOCK(lock, op->mutex, trigger_event->ethread);
+      if (!lock)
+        trigger_event->ethread->schedule_imm(op);
+      else
+        op->handleEvent(EVENT_NONE, NULL);
+    }
+  }
+  return EVENT_CONT;
+}
+#endif // TS_USE_LINUX_NATIVE_AIO
+
+bool
+ink_aio_set_fd_mode(int fd, int mode)
+{
+  if (mode == AIO_MODE_THREAD)
+    return true;
+#if TS_USE_LINUX_NATIVE_AIO
+  if (mode == AIO_MODE_NATIVE) {
+    ink_mutex_acquire(&insert_mutex);
+    if (num_native_fds >= MAX_DISKS_POSSIBLE) {
+      ink_mutex_release(&insert_mutex);
+      return false;
+    }
+    if (!aio_fd_is_native(fd)) {
+      aio_native_fds[num_native_fds] = fd;
+      INK_WRITE_MEMORY_BARRIER;
+      if (num_native_fds++ == 0)
+        aio_native_start();
+    }
+    ink_mutex_release(&insert_mutex);
+    return true;
+  }
+#endif
+  (void) fd;
+  return false;
+}
+
 int
 ink_aio_read(AIOCallback *op, int fromAPI)
 {
@@ -433,6 +639,10 @@ ink_aio_read(AIOCallback *op, int fromAPI)
   cache_op((AIOCallbackInternal *) op);
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
+#if TS_USE_LINUX_NATIVE_AIO
+  if (!fromAPI && aio_native_queue((AIOCallbackInternal *) op))
+    return 1;
+#endif
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
@@ -456,6 +666,10 @@ ink_aio_write(AIOCallback *op, int fromAPI)
   cache_op((AIOCallbackInternal *) op);
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
+#if TS_USE_LINUX_NATIVE_AIO
+  if (!fromAPI && aio_native_queue((AIOCallbackInternal *) op))
+    return 1;
+#endif
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
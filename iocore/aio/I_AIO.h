@@ -50,6 +50,7 @@
 #define AIO_MODE_AIO             0
 #define AIO_MODE_SYNC            1
 #define AIO_MODE_THREAD          2
+#define AIO_MODE_NATIVE          3
 #define AIO_MODE                 AIO_MODE_THREAD
 
 // AIOCallback::thread special values
@@ -87,5 +88,8 @@ void ink_aio_set_callback(Continuation * error_callback);
 int ink_aio_read(AIOCallback *op, int fromAPI = 0);   // fromAPI is a boolean to indicate if this is from a API call such as upload proxy feature
 int ink_aio_write(AIOCallback *op, int fromAPI = 0);
 bool ink_aio_thread_num_set(int thread_num);
+// Select the AIO mode (AIO_MODE_THREAD or AIO_MODE_NATIVE) used for requests on fd.
+// Returns false if the mode is not available in this build.
+bool ink_aio_set_fd_mode(int fd, int mode);
 AIOCallback *new_AIOCallback(void);
 #endif
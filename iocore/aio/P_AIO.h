@@ -39,6 +39,10 @@
 #include "P_EventSystem.h"
 #include "I_AIO.h"
 
+#if TS_USE_LINUX_NATIVE_AIO
+#include <linux/aio_abi.h>
+#endif
+
 // for debugging
 // #define AIO_STATS 1
 
@@ -53,6 +57,9 @@ struct AIOCallbackInternal: public AIOCallback
   AIOCallback *first;
   AIO_Reqs *aio_req;
   ink_hrtime sleep_time;
+#if TS_USE_LINUX_NATIVE_AIO
+  struct iocb native_cb;        // kernel control block, used only in AIO_MODE_NATIVE
+#endif
   int io_complete(int event, void *data);
   AIOCallbackInternal()
   {
@@ -97,6 +104,33 @@ struct AIO_Reqs
   volatile int requests_queued;
 };
 
+#if TS_USE_LINUX_NATIVE_AIO
+#define MAX_AIO_EVENTS           1024
+#define AIO_PERIOD               -HRTIME_MSECONDS(4)
+
+/* Per EThread kernel AIO context. Requests on native mode file
+   descriptors are queued on the ready_list of the submitting thread,
+   submitted in one io_submit() batch and reaped with io_getevents()
+   from the same thread's poll loop. The kernel signals completions
+   through the thread's eventfd, so an idle net thread wakes up. */
+struct DiskHandler: public Continuation
+{
+  Event *trigger_event;
+  aio_context_t ctx;
+  struct io_event events[MAX_AIO_EVENTS];
+  Que(AIOCallback, link) ready_list;
+  Que(AIOCallback, link) complete_list;
+
+  int startAIOEvent(int event, Event *e);
+  int mainAIOEvent(int event, Event *e);
+
+  DiskHandler():Continuation(new_ProxyMutex()), trigger_event(NULL), ctx(0)
+  {
+    SET_HANDLER(&DiskHandler::startAIOEvent);
+  }
+};
+#endif
+
 #ifdef AIO_STATS
 class AIOTestData:public Continuation
 {
@@ -64,6 +64,7 @@ int cache_config_vary_on_user_agent = 0;
 int cache_config_select_alternate = 1;
 int cache_config_max_doc_size = 0;
 int cache_config_min_average_object_size = ESTIMATED_OBJECT_SIZE;
+int cache_config_dir_layout = DIR_LAYOUT_CHAINED;
 int64_t cache_config_ram_cache_cutoff = AGG_SIZE;
 int cache_config_max_disk_errors = 5;
 #ifdef HIT_EVACUATE
@@ -90,6 +91,7 @@ int enable_cache_empty_http_doc = 0;
 #ifdef SSD_CACHE
 int migrate_threshold = 2;
 int64_t transistor_range_threshold = (1 << 30); // 1G;
+int64_t admission_sample_size = (1 << 20);
 #endif
 // Globals
 
@@ -916,6 +918,8 @@ CacheProcessor::start_internal(int flags)
         }
         off_t skip = ROUND_TO_STORE_BLOCK((sd->offset < START_POS ? START_POS + sd->alignment : sd->offset));
         blocks = blocks - ROUND_TO_STORE_BLOCK(sd->offset + skip);
+        if (sd->native_aio && !ink_aio_set_fd_mode(fd, AIO_MODE_NATIVE))
+          Warning("native AIO is not available for '%s', using AIO threads", path);
         gdisks[gndisks]->open(path, blocks, skip, sector_size, fd, clear);
         gndisks++;
       }
@@ -1110,6 +1114,9 @@ CacheProcessor::cacheInitialized()
           case RAM_CACHE_ALGORITHM_LRU:
             gvol[i]->ram_cache = new_RamCacheLRU();
             break;
+          case RAM_CACHE_ALGORITHM_SHARDED:
+            gvol[i]->ram_cache = new_RamCacheSharded();
+            break;
         }
       }
       // let us cocalate the Size
@@ -1119,7 +1126,7 @@ CacheProcessor::cacheInitialized()
           vol = gvol[i];
           gvol[i]->ram_cache->init(vol_dirlen(vol), vol);
 #ifdef SSD_CACHE
-          gvol[i]->history.init(1<<20, 2097143);
+          gvol[i]->admission.init(admission_sample_size);
 #endif
           ram_cache_bytes += vol_dirlen(gvol[i]);
           Debug("cache_init", "CacheProcessor::cacheInitialized - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
@@ -1160,7 +1167,7 @@ CacheProcessor::cacheInitialized()
         for (i = 0; i < gnvol; i++) {
           vol = gvol[i];
 #ifdef SSD_CACHE
-          gvol[i]->history.init(1<<20, 2097143);
+          gvol[i]->admission.init(admission_sample_size);
 #endif
           double factor;
           if (gvol[i]->cache == theCache) {
@@ -1296,6 +1303,12 @@ vol_init_dir(Vol *d)
 {
   int b, s, l;
 
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    for (s = 0; s < d->segments; s++)
+      d->header->freelist[s] = 0;
+    dir_open_build_tags(d);
+    return;
+  }
   for (s = 0; s < d->segments; s++) {
     d->header->freelist[s] = 0;
     Dir *seg = dir_segment(s, d);
@@ -1333,10 +1346,11 @@ vol_clear_init(Vol *d)
 {
   size_t dir_len = vol_dirlen(d);
   memset(d->raw_dir, 0, dir_len);
+  d->dir_layout = cache_config_dir_layout;
   vol_init_dir(d);
   d->header->magic = VOL_MAGIC;
   d->header->version.ink_major = CACHE_DB_MAJOR_VERSION;
-  d->header->version.ink_minor = CACHE_DB_MINOR_VERSION;
+  d->header->version.ink_minor = d->dir_layout == DIR_LAYOUT_OPEN ? CACHE_DB_MINOR_VERSION_OPEN_DIR : CACHE_DB_MINOR_VERSION;
   d->scan_pos = d->header->agg_pos = d->header->write_pos = d->start;
   d->header->last_write_pos = d->header->write_pos;
   d->header->phase = 0;
@@ -1613,6 +1627,11 @@ Vol::handle_dir_read(int event, void *data)
     clear_dir();
     return EVENT_DONE;
   }
+  dir_layout = header->version.ink_minor == CACHE_DB_MINOR_VERSION_OPEN_DIR ? DIR_LAYOUT_OPEN : DIR_LAYOUT_CHAINED;
+  if (dir_layout != cache_config_dir_layout)
+    dir_migrate(this, cache_config_dir_layout);
+  else if (dir_layout == DIR_LAYOUT_OPEN)
+    dir_open_build_tags(this);
   CHECK_DIR(this);
 
   sector_size = header->sector_size;
@@ -2827,8 +2846,11 @@ CacheVC::handleRead(int event, Event *e)
   if(f.read_from_ssd && mts && mts->rewrite)
     goto LssdRead;
 #endif
-  if (vol->ram_cache->get(read_key, &buf, (uint32_t)(o >> 32), (uint32_t)o))
+  if (vol->ram_cache->get(read_key, &buf, (uint32_t)(o >> 32), (uint32_t)o)) {
+    CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_size_class_hits_stat + ram_cache_size_class(io.aiocb.aio_nbytes), 1);
     goto LramHit;
+  }
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_size_class_misses_stat + ram_cache_size_class(io.aiocb.aio_nbytes), 1);
 
   // check if it was read in the last open_read call
   if (*read_key == vol->first_fragment_key && dir_get_offset(&dir) == vol->first_fragment_offset) {
@@ -3515,6 +3537,13 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("ram_cache.bytes_used", cache_ram_cache_bytes_stat);
   REG_INT("ram_cache.hits", cache_ram_cache_hits_stat);
   REG_INT("ram_cache.misses", cache_ram_cache_misses_stat);
+  for (int i = 0; i < DEFAULT_BUFFER_SIZES; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "ram_cache.size_class.%d.hits", BUFFER_SIZE_FOR_INDEX(i));
+    REG_INT(name, cache_ram_cache_size_class_hits_stat + i);
+    snprintf(name, sizeof(name), "ram_cache.size_class.%d.misses", BUFFER_SIZE_FOR_INDEX(i));
+    REG_INT(name, cache_ram_cache_size_class_misses_stat + i);
+  }
   REG_INT("pread_count", cache_pread_count_stat);
   REG_INT("percent_full", cache_percent_full_stat);
   REG_INT("lookup.active", cache_lookup_active_stat);
@@ -3527,6 +3556,9 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("ssd.read.success", cache_ssd_read_success_stat);
   REG_INT("sas.read.success", cache_sas_read_success_stat);
   REG_INT("ram.read.success", cache_ram_read_success_stat);
+  REG_INT("ssd.admission.reject", cache_ssd_admission_reject_stat);
+  REG_INT("ssd.promote", cache_ssd_promote_stat);
+  REG_INT("ssd.promote.reread", cache_ssd_promote_reread_stat);
 #endif
   REG_INT("write.active", cache_write_active_stat);
   REG_INT("write.success", cache_write_success_stat);
@@ -3573,6 +3605,8 @@ ink_cache_init(ModuleVersion v)
         cache_config_ram_cache_size, cache_config_ram_cache_size / (1024 * 1024));
 
   IOCORE_EstablishStaticConfigInt32(cache_config_ram_cache_algorithm, "proxy.config.cache.ram_cache.algorithm");
+  IOCORE_EstablishStaticConfigInt32(cache_config_dir_layout, "proxy.config.cache.dir.layout");
+  Debug("cache_init", "proxy.config.cache.dir.layout = %d", cache_config_dir_layout);
   IOCORE_EstablishStaticConfigInt32(cache_config_ram_cache_compress, "proxy.config.cache.ram_cache.compress");
   IOCORE_EstablishStaticConfigInt32(cache_config_ram_cache_compress_percent, "proxy.config.cache.ram_cache.compress_percent");
   IOCORE_EstablishStaticConfigInt32(cache_config_ram_cache_use_seen_filter, "proxy.config.cache.ram_cache.use_seen_filter");
@@ -3651,6 +3685,8 @@ ink_cache_init(ModuleVersion v)
   Debug("cache_init", "proxy.config.cache.migrate_threshold = %d", migrate_threshold);
   IOCORE_EstablishStaticConfigInteger(transistor_range_threshold, "proxy.config.cache.ssd.transistor_range_threshold");
   Debug("cache_init", "proxy.config.cache.ssd.transistor_range_threshold = %" PRId64 "", transistor_range_threshold);
+  IOCORE_EstablishStaticConfigInteger(admission_sample_size, "proxy.config.cache.ssd.admission_sample_size");
+  Debug("cache_init", "proxy.config.cache.ssd.admission_sample_size = %" PRId64 "", admission_sample_size);
 #endif
 #endif
 
@@ -29,6 +29,11 @@
 #define DIR_LOOP_THRESHOLD	      1000
 #endif
 #include "ink_stack_trace.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define CACHE_INC_DIR_USED(_m) do { \
 ProxyMutex *mutex = _m; \
@@ -51,6 +56,15 @@ CACHE_INCREMENT_DYN_STAT(cache_directory_collision_count_stat); \
 ClassAllocator<OpenDirEntry> openDirEntryAllocator("openDirEntry");
 Dir empty_dir;
 
+static void dir_open_clean_segment(int s, Vol *d);
+
+// shadow tag of an entry of bucket b in the open layout
+static inline uint16_t
+dir_open_tag(int b, uint32_t tag)
+{
+  return (uint16_t) (DIR_TAG_USED | ((b % DIR_GROUP_BUCKETS) << DIR_TAG_WIDTH) | DIR_MASK_TAG(tag));
+}
+
 // OpenDir
 
 OpenDir::OpenDir()
@@ -210,6 +224,10 @@ dir_init_segment(int s, Vol *d)
   Dir *seg = dir_segment(s, d);
   int l, b;
   memset(seg, 0, SIZEOF_DIR * DIR_DEPTH * d->buckets);
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    memset(vol_dir_tags(d, s), 0, vol_dir_tag_stride(d) * sizeof(uint16_t));
+    return;
+  }
   for (l = 1; l < DIR_DEPTH; l++) {
     for (b = 0; b < d->buckets; b++) {
       Dir *bucket = dir_bucket(b, seg);
@@ -237,6 +255,12 @@ dir_freelist_length(Vol *d, int s)
 {
   int free = 0;
   Dir *seg = dir_segment(s, d);
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    for (int i = 0; i < d->buckets * DIR_DEPTH; i++)
+      if (dir_is_empty(dir_in_seg(seg, i)))
+        free++;
+    return free;
+  }
   Dir *e = dir_from_offset(d->header->freelist[s], seg);
   if (dir_bucket_loop_fix(e, s, d))
     return (DIR_DEPTH - 1) * d->buckets;
@@ -253,6 +277,12 @@ dir_bucket_length(Dir *b, int s, Vol *d)
   Dir *e = b;
   int i = 0;
   Dir *seg = dir_segment(s, d);
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    for (int l = 0; l < DIR_DEPTH; l++)
+      if (!dir_is_empty(dir_bucket_row(b, l)))
+        i++;
+    return i ? i : 1;
+  }
 #ifdef LOOP_CHECK_MODE
   if (dir_bucket_loop_fix(b, s, d))
     return 1;
@@ -273,6 +303,19 @@ check_dir(Vol *d)
   Debug("cache_check_dir", "inside check dir");
   for (s = 0; s < d->segments; s++) {
     Dir *seg = dir_segment(s, d);
+    if (d->dir_layout == DIR_LAYOUT_OPEN) {
+      uint16_t *tags = vol_dir_tags(d, s);
+      for (i = 0; i < d->buckets * DIR_DEPTH; i++) {
+        Dir *e = dir_in_seg(seg, i);
+        if (dir_is_empty(e)) {
+          if (tags[i]) return 0;
+          continue;
+        }
+        if (dir_open_bucket(e) / DIR_GROUP_BUCKETS != i / DIR_GROUP_SLOTS) return 0;
+        if (tags[i] != dir_open_tag(dir_open_bucket(e), dir_tag(e))) return 0;
+      }
+      continue;
+    }
     for (i = 0; i < d->buckets; i++) {
       Dir *b = dir_bucket(i, seg);
       if (!(dir_bucket_length(b, s, d) >= 0)) return 0;
@@ -359,6 +402,10 @@ dir_clean_bucket(Dir *b, int s, Vol *vol)
 void
 dir_clean_segment(int s, Vol *d)
 {
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    dir_open_clean_segment(s, d);
+    return;
+  }
   Dir *seg = dir_segment(s, d);
   for (int i = 0; i < d->buckets; i++) {
     dir_clean_bucket(dir_bucket(i, seg), s, d);
@@ -573,24 +620,41 @@ dir_segment_accounted(int s, Vol *d, int offby, int *f, int *u, int *et, int *v,
   int valid = 0, agg_valid = 0;
   int64_t agg_size = 0;
   Dir *seg = dir_segment(s, d);
-  for (int bi = 0; bi < d->buckets; bi++) {
-    Dir *b = dir_bucket(bi, seg);
-    Dir *e = b;
-    while (e) {
-      if (!dir_offset(e)) {
-        ink_assert(e == b);
-        empty++;
-      } else {
-        used++;
-        if (dir_valid(d, e))
-          valid++;
-        if (dir_agg_valid(d, e))
-          agg_valid++;
-        agg_size += dir_approx_size(e);
+  if (d->dir_layout == DIR_LAYOUT_OPEN) {
+    // no chains, every used row holds an entry
+    for (int bi = 0; bi < d->buckets; bi++) {
+      for (int l = 0; l < DIR_DEPTH; l++) {
+        Dir *e = dir_bucket_row(dir_bucket(bi, seg), l);
+        if (dir_offset(e)) {
+          used++;
+          if (dir_valid(d, e))
+            valid++;
+          if (dir_agg_valid(d, e))
+            agg_valid++;
+          agg_size += dir_approx_size(e);
+        }
+      }
+    }
+  } else {
+    for (int bi = 0; bi < d->buckets; bi++) {
+      Dir *b = dir_bucket(bi, seg);
+      Dir *e = b;
+      while (e) {
+        if (!dir_offset(e)) {
+          ink_assert(e == b);
+          empty++;
+        } else {
+          used++;
+          if (dir_valid(d, e))
+            valid++;
+          if (dir_agg_valid(d, e))
+            agg_valid++;
+          agg_size += dir_approx_size(e);
+        }
+        e = next_dir(e, seg);
+        if (!e)
+          break;
       }
-      e = next_dir(e, seg);
-      if (!e)
-        break;
     }
   }
   if (f)
@@ -621,10 +685,405 @@ dir_free_entry(Dir *e, int s, Vol *d)
   d->header->freelist[s] = eo;
 }
 
+// Open Layout
+
+#if DIR_GROUP_SLOTS != 32
+#error "dir_group_match() compares 32 shadow tags"
+#endif
+
+// returns the bit mask of the rows of the group whose shadow tag is t
+uint32_t
+dir_group_match(const uint16_t *tags, uint16_t t)
+{
+#if defined(__AVX2__)
+  __m256i k = _mm256_set1_epi16((short) t);
+  __m256i lo = _mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *) tags), k);
+  __m256i hi = _mm256_cmpeq_epi16(_mm256_load_si256((const __m256i *) (tags + 16)), k);
+  // packs works within the 128 bit lanes, put the quadwords back in order
+  __m256i m = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+  return (uint32_t) _mm256_movemask_epi8(m);
+#elif defined(__SSE2__)
+  __m128i k = _mm_set1_epi16((short) t);
+  const __m128i *p = (const __m128i *) tags;
+  __m128i m0 = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_load_si128(p), k), _mm_cmpeq_epi16(_mm_load_si128(p + 1), k));
+  __m128i m1 = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_load_si128(p + 2), k), _mm_cmpeq_epi16(_mm_load_si128(p + 3), k));
+  return (uint32_t) _mm_movemask_epi8(m0) | ((uint32_t) _mm_movemask_epi8(m1) << 16);
+#else
+  uint32_t m = 0;
+  for (int i = 0; i < DIR_GROUP_SLOTS; i++)
+    if (tags[i] == t)
+      m |= 1U << i;
+  return m;
+#endif
+}
+
+// mask of the rows of group g, the last group of a segment may be short
+static inline uint32_t
+dir_group_valid(Vol *d, int g)
+{
+  int rows = d->buckets * DIR_DEPTH - g * DIR_GROUP_SLOTS;
+  return rows >= DIR_GROUP_SLOTS ? ~0U : ((1U << rows) - 1);
+}
+
+static inline void
+dir_open_fill(Vol *d, int s, int i, int b, uint32_t tag, Dir *to_part)
+{
+  Dir *e = dir_in_seg(dir_segment(s, d), i);
+  dir_assign(e, to_part);
+  dir_set_tag(e, tag);
+  dir_set_open_bucket(e, b);
+  vol_dir_tags(d, s)[i] = dir_open_tag(b, tag);
+}
+
+static inline void
+dir_open_clear(Vol *d, int s, int i)
+{
+  dir_clear(dir_in_seg(dir_segment(s, d), i));
+  vol_dir_tags(d, s)[i] = 0;
+}
+
+// returns a free row for bucket b, the rows of b first. If the group is
+// full the stale entries are removed, then the home row holding the
+// oldest data is replaced.
+static int
+dir_open_free_row(Vol *d, int s, int b)
+{
+  Vol *vol = d;
+  int g = b / DIR_GROUP_BUCKETS;
+  int base = g * DIR_GROUP_SLOTS;
+  uint16_t *tags = vol_dir_tags(d, s) + base;
+  uint32_t valid = dir_group_valid(d, g);
+  uint32_t empty = dir_group_match(tags, 0) & valid;
+  int home = (b % DIR_GROUP_BUCKETS) * DIR_DEPTH;
+  Dir *seg = dir_segment(s, d);
+  if (!empty) {
+    for (int i = 0; i < DIR_GROUP_SLOTS; i++) {
+      if (!(valid & (1U << i)))
+        break;
+      if (!dir_valid(d, dir_in_seg(seg, base + i))) {
+        CACHE_DEC_DIR_USED(d->mutex);
+        dir_open_clear(d, s, base + i);
+        empty |= 1U << i;
+      }
+    }
+  }
+  if (!empty) {
+    int victim = home;
+    off_t victim_dist = d->len;
+    for (int l = 0; l < DIR_DEPTH; l++) {
+      off_t dist = vol_offset(d, dir_in_seg(seg, base + home + l)) - d->header->write_pos;
+      if (dist < 0)
+        dist += d->len;
+      if (dist < victim_dist) {
+        victim = home + l;
+        victim_dist = dist;
+      }
+    }
+    DDebug("dir_insert", "group %d of segment %d full, replacing row %d", g, s, victim);
+    CACHE_DEC_DIR_USED(d->mutex);
+    return base + victim;
+  }
+  uint32_t h = empty & (((1U << DIR_DEPTH) - 1) << home);
+  return base + ffs(h ? h : empty) - 1;
+}
+
+static int
+dir_open_probe(CacheKey *key, Vol *d, Dir *result, Dir ** last_collision)
+{
+  Vol *vol = d;
+  int s = key->word(0) % d->segments;
+  int b = key->word(1) % d->buckets;
+  int base = (b / DIR_GROUP_BUCKETS) * DIR_GROUP_SLOTS;
+  Dir *seg = dir_segment(s, d);
+  uint16_t *tags = vol_dir_tags(d, s) + base;
+  uint16_t t = dir_open_tag(b, key->word(2));
+  Dir *collision = *last_collision;
+  uint32_t m;
+Lagain:
+  m = dir_group_match(tags, t);
+  while (m) {
+    int i = ffs(m) - 1;
+    m &= m - 1;
+    Dir *e = dir_in_seg(seg, base + i);
+    if (collision) {
+      if (collision == e) {
+        collision = NULL;
+        DDebug("cache_stats", "Incrementing dir collisions");
+        CACHE_INC_DIR_COLLISIONS(d->mutex);
+      }
+      continue;
+    }
+    if (dir_valid(d, e)) {
+      DDebug("dir_probe_hit", "found %X %X vol %d bucket %d boffset %" PRId64 "", key->word(0), key->word(1), d->fd, b, dir_offset(e));
+      dir_assign(result, e);
+      *last_collision = e;
+      return 1;
+    }
+    // delete the invalid entry
+#if TS_USE_DIR_SHM
+    d->header->segment = s + 1;
+#endif
+    CACHE_DEC_DIR_USED(d->mutex);
+    dir_open_clear(d, s, base + i);
+    d->header->dirty = 1;
+#if TS_USE_DIR_SHM
+    d->header->segment = 0;
+#endif
+  }
+  if (collision) {              // last collision no longer in the group, retry
+    DDebug("cache_stats", "Incrementing dir collisions");
+    CACHE_INC_DIR_COLLISIONS(d->mutex);
+    collision = NULL;
+    goto Lagain;
+  }
+  DDebug("dir_probe_miss", "missed %X %X on vol %d bucket %d at %p", key->word(0), key->word(1), d->fd, b, seg);
+  return 0;
+}
+
+static int
+dir_open_insert(CacheKey *key, Vol *d, Dir *to_part)
+{
+  Vol *vol = d;
+  int s = key->word(0) % d->segments;
+  int b = key->word(1) % d->buckets;
+#if TS_USE_DIR_SHM
+  d->header->segment = s + 1;
+#endif
+  int i = dir_open_free_row(d, s, b);
+  dir_open_fill(d, s, i, b, key->word(2), to_part);
+  DDebug("dir_insert", "insert %X into vol %d bucket %d row %d tag %X boffset %" PRId64 "",
+         key->word(0), d->fd, b, i, DIR_MASK_TAG(key->word(2)), dir_offset(to_part));
+  d->header->dirty = 1;
+  CACHE_INC_DIR_USED(d->mutex);
+#if TS_USE_DIR_SHM
+  d->header->segment = 0;
+#endif
+  return 1;
+}
+
+static int
+dir_open_overwrite(CacheKey *key, Vol *d, Dir *dir, Dir *overwrite, bool must_overwrite)
+{
+  Vol *vol = d;
+  int s = key->word(0) % d->segments;
+  int b = key->word(1) % d->buckets;
+  int base = (b / DIR_GROUP_BUCKETS) * DIR_GROUP_SLOTS;
+  Dir *seg = dir_segment(s, d);
+  int res = 1, i = -1;
+#if TS_USE_DIR_SHM
+  d->header->segment = s + 1;
+#endif
+  uint32_t m = dir_group_match(vol_dir_tags(d, s) + base, dir_open_tag(b, key->word(2)));
+  while (m) {
+    int r = ffs(m) - 1;
+    m &= m - 1;
+    if (dir_get_offset(dir_in_seg(seg, base + r)) == dir_get_offset(overwrite)) {
+      i = base + r;
+      break;
+    }
+  }
+  if (i < 0) {
+    if (must_overwrite) {
+#if TS_USE_DIR_SHM
+      d->header->segment = 0;
+#endif
+      return 0;
+    }
+    res = 0;
+    i = dir_open_free_row(d, s, b);
+    CACHE_INC_DIR_USED(d->mutex);
+  }
+  dir_open_fill(d, s, i, b, key->word(2), dir);
+  ink_assert(vol_offset(d, dir_in_seg(seg, i)) < d->skip + d->len);
+  DDebug("dir_overwrite", "overwrite %X into vol %d bucket %d row %d tag %X boffset %" PRId64 "",
+         key->word(0), d->fd, b, i, DIR_MASK_TAG(key->word(2)), dir_offset(dir));
+  d->header->dirty = 1;
+#if TS_USE_DIR_SHM
+  d->header->segment = 0;
+#endif
+  return res;
+}
+
+static int
+dir_open_delete(CacheKey *key, Vol *d, Dir *del)
+{
+  Vol *vol = d;
+  int s = key->word(0) % d->segments;
+  int b = key->word(1) % d->buckets;
+  int base = (b / DIR_GROUP_BUCKETS) * DIR_GROUP_SLOTS;
+  Dir *seg = dir_segment(s, d);
+  uint32_t m = dir_group_match(vol_dir_tags(d, s) + base, dir_open_tag(b, key->word(2)));
+  while (m) {
+    int r = ffs(m) - 1;
+    m &= m - 1;
+    if (dir_get_offset(dir_in_seg(seg, base + r)) == dir_get_offset(del)) {
+#if TS_USE_DIR_SHM
+      d->header->segment = s + 1;
+#endif
+      CACHE_DEC_DIR_USED(d->mutex);
+      dir_open_clear(d, s, base + r);
+      d->header->dirty = 1;
+#if TS_USE_DIR_SHM
+      d->header->segment = 0;
+#endif
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static void
+dir_open_clean_segment(int s, Vol *d)
+{
+  Vol *vol = d;
+  Dir *seg = dir_segment(s, d);
+  uint16_t *tags = vol_dir_tags(d, s);
+  for (int i = 0; i < d->buckets * DIR_DEPTH; i++) {
+    Dir *e = dir_in_seg(seg, i);
+    if (dir_offset(e) && !dir_valid(d, e))
+      CACHE_DEC_DIR_USED(d->mutex);
+    else if (dir_offset(e)) {
+      tags[i] = dir_open_tag(dir_open_bucket(e), dir_tag(e));
+      continue;
+    }
+    dir_clear(e);
+    tags[i] = 0;
+  }
+}
+
+static void
+vol_alloc_dir_tags(Vol *d)
+{
+  if (d->dir_tags)
+    return;
+  size_t n = (size_t) vol_dir_tag_stride(d) * d->segments * sizeof(uint16_t);
+  d->dir_tags = (uint16_t *) ats_memalign(64, n);
+  memset(d->dir_tags, 0, n);
+}
+
+// rebuild the shadow tags from the directory
+void
+dir_open_build_tags(Vol *d)
+{
+  vol_alloc_dir_tags(d);
+  for (int s = 0; s < d->segments; s++) {
+    Dir *seg = dir_segment(s, d);
+    uint16_t *tags = vol_dir_tags(d, s);
+    for (int i = 0; i < d->buckets * DIR_DEPTH; i++) {
+      Dir *e = dir_in_seg(seg, i);
+      tags[i] = dir_offset(e) ? dir_open_tag(dir_open_bucket(e), dir_tag(e)) : 0;
+    }
+  }
+}
+
+// place an entry of bucket b without a key, returns 0 if there is no room
+static int
+dir_migrate_place(Vol *d, int s, int b, Dir *entry, int layout)
+{
+  Dir *seg = dir_segment(s, d);
+  if (layout == DIR_LAYOUT_OPEN) {
+    int base = (b / DIR_GROUP_BUCKETS) * DIR_GROUP_SLOTS;
+    uint32_t empty = dir_group_match(vol_dir_tags(d, s) + base, 0) & dir_group_valid(d, b / DIR_GROUP_BUCKETS);
+    uint32_t h = empty & (((1U << DIR_DEPTH) - 1) << ((b % DIR_GROUP_BUCKETS) * DIR_DEPTH));
+    if (!empty)
+      return 0;
+    dir_open_fill(d, s, base + ffs(h ? h : empty) - 1, b, dir_tag(entry), entry);
+    return 1;
+  }
+  Dir *bucket = dir_bucket(b, seg);
+  if (!dir_is_empty(bucket)) {
+    Dir *e = NULL;
+    for (int l = 1; l < DIR_DEPTH; l++) {
+      if (dir_is_empty(dir_bucket_row(bucket, l))) {
+        e = dir_bucket_row(bucket, l);
+        unlink_from_freelist(e, s, d);
+        break;
+      }
+    }
+    if (!e) {
+      if (!(e = dir_from_offset(d->header->freelist[s], seg)))
+        return 0;
+      unlink_from_freelist(e, s, d);
+    }
+    dir_assign(e, bucket);
+    dir_set_next(bucket, dir_to_offset(e, seg));
+  }
+  dir_assign_data(bucket, entry);
+  return 1;
+}
+
+// Convert the directory to another layout in place. The entries keep
+// their data, only the entries which do not fit are dropped. Must be
+// called before the volume is in use.
+void
+dir_migrate(Vol *d, int layout)
+{
+  if (d->dir_layout == layout)
+    return;
+  int rows = d->buckets * DIR_DEPTH;
+  Dir *entries = (Dir *) ats_malloc(rows * sizeof(Dir));
+  int *buckets = (int *) ats_malloc(rows * sizeof(int));
+  int64_t moved = 0, dropped = 0;
+  if (layout == DIR_LAYOUT_OPEN)
+    vol_alloc_dir_tags(d);
+  for (int s = 0; s < d->segments; s++) {
+    Dir *seg = dir_segment(s, d);
+    int n = 0;
+    if (d->dir_layout == DIR_LAYOUT_OPEN) {
+      for (int i = 0; i < rows; i++) {
+        Dir *e = dir_in_seg(seg, i);
+        if (dir_offset(e) && dir_open_bucket(e) < d->buckets) {
+          dir_assign(&entries[n], e);
+          buckets[n++] = dir_open_bucket(e);
+        }
+      }
+    } else {
+      for (int b = 0; b < d->buckets; b++) {
+        Dir *e = dir_bucket(b, seg);
+        if (!dir_bucket_loop_check(e, seg))
+          continue;             // drop a corrupt bucket
+        for (; e; e = next_dir(e, seg)) {
+          if (dir_offset(e)) {
+            dir_assign(&entries[n], e);
+            buckets[n++] = b;
+          }
+        }
+      }
+    }
+    memset(seg, 0, rows * SIZEOF_DIR);
+    d->header->freelist[s] = 0;
+    if (layout == DIR_LAYOUT_OPEN)
+      memset(vol_dir_tags(d, s), 0, vol_dir_tag_stride(d) * sizeof(uint16_t));
+    else {
+      for (int l = 1; l < DIR_DEPTH; l++)
+        for (int b = 0; b < d->buckets; b++)
+          dir_free_entry(dir_bucket_row(dir_bucket(b, seg), l), s, d);
+    }
+    // the chained layout inserts at the head of the bucket, go backward
+    // to keep the order of the chains
+    while (n--) {
+      if (dir_migrate_place(d, s, buckets[n], &entries[n], layout))
+        moved++;
+      else
+        dropped++;
+    }
+  }
+  ats_free(entries);
+  ats_free(buckets);
+  d->dir_layout = layout;
+  d->header->version.ink_minor = d->footer->version.ink_minor =
+    layout == DIR_LAYOUT_OPEN ? CACHE_DB_MINOR_VERSION_OPEN_DIR : CACHE_DB_MINOR_VERSION;
+  d->header->dirty = 1;
+  Note("cache directory '%s' migrated to the %s layout, %" PRId64 " entries moved, %" PRId64 " dropped",
+       d->hash_id, layout == DIR_LAYOUT_OPEN ? "open" : "chained", moved, dropped);
+}
+
 int
 dir_probe(CacheKey *key, Vol *d, Dir *result, Dir ** last_collision)
 {
   ink_debug_assert(d->mutex->thread_holding == this_ethread());
+  if (d->dir_layout == DIR_LAYOUT_OPEN)
+    return dir_open_probe(key, d, result, last_collision);
   int s = key->word(0) % d->segments;
   int b = key->word(1) % d->buckets;
   Dir *seg = dir_segment(s, d);
@@ -697,6 +1156,8 @@ int
 dir_insert(CacheKey *key, Vol *d, Dir *to_part)
 {
   ink_debug_assert(d->mutex->thread_holding == this_ethread());
+  if (d->dir_layout == DIR_LAYOUT_OPEN)
+    return dir_open_insert(key, d, to_part);
   int s = key->word(0) % d->segments, l;
   int bi = key->word(1) % d->buckets;
 #if TS_USE_DIR_SHM
@@ -759,6 +1220,8 @@ int
 dir_overwrite(CacheKey *key, Vol *d, Dir *dir, Dir *overwrite, bool must_overwrite)
 {
   ink_debug_assert(d->mutex->thread_holding == this_ethread());
+  if (d->dir_layout == DIR_LAYOUT_OPEN)
+    return dir_open_overwrite(key, d, dir, overwrite, must_overwrite);
   int s = key->word(0) % d->segments, l;
   int bi = key->word(1) % d->buckets;
   Dir *seg = dir_segment(s, d);
@@ -842,6 +1305,8 @@ int
 dir_delete(CacheKey *key, Vol *d, Dir *del)
 {
   ink_debug_assert(d->mutex->thread_holding == this_ethread());
+  if (d->dir_layout == DIR_LAYOUT_OPEN)
+    return dir_open_delete(key, d, del);
   int s = key->word(0) % d->segments;
   int b = key->word(1) % d->buckets;
   Dir *seg = dir_segment(s, d);
@@ -1021,6 +1486,12 @@ dir_entries_used(Vol *d)
   for (int s = 0; s < d->segments; full += sfull, s++) {
     Dir *seg = dir_segment(s, d);
     sfull = 0;
+    if (d->dir_layout == DIR_LAYOUT_OPEN) {
+      for (int i = 0; i < d->buckets * DIR_DEPTH; i++)
+        if (dir_offset(dir_in_seg(seg, i)))
+          sfull++;
+      continue;
+    }
     for (int b = 0; b < d->buckets; b++) {
       Dir *e = dir_bucket(b, seg);
       if (dir_bucket_loop_fix(e, s, d)) {
@@ -1312,7 +1783,7 @@ Vol::dir_check(bool fix)
     for (int b = 0; b < buckets; b++) {
       int h = 0;
       Dir *e = dir_bucket(b, seg);
-      while (e) {
+      for (int l = 0; e; l++) {
         if (!dir_offset(e))
           empty++;
         else {
@@ -1322,9 +1793,10 @@ Vol::dir_check(bool fix)
           else
             full++;
         }
-        e = next_dir(e, seg);
-        if (!e)
-          break;
+        if (dir_layout == DIR_LAYOUT_OPEN)  // rows of the bucket
+          e = l + 1 < DIR_DEPTH ? dir_bucket_row(dir_bucket(b, seg), l + 1) : NULL;
+        else
+          e = next_dir(e, seg);
       }
       if (h > HIST_DEPTH)
         h = HIST_DEPTH;
@@ -1338,6 +1810,7 @@ Vol::dir_check(bool fix)
   int total = buckets * segments * DIR_DEPTH;
   printf("    Directory for [%s]\n", hash_id);
   printf("        Bytes:     %d\n", total * SIZEOF_DIR);
+  printf("        Layout:    %s\n", dir_layout == DIR_LAYOUT_OPEN ? "open" : "chained");
   printf("        Segments:  %" PRIu64 "\n", (uint64_t)segments);
   printf("        Buckets:   %" PRIu64 "\n", (uint64_t)buckets);
   printf("        Entries:   %d\n", total);
@@ -1494,6 +1967,8 @@ EXCLUSIVE_REGRESSION_TEST(Cache_dir) (RegressionTest *t, int atype, int *status)
   ink_release_assert(lock);
   rprintf(t, "clearing vol 0\n", free);
   vol_dir_clear(d);
+  // the chain and loop tests need the chained layout
+  dir_migrate(d, DIR_LAYOUT_CHAINED);
 
   // coverity[var_decl]
   Dir dir;
@@ -1652,3 +2127,68 @@ EXCLUSIVE_REGRESSION_TEST(Cache_dir) (RegressionTest *t, int atype, int *status)
   vol_dir_clear(d);
   *status = ret;
 }
+
+// Probe cost of the directory layouts at different fill factors
+EXCLUSIVE_REGRESSION_TEST(Cache_dir_layout) (RegressionTest *t, int atype, int *status) {
+  NOWARN_UNUSED(atype);
+  static const int fills[] = { 25, 50, 75, 90 };
+  int ret = REGRESSION_TEST_PASSED;
+
+  if ((CacheProcessor::IsCacheEnabled() != CACHE_INITIALIZED) || gnvol < 1) {
+    rprintf(t, "cache not ready/configured");
+    *status = REGRESSION_TEST_FAILED;
+    return;
+  }
+  Vol *d = gvol[0];
+  EThread *thread = this_ethread();
+  MUTEX_TRY_LOCK(lock, d->mutex, thread);
+  ink_release_assert(lock);
+
+  Dir dir;
+  dir_clear(&dir);
+  dir_set_phase(&dir, 0);
+  dir_set_head(&dir, true);
+  dir_set_offset(&dir, 1);
+
+  for (int layout = DIR_LAYOUT_CHAINED; layout <= DIR_LAYOUT_OPEN; layout++) {
+    for (unsigned int f = 0; f < sizeof(fills) / sizeof(fills[0]); f++) {
+      vol_dir_clear(d);
+      dir_migrate(d, layout);
+      d->header->agg_pos = d->header->write_pos += 1024;
+      int n = (int) ((int64_t) vol_direntries(d) * fills[f] / 100);
+      CacheKey key;
+      regress_rand_init(17);
+      for (int i = 0; i < n; i++) {
+        regress_rand_CacheKey(&key);
+        dir_insert(&key, d, &dir);
+      }
+      // hits
+      int found = 0;
+      regress_rand_init(17);
+      ink_hrtime ttime = ink_get_hrtime_internal();
+      for (int i = 0; i < n; i++) {
+        Dir *last_collision = 0;
+        regress_rand_CacheKey(&key);
+        found += dir_probe(&key, d, &dir, &last_collision);
+      }
+      uint64_t hit_us = (ink_get_hrtime_internal() - ttime) / HRTIME_USECOND;
+      // misses, the random sequence continues with keys never inserted
+      ttime = ink_get_hrtime_internal();
+      for (int i = 0; i < n; i++) {
+        Dir *last_collision = 0;
+        regress_rand_CacheKey(&key);
+        dir_probe(&key, d, &dir, &last_collision);
+      }
+      uint64_t miss_us = (ink_get_hrtime_internal() - ttime) / HRTIME_USECOND;
+      rprintf(t, "%s layout, %d%% full: %d entries, %d%% found, hit probe %" PRIu64 " ns, miss probe %" PRIu64 " ns\n",
+              layout == DIR_LAYOUT_OPEN ? "open" : "chained", fills[f], n, n ? (int) ((int64_t) found * 100 / n) : 0,
+              n ? hit_us * 1000 / n : 0, n ? miss_us * 1000 / n : 0);
+      if (fills[f] <= 50 && found < n - n / 100)
+        ret = REGRESSION_TEST_FAILED;
+      if (!check_dir(d))
+        ret = REGRESSION_TEST_FAILED;
+    }
+  }
+  vol_dir_clear(d);
+  *status = ret;
+}
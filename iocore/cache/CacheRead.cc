@@ -815,6 +815,23 @@ Lread: {
     // EVENT_IMMEDIATE events. So, we have to cancel that trigger and set
     // a new EVENT_INTERVAL event.
 
+    // fragment keys are never reused for other data, so a RAM cache that
+    // locks internally can serve the next fragment without the vol lock
+    {
+      Ptr<IOBufferData> rbuf;
+      if (vol->ram_cache->probe(&key, &rbuf)) {
+        Doc *rdoc = (Doc *) rbuf->data();
+        if (rdoc->magic == DOC_MAGIC && rdoc->key == key && !rdoc->hlen) {
+          CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_size_class_hits_stat + ram_cache_size_class(rdoc->len), 1);
+          buf = rbuf;
+          f.doc_from_ram_cache = true;
+          fragment++;
+          doc_pos = rdoc->prefix_len();
+          next_CacheKey(&key, &key);
+          return openReadMain(event, e);
+        }
+      }
+    }
     CACHE_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
     if (!lock) {
       SET_HANDLER(&CacheVC::openReadMain);
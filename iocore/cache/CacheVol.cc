@@ -131,6 +131,16 @@ static char *make_vol_map(Vol *d)
   // Copied from dir_entries_used() and modified to fill in the map instead.
   for (int s = 0; s < d->segments; s++) {
     Dir *seg = dir_segment(s, d);
+    if (d->dir_layout == DIR_LAYOUT_OPEN) {
+      for (int i = 0; i < d->buckets * DIR_DEPTH; i++) {
+        Dir *e = dir_in_seg(seg, i);
+        if (dir_offset(e)) {
+            off_t offset = vol_offset(d, e) - start_offset;
+            if (offset <= vol_len) vol_map[offset / SCAN_BUF_SIZE] = 1;
+        }
+      }
+      continue;
+    }
     for (int b = 0; b < d->buckets; b++) {
       Dir *e = dir_bucket(b, seg);
       if (dir_bucket_loop_fix(e, s, d)) {
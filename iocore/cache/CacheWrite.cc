@@ -1892,6 +1892,10 @@ Lagain:
         mts->vc->dir_off = new_off;
       }
       vol->set_migrate_done(mts);
+      if (!mts->rewrite) {
+        vol->admission.set_promoted(&mts->key);
+        CACHE_INCREMENT_DYN_STAT(cache_ssd_promote_stat);
+      }
     } else
       vol->set_migrate_failed(mts);
 
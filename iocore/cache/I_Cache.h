@@ -49,6 +49,7 @@
 
 #define RAM_CACHE_ALGORITHM_CLFUS        0
 #define RAM_CACHE_ALGORITHM_LRU          1
+#define RAM_CACHE_ALGORITHM_SHARDED      2
 
 #define CACHE_COMPRESSION_NONE           0
 #define CACHE_COMPRESSION_FASTLZ         1
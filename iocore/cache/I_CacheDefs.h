@@ -35,6 +35,7 @@
 
 #define CACHE_DB_MAJOR_VERSION      24
 #define CACHE_DB_MINOR_VERSION      0
+#define CACHE_DB_MINOR_VERSION_OPEN_DIR 1 // open addressed directory buckets
 
 #define CACHE_DIR_MAJOR_VERSION     19
 #define CACHE_DIR_MINOR_VERSION     0
@@ -55,6 +55,7 @@ struct Span
   int64_t offset;                 // used only if (file == true)
   int alignment;
   int disk_id;
+  bool native_aio;              // use kernel AIO for this span ("aio=native")
   LINK(Span, link);
 
 private:
@@ -99,7 +100,7 @@ public:
 
   Span()
     : pathname(NULL), blocks(0), hw_sector_size(DEFAULT_HW_SECTOR_SIZE), file_pathname(false),
-      isRaw(true), offset(0), alignment(0), disk_id(0), is_mmapable_internal(false)
+      isRaw(true), offset(0), alignment(0), disk_id(0), native_aio(false), is_mmapable_internal(false)
   { }
   ~Span();
 };
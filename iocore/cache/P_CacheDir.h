@@ -53,6 +53,18 @@ struct CacheVC;
 #define DIR_OFFSET_MAX                  ((((off_t)1) << DIR_OFFSET_BITS) - 1)
 #define MAX_DOC_SIZE                    ((1<<DIR_SIZE_WIDTH)*(1<<B8K_SHIFT)) // 1MB
 
+// Directory layouts, recorded as the minor version of the volume header.
+// In the open layout the buckets of a segment are grouped by
+// DIR_GROUP_BUCKETS and an entry may use any row of the group of its
+// bucket, so there are no chains and no freelist. Each row has a 16 bit
+// shadow tag (used bit, bucket in the group, dir tag) kept in memory, the
+// shadow tags of a group fill one cache line.
+#define DIR_LAYOUT_CHAINED              0
+#define DIR_LAYOUT_OPEN                 1
+#define DIR_GROUP_BUCKETS               8
+#define DIR_GROUP_SLOTS                 (DIR_GROUP_BUCKETS * DIR_DEPTH)
+#define DIR_TAG_USED                    0x8000
+
 #define SYNC_MAX_WRITE                  (2 * 1024 * 1024)
 #define SYNC_DELAY                      HRTIME_MSECONDS(500)
 #define DO_NOT_REMOVE_THIS              0
@@ -233,6 +245,9 @@ struct FreeDir
 #define dir_set_next(_e, _o) (_e)->w[3] = (uint16_t)(_o)
 #define dir_prev(_e) (_e)->w[2]
 #define dir_set_prev(_e,_o) (_e)->w[2] = (uint16_t)(_o)
+// open layout: the bucket of the entry is kept in place of next
+#define dir_open_bucket(_e) dir_next(_e)
+#define dir_set_open_bucket(_e, _b) dir_set_next(_e, _b)
 
 // INKqa11166 - Cache can not store 2 HTTP alternates simultaneously.
 // To allow this, move the vector from the CacheVC to the OpenDirEntry.
@@ -323,6 +338,9 @@ int dir_segment_accounted(int s, Vol *d, int offby = 0,
 uint64_t dir_entries_used(Vol *d);
 void sync_cache_dir_on_shutdown(bool restart);
 void dir_init_segment(int s, Vol *d);
+void dir_open_build_tags(Vol *d);
+void dir_migrate(Vol *d, int layout);
+uint32_t dir_group_match(const uint16_t *tags, uint16_t t);
 
 // Global Data
 
@@ -123,7 +123,9 @@ enum
   cache_direntries_used_stat,
   cache_ram_cache_hits_stat,
   cache_ram_cache_misses_stat,
-  cache_pread_count_stat,
+  cache_ram_cache_size_class_hits_stat, // one per buffer size index
+  cache_ram_cache_size_class_misses_stat = cache_ram_cache_size_class_hits_stat + DEFAULT_BUFFER_SIZES,
+  cache_pread_count_stat = cache_ram_cache_size_class_misses_stat + DEFAULT_BUFFER_SIZES,
   cache_percent_full_stat,
   cache_lookup_active_stat,
   cache_lookup_success_stat,
@@ -135,6 +137,9 @@ enum
   cache_ssd_read_success_stat,
   cache_sas_read_success_stat,
   cache_ram_read_success_stat,
+  cache_ssd_admission_reject_stat,
+  cache_ssd_promote_stat,
+  cache_ssd_promote_reread_stat,
 #endif
   cache_write_active_stat,
   cache_write_success_stat,
@@ -173,6 +178,14 @@ extern RecRawStatBlock *cache_rsb;
 #define GLOBAL_CACHE_SET_DYN_STAT(x,y) \
 	RecSetGlobalRawStatSum(cache_rsb, (x), (y))
 
+// index of the ram_cache.size_class.* stats for a document of len bytes
+static inline int
+ram_cache_size_class(int64_t len)
+{
+  int64_t i = iobuffer_size_to_index(len, MAX_BUFFER_SIZE_INDEX);
+  return (i < 0 || i > MAX_BUFFER_SIZE_INDEX) ? MAX_BUFFER_SIZE_INDEX : (int) i;
+}
+
 #define CACHE_SET_DYN_STAT(x,y) \
 	RecSetGlobalRawStatSum(cache_rsb, (x), (y)) \
 	RecSetGlobalRawStatSum(vol->cache_vol->vol_rsb, (x), (y))
@@ -219,6 +232,7 @@ extern int cache_config_select_alternate;
 extern int cache_config_vary_on_user_agent;
 extern int cache_config_max_doc_size;
 extern int cache_config_min_average_object_size;
+extern int cache_config_dir_layout;
 extern int cache_config_agg_write_backlog;
 extern int cache_config_enable_checksum;
 extern int cache_config_alt_rewrite_max_size;
@@ -245,6 +259,7 @@ extern int enable_cache_empty_http_doc;
 #ifdef SSD_CACHE
 extern int good_ssd_disks;
 extern int64_t transistor_range_threshold;
+extern int64_t admission_sample_size;
 #endif
 
 struct CacheWriterTable;
@@ -889,11 +904,16 @@ CacheVC::do_read_call(CacheKey *akey)
   f.read_from_ssd = dir_inssd(&dir);
 
   if (!f.read_from_ssd && vio.op == VIO::READ && good_ssd_disks > 0){
-    vol->history.put_key(read_key);
-    if (vol->history.is_hot(read_key) && !vol->migrate_probe(read_key, NULL) && !od) {
-      f.write_into_ssd = 1;
+    vol->admission.put_key(read_key);
+    if (vol->admission.is_hot(read_key)) {
+      if (!vol->migrate_probe(read_key, NULL) && !od)
+        f.write_into_ssd = 1;
+    } else {
+      CACHE_INCREMENT_DYN_STAT(cache_ssd_admission_reject_stat);
     }
   }
+  if (f.read_from_ssd && vio.op == VIO::READ && vol->admission.clear_promoted(read_key))
+    CACHE_INCREMENT_DYN_STAT(cache_ssd_promote_reread_stat);
   if (f.read_from_ssd) {
     ssd_vol = &vol->ssd_vols[dir_get_index(&dir)];
     if (vio.op == VIO::READ && vol_transistor_range_valid(ssd_vol, &dir, transistor_range_threshold) &&
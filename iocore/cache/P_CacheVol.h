@@ -168,163 +168,159 @@ struct EvacuationBlock
 
 #ifdef SSD_CACHE
 
-union AccessEntry {
-  uintptr_t v[2];
-  struct {
-    uint32_t  next;
-    uint32_t  prev;
-    uint32_t  index;
-    uint16_t  tag;
-    int16_t  count;
-  } item;
-};
-
-struct AccessHistory {
-  AccessEntry *base;
-  int size; // 1M
-
-  uint32_t *hash;
-  int hash_size; // 2097143
-
-  AccessEntry *freelist;
+// TinyLFU admission filter for the SSD tier.
+//
+// A doorkeeper bloom filter absorbs the first access of each key so that
+// one-hit wonders never reach the frequency sketch. Further accesses bump
+// a count-min sketch of 4 bit counters (16 per word, conservative update).
+// Every sample_size additions all counters are halved and the doorkeeper
+// is cleared, so the frequencies age and stale objects stop being promoted.
+//
+// The promoted table remembers (by tag) which keys were written into the
+// SSD, the first SSD hit on such a key counts as a useful promotion.
+#define ADMISSION_DEPTH                 4
+#define ADMISSION_DOOR_HASHES           3
+#define ADMISSION_COUNTER_MAX           15
+#define ADMISSION_RESET_MASK            0x7777777777777777ULL
+
+struct AdmissionFilter {
+  uint64_t *table;              // 4 bit counters
+  uint32_t table_mask;          // number of counters - 1
+  uint64_t *door;               // doorkeeper bits
+  uint32_t door_mask;           // number of bits - 1
+  uint32_t *promoted;           // tags of the keys written into the SSD
+  uint32_t promoted_mask;
+  int64_t sample_size;
+  int64_t additions;
+
+  AdmissionFilter()
+    : table(NULL), table_mask(0), door(NULL), door_mask(0), promoted(NULL), promoted_mask(0),
+      sample_size(0), additions(0)
+  { }
 
-  void freeEntry(AccessEntry *entry) {
-    entry->v[0] = (uintptr_t) freelist;
-    entry->v[1] = 0xABCD1234U;
-    freelist = entry;
+  static uint32_t round_up_pow2(int64_t n) {
+    uint32_t v = 64;
+    while (v < n && v < (1U << 30))
+      v <<= 1;
+    return v;
   }
 
-  void init(int size, int hash_size) {
-    this->size = size;
-    this->hash_size = hash_size;
-    freelist = NULL;
+  void init(int64_t a_sample_size) {
+    if (a_sample_size < 1024)
+      a_sample_size = 1024;
+    sample_size = a_sample_size;
+    additions = 0;
 
-    base = (AccessEntry *) malloc(sizeof(AccessEntry) * size);
-    hash = (uint32_t *) malloc (sizeof(uint32_t) * hash_size);
+    uint32_t counters = round_up_pow2(sample_size);
+    table_mask = counters - 1;
+    table = (uint64_t *) ats_malloc(counters / 2);
+    memset(table, 0, counters / 2);
 
-    memset(hash, 0, sizeof(uint32_t) * hash_size);
+    // the doorkeeper holds the distinct keys of one sample, ~1% false positives at 8 bits per key
+    uint32_t bits = round_up_pow2(sample_size * 8);
+    door_mask = bits - 1;
+    door = (uint64_t *) ats_malloc(bits / 8);
+    memset(door, 0, bits / 8);
 
-    base[0].item.next = base[0].item.prev = 0;
-    base[0].v[1] = 0xABCD1234UL;
-    for (int i = size; --i > 0;)
-     freeEntry(&base[i]);
+    uint32_t slots = round_up_pow2(sample_size / 4);
+    promoted_mask = slots - 1;
+    promoted = (uint32_t *) ats_malloc(sizeof(uint32_t) * slots);
+    memset(promoted, 0, sizeof(uint32_t) * slots);
+  }
 
-    return;
+  static inline uint32_t hash_at(INK_MD5 *key, int i) {
+    return key->word(3) + i * (key->word(2) | 1);
   }
 
-  void remove(AccessEntry *entry) {
-    if (entry == &(base[base[0].item.prev])) { // head
-      base[0].item.prev = entry->item.next;
-    } else {
-      base[entry->item.prev].item.next = entry->item.next;
-    }
-    if (entry == &(base[base[0].item.next])) { // tail
-      base[0].item.next = entry->item.prev;
-    } else {
-      base[entry->item.next].item.prev = entry->item.prev;
+  bool door_contains(INK_MD5 *key) {
+    for (int i = 0; i < ADMISSION_DOOR_HASHES; i++) {
+      uint32_t bit = (key->word(1) + i * (key->word(0) | 1)) & door_mask;
+      if (!(door[bit >> 6] & (1ULL << (bit & 63))))
+        return false;
     }
-    uint32_t hash_index = (uint32_t) (entry->item.index % hash_size);
-    hash[hash_index] = 0;
+    return true;
   }
 
-  void enqueue(AccessEntry *entry) {
-    uint32_t hash_index = (uint32_t) (entry->item.index % hash_size);
-    hash[hash_index] = entry - base;
-
-    entry->item.prev = 0;
-    entry->item.next = base[0].item.prev;
-    base[base[0].item.prev].item.prev = entry - base;
-    base[0].item.prev = entry - base;
-    if (base[0].item.next == 0)
-      base[0].item.next = entry - base;
+  // returns true if the key was already present
+  bool door_put(INK_MD5 *key) {
+    bool present = true;
+    for (int i = 0; i < ADMISSION_DOOR_HASHES; i++) {
+      uint32_t bit = (key->word(1) + i * (key->word(0) | 1)) & door_mask;
+      uint64_t m = 1ULL << (bit & 63);
+      if (!(door[bit >> 6] & m)) {
+        door[bit >> 6] |= m;
+        present = false;
+      }
+    }
+    return present;
   }
 
-  AccessEntry* dequeue() {
-    AccessEntry *tail = &base[base[0].item.next];
-    if (tail != base)
-      remove(tail);
-
-    return tail;
+  inline int counter(uint32_t idx) {
+    return (int) ((table[idx >> 4] >> ((idx & 15) << 2)) & 0xF);
   }
 
-  void set_in_progress(INK_MD5 *key) {
-    uint32_t key_index = key->word(3);
-    uint16_t tag = (uint16_t) key->word(1);
-    unsigned int hash_index = (uint32_t) (key_index % hash_size);
-
-    uint32_t index = hash[hash_index];
-    AccessEntry *entry = &base[index];
-    if (index != 0 && entry->item.tag == tag && entry->item.index == key_index) {
-      entry->item.count |= 0x8000;
+  int sketch_estimate(INK_MD5 *key) {
+    int min = ADMISSION_COUNTER_MAX;
+    for (int i = 0; i < ADMISSION_DEPTH; i++) {
+      int c = counter(hash_at(key, i) & table_mask);
+      if (c < min)
+        min = c;
     }
+    return min;
   }
 
-  void set_not_in_progress(INK_MD5 *key) {
-    uint32_t key_index = key->word(3);
-    uint16_t tag = (uint16_t) key->word(1);
-    unsigned int hash_index = (uint32_t) (key_index % hash_size);
-
-    uint32_t index = hash[hash_index];
-    AccessEntry *entry = &base[index];
-    if (index != 0 && entry->item.tag == tag && entry->item.index == key_index) {
-      entry->item.count &= 0x7FFF;
-    }
+  void reset() {
+    for (uint32_t i = 0; i <= table_mask >> 4; i++)
+      table[i] = (table[i] >> 1) & ADMISSION_RESET_MASK;
+    memset(door, 0, (door_mask + 1) / 8);
+    additions /= 2;
   }
 
   void put_key(INK_MD5 *key) {
-    uint32_t key_index = key->word(3);
-    uint16_t tag = (uint16_t) key->word(1);
-    unsigned int hash_index = (uint32_t) (key_index % hash_size);
-
-    uint32_t index = hash[hash_index];
-    AccessEntry *entry = &base[index];
-    if (index != 0 && entry->item.tag == tag && entry->item.index == key_index) { // seen before
-      remove(entry);
-      enqueue(entry);
-      ++entry->item.count;
-    } else {
-      if (index == 0) { // not seen before
-        if (!freelist) {
-          entry = dequeue();
-          if (entry == base) {
-            return;
-          }
-        } else {
-          entry = freelist;
-          freelist = (AccessEntry *) entry->v[0];
+    if (!table)
+      return;
+    if (door_put(key)) {
+      int min = sketch_estimate(key);
+      if (min < ADMISSION_COUNTER_MAX) {
+        for (int i = 0; i < ADMISSION_DEPTH; i++) {
+          uint32_t idx = hash_at(key, i) & table_mask;
+          if (counter(idx) == min)
+            table[idx >> 4] += 1ULL << ((idx & 15) << 2);
         }
-      } else { // collation
-        remove(entry);
       }
-      entry->item.index = key_index;
-      entry->item.tag = tag;
-      entry->item.count = 1;
-      enqueue(entry);
     }
+    if (++additions >= sample_size)
+      reset();
   }
 
-  bool remove_key(INK_MD5 *key) {
-    unsigned int hash_index = (uint32_t) (key->word(3) % hash_size);
-    uint32_t index = hash[hash_index];
-    AccessEntry *entry = &base[index];
-    if (index != 0 && entry->item.tag == (uint16_t)key->word(1) && entry->item.index == key->word(3)) {
-      remove(entry);
-      freeEntry(entry);
-      return true;
-    }
-    return false;
+  // the doorkeeper counts for the first access
+  int estimate(INK_MD5 *key) {
+    if (!table || !door_contains(key))
+      return 0;
+    return sketch_estimate(key) + 1;
   }
 
   bool is_hot(INK_MD5 *key) {
-    uint32_t key_index = key->word(3);
-    uint16_t tag = (uint16_t) key->word(1);
-    unsigned int hash_index = (uint32_t) (key_index % hash_size);
+    int threshold = migrate_threshold;
+    if (threshold > ADMISSION_COUNTER_MAX + 1)
+      threshold = ADMISSION_COUNTER_MAX + 1;
+    return estimate(key) >= threshold;
+  }
 
-    uint32_t index = hash[hash_index];
-    AccessEntry *entry = &base[index];
+  void set_promoted(INK_MD5 *key) {
+    if (promoted)
+      promoted[key->word(2) & promoted_mask] = key->word(1) | 1;
+  }
 
-    return (index != 0 && entry->item.tag == tag && entry->item.index == key_index
-        && entry->item.count >= migrate_threshold);
+  // true on the first ssd hit of a promoted key
+  bool clear_promoted(INK_MD5 *key) {
+    if (!promoted)
+      return false;
+    uint32_t *slot = &promoted[key->word(2) & promoted_mask];
+    if (*slot != (key->word(1) | 1))
+      return false;
+    *slot = 0;
+    return true;
   }
 };
 
@@ -454,6 +450,8 @@ struct Vol: public Continuation
 
   char *raw_dir;
   Dir *dir;
+  int dir_layout;
+  uint16_t *dir_tags;           // shadow tags of the open layout
   VolHeaderFooter *header;
   VolHeaderFooter *footer;
   int segments;
@@ -504,7 +502,7 @@ struct Vol: public Continuation
 #ifdef SSD_CACHE
   int num_ssd_vols;
   SSDVol ssd_vols[8];
-  AccessHistory history;
+  AdmissionFilter admission;
   uint32_t ssd_index;
   Queue<MigrateToSSD, MigrateToSSD::Link_hash_link> mig_hash[MIGRATE_BUCKETS];
   volatile int ssd_done;
@@ -533,7 +531,6 @@ struct Vol: public Continuation
   void set_migrate_done(MigrateToSSD *m) {
     uint32_t indx = m->key.word(3) % MIGRATE_BUCKETS;
     mig_hash[indx].remove(m);
-    history.remove_key(&m->key);
   }
 #endif
 
@@ -610,7 +607,7 @@ struct Vol: public Continuation
 
   Vol()
     : Continuation(new_ProxyMutex()), path(NULL), fd(-1), volume_number(0), dir_shm(false),
-      dir(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
+      dir(0), dir_layout(DIR_LAYOUT_CHAINED), dir_tags(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
       len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), trigger(0),
       evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false),
       dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0) {
@@ -625,6 +622,8 @@ struct Vol: public Continuation
 
   ~Vol() {
     ats_memalign_free(agg_buffer);
+    if (dir_tags)
+      ats_memalign_free(dir_tags);
   }
 };
 
@@ -721,6 +720,18 @@ vol_dir_segment(Vol *d, int s)
   return (Dir *) (((char *) d->dir) + (s * d->buckets) * DIR_DEPTH * SIZEOF_DIR);
 }
 
+TS_INLINE int
+vol_dir_tag_stride(Vol *d)
+{
+  return ((d->buckets + DIR_GROUP_BUCKETS - 1) / DIR_GROUP_BUCKETS) * DIR_GROUP_SLOTS;
+}
+
+TS_INLINE uint16_t *
+vol_dir_tags(Vol *d, int s)
+{
+  return d->dir_tags + (size_t)s * vol_dir_tag_stride(d);
+}
+
 #ifdef SSD_CACHE
 #define vol_out_of_phase_valid(d, e)            \
     (dir_offset(e) - 1 >= ((d->header->agg_pos - d->start) / CACHE_BLOCK_SIZE))
@@ -34,6 +34,13 @@ struct RamCache {
   virtual int get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0) = 0;
   virtual int put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool copy = false, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0) = 0;
   virtual int fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1, uint32_t new_auxkey2) = 0;
+  // lookup by key alone without holding the Vol mutex, for keys which always name the same data
+  // returns 1 on found, 0 on not found or if the implementation needs the Vol mutex
+  virtual int probe(INK_MD5 *key, Ptr<IOBufferData> *ret_data) {
+    NOWARN_UNUSED(key);
+    NOWARN_UNUSED(ret_data);
+    return 0;
+  }
 
   virtual void init(int64_t max_bytes, Vol *vol) = 0;
   virtual ~RamCache() {};
@@ -41,5 +48,6 @@ struct RamCache {
 
 RamCache *new_RamCacheLRU();
 RamCache *new_RamCacheCLFUS();
+RamCache *new_RamCacheSharded();
 
 #endif /* _P_RAM_CACHE_H__ */
@@ -0,0 +1,563 @@
+/** @file
+
+  Sharded, scan resistant RAM cache with background compression
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+// The entries are spread over independently locked shards, so a get or a
+// put only holds the lock of one shard and the compressor never takes the
+// Vol mutex. Fragment reads probe by key alone before taking the Vol
+// mutex, so RAM cache hits on the body of a document never wait for the
+// volume. Each shard is a segmented LRU: new entries go to the probation
+// segment and move to the protected segment on their first hit, so a scan
+// only replaces probation entries. Probation entries are compressed by a
+// task thread, protected entries are kept uncompressed so that repeated
+// hits never decompress.
+
+#include "P_Cache.h"
+#include "I_Tasks.h"
+#if TS_HAS_LIBZ
+#include <zlib.h>
+#endif
+#if TS_HAS_LZMA
+#include <lzma.h>
+#endif
+
+#define RAM_CACHE_MAX_SHARDS 64
+#define RAM_CACHE_MIN_SHARD_BYTES (64 * 1024 * 1024)
+#define PROTECTED_PERCENT 80  // max share of the protected segment
+#define REQUIRED_COMPRESSION 0.9 // must get to this size or declared incompressible
+#define ENTRY_OVERHEAD 256 // per-entry overhead to consider when computing cache size
+#define COMPRESS_BATCH 32 // entries compressed per shard and tick
+#define COMPRESS_PERIOD HRTIME_MSECONDS(100)
+#define LZMA_BASE_MEMLIMIT (64 * 1024 * 1024)
+
+struct RamCacheShardedEntry {
+  INK_MD5 key;
+  uint32_t auxkey1;
+  uint32_t auxkey2;
+  uint32_t size; // memory used including paddding in buffer
+  uint32_t len;  // actual data length
+  uint32_t compressed_len;
+  union {
+    struct {
+      uint32_t compressed:3; // compression type
+      uint32_t incompressible:1;
+      uint32_t hot:1; // in the protected segment
+      uint32_t copy:1; // copy-in-copy-out
+      uint32_t pending:1; // in the compress queue
+    } flag_bits;
+    uint32_t flags;
+  };
+  LINK(RamCacheShardedEntry, lru_link);
+  LINK(RamCacheShardedEntry, hash_link);
+  LINK(RamCacheShardedEntry, compress_link);
+  Ptr<IOBufferData> data;
+};
+
+struct RamCacheShard {
+  ink_mutex lock;
+  int64_t max_bytes;
+  int64_t bytes;
+  int64_t hot_bytes;
+  int64_t objects;
+  int ibuckets;
+  int nbuckets;
+  DList(RamCacheShardedEntry, hash_link) *bucket;
+  Que(RamCacheShardedEntry, lru_link) lru[2]; // probation, protected
+  Que(RamCacheShardedEntry, compress_link) pending;
+  uint16_t *seen;
+};
+
+struct RamCacheSharded : public RamCache {
+  int64_t max_bytes;
+
+  // returns 1 on found/stored, 0 on not found/stored, if provided auxkey1 and auxkey2 must match
+  int get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0);
+  int put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool copy = false, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0);
+  int fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1, uint32_t new_auxkey2);
+  int probe(INK_MD5 *key, Ptr<IOBufferData> *ret_data);
+
+  void init(int64_t max_bytes, Vol *vol);
+
+  // private
+  Vol *vol; // for stats
+  int nshards;
+  RamCacheShard *shards;
+
+  RamCacheShard *get_shard(INK_MD5 *key) { return shards + (key->word(2) & (nshards - 1)); }
+  RamCacheShardedEntry *find(RamCacheShard *s, INK_MD5 *key, uint32_t auxkey1, uint32_t auxkey2, bool any_aux = false);
+  int lookup(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1, uint32_t auxkey2, bool any_aux);
+  void resize_hashtable(RamCacheShard *s);
+  void destroy(RamCacheShard *s, RamCacheShardedEntry *e);
+  void promote(RamCacheShard *s, RamCacheShardedEntry *e);
+  void set_data(RamCacheShard *s, RamCacheShardedEntry *e, IOBufferData *data, uint32_t size);
+  void queue_compress(RamCacheShard *s, RamCacheShardedEntry *e);
+  void compress_entries(RamCacheShard *s);
+  RamCacheSharded(): max_bytes(0), vol(0), nshards(0), shards(0) { }
+};
+
+ClassAllocator<RamCacheShardedEntry> ramCacheShardedEntryAllocator("RamCacheShardedEntry");
+
+static const int bucket_sizes[] = {
+  127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139,
+  524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859,
+  134217689, 268435399, 536870909, 1073741789, 2147483647
+};
+
+static IOBufferData *copy_data(const char *data, uint32_t len) {
+  char *b = (char*)ats_malloc(len);
+  memcpy(b, data, len);
+  IOBufferData *d = new_xmalloc_IOBufferData(b, len);
+  d->_mem_type = DEFAULT_ALLOC;
+  return d;
+}
+
+// returns the compressed length, 0 on failure
+static uint32_t compress_buffer(int ctype, const char *data, uint32_t len, char **ret) {
+  uint32_t l = 0;
+  switch (ctype) {
+    default: return 0;
+    case CACHE_COMPRESSION_FASTLZ:
+      if (len < 16)
+        return 0;
+      l = (uint32_t)((double)len * 1.05 + 66);
+      break;
+#if TS_HAS_LIBZ
+    case CACHE_COMPRESSION_LIBZ: l = (uint32_t)compressBound(len); break;
+#endif
+#if TS_HAS_LZMA
+    case CACHE_COMPRESSION_LIBLZMA: l = len; break;
+#endif
+  }
+  char *b = (char*)ats_malloc(l);
+  switch (ctype) {
+    case CACHE_COMPRESSION_FASTLZ: {
+      int ll = fastlz_compress(data, len, b);
+      l = ll > 0 ? (uint32_t)ll : 0;
+      break;
+    }
+#if TS_HAS_LIBZ
+    case CACHE_COMPRESSION_LIBZ: {
+      uLongf ll = l;
+      l = (Z_OK == compress((Bytef*)b, &ll, (Bytef*)data, len)) ? (uint32_t)ll : 0;
+      break;
+    }
+#endif
+#if TS_HAS_LZMA
+    case CACHE_COMPRESSION_LIBLZMA: {
+      size_t pos = 0;
+      l = (LZMA_OK == lzma_easy_buffer_encode(LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE, NULL,
+                                              (uint8_t*)data, len, (uint8_t*)b, &pos, l)) ? (uint32_t)pos : 0;
+      break;
+    }
+#endif
+  }
+  if (!l) {
+    ats_free(b);
+    return 0;
+  }
+  *ret = b;
+  return l;
+}
+
+static bool decompress_buffer(int ctype, const char *data, uint32_t compressed_len, char *b, uint32_t len) {
+  switch (ctype) {
+    default: return false;
+    case CACHE_COMPRESSION_FASTLZ:
+      return (int)len == fastlz_decompress(data, compressed_len, b, len);
+#if TS_HAS_LIBZ
+    case CACHE_COMPRESSION_LIBZ: {
+      uLongf l = len;
+      return Z_OK == uncompress((Bytef*)b, &l, (Bytef*)data, compressed_len) && l == len;
+    }
+#endif
+#if TS_HAS_LZMA
+    case CACHE_COMPRESSION_LIBLZMA: {
+      size_t ipos = 0, opos = 0;
+      uint64_t memlimit = len * 2 + LZMA_BASE_MEMLIMIT;
+      return LZMA_OK == lzma_stream_buffer_decode(&memlimit, 0, NULL, (uint8_t*)data, &ipos, compressed_len,
+                                                  (uint8_t*)b, &opos, len);
+    }
+#endif
+  }
+}
+
+void RamCacheSharded::resize_hashtable(RamCacheShard *s) {
+  int anbuckets = bucket_sizes[s->ibuckets];
+  DDebug("ram_cache", "resize hashtable %d", anbuckets);
+  int64_t size = anbuckets * sizeof(DList(RamCacheShardedEntry, hash_link));
+  DList(RamCacheShardedEntry, hash_link) *new_bucket = (DList(RamCacheShardedEntry, hash_link) *)ats_malloc(size);
+  memset(new_bucket, 0, size);
+  if (s->bucket) {
+    for (int64_t i = 0; i < s->nbuckets; i++) {
+      RamCacheShardedEntry *e = 0;
+      while ((e = s->bucket[i].pop()))
+        new_bucket[e->key.word(3) % anbuckets].push(e);
+    }
+    ats_free(s->bucket);
+  }
+  s->bucket = new_bucket;
+  s->nbuckets = anbuckets;
+  ats_free(s->seen);
+  s->seen = 0;
+  if (cache_config_ram_cache_use_seen_filter) {
+    size = anbuckets * sizeof(uint16_t);
+    s->seen = (uint16_t*)ats_malloc(size);
+    memset(s->seen, 0, size);
+  }
+}
+
+void RamCacheSharded::init(int64_t abytes, Vol *avol) {
+  vol = avol;
+  max_bytes = abytes;
+  DDebug("ram_cache", "initializing ram_cache %" PRId64 " bytes", abytes);
+  if (!max_bytes)
+    return;
+  nshards = 1;
+  while (nshards < RAM_CACHE_MAX_SHARDS && max_bytes / (nshards * 2) >= RAM_CACHE_MIN_SHARD_BYTES)
+    nshards <<= 1;
+  shards = new RamCacheShard[nshards];
+  for (int i = 0; i < nshards; i++) {
+    RamCacheShard *s = shards + i;
+    ink_mutex_init(&s->lock, "RamCacheShard");
+    s->max_bytes = max_bytes / nshards;
+    s->bytes = s->hot_bytes = s->objects = 0;
+    s->ibuckets = 0;
+    s->nbuckets = 0;
+    s->bucket = 0;
+    s->seen = 0;
+    resize_hashtable(s);
+  }
+  Debug("ram_cache", "ram_cache %" PRId64 " bytes in %d shards", max_bytes, nshards);
+}
+
+RamCacheShardedEntry *RamCacheSharded::find(RamCacheShard *s, INK_MD5 *key, uint32_t auxkey1, uint32_t auxkey2, bool any_aux) {
+  RamCacheShardedEntry *e = s->bucket[key->word(3) % s->nbuckets].head;
+  while (e) {
+    if (e->key == *key && (any_aux || (e->auxkey1 == auxkey1 && e->auxkey2 == auxkey2)))
+      return e;
+    e = e->hash_link.next;
+  }
+  return NULL;
+}
+
+void RamCacheSharded::destroy(RamCacheShard *s, RamCacheShardedEntry *e) {
+  s->lru[e->flag_bits.hot].remove(e);
+  if (e->flag_bits.pending)
+    s->pending.remove(e);
+  if (e->flag_bits.hot)
+    s->hot_bytes -= e->size + ENTRY_OVERHEAD;
+  s->bytes -= e->size + ENTRY_OVERHEAD;
+  s->objects--;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_bytes_stat, -e->size);
+  s->bucket[e->key.word(3) % s->nbuckets].remove(e);
+  DDebug("ram_cache", "put %X %d %d size %d DESTROYED", e->key.word(3), e->auxkey1, e->auxkey2, e->size);
+  e->data = NULL;
+  THREAD_FREE(e, ramCacheShardedEntryAllocator, this_ethread());
+}
+
+// replace the data of an entry, the size accounting follows
+void RamCacheSharded::set_data(RamCacheShard *s, RamCacheShardedEntry *e, IOBufferData *data, uint32_t size) {
+  int64_t delta = ((int64_t)size) - (int64_t)e->size;
+  s->bytes += delta;
+  if (e->flag_bits.hot)
+    s->hot_bytes += delta;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_bytes_stat, delta);
+  e->size = size;
+  e->data = data;
+}
+
+// queue a probation entry for the compressor unless it is known not to shrink
+void RamCacheSharded::queue_compress(RamCacheShard *s, RamCacheShardedEntry *e) {
+  if (!e->flag_bits.pending && !e->flag_bits.compressed && !e->flag_bits.incompressible &&
+      cache_config_ram_cache_compress && cache_config_ram_cache_compress_percent) {
+    e->flag_bits.pending = 1;
+    s->pending.enqueue(e);
+  }
+}
+
+// move a probation entry to the protected segment, the oldest protected
+// entries go back to probation when the protected segment is full
+void RamCacheSharded::promote(RamCacheShard *s, RamCacheShardedEntry *e) {
+  s->lru[0].remove(e);
+  if (e->flag_bits.pending) {
+    s->pending.remove(e);
+    e->flag_bits.pending = 0;
+  }
+  e->flag_bits.hot = 1;
+  s->hot_bytes += e->size + ENTRY_OVERHEAD;
+  s->lru[1].enqueue(e);
+  int64_t hot_max = s->max_bytes / 100 * PROTECTED_PERCENT;
+  RamCacheShardedEntry *d = 0;
+  while (s->hot_bytes > hot_max && (d = s->lru[1].head) != e) {
+    s->lru[1].remove(d);
+    d->flag_bits.hot = 0;
+    s->hot_bytes -= d->size + ENTRY_OVERHEAD;
+    s->lru[0].enqueue(d);
+    queue_compress(s, d);
+  }
+}
+
+int RamCacheSharded::get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1, uint32_t auxkey2) {
+  return lookup(key, ret_data, auxkey1, auxkey2, false);
+}
+
+// key only lookup, called without the Vol mutex for fragment keys which
+// are never reused for different data
+int RamCacheSharded::probe(INK_MD5 *key, Ptr<IOBufferData> *ret_data) {
+  return lookup(key, ret_data, 0, 0, true);
+}
+
+int RamCacheSharded::lookup(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1, uint32_t auxkey2, bool any_aux) {
+  if (!max_bytes)
+    return 0;
+  RamCacheShard *s = get_shard(key);
+  ink_mutex_acquire(&s->lock);
+  RamCacheShardedEntry *e = find(s, key, auxkey1, auxkey2, any_aux);
+  if (!e) {
+    ink_mutex_release(&s->lock);
+    DDebug("ram_cache", "get %X %d %d MISS", key->word(3), auxkey1, auxkey2);
+    if (!any_aux) { // a failed probe is followed by a get
+      CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_misses_stat, 1);
+    }
+    return 0;
+  }
+  if (!e->flag_bits.hot)
+    promote(s, e);
+  else {
+    s->lru[1].remove(e);
+    s->lru[1].enqueue(e);
+  }
+  Ptr<IOBufferData> data = e->data;
+  uint32_t len = e->len;
+  uint32_t compressed_len = e->compressed_len;
+  int ctype = e->flag_bits.compressed;
+  bool copy = e->flag_bits.copy;
+  ink_mutex_release(&s->lock);
+
+  // copy and decompress without the lock
+  if (ctype) {
+    char *b = (char*)ats_malloc(len);
+    if (!decompress_buffer(ctype, data->data(), compressed_len, b, len)) {
+      ats_free(b);
+      ink_mutex_acquire(&s->lock);
+      if ((e = find(s, key, auxkey1, auxkey2, any_aux)) && e->data == data)
+        destroy(s, e);
+      ink_mutex_release(&s->lock);
+      DDebug("ram_cache", "get %X %d %d Z_ERR", key->word(3), auxkey1, auxkey2);
+      if (!any_aux) {
+        CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_misses_stat, 1);
+      }
+      return 0;
+    }
+    IOBufferData *udata = new_xmalloc_IOBufferData(b, len);
+    udata->_mem_type = DEFAULT_ALLOC;
+    if (!copy) { // don't bother if we have to copy anyway
+      ink_mutex_acquire(&s->lock);
+      if ((e = find(s, key, auxkey1, auxkey2, any_aux)) && e->data == data) {
+        set_data(s, e, udata, len);
+        e->flag_bits.compressed = 0;
+      }
+      ink_mutex_release(&s->lock);
+    }
+    (*ret_data) = udata;
+  } else if (copy) {
+    IOBufferData *cdata = new_IOBufferData(iobuffer_size_to_index(len, MAX_BUFFER_SIZE_INDEX), MEMALIGNED);
+    memcpy(cdata->data(), data->data(), len);
+    (*ret_data) = cdata;
+  } else
+    (*ret_data) = data;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_hits_stat, 1);
+  DDebug("ram_cache", "get %X %d %d len %d HIT", key->word(3), auxkey1, auxkey2, len);
+  return 1;
+}
+
+int RamCacheSharded::put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool copy, uint32_t auxkey1, uint32_t auxkey2) {
+  if (!max_bytes)
+    return 0;
+  uint32_t size = copy ? len : data->block_size();
+  RamCacheShard *s = get_shard(key);
+  if (size + ENTRY_OVERHEAD > s->max_bytes)
+    return 0;
+  // copy before taking the lock
+  Ptr<IOBufferData> edata = copy ? copy_data(data->data(), len) : data;
+  ink_mutex_acquire(&s->lock);
+  uint32_t i = key->word(3) % s->nbuckets;
+  RamCacheShardedEntry *e = s->bucket[i].head;
+  while (e) {
+    if (e->key == *key) {
+      if (e->auxkey1 == auxkey1 && e->auxkey2 == auxkey2)
+        break;
+      RamCacheShardedEntry *next = e->hash_link.next;
+      destroy(s, e); // discard when aux keys conflict
+      e = next;
+      continue;
+    }
+    e = e->hash_link.next;
+  }
+  if (e) { // already in cache, refresh the data and reset it like a fresh insert
+    s->lru[e->flag_bits.hot].remove(e);
+    s->lru[e->flag_bits.hot].enqueue(e);
+    if (e->flag_bits.pending) {
+      s->pending.remove(e);
+      e->flag_bits.pending = 0;
+    }
+    set_data(s, e, edata, size);
+    e->len = len;
+    e->compressed_len = 0;
+    e->flag_bits.copy = copy;
+    e->flag_bits.compressed = 0;
+    e->flag_bits.incompressible = 0;
+    if (!e->flag_bits.hot)
+      queue_compress(s, e);
+    ink_mutex_release(&s->lock);
+    DDebug("ram_cache", "put %X %d %d size %d HIT", key->word(3), auxkey1, auxkey2, size);
+    return 1;
+  }
+  if (s->bytes + size + ENTRY_OVERHEAD > s->max_bytes) {
+    if (s->seen) {
+      uint16_t k = key->word(3) >> 16;
+      uint16_t kk = s->seen[i];
+      s->seen[i] = k;
+      if (kk != k) {
+        ink_mutex_release(&s->lock);
+        DDebug("ram_cache", "put %X %d %d size %d UNSEEN", key->word(3), auxkey1, auxkey2, size);
+        return 0;
+      }
+    }
+    // evict probation first, a scan never reaches the protected segment
+    while (s->bytes + size + ENTRY_OVERHEAD > s->max_bytes) {
+      RamCacheShardedEntry *victim = s->lru[0].head ? s->lru[0].head : s->lru[1].head;
+      if (!victim)
+        break;
+      destroy(s, victim);
+    }
+  }
+  e = THREAD_ALLOC(ramCacheShardedEntryAllocator, this_ethread());
+  e->key = *key;
+  e->auxkey1 = auxkey1;
+  e->auxkey2 = auxkey2;
+  e->flags = 0;
+  e->flag_bits.copy = copy;
+  e->len = len;
+  e->size = size;
+  e->compressed_len = 0;
+  e->data = edata;
+  s->bucket[i].push(e);
+  s->lru[0].enqueue(e);
+  queue_compress(s, e);
+  s->bytes += size + ENTRY_OVERHEAD;
+  s->objects++;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_bytes_stat, size);
+  if (s->objects > s->nbuckets) {
+    ++s->ibuckets;
+    resize_hashtable(s);
+  }
+  ink_mutex_release(&s->lock);
+  DDebug("ram_cache", "put %X %d %d size %d INSERTED", key->word(3), auxkey1, auxkey2, size);
+  return 1;
+}
+
+int RamCacheSharded::fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1, uint32_t new_auxkey2) {
+  if (!max_bytes)
+    return 0;
+  RamCacheShard *s = get_shard(key);
+  ink_mutex_acquire(&s->lock);
+  RamCacheShardedEntry *e = find(s, key, old_auxkey1, old_auxkey2);
+  if (e) {
+    e->auxkey1 = new_auxkey1;
+    e->auxkey2 = new_auxkey2;
+  }
+  ink_mutex_release(&s->lock);
+  return e ? 1 : 0;
+}
+
+void RamCacheSharded::compress_entries(RamCacheShard *s) {
+  int ctype = cache_config_ram_cache_compress;
+  for (int n = 0; n < COMPRESS_BATCH; n++) {
+    ink_mutex_acquire(&s->lock);
+    RamCacheShardedEntry *e = s->pending.dequeue();
+    if (!e) {
+      ink_mutex_release(&s->lock);
+      return;
+    }
+    e->flag_bits.pending = 0;
+    if (e->flag_bits.hot || e->flag_bits.compressed || e->flag_bits.incompressible) {
+      ink_mutex_release(&s->lock);
+      continue;
+    }
+    // store transient data for lock release
+    Ptr<IOBufferData> edata = e->data;
+    uint32_t elen = e->len;
+    uint32_t auxkey1 = e->auxkey1, auxkey2 = e->auxkey2;
+    INK_MD5 key = e->key;
+    ink_mutex_release(&s->lock);
+
+    char *b = 0;
+    uint32_t l = compress_buffer(ctype, edata->data(), elen, &b);
+
+    ink_mutex_acquire(&s->lock);
+    // see if the entry is still around, unchanged and still on probation
+    e = find(s, &key, auxkey1, auxkey2);
+    if (!e || e->data != edata || e->flag_bits.hot || e->flag_bits.compressed || e->flag_bits.incompressible) {
+      ink_mutex_release(&s->lock);
+      ats_free(b);
+      continue;
+    }
+    if (!l || l > REQUIRED_COMPRESSION * elen) {
+      e->flag_bits.incompressible = 1;
+      ats_free(b);
+    } else {
+      IOBufferData *cdata = new_xmalloc_IOBufferData(b, l);
+      cdata->_mem_type = DEFAULT_ALLOC;
+      set_data(s, e, cdata, l);
+      e->compressed_len = l;
+      e->flag_bits.compressed = ctype;
+    }
+    DDebug("ram_cache", "compress %X %d %d %d %d %d %d", key.word(3), auxkey1, auxkey2,
+           e->flag_bits.incompressible, e->flag_bits.compressed, elen, l);
+    ink_mutex_release(&s->lock);
+  }
+}
+
+class RamCacheShardedCompressor : public Continuation { public:
+  RamCacheSharded *rc;
+  int mainEvent(int event, Event *e);
+  RamCacheShardedCompressor(RamCacheSharded *arc): Continuation(NULL), rc(arc) {
+    SET_HANDLER(&RamCacheShardedCompressor::mainEvent);
+  }
+};
+
+int RamCacheShardedCompressor::mainEvent(int event, Event *e) {
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(e);
+  if (!cache_config_ram_cache_compress || !cache_config_ram_cache_compress_percent)
+    return EVENT_CONT;
+  for (int i = 0; i < rc->nshards; i++)
+    rc->compress_entries(rc->shards + i);
+  return EVENT_CONT;
+}
+
+RamCache *new_RamCacheSharded() {
+  RamCacheSharded *r = new RamCacheSharded;
+  eventProcessor.schedule_every(new RamCacheShardedCompressor(r), COMPRESS_PERIOD, ET_TASK);
+  return r;
+}
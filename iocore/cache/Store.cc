@@ -292,20 +292,36 @@ Store::read_config(int fd)
 
     char *e = strpbrk(n, " \t\n");
     int len = e ? e - n : strlen(n);
-    (void) len;
     int64_t size = -1;
-    while (e && *e && !ParseRules::is_digit(*e))
-      e++;
-    if (e && *e) {
-      if ((size = ink_atoi64(e)) <= 0) {
-        err = "error parsing size";
-        goto Lfail;
+    bool native_aio = false;
+
+    // the path may be followed by a size and by the AIO mode of the span,
+    // "aio=native" or "aio=thread", in either order
+    while (e && *e) {
+      e += strspn(e, " \t\n");
+      if (!*e)
+        break;
+      char *opt = e;
+      int opt_len = (e = strpbrk(e, " \t\n")) ? e - opt : strlen(opt);
+      if (opt_len >= 4 && !strncasecmp(opt, "aio=", 4)) {
+        if (opt_len == 10 && !strncasecmp(opt + 4, "native", 6))
+          native_aio = true;
+        else if (opt_len != 10 || strncasecmp(opt + 4, "thread", 6)) {
+          err = "error parsing aio mode";
+          goto Lfail;
+        }
+      } else if (ParseRules::is_digit(*opt)) {
+        if ((size = ink_atoi64(opt)) <= 0) {
+          err = "error parsing size";
+          goto Lfail;
+        }
       }
     }
 
     n[len] = 0;
     char *pp = Layout::get()->relative(n);
     ns = NEW(new Span);
+    ns->native_aio = native_aio;
     Debug("cache_init", "Store::read_config - ns = NEW (new Span); ns->init(\"%s\",%" PRId64 ")", pp, size);
     if ((err = ns->init(pp, size))) {
       char buf[4096];
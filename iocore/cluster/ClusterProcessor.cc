@@ -832,6 +832,12 @@ ClusterProcessor::init()
   IOCORE_EstablishStaticConfigInt32(cluster_send_max_wait_time, "proxy.config.cluster.flow_ctrl.max_send_wait_time");
   IOCORE_EstablishStaticConfigInt32(cluster_min_loop_interval, "proxy.config.cluster.flow_ctrl.min_loop_interval");
   IOCORE_EstablishStaticConfigInt32(cluster_max_loop_interval, "proxy.config.cluster.flow_ctrl.max_loop_interval");
+  IOCORE_EstablishStaticConfigInt32(cluster_busy_poll_time, "proxy.config.cluster.busy_poll_time");
+  IOCORE_EstablishStaticConfigInt32(cluster_zerocopy_min_bytes, "proxy.config.cluster.zerocopy_min_bytes");
+  IOCORE_EstablishStaticConfigInt32(cluster_send_quantum, "proxy.config.cluster.send_quantum");
+  IOCORE_EstablishStaticConfigInt32(cluster_send_weights[PRIORITY_HIGH], "proxy.config.cluster.send_weight.control");
+  IOCORE_EstablishStaticConfigInt32(cluster_send_weights[PRIORITY_MID], "proxy.config.cluster.send_weight.lookup");
+  IOCORE_EstablishStaticConfigInt32(cluster_send_weights[PRIORITY_LOW], "proxy.config.cluster.send_weight.data");
 
   int cluster_type = 0;
   IOCORE_ReadConfigInteger(cluster_type, "proxy.local.cluster.type");
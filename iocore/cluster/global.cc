@@ -23,6 +23,10 @@ int cluster_send_min_wait_time = 1000; //us
 int cluster_send_max_wait_time = 5000; //us
 int cluster_min_loop_interval = 0;     //us
 int cluster_max_loop_interval = 1000;  //us
+int cluster_busy_poll_time = 50;       //us, 0 for disable
+int cluster_zerocopy_min_bytes = 16 * 1024;  //0 for disable
+int cluster_send_quantum = 16 * 1024;  //bytes
+int cluster_send_weights[PRIORITY_COUNT] = {8, 4, 1};  //control, lookup, data
 int64_t cluster_ping_send_interval= 0;
 int64_t cluster_ping_latency_threshold = 0;
 int cluster_ping_retries = 3;
@@ -28,6 +28,10 @@ extern int cluster_send_min_wait_time; //us
 extern int cluster_send_max_wait_time; //us
 extern int cluster_min_loop_interval;  //us
 extern int cluster_max_loop_interval;  //us
+extern int cluster_busy_poll_time;     //us
+extern int cluster_zerocopy_min_bytes;
+extern int cluster_send_quantum;  //bytes
+extern int cluster_send_weights[PRIORITY_COUNT];
 extern int64_t cluster_ping_send_interval;
 extern int64_t cluster_ping_latency_threshold;
 extern int cluster_ping_retries;
@@ -12,6 +12,7 @@
 #include <fcntl.h>
 #include <sys/epoll.h>
 #include <sys/prctl.h>
+#include <sys/uio.h>
 #include "Diags.h"
 #include "global.h"
 #include "shared_func.h"
@@ -30,6 +31,11 @@
 #include "ink_config.h"
 #include "nio.h"
 
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#include <linux/errqueue.h>
+#define USE_MSG_ZEROCOPY 1
+#endif
+
 int g_worker_thread_count = 0;
 static int read_buffer_size = 2 * 1024 * 1024;
 
@@ -61,8 +67,15 @@ struct NIORecords {
   RecRecord * max_usleep_time_used;
   RecRecord * max_callback_time_used;
 #endif
+
+  RecRecord * send_latency_count[PRIORITY_COUNT];
+  RecRecord * send_latency_time[PRIORITY_COUNT];
+  RecRecord * send_latency[PRIORITY_COUNT][SEND_LATENCY_BUCKETS];
 };
 
+//the message classes, index by priority
+static const char *send_class_names[PRIORITY_COUNT] = {"control", "lookup", "data"};
+
 static NIORecords nio_records = {NULL, NULL, NULL, NULL, NULL, NULL, NULL
 #ifdef DEBUG
   , NULL, NULL, NULL, NULL, NULL
@@ -82,6 +95,35 @@ static volatile int64_t max_callback_time_used = 0;
 
 volatile int64_t cluster_current_out_bps = 0;
 
+static ClassAllocator<ZeroCopyEntry> zeroCopyEntryAllocator("zeroCopyEntryAllocator");
+
+inline static void stat_send_latency(SocketStats *stats,
+    const int priority, const int64_t time_used)
+{
+  int index;
+  int64_t bound;
+
+  index = 0;
+  bound = SEND_LATENCY_MIN_BOUND * HRTIME_USECOND;
+  while (index < SEND_LATENCY_BUCKETS - 1 && time_used >= bound) {
+    bound <<= 1;
+    index++;
+  }
+  stats->send_latency[priority][index]++;
+  stats->send_latency_count[priority]++;
+  stats->send_latency_time[priority] += time_used;
+}
+
+inline static void free_zerocopy_entry(ZeroCopyEntry *entry)
+{
+  int i;
+  for (i=0; i<entry->block_count; i++) {
+    entry->blocks[i] = NULL;
+  }
+  entry->staging = NULL;
+  zeroCopyEntryAllocator.free(entry);
+}
+
 inline int get_iovec(IOBufferBlock *blocks, IOVec *iovec, int size) {
   int niov;
   IOBufferBlock *b = blocks;
@@ -115,6 +157,8 @@ inline void consume(OutMessage *pMessage, int64_t l) {
 static void init_nio_stats()
 {
   RecData data_default;
+  char name[128];
+  int i, k;
   memset(&data_default, 0, sizeof(RecData));
 
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.send_msg_count", 0, RECP_NON_PERSISTENT);
@@ -130,6 +174,10 @@ static void init_nio_stats()
 
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.call_writev_count", 0, RECP_NON_PERSISTENT);
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.call_read_count", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.send_copied_bytes", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.send_zerocopy_bytes", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.zerocopy_send_count", 0, RECP_NON_PERSISTENT);
+  RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.loop_busy_poll_count", 0, RECP_NON_PERSISTENT);
 
   nio_records.send_retry_count = RecRegisterStat(RECT_PROCESS,
       "proxy.process.cluster.io.send_retry_count", RECD_INT, data_default, RECP_NON_PERSISTENT);
@@ -155,6 +203,30 @@ static void init_nio_stats()
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.fail_msg_count", 0, RECP_NON_PERSISTENT);
   RecRegisterStatInt(RECT_PROCESS, "proxy.process.cluster.io.fail_msg_bytes", 0, RECP_NON_PERSISTENT);
 
+  for (i=0; i<PRIORITY_COUNT; i++) {
+    snprintf(name, sizeof(name), "proxy.process.cluster.io.send_latency.%s.count",
+        send_class_names[i]);
+    nio_records.send_latency_count[i] = RecRegisterStat(RECT_PROCESS,
+        name, RECD_INT, data_default, RECP_NON_PERSISTENT);
+    snprintf(name, sizeof(name), "proxy.process.cluster.io.send_latency.%s.time_used",
+        send_class_names[i]);
+    nio_records.send_latency_time[i] = RecRegisterStat(RECT_PROCESS,
+        name, RECD_INT, data_default, RECP_NON_PERSISTENT);
+
+    for (k=0; k<SEND_LATENCY_BUCKETS; k++) {
+      if (k < SEND_LATENCY_BUCKETS - 1) {
+        snprintf(name, sizeof(name), "proxy.process.cluster.io.send_latency.%s.lt_%dus",
+            send_class_names[i], SEND_LATENCY_MIN_BOUND << k);
+      }
+      else {
+        snprintf(name, sizeof(name), "proxy.process.cluster.io.send_latency.%s.inf",
+            send_class_names[i]);
+      }
+      nio_records.send_latency[i][k] = RecRegisterStat(RECT_PROCESS,
+          name, RECD_INT, data_default, RECP_NON_PERSISTENT);
+    }
+  }
+
 #ifdef DEBUG
   nio_records.max_write_loop_time_used = RecRegisterStat(RECT_PROCESS,
       "proxy.process.cluster.io.max_write_loop_time_used", RECD_INT, data_default, RECP_NON_PERSISTENT);
@@ -174,14 +246,23 @@ void log_nio_stats()
   RecData data;
 	struct worker_thread_context *pThreadContext;
 	struct worker_thread_context *pContextEnd;
-  SocketStats sum = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  SocketStats sum;
+  int i, k;
   static time_t last_calc_bps_time = CURRENT_TIME();
   static int64_t last_send_bytes = 0;
 
+  memset(&sum, 0, sizeof(sum));
 	pContextEnd = g_worker_thread_contexts + g_work_threads;
 	for (pThreadContext=g_worker_thread_contexts; pThreadContext<pContextEnd;
       pThreadContext++)
 	{
+    for (i=0; i<PRIORITY_COUNT; i++) {
+      sum.send_latency_count[i] += pThreadContext->stats.send_latency_count[i];
+      sum.send_latency_time[i] += pThreadContext->stats.send_latency_time[i];
+      for (k=0; k<SEND_LATENCY_BUCKETS; k++) {
+        sum.send_latency[i][k] += pThreadContext->stats.send_latency[i][k];
+      }
+    }
     sum.send_msg_count += pThreadContext->stats.send_msg_count;
     sum.drop_msg_count += pThreadContext->stats.drop_msg_count;
     sum.send_bytes += pThreadContext->stats.send_bytes;
@@ -199,6 +280,10 @@ void log_nio_stats()
     sum.epoll_wait_time_used += pThreadContext->stats.epoll_wait_time_used;
     sum.loop_usleep_count += pThreadContext->stats.loop_usleep_count;
     sum.loop_usleep_time += pThreadContext->stats.loop_usleep_time;
+    sum.loop_busy_poll_count += pThreadContext->stats.loop_busy_poll_count;
+    sum.send_copied_bytes += pThreadContext->stats.send_copied_bytes;
+    sum.send_zerocopy_bytes += pThreadContext->stats.send_zerocopy_bytes;
+    sum.zerocopy_send_count += pThreadContext->stats.zerocopy_send_count;
     sum.ping_total_count += pThreadContext->stats.ping_total_count;
     sum.ping_success_count += pThreadContext->stats.ping_success_count;
     sum.ping_time_used += pThreadContext->stats.ping_time_used;
@@ -249,6 +334,14 @@ void log_nio_stats()
   RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.call_writev_count", RECD_INT, &data, NULL);
   data.rec_int = sum.call_read_count;
   RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.call_read_count", RECD_INT, &data, NULL);
+  data.rec_int = sum.send_copied_bytes;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.send_copied_bytes", RECD_INT, &data, NULL);
+  data.rec_int = sum.send_zerocopy_bytes;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.send_zerocopy_bytes", RECD_INT, &data, NULL);
+  data.rec_int = sum.zerocopy_send_count;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.zerocopy_send_count", RECD_INT, &data, NULL);
+  data.rec_int = sum.loop_busy_poll_count;
+  RecSetRecord(RECT_PROCESS, "proxy.process.cluster.io.loop_busy_poll_count", RECD_INT, &data, NULL);
 
   RecDataSetFromInk64(RECD_INT, &nio_records.send_retry_count->data,
         sum.send_retry_count);
@@ -261,6 +354,17 @@ void log_nio_stats()
   RecDataSetFromInk64(RECD_INT, &nio_records.loop_usleep_time->data,
         sum.loop_usleep_time);
 
+  for (i=0; i<PRIORITY_COUNT; i++) {
+    RecDataSetFromInk64(RECD_INT, &nio_records.send_latency_count[i]->data,
+        sum.send_latency_count[i]);
+    RecDataSetFromInk64(RECD_INT, &nio_records.send_latency_time[i]->data,
+        sum.send_latency_time[i]);
+    for (k=0; k<SEND_LATENCY_BUCKETS; k++) {
+      RecDataSetFromInk64(RECD_INT, &nio_records.send_latency[i][k]->data,
+          sum.send_latency[i][k]);
+    }
+  }
+
 #ifdef DEBUG
   RecDataSetFromInk64(RECD_INT, &nio_records.max_write_loop_time_used->data,
         max_write_loop_time_used);
@@ -549,6 +653,9 @@ int nio_add_to_epoll(SocketContext *pSockContext)
   clear_send_queue(pSockContext, true);
 
   pSockContext->queue_index = 0;
+  pSockContext->drr_index = 0;
+  pSockContext->quantum_added = false;
+  memset(pSockContext->deficits, 0, sizeof(pSockContext->deficits));
   pSockContext->ping_start_time = 0;
   pSockContext->ping_fail_count = 0;
   pSockContext->next_write_time = CURRENT_NS() + send_wait_time;
@@ -557,6 +664,15 @@ int nio_add_to_epoll(SocketContext *pSockContext)
   INIT_READER(pSockContext->reader, read_buffer_size);
   pSockContext->reader.recv_body_bytes = 0;
 
+  pSockContext->zc_next_seq = 0;
+  pSockContext->zc_head = pSockContext->zc_tail = NULL;
+#ifdef USE_MSG_ZEROCOPY
+  pSockContext->zerocopy = cluster_zerocopy_min_bytes > 0 &&
+    tcpsetzerocopy(pSockContext->sock) == 0;
+#else
+  pSockContext->zerocopy = false;
+#endif
+
   set_socket_rw_buff_size(pSockContext->sock);
   init_machine_sessions(pSockContext->machine, false);
   add_machine_sock_context(pSockContext);
@@ -590,6 +706,92 @@ static void pack_header(OutMessage *msg, char *buff)
 }
 */
 
+#ifdef USE_MSG_ZEROCOPY
+static void release_zerocopy_entries(SocketContext *pSockContext,
+    const uint32_t lo, const uint32_t hi, const bool copied)
+{
+  ZeroCopyEntry *entry;
+  ZeroCopyEntry *previous;
+  ZeroCopyEntry *next;
+
+  previous = NULL;
+  entry = pSockContext->zc_head;
+  while (entry != NULL) {
+    next = entry->next;
+    if (entry->seq - lo > hi - lo) {  //not in [lo, hi]
+      previous = entry;
+      entry = next;
+      continue;
+    }
+
+    if (copied) {  //the kernel fell back to copy
+      pSockContext->thread_context->stats.send_copied_bytes += entry->data_bytes;
+    }
+    else {
+      pSockContext->thread_context->stats.send_zerocopy_bytes += entry->data_bytes;
+    }
+
+    if (previous == NULL) {
+      pSockContext->zc_head = next;
+    }
+    else {
+      previous->next = next;
+    }
+    if (pSockContext->zc_tail == entry) {
+      pSockContext->zc_tail = previous;
+    }
+    free_zerocopy_entry(entry);
+    entry = next;
+  }
+}
+
+/* the completion notify of MSG_ZEROCOPY sends come from the error queue,
+ * the IOBufferBlocks of a send are released only after its notify */
+static void reap_zerocopy_completions(SocketContext *pSockContext)
+{
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  struct sock_extended_err *serr;
+  char control[128];
+
+  while (true) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(pSockContext->sock, &msg, MSG_ERRQUEUE) < 0) {
+      break;  //EAGAIN, nothing to reap
+    }
+
+    for (cmsg=CMSG_FIRSTHDR(&msg); cmsg!=NULL; cmsg=CMSG_NXTHDR(&msg, cmsg)) {
+      if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+      {
+        continue;
+      }
+
+      serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      release_zerocopy_entries(pSockContext, serr->ee_info, serr->ee_data,
+          (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+    }
+  }
+}
+#endif
+
+static void clear_zerocopy_entries(SocketContext *pSockContext)
+{
+  ZeroCopyEntry *entry;
+
+  while (pSockContext->zc_head != NULL) {
+    entry = pSockContext->zc_head;
+    pSockContext->zc_head = entry->next;
+    free_zerocopy_entry(entry);
+  }
+  pSockContext->zc_tail = NULL;
+}
+
 static void clear_send_queue(SocketContext * pSockContext, const bool warning)
 {
   int i;
@@ -653,6 +855,7 @@ static int close_socket(SocketContext * pSockContext)
   pSockContext->reader.blocks = NULL;
   pSockContext->reader.buffer = NULL;
 
+  clear_zerocopy_entries(pSockContext);
   clear_send_queue(pSockContext, false);
   notify_connection_closed(pSockContext);
 
@@ -702,10 +905,14 @@ static int deal_write_event(SocketContext * pSockContext)
   } msgs[PRIORITY_COUNT];
 
 	OutMessage *msg;
+  ZeroCopyEntry *zc_entry;
+  int64_t object_bytes;
   int write_bytes;
   int remain_len;
+  int msg_bytes;
+  int start_bytes;
+  int64_t time_used;
   int priority;
-  int start;
   int total_msg_count;
 	int vec_count;
 	int total_bytes;
@@ -715,33 +922,68 @@ static int deal_write_event(SocketContext * pSockContext)
   bool fetch_done;
   bool last_msg_complete;
 
+  OutMessage *tails[PRIORITY_COUNT];  //the last fetched message of each queue
+  int deficits[PRIORITY_COUNT];
+  int needs[PRIORITY_COUNT];
+  int unsent_bytes[PRIORITY_COUNT];
+  int drr_index;
+  int visits;
+  bool quantum_added;
+  bool head_only;
+  bool waiting;
+  bool progress;
+
 	msgs[0].msg_count = msgs[1].msg_count = msgs[2].msg_count = 0;
   total_msg_count = 0;
 	vec_count = 0;
 	total_bytes = 0;
+  object_bytes = 0;
 
-  priority = pSockContext->queue_index;
-  if (pSockContext->queue_index == 0) {
-    start = 1;  //only loop 3 times
-  }
-  else {
-    start = 0;  //need loop 4 times
+  /* deficit round robin over the message classes: a visit adds
+   * weight * quantum bytes to the deficit of the class and fetches the
+   * messages which fit into it. the deficits are local until the write,
+   * the bytes which are not written are given back after it. */
+  for (i=0; i<PRIORITY_COUNT; i++) {
+    tails[i] = NULL;
+    deficits[i] = pSockContext->deficits[i];
+    needs[i] = 0;
   }
+  drr_index = pSockContext->drr_index;
+  quantum_added = pSockContext->quantum_added;
+
+  //the head message of queue_index may be partly sent, messages can't be
+  //interleaved on the wire so it goes first whatever its deficit is
+  priority = pSockContext->queue_index;
+  head_only = true;
+  visits = 0;
+  waiting = progress = false;
 
   last_msg_complete = false;
   fetch_done = false;
-  for (i=start; i<=PRIORITY_COUNT; i++) {
+  while (true) {
     send_queue = pSockContext->send_queues + priority;
     pthread_mutex_lock(&send_queue->lock);
-    msg = send_queue->head;
-    if (pSockContext->queue_index > 0 &&
-        i == pSockContext->queue_index + 1)
-    {
-      if (msg != NULL) {
-        msg = msg->next;  //should skip to next for the first already consumed
+    msg = (tails[priority] == NULL) ? send_queue->head : tails[priority]->next;
+    if (head_only) {
+      if (msg != NULL && msg->bytes_sent == 0) {
+        msg = NULL;
       }
     }
+    else if (msg != NULL && !quantum_added) {
+      deficits[priority] += cluster_send_quantum * cluster_send_weights[priority];
+      quantum_added = true;
+    }
+
     while (msg != NULL) {
+      msg_bytes = (MSG_HEADER_LENGTH + msg->header.aligned_data_len) -
+        msg->bytes_sent;
+      if (!head_only && msg_bytes > deficits[priority]) {
+        needs[priority] = msg_bytes - deficits[priority];
+        break;
+      }
+      start_bytes = total_bytes;
+      progress = true;
+
       if (msg->bytes_sent < MSG_HEADER_LENGTH) {  //should send header
         write_vec[vec_count].iov_base = ((char *)&msg->header) +
           msg->bytes_sent;
@@ -783,6 +1025,7 @@ static int deal_write_event(SocketContext * pSockContext)
             //assert(read_bytes <= remain_data_len);
 
             total_bytes += read_bytes;
+            object_bytes += read_bytes;
             last_msg_complete = read_bytes == remain_data_len;
           }
           else {
@@ -817,7 +1060,9 @@ static int deal_write_event(SocketContext * pSockContext)
       }
 
       msgs[priority].send_msgs[msgs[priority].msg_count++] = msg;
+      tails[priority] = msg;
       total_msg_count++;
+      deficits[priority] -= total_bytes - start_bytes;
 
       /*
       Debug(CLUSTER_DEBUG_TAG, "file: " __FILE__ ", line: %d, "
@@ -835,7 +1080,7 @@ static int deal_write_event(SocketContext * pSockContext)
         fetch_done = true;
         break;
       }
-      if (i == 0) {  //fetch only one, the head message
+      if (head_only) {  //fetch only one, the head message
         break;
       }
       msg = msg->next;
@@ -846,12 +1091,58 @@ static int deal_write_event(SocketContext * pSockContext)
       break;
     }
 
-    if (i == 0) {
-      priority = 0;  //next should start from first priority
+    if (head_only) {
+      head_only = false;
+      priority = drr_index;
+      continue;
+    }
+
+    if (msg == NULL) {  //queue empty, the deficit does not accumulate
+      deficits[priority] = 0;
     }
     else {
-      priority++;
+      waiting = true;
+    }
+
+    drr_index = (drr_index + 1) % PRIORITY_COUNT;
+    priority = drr_index;
+    quantum_added = false;
+    if (++visits % PRIORITY_COUNT != 0) {
+      continue;
+    }
+
+    //end of a round
+    if (!waiting) {
+      break;
+    }
+    if (!progress) {
+      //skip the rounds which can't fetch any message
+      int rounds;
+      int quantum;
+
+      rounds = INT_MAX;
+      for (i=0; i<PRIORITY_COUNT; i++) {
+        quantum = cluster_send_quantum * cluster_send_weights[i];
+        if (needs[i] > 0 && quantum > 0 &&
+            (needs[i] + quantum - 1) / quantum < rounds)
+        {
+          rounds = (needs[i] + quantum - 1) / quantum;
+        }
+      }
+      if (rounds == INT_MAX) {  //all the weights are 0
+        break;
+      }
+      for (i=0; i<PRIORITY_COUNT; i++) {
+        if (needs[i] > 0) {
+          deficits[i] += (rounds - 1) * cluster_send_quantum *
+            cluster_send_weights[i];
+        }
+      }
     }
+    for (i=0; i<PRIORITY_COUNT; i++) {
+      needs[i] = 0;
+    }
+    waiting = progress = false;
   }
 
   /*
@@ -868,7 +1159,62 @@ static int deal_write_event(SocketContext * pSockContext)
 
   pSockContext->thread_context->stats.send_retry_count += total_msg_count;
   pSockContext->thread_context->stats.call_writev_count++;
+#define IS_OBJECT_VEC(vi) (msg_indexes[vi].buff_type == BUFF_TYPE_DATA && \
+    msgs[msg_indexes[vi].priority].send_msgs[msg_indexes[vi].index]-> \
+    data_type == DATA_TYPE_OBJECT)
+
+  zc_entry = NULL;
+#ifdef USE_MSG_ZEROCOPY
+  if (pSockContext->zerocopy && object_bytes >= cluster_zerocopy_min_bytes) {
+    struct msghdr mh;
+    int staging_bytes;
+    char *p;
+
+    //the kernel reads the iovecs after sendmsg returns, so the headers
+    //and the mini messages, which are released on done, are staged into
+    //a buffer held with the IOBufferBlocks until the completion notify
+    staging_bytes = 0;
+    for (k=0; k<vec_count; k++) {
+      if (!(IS_OBJECT_VEC(k) || msg_indexes[k].buff_type == BUFF_TYPE_PADDING)) {
+        staging_bytes += write_vec[k].iov_len;
+      }
+    }
+
+    zc_entry = zeroCopyEntryAllocator.alloc();
+    zc_entry->data_bytes = 0;
+    zc_entry->block_count = 0;
+    if (staging_bytes > 0) {
+      zc_entry->staging = new_RecvBuffer(staging_bytes);
+      p = zc_entry->staging->_data;
+      for (k=0; k<vec_count; k++) {
+        if (!(IS_OBJECT_VEC(k) || msg_indexes[k].buff_type == BUFF_TYPE_PADDING)) {
+          memcpy(p, write_vec[k].iov_base, write_vec[k].iov_len);
+          write_vec[k].iov_base = p;
+          p += write_vec[k].iov_len;
+        }
+      }
+    }
+
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = write_vec;
+    mh.msg_iovlen = vec_count;
+    write_bytes = sendmsg(pSockContext->sock, &mh, MSG_ZEROCOPY);
+    if (write_bytes < 0 && errno == ENOBUFS) {  //optmem limit, copy this time
+      free_zerocopy_entry(zc_entry);
+      zc_entry = NULL;
+      write_bytes = writev(pSockContext->sock, write_vec, vec_count);
+    }
+    else if (write_bytes <= 0) {
+      free_zerocopy_entry(zc_entry);
+      zc_entry = NULL;
+    }
+  }
+  else {
+    write_bytes = writev(pSockContext->sock, write_vec, vec_count);
+  }
+#else
 	write_bytes = writev(pSockContext->sock, write_vec, vec_count);
+#endif
 	if (write_bytes == 0) {   //connection closed
 		Debug(CLUSTER_DEBUG_TAG, "file: "__FILE__", line: %d, "
 			"write to %s fail, connection closed",
@@ -897,6 +1243,69 @@ static int deal_write_event(SocketContext * pSockContext)
 	}
 
   pSockContext->thread_context->stats.send_bytes += write_bytes;
+
+  //charge the classes for the bytes written only
+  for (i=0; i<PRIORITY_COUNT; i++) {
+    unsent_bytes[i] = 0;
+  }
+  remain_len = write_bytes;
+  for (k=0; k<vec_count; k++) {
+    if (remain_len >= (int)write_vec[k].iov_len) {
+      remain_len -= write_vec[k].iov_len;
+    }
+    else {
+      unsent_bytes[msg_indexes[k].priority] += write_vec[k].iov_len - remain_len;
+      remain_len = 0;
+    }
+  }
+  for (i=0; i<PRIORITY_COUNT; i++) {
+    pSockContext->deficits[i] = deficits[i] + unsent_bytes[i];
+  }
+  pSockContext->drr_index = drr_index;
+  pSockContext->quantum_added = quantum_added;
+
+  if (zc_entry == NULL) {
+    pSockContext->thread_context->stats.send_copied_bytes += write_bytes;
+  }
+  else {
+    int remain_bytes;
+    int bytes;
+
+    remain_bytes = write_bytes;
+    for (k=0; k<vec_count && remain_bytes > 0; k++) {
+      bytes = (int)write_vec[k].iov_len < remain_bytes ?
+        (int)write_vec[k].iov_len : remain_bytes;
+      if (IS_OBJECT_VEC(k)) {
+        zc_entry->data_bytes += bytes;
+      }
+      remain_bytes -= bytes;
+    }
+
+    //hold the blocks before consume() and release_out_message() drop them
+    for (i=0; i<PRIORITY_COUNT; i++) {
+      for (k=0; k<msgs[i].msg_count; k++) {
+        msg = msgs[i].send_msgs[k];
+        if (msg->data_type == DATA_TYPE_OBJECT && msg->blocks != NULL) {
+          zc_entry->blocks[zc_entry->block_count++] = msg->blocks;
+        }
+      }
+    }
+
+    zc_entry->seq = pSockContext->zc_next_seq++;
+    zc_entry->next = NULL;
+    if (pSockContext->zc_tail == NULL) {
+      pSockContext->zc_head = zc_entry;
+    }
+    else {
+      pSockContext->zc_tail->next = zc_entry;
+    }
+    pSockContext->zc_tail = zc_entry;
+
+    pSockContext->thread_context->stats.zerocopy_send_count++;
+    pSockContext->thread_context->stats.send_copied_bytes +=
+      write_bytes - zc_entry->data_bytes;
+  }
+
   if (write_bytes == total_bytes && fetch_done) {  //send done and have more message to send
     result = 0;
   }
@@ -1027,8 +1436,9 @@ static int deal_write_event(SocketContext * pSockContext)
           msgs[i].pDoneMsgs[k]->bytes_sent);
       */
 
-      pSockContext->thread_context->stats.send_delayed_time +=
-        CURRENT_NS() - msg->in_queue_time;
+      time_used = CURRENT_NS() - msg->in_queue_time;
+      pSockContext->thread_context->stats.send_delayed_time += time_used;
+      stat_send_latency(&pSockContext->thread_context->stats, i, time_used);
       release_out_message(pSockContext, msg);
     }
   }
@@ -1424,6 +1834,23 @@ inline static void deal_epoll_events(struct worker_thread_context *
         pSockContext->sock, pEvent->events);
     */
 
+#ifdef USE_MSG_ZEROCOPY
+    if ((pEvent->events & EPOLLERR) && pSockContext->zerocopy) {
+      //the zerocopy completion notify raises EPOLLERR too
+      int sock_error;
+      socklen_t len;
+
+      reap_zerocopy_completions(pSockContext);
+      sock_error = 0;
+      len = sizeof(sock_error);
+      if (getsockopt(pSockContext->sock, SOL_SOCKET, SO_ERROR,
+            &sock_error, &len) == 0 && sock_error == 0)
+      {
+        pEvent->events &= ~EPOLLERR;
+      }
+    }
+#endif
+
     if ((pEvent->events & EPOLLRDHUP) || (pEvent->events & EPOLLERR) ||
         (pEvent->events & EPOLLHUP))
     {
@@ -1464,6 +1891,12 @@ inline static void schedule_sock_write(struct worker_thread_context * pThreadCon
   for (ppSockContext = pThreadContext->active_sockets;
       ppSockContext < ppContextEnd; ppSockContext++)
   {
+#ifdef USE_MSG_ZEROCOPY
+    if ((*ppSockContext)->zc_head != NULL) {
+      reap_zerocopy_completions(*ppSockContext);
+    }
+#endif
+
     if (current_time < (*ppSockContext)->next_write_time) {
       continue;
     }
@@ -1580,6 +2013,8 @@ static void *work_thread_entrance(void* arg)
   int remain_time;
   int64_t loop_start_time;
   int64_t deal_start_time;
+  int64_t send_bytes;
+  int64_t busy_poll_end_time;
 #ifdef DEBUG
   int64_t deal_end_time;
   int64_t time_used;
@@ -1587,6 +2022,7 @@ static void *work_thread_entrance(void* arg)
 	struct worker_thread_context *pThreadContext;
 
 	pThreadContext = (struct worker_thread_context *)arg;
+  busy_poll_end_time = 0;
 
 #if defined(HAVE_SYS_PRCTL_H) && defined(PR_SET_NAME)
   char name[32];
@@ -1611,6 +2047,7 @@ static void *work_thread_entrance(void* arg)
     deal_start_time = loop_start_time;
 #endif
 
+    send_bytes = pThreadContext->stats.send_bytes;
     schedule_sock_write(pThreadContext);
 
 #ifdef DEBUG
@@ -1620,9 +2057,11 @@ static void *work_thread_entrance(void* arg)
 #ifndef DEBUG
     deal_start_time = CURRENT_NS();
 #endif
+    //do NOT block in epoll_wait while busy polling
     pThreadContext->stats.epoll_wait_count++;
 		count = epoll_wait(pThreadContext->epoll_fd,
-			pThreadContext->events, pThreadContext->alloc_size, 1);
+			pThreadContext->events, pThreadContext->alloc_size,
+      loop_start_time < busy_poll_end_time ? 0 : 1);
 
     pThreadContext->stats.epoll_wait_time_used += CURRENT_NS() - deal_start_time;
 #ifdef DEBUG
@@ -1647,6 +2086,18 @@ static void *work_thread_entrance(void* arg)
 #endif
     }
 
+    //keep spinning for cluster_busy_poll_time after the last IO, the
+    //threads sleep between the loops only when the connections are idle
+    if (cluster_busy_poll_time > 0) {
+      if (count > 0 || pThreadContext->stats.send_bytes != send_bytes) {
+        busy_poll_end_time = CURRENT_NS() + cluster_busy_poll_time * HRTIME_USECOND;
+      }
+      if (CURRENT_NS() < busy_poll_end_time) {
+        pThreadContext->stats.loop_busy_poll_count++;
+        continue;
+      }
+    }
+
     if (io_loop_interval > MIN_USLEEP_TIME) {
       remain_time = io_loop_interval - (int)((CURRENT_NS() -
           loop_start_time) / HRTIME_USECOND);
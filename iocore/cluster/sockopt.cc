@@ -1224,6 +1224,24 @@ int tcpsetserveropt(int fd, const int timeout)
 	return 0;
 }
 
+int tcpsetzerocopy(int fd)
+{
+#ifdef SO_ZEROCOPY
+	int flags;
+
+	flags = 1;
+	if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, \
+		(char *)&flags, sizeof(flags)) < 0)
+	{
+		return errno != 0 ? errno : ENOTSUP;
+	}
+
+	return 0;
+#else
+	return ENOTSUP;
+#endif
+}
+
 int tcpsetkeepalive(int fd, const int idleSeconds)
 {
 	int keepAlive;
@@ -164,6 +164,13 @@ int tcpsetnonblockopt(int fd);
 */
 int tcpsetnodelay(int fd);
 
+/** enable MSG_ZEROCOPY send on the socket
+ *  parameters:
+ *          sock: the socket
+ *  return: error no, 0 success, != 0 fail, ENOTSUP when not supported
+*/
+int tcpsetzerocopy(int fd);
+
 /** set socket keep-alive
  *  parameters:
  *          sock: the socket
@@ -15,6 +15,11 @@
 
 #define PRIORITY_COUNT      3   //priority queue count
 
+//send latency histogram: bucket i counts the messages sent in less than
+//(SEND_LATENCY_MIN_BOUND << i) us, the last bucket counts the others
+#define SEND_LATENCY_BUCKETS    16
+#define SEND_LATENCY_MIN_BOUND  64
+
 //statistic marco defines
 //#define TRIGGER_STAT_FLAG  1  //trigger statistic flag
 //#define MSG_TIME_STAT_FLAG 1  //data statistic flag
@@ -116,6 +121,15 @@ typedef struct out_msg_entry {
   int64_t in_queue_time; //the time when push to send queue
 } OutMessage;
 
+typedef struct zerocopy_entry {
+  uint32_t seq;      //MSG_ZEROCOPY send sequence no, base 0
+  int data_bytes;    //object bytes sent without copy
+  int block_count;
+  Ptr<IOBufferData> staging;  //copy of the headers and mini messages
+  Ptr<IOBufferBlock> blocks[WRITEV_ITEM_ONCE];  //hold until completion
+  struct zerocopy_entry *next;
+} ZeroCopyEntry;
+
 typedef struct read_manager {
   Ptr<IOBufferData> buffer; //recv buffer
   Ptr<IOBufferBlock> blocks;    //recv blocks
@@ -142,6 +156,9 @@ typedef struct socket_context {
   MessageQueue send_queues[PRIORITY_COUNT];  //queue for send
 
   int queue_index;  //current deal queue index
+  int drr_index;    //the queue visited by the deficit round robin
+  bool quantum_added;  //the quantum of drr_index already added
+  int deficits[PRIORITY_COUNT];  //deficit bytes of each queue
   int connect_type;       //client or server
   time_t connected_time;  //connection established timestamp
   uint32_t version;    //avoid CAS ABA
@@ -151,6 +168,11 @@ typedef struct socket_context {
   int64_t next_write_time; //next time to send data
   int64_t ping_start_time;
 
+  bool zerocopy;           //SO_ZEROCOPY enabled
+  uint32_t zc_next_seq;    //sequence no of the next MSG_ZEROCOPY send
+  ZeroCopyEntry *zc_head;  //sends waiting for the completion notify
+  ZeroCopyEntry *zc_tail;
+
 #ifdef USE_MULTI_ALLOCATOR
   Allocator *out_msg_allocator;  //for send
   Allocator *in_msg_allocator;   //for notify dealer
@@ -185,10 +207,20 @@ struct SocketStats {
   int64_t epoll_wait_time_used;
   int64_t loop_usleep_count;
   int64_t loop_usleep_time;
+  int64_t loop_busy_poll_count;
+
+  int64_t send_copied_bytes;    //copied into the socket buffer
+  int64_t send_zerocopy_bytes;  //sent from the IOBufferBlocks directly
+  int64_t zerocopy_send_count;  //MSG_ZEROCOPY send count
 
   int64_t ping_total_count;
   int64_t ping_success_count;
   int64_t ping_time_used;
+
+  //per message class (priority), time from push to send done
+  int64_t send_latency_count[PRIORITY_COUNT];
+  int64_t send_latency_time[PRIORITY_COUNT];
+  int64_t send_latency[PRIORITY_COUNT][SEND_LATENCY_BUCKETS];
 };
 
 struct worker_thread_context
@@ -30,13 +30,57 @@
 
 #include "P_EventSystem.h"
 
+enum IOBuffer_Stats
+{
+  iobuffer_huge_page_bytes_stat,
+  iobuffer_huge_page_fallback_bytes_stat,
+  IOBuffer_Stat_Count
+};
+
+static RecRawStatBlock *iobuffer_rsb = NULL;
+
+static int
+iobuffer_huge_page_stats_cb(const char *name, RecDataT data_type, RecData *data, RecRawStatBlock *rsb, int id)
+{
+  if (id == iobuffer_huge_page_bytes_stat)
+    RecSetGlobalRawStatSum(rsb, id, ink_huge_page_bytes);
+  else
+    RecSetGlobalRawStatSum(rsb, id, ink_huge_page_fallback_bytes);
+  return RecRawStatSyncSum(name, data_type, data, rsb, id);
+}
+
 void
 ink_event_system_init(ModuleVersion v)
 {
   ink_release_assert(!checkModuleVersion(v, EVENT_SYSTEM_MODULE_VERSION));
   int config_max_iobuffer_size = DEFAULT_MAX_BUFFER_SIZE;
+  int huge_pages = INK_HUGE_PAGES_OFF;
+  int huge_pages_arena_mb = 0;
+#if !TS_USE_RECLAIMABLE_FREELIST
+  int thread_magazines = 1;
+#endif
 
   IOCORE_ReadConfigInteger(config_max_iobuffer_size, "proxy.config.io.max_buffer_size");
+  IOCORE_ReadConfigInteger(huge_pages, "proxy.config.iobuffer.huge_pages");
+  IOCORE_ReadConfigInteger(huge_pages_arena_mb, "proxy.config.iobuffer.huge_pages_arena_mb");
+
+#if !TS_USE_RECLAIMABLE_FREELIST
+  // before the event threads start allocating
+  IOCORE_ReadConfigInteger(thread_magazines, "proxy.config.allocator.thread_magazines");
+  if (!thread_magazines)
+    ink_freelists_thread_magazines(0);
+#endif
+
+  // before init_buffer_allocators(), which asks for them
+  if (huge_pages != INK_HUGE_PAGES_OFF) {
+    huge_pages = ink_huge_pages_init(huge_pages, (int64_t) huge_pages_arena_mb * 1024 * 1024);
+    iobuffer_rsb = RecAllocateRawStatBlock((int) IOBuffer_Stat_Count);
+    RecRegisterRawStat(iobuffer_rsb, RECT_PROCESS, "proxy.process.iobuffer.huge_page_bytes",
+                       RECD_INT, RECP_NON_PERSISTENT, (int) iobuffer_huge_page_bytes_stat, iobuffer_huge_page_stats_cb);
+    RecRegisterRawStat(iobuffer_rsb, RECT_PROCESS, "proxy.process.iobuffer.huge_page_fallback_bytes",
+                       RECD_INT, RECP_NON_PERSISTENT, (int) iobuffer_huge_page_fallback_bytes_stat,
+                       iobuffer_huge_page_stats_cb);
+  }
 
   max_iobuffer_size = buffer_size_to_index(config_max_iobuffer_size, DEFAULT_BUFFER_SIZES - 1);
   if (default_small_iobuffer_size > max_iobuffer_size)
@@ -68,6 +68,14 @@ init_buffer_allocators()
     name = NEW(new char[64]);
     snprintf(name, 64, "ramBufAllocator[%d]", i);
     ramBufAllocator[i].re_init(name, s, n, a);
+
+    // the data of the 4K and larger buffers, the RAM cache included, goes
+    // on huge pages if proxy.config.iobuffer.huge_pages is set
+    if (i >= BUFFER_SIZE_INDEX_4K) {
+      ioBufAllocator[i].use_huge_pages();
+      cacheBufAllocator[i].use_huge_pages();
+      ramBufAllocator[i].use_huge_pages();
+    }
   }
 }
 
@@ -275,6 +275,7 @@ public:
   ProxyAllocator openDirEntryAllocator;
   ProxyAllocator ramCacheCLFUSEntryAllocator;
   ProxyAllocator ramCacheLRUEntryAllocator;
+  ProxyAllocator ramCacheShardedEntryAllocator;
   ProxyAllocator evacuationBlockAllocator;
   ProxyAllocator ioDataAllocator;
   ProxyAllocator ioBlockAllocator;
@@ -318,6 +319,8 @@ public:
 
   int id;
   unsigned int event_types;
+  int affinity_cpu;             // first cpu the thread is bound to, or -1
+  int numa_node;                // node of the freelists the thread uses
   bool is_event_type(EventType et);
   void set_event_type(EventType et);
 #if defined(USE_OLD_EVENTFD)
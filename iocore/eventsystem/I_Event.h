@@ -85,6 +85,7 @@
 #define BLOCK_CACHE_EVENT_EVENTS_START            4000
 #define UTILS_EVENT_EVENTS_START                  5000
 #define CONGESTION_EVENT_EVENTS_START             5100
+#define HEALTHCHECK_EVENTS_START                  5200
 #define CLUSTER_MSG_START                         6000
 #define INK_API_EVENT_EVENTS_START                60000
 #define SRV_EVENT_EVENTS_START	                  62000
@@ -212,7 +213,7 @@ public:
   unsigned int in_the_priority_queue:1;
   unsigned int immediate:1;
   unsigned int globally_allocated:1;
-  unsigned int in_heap:4;
+  unsigned int in_heap:12;
   int callback_event;
 
   ink_hrtime timeout_at;
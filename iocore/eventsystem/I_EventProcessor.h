@@ -300,6 +300,14 @@ public:
   */
   int n_thread_groups;
 
+  /**
+    Placement of the event threads, one of the INK_AFFINITY values
+    of proxy.config.exec_thread.affinity. Thread i is bound to the
+    i-th object of that type, round robin.
+
+  */
+  int thread_affinity;
+
 private:
   // prevent unauthorized copies (Not implemented)
     EventProcessor(const EventProcessor &);
@@ -28,9 +28,21 @@
 #include "I_Event.h"
 
 
-// <5ms, 10, 20, 40, 80, 160, 320, 640, 1280, 2560, 5120
-#define N_PQ_LIST        10
-#define PQ_BUCKET_TIME(_i) (HRTIME_MSECONDS(5) << (_i))
+// Hierarchical timing wheel of 5ms ticks. Level 0 has a slot per tick
+// (1.28s), each higher level a slot per turn of the level below (327s,
+// 23h, 248d). An event sits on the lowest level whose turn contains its
+// tick, and moves down a level when the turn of its slot begins. Events
+// beyond the turn of the last level wait on an overflow list, which is
+// placed again on each step of the last level.
+#define PQ_TICK            HRTIME_MSECONDS(5)
+#define PQ_WHEEL_BITS      8
+#define PQ_WHEEL_SIZE      (1 << PQ_WHEEL_BITS)
+#define PQ_WHEEL_MASK      (PQ_WHEEL_SIZE - 1)
+#define PQ_WHEEL_LEVELS    4
+// list 0 holds the ready events, the wheel slots and the overflow follow
+#define PQ_SLOT(_level, _i) (1 + ((_level) << PQ_WHEEL_BITS) + (_i))
+#define PQ_OVERFLOW        PQ_SLOT(PQ_WHEEL_LEVELS, 0)
+#define N_PQ_LIST          (PQ_OVERFLOW + 1)
 
 class EThread;
 
@@ -39,51 +51,25 @@ struct PriorityEventQueue
 
   Que(Event, link) after[N_PQ_LIST];
   ink_hrtime last_check_time;
-  uint32_t last_check_buckets;
+  uint64_t last_check_tick;
+  int n_in_wheel;
 
   void enqueue(Event * e, ink_hrtime now)
   {
-    ink_hrtime t = e->timeout_at - now;
+    (void) now;
+    uint64_t tick = (uint64_t) e->timeout_at / PQ_TICK;
     int i = 0;
-    // equivalent but faster
-    if (t <= PQ_BUCKET_TIME(3))
-    {
-      if (t <= PQ_BUCKET_TIME(1)) {
-        if (t <= PQ_BUCKET_TIME(0)) {
-          i = 0;
-        } else
-        {
-          i = 1;
-        }
-      } else {
-        if (t <= PQ_BUCKET_TIME(2)) {
-          i = 2;
-        } else {
-          i = 3;
-        }
-      }
-    } else {
-      if (t <= PQ_BUCKET_TIME(7)) {
-        if (t <= PQ_BUCKET_TIME(5)) {
-          if (t <= PQ_BUCKET_TIME(4)) {
-            i = 4;
-          } else {
-            i = 5;
-          }
-        } else {
-          if (t <= PQ_BUCKET_TIME(6)) {
-            i = 6;
-          } else {
-            i = 7;
-          }
-        }
-      } else {
-        if (t <= PQ_BUCKET_TIME(8)) {
-          i = 8;
-        } else {
-          i = 9;
-        }
-      }
+    if (tick > last_check_tick) {
+      int level = 0;
+      while (level < PQ_WHEEL_LEVELS - 1 &&
+             (tick >> (PQ_WHEEL_BITS * (level + 1))) != (last_check_tick >> (PQ_WHEEL_BITS * (level + 1))))
+        level++;
+      if (level == PQ_WHEEL_LEVELS - 1 &&
+          (tick >> (PQ_WHEEL_BITS * PQ_WHEEL_LEVELS)) != (last_check_tick >> (PQ_WHEEL_BITS * PQ_WHEEL_LEVELS)))
+        i = PQ_OVERFLOW;
+      else
+        i = PQ_SLOT(level, (tick >> (PQ_WHEEL_BITS * level)) & PQ_WHEEL_MASK);
+      n_in_wheel++;
     }
     e->in_the_priority_queue = 1;
     e->in_heap = i;
@@ -94,6 +80,8 @@ struct PriorityEventQueue
   {
     ink_assert(e->in_the_priority_queue);
     e->in_the_priority_queue = 0;
+    if (e->in_heap)
+      n_in_wheel--;
     after[e->in_heap].remove(e);
   }
 
@@ -112,14 +100,22 @@ struct PriorityEventQueue
 
   ink_hrtime earliest_timeout()
   {
-    for (int i = 0; i < N_PQ_LIST; i++) {
-      if (after[i].head)
-        return last_check_time + (PQ_BUCKET_TIME(i) / 2);
+    if (after[0].head)
+      return last_check_time;
+    if (!n_in_wheel)
+      return last_check_time + HRTIME_FOREVER;
+    for (uint64_t tick = last_check_tick + 1; tick & PQ_WHEEL_MASK; tick++) {
+      if (after[PQ_SLOT(0, tick & PQ_WHEEL_MASK)].head)
+        return tick * PQ_TICK;
     }
-    return last_check_time + HRTIME_FOREVER;
+    // the next turn moves events down from level 1
+    return ((last_check_tick | PQ_WHEEL_MASK) + 1) * PQ_TICK;
   }
 
   PriorityEventQueue();
+
+private:
+  void cascade(int level, EThread * t);
 };
 
 #endif
@@ -26,38 +26,122 @@
 PriorityEventQueue::PriorityEventQueue()
 {
   last_check_time = ink_get_based_hrtime_internal();
-  last_check_buckets = last_check_time / PQ_BUCKET_TIME(0);
+  last_check_tick = last_check_time / PQ_TICK;
+  n_in_wheel = 0;
+}
+
+// Place the events of the slot of the current turn of the level again,
+// they land on a lower level or are ready
+void
+PriorityEventQueue::cascade(int level, EThread * t)
+{
+  int i = level ? PQ_SLOT(level, (last_check_tick >> (PQ_WHEEL_BITS * level)) & PQ_WHEEL_MASK) : PQ_OVERFLOW;
+  Event *e;
+  Que(Event, link) q = after[i];
+  after[i].clear();
+  while ((e = q.dequeue()) != NULL) {
+    n_in_wheel--;
+    if (e->cancelled) {
+      e->in_the_priority_queue = 0;
+      e->cancelled = 0;
+      EVENT_FREE(e, eventAllocator, t);
+    } else
+      enqueue(e, last_check_time);
+  }
 }
 
 void
 PriorityEventQueue::check_ready(ink_hrtime now, EThread * t)
 {
-  int i, j, k = 0;
-  uint32_t check_buckets = (uint32_t) (now / PQ_BUCKET_TIME(0));
-  uint32_t todo_buckets = check_buckets ^ last_check_buckets;
+  uint64_t check_tick = (uint64_t) now / PQ_TICK;
+
   last_check_time = now;
-  last_check_buckets = check_buckets;
-  todo_buckets &= ((1 << (N_PQ_LIST - 1)) - 1);
-  while (todo_buckets) {
-    k++;
-    todo_buckets >>= 1;
+  if (!n_in_wheel) {
+    if (check_tick > last_check_tick)
+      last_check_tick = check_tick;
+    return;
   }
-  for (i = 1; i <= k; i++) {
+  while (last_check_tick < check_tick) {
+    last_check_tick++;
+    // the turns which begin at this tick, from the top level down
+    int levels = 0;
+    while (levels < PQ_WHEEL_LEVELS - 1 && !(last_check_tick & ((1ULL << (PQ_WHEEL_BITS * (levels + 1))) - 1)))
+      levels++;
+    if (levels == PQ_WHEEL_LEVELS - 1)
+      cascade(0, t);
+    for (int level = levels; level > 0; level--)
+      cascade(level, t);
+
+    Que(Event, link) &q = after[PQ_SLOT(0, last_check_tick & PQ_WHEEL_MASK)];
     Event *e;
-    Que(Event, link) q = after[i];
-    after[i].clear();
     while ((e = q.dequeue()) != NULL) {
+      n_in_wheel--;
       if (e->cancelled) {
         e->in_the_priority_queue = 0;
         e->cancelled = 0;
         EVENT_FREE(e, eventAllocator, t);
       } else {
-        ink_hrtime tt = e->timeout_at - now;
-        for (j = i; j > 0 && tt <= PQ_BUCKET_TIME(j - 1);)
-          j--;
-        e->in_heap = j;
-        after[j].enqueue(e);
+        e->in_heap = 0;
+        after[0].enqueue(e);
       }
     }
+    if (!n_in_wheel)
+      last_check_tick = check_tick;
+  }
+}
+
+#ifdef TS_HAS_TESTS
+// Schedule a million timers up to 10 minutes out, cancel half of them and
+// run the wheel to the end. Every timer has to fire within its tick.
+REGRESSION_TEST(PriorityEventQueue) (RegressionTest *t, int atype, int *pstatus) {
+  NOWARN_UNUSED(atype);
+  const int n = 1 << 20;
+  const ink_hrtime span = HRTIME_MINUTES(10);
+  EThread *thread = this_ethread();
+  PriorityEventQueue *q = NEW(new PriorityEventQueue);
+  Event **events = (Event **)ats_malloc(n * sizeof(Event *));
+  ink_hrtime now = q->last_check_time;
+  uint64_t x = 88172645463325252ULL;
+  int i, fired = 0, late = 0;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (i = 0; i < n; i++) {
+    events[i] = eventAllocator.alloc();
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    events[i]->timeout_at = now + 1 + (ink_hrtime) (x % span);
+  }
+
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (i = 0; i < n; i++)
+    q->enqueue(events[i], now);
+  ink_hrtime scheduled = ink_get_hrtime_internal();
+  for (i = 0; i < n; i += 2) {
+    q->remove(events[i]);
+    eventAllocator.free(events[i]);
+  }
+  ink_hrtime cancelled = ink_get_hrtime_internal();
+  for (ink_hrtime at = now; at <= now + span + PQ_TICK; at += PQ_TICK) {
+    Event *e;
+    q->check_ready(at, thread);
+    while ((e = q->dequeue_ready(at))) {
+      if (e->timeout_at > at + PQ_TICK || e->timeout_at < at - PQ_TICK)
+        late++;
+      fired++;
+      eventAllocator.free(e);
+    }
+  }
+  ink_hrtime done = ink_get_hrtime_internal();
+
+  rprintf(t, "%d timers: schedule %" PRId64 " ns, cancel %" PRId64 " ns, expire %" PRId64 " ns per timer\n", n,
+          (int64_t) ((scheduled - start) / n), (int64_t) ((cancelled - scheduled) / (n / 2)),
+          (int64_t) ((done - cancelled) / (n / 2)));
+  if (fired != n / 2 || late || q->n_in_wheel) {
+    rprintf(t, "fired %d of %d, %d outside their tick, %d left\n", fired, n / 2, late, q->n_in_wheel);
+    *pstatus = REGRESSION_TEST_FAILED;
   }
+  ats_free(events);
+  delete q;
 }
+#endif
@@ -32,6 +32,7 @@ TS_INLINE
 EventProcessor::EventProcessor():
 n_ethreads(0),
 n_thread_groups(0),
+thread_affinity(INK_AFFINITY_NONE),
 n_dthreads(0),
 thread_data_used(0)
 {
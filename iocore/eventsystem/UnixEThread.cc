@@ -42,10 +42,12 @@ struct AIOCallback;
 
 EThread::EThread()
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
    id(NO_ETHREAD_ID), event_types(0),
+   affinity_cpu(-1), numa_node(0),
    signal_hook(0),
    tt(REGULAR), eventsem(NULL)
 {
@@ -54,11 +56,14 @@ EThread::EThread()
 
 EThread::EThread(ThreadType att, int anid)
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+    diskHandler(NULL),
     ethreads_to_be_signalled(NULL),
     n_ethreads_to_be_signalled(0),
     main_accept_index(-1),
     id(anid),
     event_types(0),
+    affinity_cpu(-1),
+    numa_node(0),
     signal_hook(0),
     tt(att),
     eventsem(NULL),
@@ -90,10 +95,12 @@ EThread::EThread(ThreadType att, int anid)
 
 EThread::EThread(ThreadType att, Event * e, ink_sem * sem)
  : generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t) this)),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
    id(NO_ETHREAD_ID), event_types(0),
+   affinity_cpu(-1), numa_node(0),
    signal_hook(0),
    tt(att), oneevent(e), eventsem(sem)
 {
@@ -180,6 +187,15 @@ EThread::execute() {
       Que(Event, link) NegativeQueue;
       ink_hrtime next_time = 0;
 
+      // bind before this thread allocates, so its freelist chunks are node local
+      if (eventProcessor.thread_affinity != INK_AFFINITY_NONE) {
+        if (ink_affinity_bind(eventProcessor.thread_affinity, id) >= 0) {
+          numa_node = ink_numa_thread_node;
+          Debug("iocore_thread", "thread %d bound to cpu %d, node %d", id, affinity_cpu, numa_node);
+        } else
+          Warning("unable to bind thread %d, affinity %d", id, eventProcessor.thread_affinity);
+      }
+
       // give priority to immediate events
       for (;;) {
         // execute all the available external events that have
@@ -43,6 +43,7 @@ EventProcessor::spawn_event_threads(int n_threads, const char* et_name)
     all_ethreads[n_ethreads + i] = t;
     eventthread[new_thread_group_id][i] = t;
     t->set_event_type(new_thread_group_id);
+    t->affinity_cpu = ink_affinity_cpu(thread_affinity, n_ethreads + i);
   }
 
   n_threads_for_type[new_thread_group_id] = n_threads;
@@ -78,6 +79,7 @@ EventProcessor::start(int n_event_threads)
 
   n_ethreads = n_event_threads;
   n_thread_groups = 1;
+  REC_ReadConfigInteger(thread_affinity, "proxy.config.exec_thread.affinity");
 
   int first_thread = 1;
 
@@ -92,6 +94,7 @@ EventProcessor::start(int n_event_threads)
 
     eventthread[ET_CALL][i] = t;
     t->set_event_type((EventType) ET_CALL);
+    t->affinity_cpu = ink_affinity_cpu(thread_affinity, i);
   }
   n_threads_for_type[ET_CALL] = n_event_threads;
   for (i = first_thread; i < n_ethreads; i++) {
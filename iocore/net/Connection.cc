@@ -263,7 +263,7 @@ Lerror:
 
 
 int
-Server::listen(bool non_blocking, int recv_bufsize, int send_bufsize, bool transparent)
+Server::listen(bool non_blocking, int recv_bufsize, int send_bufsize, bool transparent, bool reuseport)
 {
   ink_assert(fd == NO_FD);
   int res = 0;
@@ -346,6 +346,13 @@ Server::listen(bool non_blocking, int recv_bufsize, int send_bufsize, bool trans
   if ((res = safe_setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, SOCKOPT_ON, sizeof(int))) < 0)
     goto Lerror;
 
+#ifdef SO_REUSEPORT
+  if (reuseport && (res = safe_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, SOCKOPT_ON, sizeof(int))) < 0)
+    goto Lerror;
+#else
+  NOWARN_UNUSED(reuseport);
+#endif
+
   if ((res = socketManager.ink_bind(fd, &addr.sa, ats_ip_size(&addr.sa), IPPROTO_TCP)) < 0) {
     goto Lerror;
   }
@@ -32,6 +32,8 @@
 #include "I_IOBuffer.h"
 #include "I_Socks.h"
 
+class HTTPHdr;
+
 #define CONNECT_SUCCESS   1
 #define CONNECT_FAILURE   0
 
@@ -486,6 +488,29 @@ public:
   /** Set the TCP initial congestion window */
   virtual int set_tcp_init_cwnd(int init_cwnd) = 0;
 
+  /** Returns true if the data of this VC can be moved with splice(2). */
+  virtual bool is_splice_capable() { return false; }
+
+  /**
+    Move everything this VC reads straight into the socket of dst via
+    a kernel pipe, the read VIO of this VC and the write VIO of dst
+    must already be set up and keep counting the bytes. Bytes already
+    in the IOBuffer of the write VIO are sent first. Only possible for
+    two plain TCP connections on the same thread under the same mutex.
+
+    @return false if the VCs can not be spliced, nothing is changed.
+
+  */
+  virtual bool splice_to(NetVConnection *dst) { NOWARN_UNUSED(dst); return false; }
+
+  /**
+    Returns the request header of a VC that decodes it from its own
+    framing, such as a SPDY stream, or NULL. The HTTP state machine
+    copies it instead of parsing the request from the read buffer.
+
+  */
+  virtual HTTPHdr *get_request_header() { return NULL; }
+
   /** Set local sock addr struct. */
   virtual void set_local_addr() = 0;
 
@@ -32,6 +32,12 @@
 #include "P_Net.h"
 
 RecRawStatBlock *net_rsb = NULL;
+RecRawStatBlock *net_accept_rsb = NULL;
+int net_listen_reuseport = 0;
+int net_inactivity_wheel = 0;
+int net_poll_busy_time = 0;
+int net_sock_busy_poll = 0;
+int net_loop_histograms = 0;
 int net_config_poll_timeout = DEFAULT_POLL_TIMEOUT;
 
 static inline void
@@ -40,6 +46,11 @@ configure_net(void)
   IOCORE_RegisterConfigUpdateFunc("proxy.config.net.connections_throttle", change_net_connections_throttle, NULL);
   IOCORE_ReadConfigInteger(fds_throttle, "proxy.config.net.connections_throttle");
   IOCORE_ReadConfigInteger(throttle_enabled,"proxy.config.net.throttle_enabled");
+  IOCORE_ReadConfigInteger(net_listen_reuseport, "proxy.config.net.listen_reuseport");
+  IOCORE_ReadConfigInteger(net_inactivity_wheel, "proxy.config.net.inactivity_wheel");
+  IOCORE_ReadConfigInteger(net_poll_busy_time, "proxy.config.net.poll_busy_time");
+  IOCORE_ReadConfigInteger(net_sock_busy_poll, "proxy.config.net.sock_busy_poll");
+  IOCORE_ReadConfigInteger(net_loop_histograms, "proxy.config.net.loop_histograms");
 }
 
 
@@ -110,6 +121,76 @@ register_net_stats()
                      RECD_INT, RECP_NULL, (int) net_calls_to_write_nodata_stat, RecRawStatSyncSum);
   NET_CLEAR_DYN_STAT(net_calls_to_write_nodata_stat);
 
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.net.busy_polls",
+                     RECD_INT, RECP_NULL, (int) net_busy_polls_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_busy_polls_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.net.splices",
+                     RECD_INT, RECP_NULL, (int) net_splices_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_splices_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.net.splice_bytes",
+                     RECD_INT, RECP_NULL, (int) net_splice_bytes_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_splice_bytes_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.ktls_sessions",
+                     RECD_INT, RECP_NULL, (int) ssl_ktls_sessions_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_ktls_sessions_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.userspace_sessions",
+                     RECD_INT, RECP_NULL, (int) ssl_userspace_sessions_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_userspace_sessions_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.hits",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_hit_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_cache_hit_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.misses",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_miss_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_cache_miss_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.evictions",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_eviction_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_cache_eviction_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_cache.lock_contentions",
+                     RECD_INT, RECP_NULL, (int) ssl_session_cache_lock_contention_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_cache_lock_contention_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_ticket.hits",
+                     RECD_INT, RECP_NULL, (int) ssl_session_ticket_hit_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_ticket_hit_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_ticket.renewals",
+                     RECD_INT, RECP_NULL, (int) ssl_session_ticket_renewal_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_ticket_renewal_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.session_ticket.misses",
+                     RECD_INT, RECP_NULL, (int) ssl_session_ticket_miss_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_session_ticket_miss_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_loads",
+                     RECD_INT, RECP_NULL, (int) ssl_context_load_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_context_load_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS,
+                     "proxy.process.ssl.context_load_time",
+                     RECD_INT, RECP_NULL, (int) ssl_context_load_time_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(ssl_context_load_time_stat);
+
 #ifndef INK_NO_SOCKS
   RecRegisterRawStat(net_rsb, RECT_PROCESS,
                      "proxy.process.socks.connections_successful",
@@ -127,6 +208,37 @@ register_net_stats()
 
 }
 
+void
+register_net_accept_thread_stats(int n_threads)
+{
+  static bool registered = false;
+  char name[64];
+
+  if (registered || !net_accept_rsb)
+    return;
+  registered = true;
+  for (int i = 0; i < n_threads && i < NET_MAX_ACCEPT_THREAD_STATS; i++) {
+    snprintf(name, sizeof(name), "proxy.process.net.accepts.thread.%d", i);
+    RecRegisterRawStat(net_accept_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL, i, RecRawStatSyncCount);
+  }
+}
+
+// SO_BUSY_POLL makes a blocking read on the socket spin on the device
+// queue for up to proxy.config.net.sock_busy_poll usecs. The accepted
+// sockets inherit it from the listen socket.
+void
+net_set_sock_busy_poll(int fd)
+{
+#ifdef SO_BUSY_POLL
+  if (net_sock_busy_poll > 0 && fd != NO_FD) {
+    if (safe_setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, (char *) &net_sock_busy_poll, sizeof(int)) < 0)
+      Debug("socket", "setsockopt() SO_BUSY_POLL %d on fd %d failed: %s", net_sock_busy_poll, fd, strerror(errno));
+  }
+#else
+  NOWARN_UNUSED(fd);
+#endif
+}
+
 void
 ink_net_init(ModuleVersion version)
 {
@@ -139,6 +251,10 @@ ink_net_init(ModuleVersion version)
     net_rsb = RecAllocateRawStatBlock((int) Net_Stat_Count);
     configure_net();
     register_net_stats();
+    // The thread local part of a stat block has to be allocated before
+    //  the threads start, the stats are registered once their number is known
+    if (net_listen_reuseport)
+      net_accept_rsb = RecAllocateRawStatBlock(NET_MAX_ACCEPT_THREAD_STATS);
   }
 
   init_called = 1;
@@ -223,7 +223,8 @@ struct Server: public Connection
   // converted into network byte order
   //
 
-  int listen(bool non_blocking = false, int recv_bufsize = 0, int send_bufsize = 0, bool transparent = false);
+  int listen(bool non_blocking = false, int recv_bufsize = 0, int send_bufsize = 0, bool transparent = false,
+             bool reuseport = false);
   int setup_fd_for_listen(
     bool non_blocking = false,
     int recv_bufsize = 0,
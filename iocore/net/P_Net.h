@@ -52,6 +52,20 @@ enum Net_Stats
   net_calls_to_writetonet_afterpoll_stat,
   net_calls_to_write_stat,
   net_calls_to_write_nodata_stat,
+  net_busy_polls_stat,
+  net_splices_stat,
+  net_splice_bytes_stat,
+  ssl_ktls_sessions_stat,
+  ssl_userspace_sessions_stat,
+  ssl_session_cache_hit_stat,
+  ssl_session_cache_miss_stat,
+  ssl_session_cache_eviction_stat,
+  ssl_session_cache_lock_contention_stat,
+  ssl_session_ticket_hit_stat,
+  ssl_session_ticket_renewal_stat,
+  ssl_session_ticket_miss_stat,
+  ssl_context_load_stat,
+  ssl_context_load_time_stat,
   socks_connections_successful_stat,
   socks_connections_unsuccessful_stat,
   socks_connections_currently_open_stat,
@@ -60,6 +74,28 @@ enum Net_Stats
 
 struct RecRawStatBlock;
 extern RecRawStatBlock *net_rsb;
+
+// Accept counters of the ET_NET threads in the SO_REUSEPORT listen
+// mode, proxy.process.net.accepts.thread.<n>
+#define NET_MAX_ACCEPT_THREAD_STATS 64
+extern RecRawStatBlock *net_accept_rsb;
+extern int net_listen_reuseport;
+void register_net_accept_thread_stats(int n_threads);
+
+// The inactivity cop visits a VC when its timeout may have expired,
+// instead of every VC every second
+extern int net_inactivity_wheel;
+
+// Busy polling: the NetHandler polls without sleeping for
+// proxy.config.net.poll_busy_time usecs after the last I/O, sockets
+// get SO_BUSY_POLL of proxy.config.net.sock_busy_poll usecs
+extern int net_poll_busy_time;
+extern int net_sock_busy_poll;
+void net_set_sock_busy_poll(int fd);
+
+// Per thread histograms of the epoll batch size and the time spent on
+// the ready connections, proxy.process.net.thread.<n>.*
+extern int net_loop_histograms;
 #define SSL_HANDSHAKE_WANT_READ   6
 #define SSL_HANDSHAKE_WANT_WRITE  7
 #define SSL_HANDSHAKE_WANT_ACCEPT 8
@@ -106,6 +106,8 @@ struct NetAccept:public Continuation
   EventType etype;
   UnixNetVConnection *epoll_vc; // only storage for epoll events
   EventIO ep;
+  int accept_stat_id;           // index in net_accept_rsb, -1 for none
+  bool own_listen_fd;           // SO_REUSEPORT socket of this thread only
 
   // Functions all THREAD_FREE and THREAD_ALLOC to be performed
   // for both SSL and regular NetVConnection transparent to
@@ -119,9 +121,10 @@ struct NetAccept:public Continuation
   void init_accept_loop();
   virtual void init_accept(EThread * t = NULL);
   virtual void init_accept_per_thread();
+  virtual void init_accept_reuseport();
   virtual NetAccept *clone();
   // 0 == success
-  int do_listen(bool non_blocking, bool transparent = false);
+  int do_listen(bool non_blocking, bool transparent = false, bool reuseport = false);
 
   int do_blocking_accept(EThread * t);
   virtual int acceptEvent(int event, void *e);
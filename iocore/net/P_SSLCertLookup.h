@@ -29,20 +29,63 @@
 
 struct SSLConfigParams;
 struct SSLContextStorage;
+struct SSLCertLookup;
+
+/*
+ * A certificate of the lookup. The context of a certificate is either
+ * built when the configuration is loaded and kept for the life of the
+ * lookup, or, for a lazy certificate, built by the lookup's loader on the
+ * first lookup that selects it. A lazy context is dropped again when it
+ * is the least recently used of more than context_max loaded contexts.
+ */
+struct SSLCertContext
+{
+  explicit SSLCertContext(SSL_CTX * c);
+  SSLCertContext(const char * cert, const char * ca, const char * key, int ticket_enabled, const char * ticket_key);
+  ~SSLCertContext();
+
+  SSL_CTX * volatile ctx;
+  bool lazy;
+  bool failed;      // the loader failed, do not try again
+
+  // The ssl_multicert.config fields of a lazy certificate.
+  char * cert;
+  char * ca;
+  char * key;
+  char * ticket_key;
+  int ticket_enabled;
+
+  bool indexed;     // owned by the storage
+  LINK(SSLCertContext, link);
+
+private:
+  SSLCertContext(const SSLCertContext &);
+  SSLCertContext & operator =(const SSLCertContext &);
+};
 
 struct SSLCertLookup : public ConfigInfo
 {
+  typedef SSL_CTX * (*Loader)(SSLCertLookup * lookup, const SSLCertContext * cc);
+
   SSLContextStorage * ssl_storage;
   SSL_CTX * ssl_default;
+  Loader loader;        // builds the context of a lazy certificate
+  int context_max;      // the lazy contexts kept loaded, 0 for all of them
 
   bool insert(SSL_CTX * ctx, const char * name);
   bool insert(SSL_CTX * ctx, const IpEndpoint& address);
+  bool insert(SSLCertContext * cc, const char * name);
+  bool insert(SSLCertContext * cc, const IpEndpoint& address);
   SSL_CTX * findInfoInHash(const char * address) const;
   SSL_CTX * findInfoInHash(const IpEndpoint& address) const;
 
   // Return the last-resort default TLS context if there is no name or address match.
   SSL_CTX * defaultContext() const { return ssl_default; }
 
+  // The number of certificates and of the lazy contexts loaded now.
+  unsigned count() const;
+  unsigned loaded() const;
+
   SSLCertLookup();
   virtual ~SSLCertLookup();
 };
@@ -49,7 +49,8 @@ struct SSLConfigParams : public ConfigInfo
   enum SSL_SESSION_CACHE_MODE
   {
     SSL_SESSION_CACHE_MODE_OFF = 0,
-    SSL_SESSION_CACHE_MODE_SERVER = 1
+    SSL_SESSION_CACHE_MODE_SERVER = 1,
+    SSL_SESSION_CACHE_MODE_SERVER_SHARED = 2
   };
 
   SSLConfigParams();
@@ -69,6 +70,12 @@ struct SSLConfigParams : public ConfigInfo
   int verify_depth;
   int ssl_session_cache;
   int ssl_session_cache_size;
+  int ssl_session_cache_num_buckets;
+  int ssl_cert_stats_max;
+  char *ticket_key_filename;
+  int ticket_key_reload_interval;
+  int ssl_context_cache_size;
+  int ssl_ktls;
 
   char *clientCertPath;
   char *clientKeyPath;
@@ -88,8 +88,13 @@ public:
   };
   int sslServerHandShakeEvent(int &err);
   int sslClientHandShakeEvent(int &err);
+  void sslHandShakeDone();
   virtual void net_read_io(NetHandler * nh, EThread * lthread);
   virtual int64_t load_buffer_and_write(int64_t towrite, int64_t &wattempted, int64_t &total_wrote, MIOBufferAccessor & buf);
+  // Only a kTLS session can be the destination of a splice, the data
+  // read from an SSL connection is always decrypted by OpenSSL.
+  virtual bool is_splice_capable() { return ktls_send; }
+  virtual bool splice_to(NetVConnection *dst) { NOWARN_UNUSED(dst); return false; }
 
   void registerNextProtocolSet(const SSLNextProtocolSet *);
 
@@ -117,6 +122,7 @@ private:
 
   bool sslHandShakeComplete;
   bool sslClientConnection;
+  bool ktls_send;               // the kernel encrypts what is written to the socket
   const SSLNextProtocolSet * npnSet;
   Continuation * npnEndpoint;
 };
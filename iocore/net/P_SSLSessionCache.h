@@ -0,0 +1,75 @@
+/** @file
+
+  The shared SSL server session cache and the resumption stats of the
+  certificates
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef __P_SSLSESSIONCACHE_H__
+#define __P_SSLSESSIONCACHE_H__
+
+#include "P_SSLUtils.h"
+#include "ink_mutex.h"
+
+struct SSLConfigParams;
+struct SSLSessionBucket;
+
+/*
+ * proxy.config.ssl.session_cache 2: one cache for all the certificates
+ * and all the threads instead of the OpenSSL cache of each SSL_CTX.
+ * The sessions are kept serialized in buckets of their own lock and LRU
+ * list. A thread never waits for a bucket: a lookup in a busy bucket is
+ * a miss, an insert into a busy bucket is dropped.
+ */
+class SSLSessionCache
+{
+public:
+  SSLSessionCache(int size, int nbuckets);
+  ~SSLSessionCache();
+
+  void insert(SSL_SESSION *sess);
+  SSL_SESSION *lookup(const unsigned char *id, unsigned len);
+  void remove(const unsigned char *id, unsigned len);
+
+private:
+  SSLSessionBucket *bucket_for(const unsigned char *id, unsigned len, uint64_t &hash);
+
+  SSLSessionBucket *buckets;
+  int nbuckets;
+
+  SSLSessionCache(const SSLSessionCache &);
+  SSLSessionCache & operator =(const SSLSessionCache &);
+};
+
+// Create the shared cache (session_cache 2) and, if enabled, the certificate stats.
+void SSLSessionCacheInitialize(const SSLConfigParams * params);
+
+// Let a server context keep its sessions in the shared cache.
+void SSLSessionCacheEnable(SSL_CTX * ctx);
+
+// Count the resumptions and full handshakes of ctx as those of certfile,
+// proxy.process.ssl.cert.<certfile>.resumptions and .full_handshakes,
+// for the first proxy.config.ssl.cert_stats.max certificate files.
+void SSLCertStatsAttach(SSL_CTX * ctx, const char * certfile);
+
+// Count a completed server handshake for the certificate it used.
+void SSLCertStatsCount(SSL * ssl);
+
+#endif /* __P_SSLSESSIONCACHE_H__ */
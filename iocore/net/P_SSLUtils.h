@@ -55,6 +55,9 @@ void SSLInitializeLibrary();
 // Release SSL_CTX and the associated data
 void SSLReleaseContext(SSL_CTX* ctx);
 
+// Start reloading the session ticket key files when they change.
+void SSLTicketKeyReloadStartup(const SSLConfigParams * params);
+
 // Log an SSL error.
 void SSLError(const char *errStr, bool critical = true);
 
@@ -0,0 +1,144 @@
+/** @file
+
+  SpdyClientStream
+
+  A NetVConnection for one SPDY stream. The stream is handed to the
+  HTTP accept endpoint like a client connection, so each SPDY request
+  is served by its own HttpClientSession/HttpSM transaction.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef __P_SPDY_CLIENT_STREAM_H__
+#define __P_SPDY_CLIENT_STREAM_H__
+
+#include "P_Net.h"
+#include "HTTP.h"
+#include <spdylay/spdylay.h>
+
+class SpdySM;
+
+/*
+ * The request side: the SYN_STREAM name/value block is decoded into
+ * req_hdr, which the HttpSM copies through get_request_header(). DATA
+ * frames are appended to req_buffer, the reader of the HttpSM gets the
+ * blocks of req_buffer, not a copy of them.
+ *
+ * The response side: the response header written by the HttpSM is
+ * parsed in place from the write VIO and sent as SYN_REPLY, the body is
+ * copied straight from the write VIO into the DATA frames.
+ *
+ * Every method runs under the mutex of the SpdySM. The stream is freed
+ * once both the HttpSM (do_io_close) and the session (detach) are done
+ * with it.
+ */
+class SpdyClientStream: public NetVConnection
+{
+public:
+  SpdyClientStream();
+  ~SpdyClientStream() {}
+
+  void init(SpdySM *sm, int32_t id);
+
+  // Called by the SpdySM
+  bool recv_headers(char **nv, bool fin);
+  void recv_data(const uint8_t *data, size_t len);
+  void recv_fin();
+  void detach();
+  ssize_t send_data(uint8_t *buf, size_t length, int *eof);
+
+  // NetVConnection
+  virtual VIO *do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf);
+  virtual VIO *do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *buf, bool owner = false);
+  virtual void do_io_close(int lerrno = -1);
+  virtual void do_io_shutdown(ShutdownHowTo_t howto);
+  virtual void reenable(VIO *vio);
+  virtual void reenable_re(VIO *vio);
+
+  virtual void set_active_timeout(ink_hrtime timeout_in);
+  virtual void set_inactivity_timeout(ink_hrtime timeout_in);
+  virtual void cancel_active_timeout();
+  virtual void cancel_inactivity_timeout();
+  virtual ink_hrtime get_active_timeout();
+  virtual ink_hrtime get_inactivity_timeout();
+
+  virtual HTTPHdr *get_request_header();
+  virtual SOCKET get_socket();
+  virtual void set_local_addr();
+  virtual void set_remote_addr();
+  virtual int set_tcp_init_cwnd(int init_cwnd);
+  virtual void apply_options();
+  virtual void set_flow_ctl(int64_t limit_rate, int64_t limit_rate_after);
+  virtual void cancel_flow_ctl();
+
+  int main_handler(int event, void *data);
+
+public:
+  SpdySM *spdy_sm;
+  int32_t stream_id;
+  int delta_window_size;
+
+private:
+  void schedule_process();
+  void schedule_timeout();
+  void process_read();
+  void process_write();
+  bool process_response_header();
+  void submit_response();
+  void process_close();
+  void process_timeout(int event);
+  void signal(VIO *vio, int event);
+  void free_stream();
+
+  VIO read_vio;
+  VIO write_vio;
+
+  MIOBuffer *req_buffer;
+  IOBufferReader *req_reader;
+  MIOBuffer *resp_buffer;       // holds the unsent body after do_io_close
+  IOBufferReader *resp_reader;
+
+  HTTPHdr req_hdr;
+  HTTPParser resp_parser;
+  HTTPHdr resp_hdr;
+
+  bool req_chunked;
+  bool req_fin;
+  bool resp_header_done;
+  bool resp_submitted;
+  bool resp_eof;
+  bool data_deferred;
+  bool write_ready;             // body was consumed, signal WRITE_READY
+  bool write_shutdown;
+  bool closed;
+  bool close_processed;
+  bool attached;                // still in the stream map of the SpdySM
+  bool in_handler;
+
+  Event *process_event;
+  Event *timeout_event;
+  ink_hrtime active_timeout;
+  ink_hrtime inactive_timeout;
+  ink_hrtime active_deadline;
+  ink_hrtime inactive_deadline;
+};
+
+extern ClassAllocator<SpdyClientStream> spdyClientStreamAllocator;
+
+#endif
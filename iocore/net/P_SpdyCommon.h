@@ -51,23 +51,6 @@ struct Config {
   int no_activity_timeout_in;
 };
 
-// Spdy Name/Value pairs
-class SpdyNV {
-public:
-
-  SpdyNV(TSFetchSM fetch_sm);
-  ~SpdyNV();
-
-public:
-  const char **nv;
-
-private:
-  SpdyNV();
-  void *mime_hdr;
-  char status[64];
-  char version[64];
-};
-
 string http_date(time_t t);
 int spdy_config_load();
 
@@ -158,6 +158,10 @@ extern int http_accept_port_number;
 #define NET_PERIOD                                -HRTIME_MSECONDS(5)
 #define ACCEPT_PERIOD                             -HRTIME_MSECONDS(4)
 #define NET_THROTTLE_DELAY                        50    /* mseconds */
+#define NET_COP_WHEEL_SLOTS                       64    /* seconds */
+#define NET_LOOP_HIST_BUCKETS                     8
+#define NET_LOOP_HIST_THREADS                     32
+#define NET_SPLICE_PIPE_SIZE                      (256 * 1024)
 
 #define PRINT_IP(x) ((uint8_t*)&(x))[0],((uint8_t*)&(x))[1], ((uint8_t*)&(x))[2],((uint8_t*)&(x))[3]
 
@@ -193,16 +197,29 @@ public:
   QueM(UnixNetVConnection, NetState, write, ready_link) write_ready_list;
   Que(UnixNetVConnection, link) open_list;
   DList(UnixNetVConnection, cop_link) cop_list;
+  // proxy.config.net.inactivity_wheel: a VC waits in the slot of the
+  // second its inactivity timeout is due, at most NET_COP_WHEEL_SLOTS - 1
+  // seconds out, and is placed again if it was active meanwhile
+  DList(UnixNetVConnection, cop_link) cop_wheel[NET_COP_WHEEL_SLOTS];
+  int64_t cop_wheel_sec;
   ASLLM(UnixNetVConnection, NetState, read, enable_link) read_enable_list;
   ASLLM(UnixNetVConnection, NetState, write, enable_link) write_enable_list;
 
   time_t sec;
   int cycles;
 
+  // poll without sleeping until then, see proxy.config.net.poll_busy_time
+  ink_hrtime busy_poll_until;
+  // proxy.config.net.loop_histograms: the first of the epoll_batch and
+  // loop_usec buckets of this thread in net_loop_rsb, -1 for none
+  int loop_stat_base;
+
   int startNetEvent(int event, Event * data);
   int mainNetEvent(int event, Event * data);
   int mainNetEventExt(int event, Event * data);
   void process_enabled_list(NetHandler *, EThread *);
+  void cop_schedule(UnixNetVConnection *vc, ink_hrtime now);
+  void cop_remove(UnixNetVConnection *vc);
 
   NetHandler();
 };
@@ -97,6 +97,7 @@ extern UnixNetProcessor unix_netProcessor;
 // accept such events by the EventProcesor.
 //
 extern void initialize_thread_for_net(EThread * thread, int thread_index);
+extern void start_net_loop_stats(int n_threads);
 #if defined(USE_OLD_EVENTFD)
 extern void initialize_eventfd(EThread * thread);
 #endif
@@ -71,6 +71,24 @@ struct FlowControl
   }
 };
 
+// A pipe between two UnixNetVConnections on the same thread, the source
+// splices from its socket into the pipe and the destination splices from
+// the pipe into its socket. The data never reaches an IOBuffer.
+struct NetSplice
+{
+  int pipe_fd[2];
+  int64_t in_pipe;              // bytes in the pipe
+  int64_t pipe_size;
+  bool src_blocked;             // the source waits for room in the pipe
+  UnixNetVConnection *src;      // NULL once the source is detached
+  UnixNetVConnection *dst;
+
+  NetSplice(): in_pipe(0), pipe_size(0), src_blocked(false), src(NULL), dst(NULL)
+  {
+    pipe_fd[0] = pipe_fd[1] = -1;
+  }
+};
+
 TS_INLINE void
 NetVCOptions::reset()
 {
@@ -147,6 +165,9 @@ public:
   virtual void do_io_close(int lerrno = -1);
   virtual void do_io_shutdown(ShutdownHowTo_t howto);
 
+  virtual bool is_splice_capable() { return true; }
+  virtual bool splice_to(NetVConnection *dst);
+
   ////////////////////////////////////////////////////////////
   // Set the timeouts associated with this connection.      //
   // active_timeout is for the total elasped time of        //
@@ -220,6 +241,7 @@ public:
   void readReschedule(NetHandler *nh);
   void writeReschedule(NetHandler *nh);
   void netActivity(EThread *lthread);
+  void splice_detach(ShutdownHowTo_t howto);
 
   Action action_;
   volatile int closed;
@@ -238,6 +260,7 @@ public:
   Event *inactivity_timeout;
 #else
   ink_hrtime next_inactivity_timeout_at;
+  int cop_slot;                 // slot of NetHandler::cop_wheel, or -1
 #endif
   Event *active_timeout;
   EventIO ep;
@@ -265,6 +288,8 @@ public:
   bool from_accept_thread;
   ProbeType pt;
   FlowControl fct;
+  NetSplice *read_splice;       // this VC fills the pipe
+  NetSplice *write_splice;      // this VC drains the pipe
 
   int startEvent(int event, Event *e);
   int acceptEvent(int event, Event *e);
@@ -284,6 +309,7 @@ public:
 };
 
 extern ClassAllocator<UnixNetVConnection> netVCAllocator;
+void net_cop_schedule(UnixNetVConnection * vc);
 
 typedef int (UnixNetVConnection::*NetVConnHandler) (int, void *);
 
@@ -319,6 +345,10 @@ UnixNetVConnection::set_inactivity_timeout(ink_hrtime timeout)
   inactivity_timeout_in = timeout;
 #ifndef INACTIVITY_TIMEOUT
   next_inactivity_timeout_at = ink_get_hrtime() + timeout;
+  // the slot may be later than the new timeout, the wheel of another
+  // thread is left alone and the VC is visited within NET_COP_WHEEL_SLOTS
+  if (cop_slot >= 0 && thread == this_ethread())
+    net_cop_schedule(this);
 #else
   if (inactivity_timeout)
     inactivity_timeout->cancel_action(this);
@@ -29,7 +29,6 @@
 #include "I_EventSystem.h"
 #include "I_Layout.h"
 #include "Regex.h"
-#include "Trie.h"
 #include "ts/TestBox.h"
 
 struct SSLAddressLookupKey
@@ -68,31 +67,73 @@ private:
   unsigned char sep; // offset of address/port separator
 };
 
+// A context dropped from the lookup is freed only after this long, a
+// thread may have found it just before and not yet made its SSL of it.
+#define SSL_CONTEXT_RETIRE_DELAY HRTIME_SECONDS(60)
+
 struct SSLContextStorage
 {
   SSLContextStorage();
   ~SSLContextStorage();
 
-  bool insert(SSL_CTX * ctx, const char * name);
-  SSL_CTX * lookup(const char * name) const;
+  bool insert(SSLCertContext * cc, const char * name);
+  SSLCertContext * lookup(const char * name) const;
+  SSLCertContext * wrap(SSL_CTX * ctx);
+  SSL_CTX * context(SSLCertLookup * lookup, SSLCertContext * cc);
+
+  unsigned count() const { return certificates.length(); }
+  unsigned loaded() const { return nloaded; }
 
 private:
-  struct SSLEntry
+  struct SSLRetiredContext
   {
-    explicit SSLEntry(SSL_CTX * c) : ctx(c) {}
-
-    void Print() const { Debug("ssl", "SSLEntry=%p SSL_CTX=%p", this, ctx); }
-
     SSL_CTX * ctx;
-    LINK(SSLEntry, link);
+    ink_hrtime when;
   };
 
-  Trie<SSLEntry>  wildcards;
+  void retire(SSL_CTX * ctx);
+
+  // The wildcard names are a trie of their reversed labels, *.b.example.com
+  // is the node "com.example.b" under "com.example" under "com". The edges
+  // are not kept in the nodes, a node is found by hashing its whole path,
+  // so a lookup is a hash probe per label of the name. A node without a
+  // certificate only says there are longer wildcards below it.
+  InkHashTable *  wildcards;
+  unsigned        nwildcards;
   InkHashTable *  hostnames;
-  Vec<SSL_CTX *>  references;
+  InkHashTable *  contexts;     // SSL_CTX to its SSLCertContext
+  Vec<SSLCertContext *> certificates;
+
+  // The loaded lazy contexts, most recently used first.
+  ink_mutex       mutex;
+  Queue<SSLCertContext> lru;
+  unsigned        nloaded;
+  Vec<SSLRetiredContext> retired;
 };
 
-SSLCertLookup::SSLCertLookup() : ssl_storage(NEW(new SSLContextStorage())), ssl_default(NULL)
+SSLCertContext::SSLCertContext(SSL_CTX * c)
+  : ctx(c), lazy(false), failed(false), cert(NULL), ca(NULL), key(NULL), ticket_key(NULL), ticket_enabled(-1),
+    indexed(false)
+{
+}
+
+SSLCertContext::SSLCertContext(const char * _cert, const char * _ca, const char * _key, int _ticket_enabled,
+                               const char * _ticket_key)
+  : ctx(NULL), lazy(true), failed(false), cert(ats_strdup(_cert)), ca(ats_strdup(_ca)), key(ats_strdup(_key)),
+    ticket_key(ats_strdup(_ticket_key)), ticket_enabled(_ticket_enabled), indexed(false)
+{
+}
+
+SSLCertContext::~SSLCertContext()
+{
+  ats_free(cert);
+  ats_free(ca);
+  ats_free(key);
+  ats_free(ticket_key);
+}
+
+SSLCertLookup::SSLCertLookup()
+  : ssl_storage(NEW(new SSLContextStorage())), ssl_default(NULL), loader(NULL), context_max(0)
 {
 }
 
@@ -104,23 +145,26 @@ SSLCertLookup::~SSLCertLookup()
 SSL_CTX *
 SSLCertLookup::findInfoInHash(const char * address) const
 {
-  return this->ssl_storage->lookup(address);
+  SSLCertContext * cc = this->ssl_storage->lookup(address);
+  return cc ? this->ssl_storage->context(const_cast<SSLCertLookup *>(this), cc) : NULL;
 }
 
 SSL_CTX *
 SSLCertLookup::findInfoInHash(const IpEndpoint& address) const
 {
-  SSL_CTX * ctx;
+  SSLCertContext * cc;
   SSLAddressLookupKey key(address);
   // First try the full address.
-  if ((ctx = this->ssl_storage->lookup(key.get()))) {
-    return ctx;
+  if ((cc = this->ssl_storage->lookup(key.get()))) {
+    return this->ssl_storage->context(const_cast<SSLCertLookup *>(this), cc);
   }
 
   // If that failed, try the address without the port.
   if (address.port()) {
     key.split();
-    return this->ssl_storage->lookup(key.get());
+    if ((cc = this->ssl_storage->lookup(key.get()))) {
+      return this->ssl_storage->context(const_cast<SSLCertLookup *>(this), cc);
+    }
   }
 
   return NULL;
@@ -129,14 +173,39 @@ SSLCertLookup::findInfoInHash(const IpEndpoint& address) const
 bool
 SSLCertLookup::insert(SSL_CTX * ctx, const char * name)
 {
-  return this->ssl_storage->insert(ctx, name);
+  return this->ssl_storage->insert(this->ssl_storage->wrap(ctx), name);
 }
 
 bool
 SSLCertLookup::insert(SSL_CTX * ctx, const IpEndpoint& address)
 {
   SSLAddressLookupKey key(address);
-  return this->ssl_storage->insert(ctx, key.get());
+  return this->ssl_storage->insert(this->ssl_storage->wrap(ctx), key.get());
+}
+
+bool
+SSLCertLookup::insert(SSLCertContext * cc, const char * name)
+{
+  return this->ssl_storage->insert(cc, name);
+}
+
+bool
+SSLCertLookup::insert(SSLCertContext * cc, const IpEndpoint& address)
+{
+  SSLAddressLookupKey key(address);
+  return this->ssl_storage->insert(cc, key.get());
+}
+
+unsigned
+SSLCertLookup::count() const
+{
+  return this->ssl_storage->count();
+}
+
+unsigned
+SSLCertLookup::loaded() const
+{
+  return this->ssl_storage->loaded();
 }
 
 struct ats_wildcard_matcher
@@ -197,32 +266,61 @@ reverse_dns_name(const char * hostname, char (&reversed)[TS_MAX_HOST_NAME_LEN+1]
 }
 
 SSLContextStorage::SSLContextStorage()
-  :wildcards(), hostnames(ink_hash_table_create(InkHashTableKeyType_String))
+  : wildcards(ink_hash_table_create(InkHashTableKeyType_String)), nwildcards(0),
+    hostnames(ink_hash_table_create(InkHashTableKeyType_String)),
+    contexts(ink_hash_table_create(InkHashTableKeyType_Word)),
+    nloaded(0)
 {
+  ink_mutex_init(&this->mutex, "SSLContextStorage");
 }
 
 SSLContextStorage::~SSLContextStorage()
 {
-  for (int i = 0; i < this->references.count(); ++i) {
-    SSLReleaseContext(this->references[i]);
+  for (int i = 0; i < this->certificates.length(); ++i) {
+    if (this->certificates[i]->ctx) {
+      SSLReleaseContext(this->certificates[i]->ctx);
+    }
+    delete this->certificates[i];
+  }
+
+  for (int i = 0; i < this->retired.length(); ++i) {
+    SSLReleaseContext(this->retired[i].ctx);
   }
 
+  ink_hash_table_destroy(this->wildcards);
   ink_hash_table_destroy(this->hostnames);
+  ink_hash_table_destroy(this->contexts);
+  ink_mutex_destroy(&this->mutex);
 }
 
+SSLCertContext *
+SSLContextStorage::wrap(SSL_CTX * ctx)
+{
+  InkHashTableValue value;
+
+  // Since we index by name, the same context is inserted for each of its names, and they must
+  // all share one SSLCertContext so that the context is freed once.
+  if (ink_hash_table_lookup(this->contexts, (InkHashTableKey)ctx, &value)) {
+    return (SSLCertContext *)value;
+  }
+
+  SSLCertContext * cc = NEW(new SSLCertContext(ctx));
+  ink_hash_table_insert(this->contexts, (InkHashTableKey)ctx, cc);
+  return cc;
+}
 
 bool
-SSLContextStorage::insert(SSL_CTX * ctx, const char * name)
+SSLContextStorage::insert(SSLCertContext * cc, const char * name)
 {
   ats_wildcard_matcher wildcard;
   bool inserted = true;
 
   if (wildcard.match(name)) {
-    // We turn wildcards into the reverse DNS form, then insert them into the trie
-    // so that we can do a longest match lookup.
+    // We turn wildcards into the reverse DNS form, then insert each of their label prefixes into
+    // the trie so that we can do a longest match lookup.
     char namebuf[TS_MAX_HOST_NAME_LEN + 1];
     char * reversed;
-    xptr<SSLEntry> entry;
+    InkHashTableValue value;
 
     reversed = reverse_dns_name(name + 2, namebuf);
     if (!reversed) {
@@ -230,42 +328,52 @@ SSLContextStorage::insert(SSL_CTX * ctx, const char * name)
       return false;
     }
 
-    Debug("ssl", "indexed wildcard certificate for '%s' as '%s' with SSL_CTX %p", name, reversed, ctx);
-    entry = new SSLEntry(ctx);
-    inserted = this->wildcards.Insert(reversed, entry, 0 /* rank */, -1 /* keylen */);
-    if (inserted) {
-      entry.release();
+    if (ink_hash_table_lookup(this->wildcards, reversed, &value) && value) {
+      Debug("ssl", "wildcard certificate for '%s' is already indexed", name);
+      inserted = false;
+    } else {
+      Debug("ssl", "indexed wildcard certificate for '%s' as '%s' with SSLCertContext %p", name, reversed, cc);
+      ink_hash_table_insert(this->wildcards, reversed, cc);
+      this->nwildcards++;
+
+      for (char * dot = strrchr(reversed, '.'); dot; dot = strrchr(reversed, '.')) {
+        *dot = '\0';
+        if (ink_hash_table_isbound(this->wildcards, reversed)) {
+          break;
+        }
+        ink_hash_table_insert(this->wildcards, reversed, NULL);
+      }
     }
   } else {
-    Debug("ssl", "indexed '%s' with SSL_CTX %p", name, ctx);
-    ink_hash_table_insert(this->hostnames, name, (void *)ctx);
+    Debug("ssl", "indexed '%s' with SSLCertContext %p", name, cc);
+    ink_hash_table_insert(this->hostnames, name, cc);
   }
 
-  // Keep a unique reference to the SSL_CTX, so that we can free it later. Since we index by name, multiple
-  // certificates can be indexed for the same name. If this happens, we will overwrite the previous pointer
-  // and leak a context. So if we insert a certificate, keep an ownership reference to it.
-  if (inserted) {
-    if (this->references.in(ctx) == NULL) {
-      this->references.push_back(ctx);
-    }
+  // Keep a unique reference to the certificate, so that we can free it later. Since we index by name,
+  // multiple certificates can be indexed for the same name. If this happens, we will overwrite the
+  // previous pointer, but the storage still owns the certificate.
+  if (inserted && !cc->indexed) {
+    cc->indexed = true;
+    this->certificates.push_back(cc);
   }
 
   return inserted;
 }
 
-SSL_CTX *
+SSLCertContext *
 SSLContextStorage::lookup(const char * name) const
 {
   InkHashTableValue value;
 
-  if (ink_hash_table_lookup(const_cast<InkHashTable *>(this->hostnames), name, &value)) {
-    return (SSL_CTX *)value;
+  if (ink_hash_table_lookup(this->hostnames, name, &value)) {
+    return (SSLCertContext *)value;
   }
 
-  if (!this->wildcards.Empty()) {
+  if (this->nwildcards) {
     char namebuf[TS_MAX_HOST_NAME_LEN + 1];
     char * reversed;
-    SSLEntry * entry;
+    char * end;
+    SSLCertContext * cc = NULL;
 
     reversed = reverse_dns_name(name, namebuf);
     if (!reversed) {
@@ -273,16 +381,111 @@ SSLContextStorage::lookup(const char * name) const
       return NULL;
     }
 
+    // Walk down the trie one label at a time and keep the deepest certificate.
     Debug("ssl", "attempting wildcard match for %s", reversed);
-    entry = this->wildcards.Search(reversed);
-    if (entry) {
-      return entry->ctx;
+    for (end = reversed; end; ) {
+      end = strchr(end + 1, '.');
+      if (end) {
+        *end = '\0';
+      }
+
+      if (!ink_hash_table_lookup(this->wildcards, reversed, &value)) {
+        break;
+      }
+      if (value) {
+        cc = (SSLCertContext *)value;
+      }
+
+      if (end) {
+        *end = '.';
+      }
     }
+
+    return cc;
   }
 
   return NULL;
 }
 
+SSL_CTX *
+SSLContextStorage::context(SSLCertLookup * lookup, SSLCertContext * cc)
+{
+  SSL_CTX * ctx = cc->ctx;
+
+  if (!cc->lazy) {
+    return ctx;
+  }
+
+  if (ctx) {
+    // The order is only a hint, do not wait for the list to move it up.
+    if (ink_mutex_try_acquire(&this->mutex)) {
+      if (cc->ctx && this->lru.head != cc) {
+        this->lru.remove(cc);
+        this->lru.push(cc);
+      }
+      ink_mutex_release(&this->mutex);
+    }
+    return ctx;
+  }
+
+  if (cc->failed || !lookup->loader) {
+    return NULL;
+  }
+
+  // Build the context outside of the lock, it reads the certificate files.
+  // The handshake needs this certificate, so it waits for the build.
+  ctx = lookup->loader(lookup, cc);
+  if (!ctx) {
+    cc->failed = true;
+    return NULL;
+  }
+
+  ink_mutex_acquire(&this->mutex);
+  if (cc->ctx) {
+    // Another thread loaded it first.
+    SSL_CTX * loaded = cc->ctx;
+    ink_mutex_release(&this->mutex);
+    SSLReleaseContext(ctx);
+    return loaded;
+  }
+
+  cc->ctx = ctx;
+  this->lru.push(cc);
+  this->nloaded++;
+
+  while (lookup->context_max > 0 && this->nloaded > (unsigned)lookup->context_max) {
+    SSLCertContext * old = this->lru.tail;
+
+    Debug("ssl", "dropping the SSL_CTX %p of %s", old->ctx, old->cert);
+    this->lru.remove(old);
+    this->retire(old->ctx);
+    old->ctx = NULL;
+    this->nloaded--;
+  }
+  ink_mutex_release(&this->mutex);
+
+  return ctx;
+}
+
+void
+SSLContextStorage::retire(SSL_CTX * ctx)
+{
+  ink_hrtime now = ink_get_hrtime_internal();
+  int i, n = 0;
+
+  for (i = 0; i < this->retired.length(); ++i) {
+    if (now - this->retired[i].when >= SSL_CONTEXT_RETIRE_DELAY) {
+      SSLReleaseContext(this->retired[i].ctx);
+    } else {
+      this->retired[n++] = this->retired[i];
+    }
+  }
+  this->retired.n = n;
+
+  SSLRetiredContext r = { ctx, now };
+  this->retired.push_back(r);
+}
+
 #if TS_HAS_TESTS
 
 REGRESSION_TEST(SSLWildcardMatch)(RegressionTest * t, int atype, int * pstatus)
@@ -37,6 +37,7 @@
 #include "P_SSLConfig.h"
 #include "P_SSLUtils.h"
 #include "P_SSLCertLookup.h"
+#include "P_SSLSessionCache.h"
 #include <records/I_RecHttp.h>
 
 int SSLConfig::configid = 0;
@@ -54,6 +55,7 @@ SSLConfigParams::SSLConfigParams()
     clientCertPath = clientKeyPath =
     clientCACertFilename = clientCACertPath =
     cipherSuite =
+    ticket_key_filename =
     serverKeyPathOnly = NULL;
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
@@ -61,6 +63,11 @@ SSLConfigParams::SSLConfigParams()
   ssl_ctx_options = 0;
   ssl_session_cache = SSL_SESSION_CACHE_MODE_SERVER;
   ssl_session_cache_size = 1024*20;
+  ssl_session_cache_num_buckets = 256;
+  ssl_cert_stats_max = 0;
+  ticket_key_reload_interval = 60;
+  ssl_context_cache_size = 0;
+  ssl_ktls = 0;
 }
 
 SSLConfigParams::~SSLConfigParams()
@@ -82,6 +89,7 @@ SSLConfigParams::cleanup()
   ats_free_null(serverCertPathOnly);
   ats_free_null(serverKeyPathOnly);
   ats_free_null(cipherSuite);
+  ats_free_null(ticket_key_filename);
 
   clientCertLevel = client_verify_depth = verify_depth = clientVerify = 0;
 }
@@ -183,6 +191,9 @@ SSLConfigParams::initialize()
   set_paths_helper(serverCertRelativePath, NULL, &serverCertPathOnly, NULL);
   ats_free(serverCertRelativePath);
 
+  // Build the contexts of the certificates on first use, at most this many at a time
+  IOCORE_ReadConfigInteger(ssl_context_cache_size, "proxy.config.ssl.server.context_cache.size");
+
   IOCORE_ReadConfigStringAlloc(multicert_config_file, "proxy.config.ssl.server.multicert.filename");
   set_paths_helper(Layout::get()->sysconfdir, multicert_config_file, NULL, &configFilePath);
   ats_free(multicert_config_file);
@@ -199,10 +210,29 @@ SSLConfigParams::initialize()
   // SSL session cache configurations
   IOCORE_ReadConfigInteger(ssl_session_cache, "proxy.config.ssl.session_cache");
   IOCORE_ReadConfigInteger(ssl_session_cache_size, "proxy.config.ssl.session_cache.size");
+  IOCORE_ReadConfigInteger(ssl_session_cache_num_buckets, "proxy.config.ssl.session_cache.num_buckets");
+  IOCORE_ReadConfigInteger(ssl_cert_stats_max, "proxy.config.ssl.cert_stats.max");
+
+  // Session ticket keys shared by the certificates without their own
+  IOCORE_ReadConfigStringAlloc(ticket_key_filename, "proxy.config.ssl.server.ticket_key.filename");
+  if (ticket_key_filename) {
+    char *path = Layout::get()->relative_to(serverCertPathOnly, ticket_key_filename);
+    ats_free(ticket_key_filename);
+    ticket_key_filename = path;
+  }
+  IOCORE_ReadConfigInteger(ticket_key_reload_interval, "proxy.config.ssl.server.ticket_key.reload_interval");
 
   // SSL record size
   REC_EstablishStaticConfigInt32(ssl_maxrecord, "proxy.config.ssl.max_record_size");
 
+  // Let OpenSSL move the keys of a session to the kernel TLS after the
+  // handshake, where the kernel supports the cipher.
+  IOCORE_ReadConfigInteger(ssl_ktls, "proxy.config.ssl.ktls.enabled");
+#ifdef SSL_OP_ENABLE_KTLS
+  if (ssl_ktls)
+    ssl_ctx_options |= SSL_OP_ENABLE_KTLS;
+#endif
+
   // ++++++++++++++++++++++++ Client part ++++++++++++++++++++
   client_verify_depth = 7;
   IOCORE_ReadConfigInt32(clientVerify, "proxy.config.ssl.client.verify.server");
@@ -233,6 +263,10 @@ void
 SSLConfig::startup()
 {
   reconfigure();
+
+  SSLConfig::scoped_config params;
+  SSLSessionCacheInitialize(params);
+  SSLTicketKeyReloadStartup(params);
 }
 
 void
@@ -23,6 +23,7 @@
 #include "ink_config.h"
 #include "P_Net.h"
 #include "P_SSLNextProtocolSet.h"
+#include "P_SSLSessionCache.h"
 
 #define SSL_READ_ERROR_NONE	  0
 #define SSL_READ_ERROR		  1
@@ -325,6 +326,10 @@ SSLNetVConnection::net_read_io(NetHandler *nh, EThread *lthread)
 int64_t
 SSLNetVConnection::load_buffer_and_write(int64_t towrite, int64_t &wattempted, int64_t &total_wrote, MIOBufferAccessor & buf)
 {
+  // The kernel makes the records, write the plain data.
+  if (ktls_send)
+    return UnixNetVConnection::load_buffer_and_write(towrite, wattempted, total_wrote, buf);
+
   ProxyMutex *mutex = this_ethread()->mutex;
   int64_t r = 0;
   int64_t l = 0;
@@ -417,6 +422,7 @@ SSLNetVConnection::load_buffer_and_write(int64_t towrite, int64_t &wattempted, i
 SSLNetVConnection::SSLNetVConnection():
   sslHandShakeComplete(false),
   sslClientConnection(false),
+  ktls_send(false),
   npnSet(NULL),
   npnEndpoint(NULL)
 {
@@ -447,6 +453,7 @@ SSLNetVConnection::free(EThread * t) {
   }
   sslHandShakeComplete = false;
   sslClientConnection = false;
+  ktls_send = false;
   npnSet = NULL;
   npnEndpoint = NULL;
 
@@ -517,6 +524,7 @@ SSLNetVConnection::sslServerHandShakeEvent(int &err)
       X509_free(client_cert);
     }
     sslHandShakeComplete = 1;
+    sslHandShakeDone();
 
 #if TS_USE_TLS_NPN
     {
@@ -584,6 +592,7 @@ SSLNetVConnection::sslClientHandShakeEvent(int &err)
 
     X509_free(server_cert);
     sslHandShakeComplete = 1;
+    sslHandShakeDone();
 
     return EVENT_DONE;
 
@@ -626,6 +635,33 @@ SSLNetVConnection::sslClientHandShakeEvent(int &err)
 
 }
 
+// If OpenSSL moved the keys to the kernel (SSL_OP_ENABLE_KTLS and a
+// cipher the kernel knows), the data is written to the socket as is and
+// the session can no longer be renegotiated: the kernel owns the keys and
+// the record sequence. Otherwise the session stays in userspace.
+void
+SSLNetVConnection::sslHandShakeDone()
+{
+  ProxyMutex *mutex = this_ethread()->mutex;
+
+  if (!sslClientConnection) {
+    SSLCertStatsCount(ssl);
+  }
+
+#ifdef SSL_OP_ENABLE_KTLS
+  if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+#ifdef SSL_OP_NO_RENEGOTIATION
+    SSL_set_options(ssl, SSL_OP_NO_RENEGOTIATION);
+#endif
+    ktls_send = true;
+    NET_INCREMENT_DYN_STAT(ssl_ktls_sessions_stat);
+    Debug("ssl", "SSLNetVConnection::sslHandShakeDone, kTLS send with %s", SSL_get_cipher_name(ssl));
+    return;
+  }
+#endif
+  NET_INCREMENT_DYN_STAT(ssl_userspace_sessions_stat);
+}
+
 void
 SSLNetVConnection::registerNextProtocolSet(const SSLNextProtocolSet * s)
 {
@@ -0,0 +1,371 @@
+/** @file
+
+  The shared SSL server session cache and the resumption stats of the
+  certificates
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ink_config.h"
+#include "P_Net.h"
+#include "P_SSLConfig.h"
+#include "P_SSLSessionCache.h"
+
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10100000L)
+typedef const unsigned char ssl_session_id_t;
+#else
+typedef unsigned char ssl_session_id_t;
+#endif
+
+struct SSLSessionEntry
+{
+  uint64_t hash;
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  unsigned id_len;
+  int64_t expire;               // seconds
+  int der_len;
+  SSLSessionEntry *hash_next;
+  LINK(SSLSessionEntry, link);
+  unsigned char der[1];         // the serialized session
+};
+
+struct SSLSessionBucket
+{
+  ink_mutex mutex;
+  SSLSessionEntry **table;
+  unsigned table_mask;
+  int count;
+  int max;
+  Queue<SSLSessionEntry> lru;   // most recent first
+
+  SSLSessionEntry **find(uint64_t hash, const unsigned char *id, unsigned len)
+  {
+    SSLSessionEntry **e = &table[hash & table_mask];
+    for (; *e; e = &(*e)->hash_next) {
+      if ((*e)->hash == hash && (*e)->id_len == len && !memcmp((*e)->id, id, len))
+        break;
+    }
+    return e;
+  }
+
+  void unlink(SSLSessionEntry **e)
+  {
+    SSLSessionEntry *entry = *e;
+    *e = entry->hash_next;
+    lru.remove(entry);
+    count--;
+    ats_free(entry);
+  }
+};
+
+static SSLSessionCache *ssl_session_cache = NULL;
+static int ssl_cert_stats_index = -1;
+
+static uint64_t
+ssl_session_hash(const unsigned char *id, unsigned len)
+{
+  // 64 bits FNV-1a, the ids are random but may be short
+  uint64_t h = 14695981039346656037ULL;
+  for (unsigned i = 0; i < len; i++) {
+    h ^= id[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+SSLSessionCache::SSLSessionCache(int size, int n)
+  : nbuckets(n)
+{
+  int max = size / nbuckets;
+  if (max < 1)
+    max = 1;
+  unsigned table_size = 1;
+  while ((int)table_size < max)
+    table_size <<= 1;
+
+  buckets = NEW(new SSLSessionBucket[nbuckets]);
+  for (int i = 0; i < nbuckets; i++) {
+    SSLSessionBucket *b = &buckets[i];
+    ink_mutex_init(&b->mutex, "SSLSessionBucket");
+    b->table = (SSLSessionEntry **)ats_calloc(table_size, sizeof(SSLSessionEntry *));
+    b->table_mask = table_size - 1;
+    b->count = 0;
+    b->max = max;
+  }
+}
+
+SSLSessionCache::~SSLSessionCache()
+{
+  for (int i = 0; i < nbuckets; i++) {
+    SSLSessionBucket *b = &buckets[i];
+    SSLSessionEntry *e;
+    while ((e = b->lru.pop()))
+      ats_free(e);
+    ats_free(b->table);
+    ink_mutex_destroy(&b->mutex);
+  }
+  delete[] buckets;
+}
+
+SSLSessionBucket *
+SSLSessionCache::bucket_for(const unsigned char *id, unsigned len, uint64_t &hash)
+{
+  hash = ssl_session_hash(id, len);
+  // the low bits pick the slot within the bucket
+  return &buckets[(hash >> 32) % nbuckets];
+}
+
+void
+SSLSessionCache::insert(SSL_SESSION *sess)
+{
+  ProxyMutex *mutex = this_ethread()->mutex;
+  unsigned len;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+  int der_len = i2d_SSL_SESSION(sess, NULL);
+
+  if (len == 0 || len > SSL_MAX_SSL_SESSION_ID_LENGTH || der_len <= 0)
+    return;
+
+  SSLSessionEntry *entry = (SSLSessionEntry *)ats_malloc(sizeof(SSLSessionEntry) + der_len);
+  unsigned char *p = entry->der;
+  i2d_SSL_SESSION(sess, &p);
+  entry->der_len = der_len;
+  memcpy(entry->id, id, len);
+  entry->id_len = len;
+  entry->expire = SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess);
+  entry->hash_next = NULL;
+
+  SSLSessionBucket *b = bucket_for(id, len, entry->hash);
+  if (!ink_mutex_try_acquire(&b->mutex)) {
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_lock_contention_stat);
+    ats_free(entry);
+    return;
+  }
+
+  SSLSessionEntry **e = b->find(entry->hash, id, len);
+  if (*e)
+    b->unlink(e);
+  while (b->count >= b->max) {
+    SSLSessionEntry *old = b->lru.tail;
+    b->unlink(b->find(old->hash, old->id, old->id_len));
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_eviction_stat);
+  }
+  SSLSessionEntry **slot = &b->table[entry->hash & b->table_mask];
+  entry->hash_next = *slot;
+  *slot = entry;
+  b->lru.push(entry);
+  b->count++;
+
+  ink_mutex_release(&b->mutex);
+}
+
+SSL_SESSION *
+SSLSessionCache::lookup(const unsigned char *id, unsigned len)
+{
+  ProxyMutex *mutex = this_ethread()->mutex;
+  SSL_SESSION *sess = NULL;
+  uint64_t hash;
+
+  SSLSessionBucket *b = bucket_for(id, len, hash);
+  if (!ink_mutex_try_acquire(&b->mutex)) {
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_lock_contention_stat);
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_miss_stat);
+    return NULL;
+  }
+
+  SSLSessionEntry **e = b->find(hash, id, len);
+  if (*e) {
+    if ((*e)->expire <= ink_hrtime_to_sec(ink_get_hrtime())) {
+      b->unlink(e);
+    } else {
+      const unsigned char *p = (*e)->der;
+      sess = d2i_SSL_SESSION(NULL, &p, (*e)->der_len);
+      b->lru.remove(*e);
+      b->lru.push(*e);
+    }
+  }
+
+  ink_mutex_release(&b->mutex);
+
+  if (sess) {
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_hit_stat);
+  } else {
+    NET_INCREMENT_DYN_STAT(ssl_session_cache_miss_stat);
+  }
+  return sess;
+}
+
+void
+SSLSessionCache::remove(const unsigned char *id, unsigned len)
+{
+  uint64_t hash;
+
+  SSLSessionBucket *b = bucket_for(id, len, hash);
+  // a removal may not be dropped, the session is no good any more
+  ink_mutex_acquire(&b->mutex);
+  SSLSessionEntry **e = b->find(hash, id, len);
+  if (*e)
+    b->unlink(e);
+  ink_mutex_release(&b->mutex);
+}
+
+//
+// OpenSSL session cache callbacks
+//
+static int
+ssl_new_cached_session(SSL *ssl, SSL_SESSION *sess)
+{
+  NOWARN_UNUSED(ssl);
+  ssl_session_cache->insert(sess);
+  // the cache keeps a copy, not a reference
+  return 0;
+}
+
+static SSL_SESSION *
+ssl_get_cached_session(SSL *ssl, ssl_session_id_t *id, int len, int *copy)
+{
+  NOWARN_UNUSED(ssl);
+  // the session is new, OpenSSL takes our reference
+  *copy = 0;
+  return ssl_session_cache->lookup(id, len);
+}
+
+static void
+ssl_rm_cached_session(SSL_CTX *ctx, SSL_SESSION *sess)
+{
+  NOWARN_UNUSED(ctx);
+  unsigned len;
+  const unsigned char *id = SSL_SESSION_get_id(sess, &len);
+  ssl_session_cache->remove(id, len);
+}
+
+void
+SSLSessionCacheEnable(SSL_CTX *ctx)
+{
+  ink_release_assert(ssl_session_cache);
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+  SSL_CTX_sess_set_new_cb(ctx, ssl_new_cached_session);
+  SSL_CTX_sess_set_get_cb(ctx, ssl_get_cached_session);
+  SSL_CTX_sess_set_remove_cb(ctx, ssl_rm_cached_session);
+}
+
+//
+// Resumption stats of the certificates, opt in with
+// proxy.config.ssl.cert_stats.max. Every certificate file takes two
+// records, so only the first cert_stats.max files get them. The stats of
+// a certificate outlive reconfigurations, a context of the new
+// configuration gets the stats of the same certificate file.
+//
+enum
+{
+  ssl_cert_resumptions_stat,
+  ssl_cert_full_handshakes_stat,
+  ssl_cert_stat_count
+};
+
+struct SSLCertStats
+{
+  char *name;
+  int base;                     // first stat of the certificate in ssl_cert_rsb
+  SSLCertStats *next;
+};
+
+static RecRawStatBlock *ssl_cert_rsb = NULL;
+static SSLCertStats *ssl_cert_stats = NULL;
+static int ssl_cert_stats_max = 0;
+static int ssl_cert_stats_used = 0;
+static ink_mutex ssl_cert_stats_mutex;
+
+static void
+ssl_cert_stat_name(char *buf, size_t len, const char *certname, const char *stat)
+{
+  int n = snprintf(buf, len, "proxy.process.ssl.cert.");
+  for (const char *c = certname; *c && n < (int)len - 1; c++)
+    buf[n++] = (ParseRules::is_alnum(*c) || *c == '-' || *c == '_') ? *c : '_';
+  buf[n] = '\0';
+  ink_strlcat(buf, stat, len);
+}
+
+void
+SSLCertStatsAttach(SSL_CTX *ctx, const char *certfile)
+{
+  char name[256];
+  SSLCertStats *stats;
+
+  if (ssl_cert_stats_index < 0)
+    return;
+
+  ink_mutex_acquire(&ssl_cert_stats_mutex);
+  for (stats = ssl_cert_stats; stats; stats = stats->next) {
+    if (!strcmp(stats->name, certfile))
+      break;
+  }
+  if (!stats) {
+    if (ssl_cert_stats_used == ssl_cert_stats_max) {
+      ink_mutex_release(&ssl_cert_stats_mutex);
+      Warning("no stats for certificate %s, proxy.config.ssl.cert_stats.max %d reached", certfile, ssl_cert_stats_max);
+      return;
+    }
+    stats = NEW(new SSLCertStats);
+    stats->name = ats_strdup(certfile);
+    stats->base = ssl_cert_stats_used++ * ssl_cert_stat_count;
+    ssl_cert_stat_name(name, sizeof(name), certfile, ".resumptions");
+    RecRegisterRawStat(ssl_cert_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL,
+                       stats->base + ssl_cert_resumptions_stat, RecRawStatSyncCount);
+    ssl_cert_stat_name(name, sizeof(name), certfile, ".full_handshakes");
+    RecRegisterRawStat(ssl_cert_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL,
+                       stats->base + ssl_cert_full_handshakes_stat, RecRawStatSyncCount);
+    stats->next = ssl_cert_stats;
+    ssl_cert_stats = stats;
+  }
+  ink_mutex_release(&ssl_cert_stats_mutex);
+
+  SSL_CTX_set_ex_data(ctx, ssl_cert_stats_index, stats);
+}
+
+void
+SSLCertStatsCount(SSL *ssl)
+{
+  if (ssl_cert_stats_index < 0)
+    return;
+
+  SSLCertStats *stats = (SSLCertStats *)SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ssl_cert_stats_index);
+  if (stats) {
+    int stat = SSL_session_reused(ssl) ? ssl_cert_resumptions_stat : ssl_cert_full_handshakes_stat;
+    RecIncrRawStat(ssl_cert_rsb, this_ethread(), stats->base + stat, 1);
+  }
+}
+
+void
+SSLSessionCacheInitialize(const SSLConfigParams *params)
+{
+  if (params->ssl_session_cache == SSLConfigParams::SSL_SESSION_CACHE_MODE_SERVER_SHARED && !ssl_session_cache) {
+    int nbuckets = params->ssl_session_cache_num_buckets > 0 ? params->ssl_session_cache_num_buckets : 1;
+    ssl_session_cache = NEW(new SSLSessionCache(params->ssl_session_cache_size, nbuckets));
+    Debug("ssl", "shared session cache of %d sessions in %d buckets", params->ssl_session_cache_size, nbuckets);
+  }
+
+  if (ssl_cert_stats_index < 0 && params->ssl_cert_stats_max > 0) {
+    ink_mutex_init(&ssl_cert_stats_mutex, "SSLCertStats");
+    ssl_cert_stats_max = params->ssl_cert_stats_max;
+    ssl_cert_rsb = RecAllocateRawStatBlock(ssl_cert_stats_max * ssl_cert_stat_count);
+    ssl_cert_stats_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  }
+}
@@ -23,6 +23,7 @@
 #include "libts.h"
 #include "I_Layout.h"
 #include "P_Net.h"
+#include "P_SSLSessionCache.h"
 
 #include <openssl/err.h>
 #include <openssl/bio.h>
@@ -75,6 +76,29 @@ struct ssl_ticket_key_t
   unsigned char aes_key[16];
 };
 
+// The keys of a ticket key file. The first key issues the tickets, the
+// others only resume the tickets they issued before a rotation.
+struct ssl_ticket_key_block
+{
+  unsigned num_keys;
+  ssl_ticket_key_t keys[1];
+};
+
+// A ticket key file shared by the contexts that name it. Files are never
+// released, a reload swaps the keys and frees the block retired by the
+// reload before, a handshake does not hold its keys that long.
+struct ssl_ticket_key_file
+{
+  char * path;
+  time_t mtime;
+  ssl_ticket_key_block * volatile keys;
+  ssl_ticket_key_block * retired;
+  ssl_ticket_key_file * next;
+};
+
+static ssl_ticket_key_file * ssl_ticket_key_files = NULL;
+static ink_mutex ssl_ticket_key_mutex;
+
 #if TS_USE_TLS_TICKETS
 static int ssl_callback_session_ticket(SSL *, unsigned char *, unsigned char *, EVP_CIPHER_CTX *, HMAC_CTX *, int);
 #endif /* TS_USE_TLS_TICKETS */
@@ -233,56 +257,159 @@ ssl_context_enable_ecdh(SSL_CTX * ctx)
   return ctx;
 }
 
-static SSL_CTX *
-ssl_context_enable_tickets(SSL_CTX * ctx, char * ticket_key_path)
-{
 #if TS_USE_TLS_TICKETS
-  xptr<char>          ticket_key_data;
-  int                 ticket_key_len;
-  ssl_ticket_key_t *  ticket_key = NULL;
+static ssl_ticket_key_block *
+ssl_ticket_key_block_read(const char * path, time_t * mtime)
+{
+  xptr<char>              ticket_key_data;
+  int                     ticket_key_len;
+  unsigned                num_keys;
+  ssl_ticket_key_block *  block;
+  struct stat             sbuf;
+
+  if (stat(path, &sbuf) < 0) {
+    Error("failed to stat SSL session ticket key file %s: %s", path, strerror(errno));
+    return NULL;
+  }
 
-  ticket_key_data = readIntoBuffer(ticket_key_path, __func__, &ticket_key_len);
+  ticket_key_data = readIntoBuffer((char *)path, __func__, &ticket_key_len);
   if (!ticket_key_data) {
-    Error("failed to read SSL session ticket key from %s", (const char *)ticket_key_path);
-    goto fail;
+    Error("failed to read SSL session ticket key from %s", path);
+    return NULL;
   }
 
-  if (ticket_key_len < 48) {
-    Error("SSL session ticket key from %s is too short (48 bytes are required)", (const char *)ticket_key_path);
-    goto fail;
+  num_keys = ticket_key_len / sizeof(ssl_ticket_key_t);
+  if (num_keys == 0) {
+    Error("SSL session ticket key from %s is too short (48 bytes are required)", path);
+    return NULL;
+  }
+
+  block = (ssl_ticket_key_block *)ats_malloc(sizeof(ssl_ticket_key_block) + (num_keys - 1) * sizeof(ssl_ticket_key_t));
+  block->num_keys = num_keys;
+  for (unsigned i = 0; i < num_keys; ++i) {
+    const char * data = (const char *)ticket_key_data + i * sizeof(ssl_ticket_key_t);
+    memcpy(block->keys[i].key_name, data, 16);
+    memcpy(block->keys[i].hmac_secret, data + 16, 16);
+    memcpy(block->keys[i].aes_key, data + 32, 16);
+  }
+
+  *mtime = sbuf.st_mtime;
+  return block;
+}
+
+static ssl_ticket_key_file *
+ssl_ticket_key_file_get(const char * path)
+{
+  ssl_ticket_key_file * file;
+
+  ink_mutex_acquire(&ssl_ticket_key_mutex);
+  for (file = ssl_ticket_key_files; file; file = file->next) {
+    if (strcmp(file->path, path) == 0) {
+      break;
+    }
+  }
+
+  if (!file) {
+    time_t mtime;
+    ssl_ticket_key_block * block = ssl_ticket_key_block_read(path, &mtime);
+
+    if (block) {
+      file = NEW(new ssl_ticket_key_file);
+      file->path = ats_strdup(path);
+      file->mtime = mtime;
+      file->keys = block;
+      file->retired = NULL;
+      file->next = ssl_ticket_key_files;
+      ssl_ticket_key_files = file;
+    }
+  }
+  ink_mutex_release(&ssl_ticket_key_mutex);
+
+  return file;
+}
+
+struct SSLTicketKeyReload : public Continuation
+{
+  int mainEvent(int event, Event * e)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(e);
+
+    ink_mutex_acquire(&ssl_ticket_key_mutex);
+    for (ssl_ticket_key_file * file = ssl_ticket_key_files; file; file = file->next) {
+      struct stat sbuf;
+      time_t mtime;
+
+      if (stat(file->path, &sbuf) < 0 || sbuf.st_mtime == file->mtime) {
+        continue;
+      }
+
+      ssl_ticket_key_block * block = ssl_ticket_key_block_read(file->path, &mtime);
+      if (block) {
+        ats_free(file->retired);
+        file->retired = file->keys;
+        INK_WRITE_MEMORY_BARRIER;
+        file->keys = block;
+        file->mtime = mtime;
+        Note("rotated the SSL session ticket keys of %s, %u keys", file->path, block->num_keys);
+      }
+    }
+    ink_mutex_release(&ssl_ticket_key_mutex);
+
+    return EVENT_CONT;
+  }
+
+  SSLTicketKeyReload() : Continuation(new_ProxyMutex())
+  {
+    SET_HANDLER(&SSLTicketKeyReload::mainEvent);
   }
+};
+#endif /* TS_USE_TLS_TICKETS */
+
+static SSL_CTX *
+ssl_context_enable_tickets(SSL_CTX * ctx, const char * ticket_key_path)
+{
+#if TS_USE_TLS_TICKETS
+  ssl_ticket_key_file * file = ssl_ticket_key_file_get(ticket_key_path);
 
-  ticket_key = NEW(new ssl_ticket_key_t());
-  memcpy(ticket_key->key_name, (const char *)ticket_key_data, 16);
-  memcpy(ticket_key->hmac_secret, (const char *)ticket_key_data + 16, 16);
-  memcpy(ticket_key->aes_key, (const char *)ticket_key_data + 32, 16);
+  if (!file) {
+    return ctx;
+  }
 
   // Setting the callback can only fail if OpenSSL does not recognize the
   // SSL_CTRL_SET_TLSEXT_TICKET_KEY_CB constant. we set the callback first
-  // so that we don't leave a ticket_key pointer attached if it fails.
+  // so that we don't leave a ticket key file attached if it fails.
   if (SSL_CTX_set_tlsext_ticket_key_cb(ctx, ssl_callback_session_ticket) == 0) {
     Error("failed to set session ticket callback");
-    goto fail;
+    return ctx;
   }
 
-  if (SSL_CTX_set_ex_data(ctx, ssl_session_ticket_index, ticket_key) == 0) {
+  if (SSL_CTX_set_ex_data(ctx, ssl_session_ticket_index, file) == 0) {
     Error ("failed to set session ticket data to ctx");
-    goto fail;
+    return ctx;
   }
 
   SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
   return ctx;
 
-fail:
-  delete ticket_key;
-  return ctx;
-
 #else /* TS_USE_TLS_TICKETS */
   (void)ticket_key_path;
   return ctx;
 #endif /* TS_USE_TLS_TICKETS */
 }
 
+void
+SSLTicketKeyReloadStartup(const SSLConfigParams * params)
+{
+#if TS_USE_TLS_TICKETS
+  if (params->ticket_key_reload_interval > 0) {
+    eventProcessor.schedule_every(NEW(new SSLTicketKeyReload), HRTIME_SECONDS(params->ticket_key_reload_interval), ET_CALL);
+  }
+#else
+  NOWARN_UNUSED(params);
+#endif
+}
+
 void
 SSLInitializeLibrary()
 {
@@ -302,11 +429,14 @@ SSLInitializeLibrary()
     CRYPTO_set_id_callback(SSL_pthreads_thread_id);
   }
 
-  int iRet = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
-  if (iRet == -1) {
-    SSLError("failed to create session ticket index");
+  if (!open_ssl_initialized) {
+    int iRet = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    if (iRet == -1) {
+      SSLError("failed to create session ticket index");
+    }
+    ssl_session_ticket_index = (iRet == -1 ? 0 : iRet);
+    ink_mutex_init(&ssl_ticket_key_mutex, "SSLTicketKeyFiles");
   }
-  ssl_session_ticket_index = (iRet == -1 ? 0 : iRet);
 
   open_ssl_initialized = true;
 }
@@ -391,6 +521,9 @@ SSLInitServerContext(
     SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
     SSL_CTX_sess_set_cache_size(ctx, params->ssl_session_cache_size);
     break;
+  case SSLConfigParams::SSL_SESSION_CACHE_MODE_SERVER_SHARED:
+    SSLSessionCacheEnable(ctx);
+    break;
   }
 
 #ifdef SSL_MODE_RELEASE_BUFFERS
@@ -575,7 +708,7 @@ asn1_strdup(ASN1_STRING * s)
 // table aliases for all of the subject and subjectAltNames. Note that we don't
 // deal with wildcards (yet).
 static void
-ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfile)
+ssl_index_certificate(SSLCertLookup * lookup, SSLCertContext * cc, const char * certfile)
 {
   X509_NAME * subject = NULL;
 
@@ -597,7 +730,7 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
       xptr<char> name(asn1_strdup(cn));
 
       Debug("ssl", "mapping '%s' to certificate %s", (const char *)name, certfile);
-      lookup->insert(ctx, name);
+      lookup->insert(cc, name);
     }
   }
 
@@ -613,7 +746,7 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
       if (name->type == GEN_DNS) {
         xptr<char> dns(asn1_strdup(name->d.dNSName));
         Debug("ssl", "mapping '%s' to certificate %s", (const char *)dns, certfile);
-        lookup->insert(ctx, dns);
+        lookup->insert(cc, dns);
       }
     }
 
@@ -623,25 +756,23 @@ ssl_index_certificate(SSLCertLookup * lookup, SSL_CTX * ctx, const char * certfi
   X509_free(cert);
 }
 
-static void
-ssl_store_ssl_context(
+static SSL_CTX *
+ssl_build_ssl_context(
     const SSLConfigParams * params,
     SSLCertLookup *         lookup,
-    xptr<char>& addr,
-    xptr<char>& cert,
-    xptr<char>& ca,
-    xptr<char>& key,
-    const int session_ticket_enabled,
-    xptr<char>& ticket_key_filename)
+    const char *            cert,
+    const char *            ca,
+    const char *            key,
+    const int               session_ticket_enabled,
+    const char *            ticket_key_filename)
 {
   SSL_CTX *   ctx;
   xptr<char>  certpath;
-  xptr<char>  session_key_path;
 
   ctx = ssl_context_enable_sni(SSLInitServerContext(params, cert, ca, key), lookup);
   if (!ctx) {
     SSLError("failed to create new SSL server context");
-    return;
+    return NULL;
   }
 
 #if TS_USE_TLS_NPN
@@ -650,39 +781,117 @@ ssl_store_ssl_context(
 
   certpath = Layout::relative_to(params->serverCertPathOnly, cert);
 
+#if defined(SSL_OP_NO_TICKET)
+  // Session tickets are enabled by default. Disable if explicitly requested.
+  if (session_ticket_enabled == 0) {
+      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+      Debug("ssl", "ssl session ticket is disabled");
+  }
+#endif
+  // Load the session ticket key if session tickets are not disabled and we have key name,
+  // of the certificate or of records.config.
+  if (session_ticket_enabled != 0 && ticket_key_filename) {
+    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
+    ssl_context_enable_tickets(ctx, ticket_key_path);
+  } else if (session_ticket_enabled != 0 && params->ticket_key_filename) {
+    ssl_context_enable_tickets(ctx, params->ticket_key_filename);
+  }
+
+  // The sessions of the shared cache and the tickets only resume on the
+  // certificate that issued them.
+  if (params->clientCertLevel == 0) {
+    unsigned char session_id_context[16];
+    ink_code_md5((unsigned char *)(const char *)certpath, strlen(certpath), session_id_context);
+    SSL_CTX_set_session_id_context(ctx, session_id_context, sizeof(session_id_context));
+  }
+  SSLCertStatsAttach(ctx, certpath);
+
+  return ctx;
+}
+
+// A lazy context that takes longer than this to build is reported.
+#define SSL_CONTEXT_LOAD_WARN_TIME HRTIME_MSECONDS(100)
+
+// The loader of the lazy certificates, on the first handshake that selects one. That handshake
+// waits for the certificate files, a slow build is reported.
+static SSL_CTX *
+ssl_load_lazy_context(SSLCertLookup * lookup, const SSLCertContext * cc)
+{
+  SSLConfig::scoped_config params;
+  ProxyMutex * mutex = this_ethread()->mutex;
+  ink_hrtime start = ink_get_hrtime();
+  SSL_CTX * ctx;
+
+  Debug("ssl", "loading the SSL context of certificate %s", cc->cert);
+  ctx = ssl_build_ssl_context(params, lookup, cc->cert, cc->ca, cc->key, cc->ticket_enabled, cc->ticket_key);
+
+  ink_hrtime elapsed = ink_get_hrtime() - start;
+  NET_INCREMENT_DYN_STAT(ssl_context_load_stat);
+  NET_SUM_DYN_STAT(ssl_context_load_time_stat, ink_hrtime_to_usec(elapsed));
+  if (elapsed > SSL_CONTEXT_LOAD_WARN_TIME) {
+    Warning("building the SSL context of certificate %s took %" PRId64 " ms", cc->cert,
+            (int64_t)ink_hrtime_to_msec(elapsed));
+  }
+
+  return ctx;
+}
+
+static void
+ssl_store_ssl_context(
+    const SSLConfigParams * params,
+    SSLCertLookup *         lookup,
+    xptr<char>& addr,
+    xptr<char>& cert,
+    xptr<char>& ca,
+    xptr<char>& key,
+    const int session_ticket_enabled,
+    xptr<char>& ticket_key_filename)
+{
+  SSLCertContext *  cc;
+  xptr<char>        certpath;
+  bool              is_default = addr && strcmp(addr, "*") == 0;
+
+  // With a context cache, only index the certificate names now and build the context on the first
+  // handshake for one of them. The default context bootstraps every handshake, it is never lazy.
+  if (params->ssl_context_cache_size > 0 && !is_default) {
+    cc = NEW(new SSLCertContext(cert, ca, key, session_ticket_enabled, ticket_key_filename));
+  } else {
+    SSL_CTX * ctx = ssl_build_ssl_context(params, lookup, cert, ca, key, session_ticket_enabled, ticket_key_filename);
+    if (!ctx) {
+      return;
+    }
+    cc = NEW(new SSLCertContext(ctx));
+  }
+
+  certpath = Layout::relative_to(params->serverCertPathOnly, cert);
+
   // Index this certificate by the specified IP(v6) address. If the address is "*", make it the default context.
   if (addr) {
-    if (strcmp(addr, "*") == 0) {
-      lookup->ssl_default = ctx;
-      lookup->insert(ctx, addr);
+    if (is_default) {
+      lookup->ssl_default = cc->ctx;
+      lookup->insert(cc, addr);
     } else {
       IpEndpoint ep;
 
       if (ats_ip_pton(addr, &ep) == 0) {
         Debug("ssl", "mapping '%s' to certificate %s", (const char *)addr, (const char *)certpath);
-        lookup->insert(ctx, ep);
+        lookup->insert(cc, ep);
       } else {
         Error("'%s' is not a valid IPv4 or IPv6 address", (const char *)addr);
       }
     }
   }
-#if defined(SSL_OP_NO_TICKET)
-  // Session tickets are enabled by default. Disable if explicitly requested.
-  if (session_ticket_enabled == 0) {
-      SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
-      Debug("ssl", "ssl session ticket is disabled");
-  }
-#endif
-  // Load the session ticket key if session tickets are not disabled and we have key name.
-  if (session_ticket_enabled != 0 && ticket_key_filename) {
-    xptr<char> ticket_key_path(Layout::relative_to(params->serverCertPathOnly, ticket_key_filename));
-    ssl_context_enable_tickets(ctx, ticket_key_path);
-  }
 
-  // Insert additional mappings. Note that this maps multiple keys to the same value, so when
-  // this code is updated to reconfigure the SSL certificates, it will need some sort of
-  // refcounting or alternate way of avoiding double frees.
-  ssl_index_certificate(lookup, ctx, certpath);
+  // Insert additional mappings. All the names share the SSLCertContext, the lookup owns it once
+  // it is indexed by any of them.
+  ssl_index_certificate(lookup, cc, certpath);
+
+  if (!cc->indexed) {
+    if (cc->ctx) {
+      SSLReleaseContext(cc->ctx);
+    }
+    delete cc;
+  }
 }
 
 static bool
@@ -759,6 +968,9 @@ SSLParseCertificateConfiguration(
 
   Note("loading SSL certificate configuration from %s", params->configFilePath);
 
+  lookup->loader = ssl_load_lazy_context;
+  lookup->context_max = params->ssl_context_cache_size;
+
   if (params->configFilePath) {
     file_buf = readIntoBuffer(params->configFilePath, __func__, NULL);
   }
@@ -816,6 +1028,7 @@ SSLParseCertificateConfiguration(
     lookup->insert(lookup->ssl_default, "*");
   }
 
+  Note("indexed %u SSL certificates%s", lookup->count(), lookup->context_max > 0 ? ", loading their contexts on first use" : "");
   return true;
 }
 
@@ -832,33 +1045,47 @@ int ssl_callback_session_ticket(SSL *ssl,
                                HMAC_CTX *hctx,
                                int enc)
 {
-  ssl_ticket_key_t* ssl_ticket_key = (ssl_ticket_key_t*) SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ssl_session_ticket_index);
-  if (NULL == ssl_ticket_key) {
+  ssl_ticket_key_file * file = (ssl_ticket_key_file *) SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ssl_session_ticket_index);
+  ProxyMutex * mutex = this_ethread()->mutex;
+  if (NULL == file) {
     Error("ssl ticket key is null.");
     return -1;
   }
 
+  ssl_ticket_key_block * block = file->keys;
+
   if (enc == 1) {
-    memcpy(keyname, ssl_ticket_key->key_name, 16);
+    const ssl_ticket_key_t * key = &block->keys[0];
+
+    memcpy(keyname, key->key_name, 16);
     RAND_pseudo_bytes(iv, EVP_MAX_IV_LENGTH);
-    EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL,
-        ssl_ticket_key->aes_key, iv);
-    HMAC_Init_ex(hctx, ssl_ticket_key->hmac_secret, 16, evp_md_func, NULL);
-    Note("create ticket for a new session");
+    EVP_EncryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key->aes_key, iv);
+    HMAC_Init_ex(hctx, key->hmac_secret, 16, evp_md_func, NULL);
+    Debug("ssl", "create ticket for a new session");
 
-    return 0;
+    return 1;
   } else if (enc == 0) {
-    if (memcmp(keyname, ssl_ticket_key->key_name, 16)) {
-      Error("keyname is not consistent.");
-      return 0;
+    for (unsigned i = 0; i < block->num_keys; ++i) {
+      const ssl_ticket_key_t * key = &block->keys[i];
+
+      if (memcmp(keyname, key->key_name, 16) == 0) {
+        EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL, key->aes_key, iv);
+        HMAC_Init_ex(hctx, key->hmac_secret, 16, evp_md_func, NULL);
+
+        // A ticket of a retired key resumes the session and is renewed
+        // with the current key.
+        if (i == 0) {
+          NET_INCREMENT_DYN_STAT(ssl_session_ticket_hit_stat);
+          return 1;
+        }
+        NET_INCREMENT_DYN_STAT(ssl_session_ticket_renewal_stat);
+        return 2;
+      }
     }
 
-    EVP_DecryptInit_ex(cipher_ctx, EVP_aes_128_cbc(), NULL,
-        ssl_ticket_key->aes_key, iv);
-    HMAC_Init_ex(hctx, ssl_ticket_key->hmac_secret, 16, evp_md_func, NULL);
-
-    Note("verify the ticket for an existing session." );
-    return 1;
+    Debug("ssl", "the ticket key name is unknown, full handshake");
+    NET_INCREMENT_DYN_STAT(ssl_session_ticket_miss_stat);
+    return 0;
   }
 
   return -1;
@@ -868,13 +1095,7 @@ int ssl_callback_session_ticket(SSL *ssl,
 void
 SSLReleaseContext(SSL_CTX * ctx)
 {
-  ssl_ticket_key_t * ssl_ticket_key = (ssl_ticket_key_t*)SSL_CTX_get_ex_data(ctx, ssl_session_ticket_index);
-
-  // Free the ticket if this is the last reference.
-  if (ctx->references == 1 && ssl_ticket_key) {
-    delete ssl_ticket_key;
-  }
-
+  // The ticket key files are shared by the contexts and outlive them.
   SSL_CTX_free(ctx);
 }
 
@@ -39,7 +39,7 @@ int
 SpdyAcceptCont::mainEvent(int event, void *netvc)
 {
 #if TS_HAS_SPDY
-  spdy_sm_create((TSCont)netvc);
+  spdy_sm_create((TSCont)netvc, endpoint);
 #endif
   return 0;
 }
@@ -31,30 +31,19 @@ spdy_callbacks_init(spdylay_session_callbacks *callbacks)
 void
 spdy_prepare_status_response(SpdySM *sm, int stream_id, const char *status)
 {
-  SpdyRequest *req = sm->req_map[stream_id];
   string date_str = http_date(time(0));
-  const char **nv = new const char*[8+req->headers.size()*2+1];
-
-  nv[0] = ":status";
-  nv[1] = status;
-  nv[2] = ":version";
-  nv[3] = "HTTP/1.1";
-  nv[4] = "server";
-  nv[5] = SPDYD_SERVER;
-  nv[6] = "date";
-  nv[7] = date_str.c_str();
-
-  for(size_t i = 0; i < req->headers.size(); ++i) {
-    nv[8+i*2] = req->headers[i].first.c_str();
-    nv[8+i*2+1] = req->headers[i].second.c_str();
-  }
-  nv[8+req->headers.size()*2] = 0;
+  const char *nv[] = {
+    ":status", status,
+    ":version", "HTTP/1.1",
+    "server", SPDYD_SERVER,
+    "date", date_str.c_str(),
+    NULL
+  };
 
   int r = spdylay_submit_response(sm->session, stream_id, nv, NULL);
   TSAssert(r == 0);
 
   TSVIOReenable(sm->write_vio);
-  delete [] nv;
 }
 
 static void
@@ -143,48 +132,6 @@ spdy_show_ctl_frame(const char *head_str, spdylay_session *session, spdylay_fram
   return;
 }
 
-static int
-spdy_fetcher_launch(SpdyRequest *req, TSFetchMethod method)
-{
-  string url;
-  int fetch_flags;
-  const sockaddr *client_addr;
-  SpdySM *sm = req->spdy_sm;
-  NetVConnection *vc = (NetVConnection *)sm->net_vc;
-
-  url = req->scheme + "://" + req->host + req->path;
-  client_addr = TSNetVConnRemoteAddrGet(sm->net_vc);
-
-  req->url = url;
-  Debug("spdy", "++++Request[%" PRIu64 ":%d] %s\n", sm->sm_id, req->stream_id, req->url.c_str());
-
-  //
-  // HTTP content should be dechunked before packed into SPDY.
-  //
-  fetch_flags = TS_FETCH_FLAGS_DECHUNK;
-  req->fetch_sm = TSFetchCreate(sm->contp, method,
-                                url.c_str(), req->version.c_str(),
-                                client_addr, fetch_flags);
-  TSFetchUserDataSet(req->fetch_sm, req);
-  TSFetchProtoTypeSet(req->fetch_sm, (TSNetProtoType)vc->proto_type);
-
-  //
-  // Set header list
-  //
-  for (size_t i = 0; i < req->headers.size(); i++) {
-
-    if (*req->headers[i].first.c_str() == ':')
-      continue;
-
-    TSFetchHeaderAdd(req->fetch_sm,
-                     req->headers[i].first.c_str(), req->headers[i].first.size(),
-                     req->headers[i].second.c_str(), req->headers[i].second.size());
-  }
-
-  TSFetchLaunch(req->fetch_sm);
-  return 0;
-}
-
 ssize_t
 spdy_send_callback(spdylay_session *session, const uint8_t *data, size_t length,
                    int flags, void *user_data)
@@ -239,60 +186,12 @@ spdy_recv_callback(spdylay_session *session, uint8_t *buf, size_t length,
   return already;
 }
 
-static void
-spdy_process_syn_stream_frame(SpdySM *sm, SpdyRequest *req)
-{
-  // validate request headers
-  for(size_t i = 0; i < req->headers.size(); ++i) {
-    const std::string &field = req->headers[i].first;
-    const std::string &value = req->headers[i].second;
-
-    if(field == ":path")
-      req->path = value;
-    else if(field == ":method")
-      req->method = value;
-    else if(field == ":scheme")
-      req->scheme = value;
-    else if(field == ":version")
-      req->version = value;
-    else if(field == ":host")
-      req->host = value;
-  }
-
-  if(!req->path.size()|| !req->method.size() || !req->scheme.size()
-     || !req->version.size() || !req->host.size()) {
-    spdy_prepare_status_response(sm, req->stream_id, STATUS_400);
-    return;
-  }
-
-
-  if (req->method == "GET")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_GET);
-  else if (req->method == "POST")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_POST);
-  else if (req->method == "PURGE")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_PURGE);
-  else if (req->method == "PUT")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_PUT);
-  else if (req->method == "HEAD")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_HEAD);
-  else if (req->method == "CONNECT")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_CONNECT);
-  else if (req->method == "DELETE")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_DELETE);
-  else if (req->method == "LAST")
-    spdy_fetcher_launch(req, TS_FETCH_METHOD_LAST);
-  else
-    spdy_prepare_status_response(sm, req->stream_id, STATUS_405);
-
-}
-
 void
 spdy_on_ctrl_recv_callback(spdylay_session *session, spdylay_frame_type type,
                            spdylay_frame *frame, void *user_data)
 {
   int         stream_id;
-  SpdyRequest *req;
+  SpdyClientStream *stream;
   SpdySM      *sm = (SpdySM*)user_data;
 
   spdy_show_ctl_frame("++++RECV", session, type, frame, user_data);
@@ -301,17 +200,29 @@ spdy_on_ctrl_recv_callback(spdylay_session *session, spdylay_frame_type type,
 
   case SPDYLAY_SYN_STREAM:
     stream_id = frame->syn_stream.stream_id;
-    req = spdyRequestAllocator.alloc();
-    req->init(sm, stream_id);
-    req->append_nv(frame->syn_stream.nv);
-    sm->req_map[stream_id] = req;
-    spdy_process_syn_stream_frame(sm, req);
+    stream = spdyClientStreamAllocator.alloc();
+    stream->init(sm, stream_id);
+    if (!stream->recv_headers(frame->syn_stream.nv,
+                              frame->syn_stream.hd.flags & SPDYLAY_CTRL_FLAG_FIN)) {
+      stream->detach();
+      stream->do_io_close();
+      spdy_prepare_status_response(sm, stream_id, STATUS_400);
+      break;
+    }
+    sm->stream_map[stream_id] = stream;
+
+    //
+    // The stream is accepted like a client connection, the HTTP
+    // endpoint attaches a client session and an HttpSM to it.
+    //
+    sm->endpoint->handleEvent(NET_EVENT_ACCEPT, stream);
     break;
 
   case SPDYLAY_HEADERS:
-    stream_id = frame->syn_stream.stream_id;
-    req = sm->req_map[stream_id];
-    req->append_nv(frame->headers.nv);
+    //
+    // The request header has been handed to the HttpSM
+    // with SYN_STREAM, later headers are ignored.
+    //
     break;
 
   case SPDYLAY_WINDOW_UPDATE:
@@ -340,16 +251,16 @@ spdy_on_data_chunk_recv_callback(spdylay_session *session, uint8_t flags,
                                  size_t len, void *user_data)
 {
   SpdySM *sm = (SpdySM *)user_data;
-  SpdyRequest *req = sm->req_map[stream_id];
+  SpdyClientStream *stream = sm->find_stream(stream_id);
 
   //
-  // SpdyRequest has been deleted on error, drop this data;
+  // The stream has been closed on error, drop this data;
   //
-  if (!req)
+  if (!stream)
     return;
 
-  Debug("spdy", "++++Fetcher Append Data, len:%zu\n", len);
-  TSFetchWriteData(req->fetch_sm, data, len);
+  Debug("spdy", "++++Stream Append Data, len:%zu\n", len);
+  stream->recv_data(data, len);
 
   return;
 }
@@ -359,28 +270,31 @@ spdy_on_data_recv_callback(spdylay_session *session, uint8_t flags,
                            int32_t stream_id, int32_t length, void *user_data)
 {
   SpdySM *sm = (SpdySM *)user_data;
-  SpdyRequest *req = sm->req_map[stream_id];
+  SpdyClientStream *stream = sm->find_stream(stream_id);
 
   spdy_show_data_frame("++++RECV", session, flags, stream_id, length, user_data);
 
   //
-  // After SpdyRequest has been deleted on error, the corresponding
+  // After the stream has been closed on error, the corresponding
   // client might continue to send POST data, We should reenable
   // sm->write_vio so that WINDOW_UPDATE has a chance to be sent.
   //
-  if (!req) {
+  if (!stream) {
     TSVIOReenable(sm->write_vio);
     return;
   }
 
-  req->delta_window_size += length;
+  if (flags & SPDYLAY_DATA_FLAG_FIN)
+    stream->recv_fin();
+
+  stream->delta_window_size += length;
 
   Debug("spdy", "----sm_id:%"PRId64", stream_id:%d, delta_window_size:%d\n",
-        sm->sm_id, stream_id, req->delta_window_size);
+        sm->sm_id, stream_id, stream->delta_window_size);
 
-  if (req->delta_window_size >= SPDY_CFG.spdy.initial_window_size/2) {
+  if (stream->delta_window_size >= SPDY_CFG.spdy.initial_window_size/2) {
     Debug("spdy", "----Reenable write_vio for WINDOW_UPDATE frame, delta_window_size:%d\n",
-          req->delta_window_size);
+          stream->delta_window_size);
 
     //
     // Need not to send WINDOW_UPDATE frame here, what we should
@@ -389,7 +303,7 @@ spdy_on_data_recv_callback(spdylay_session *session, uint8_t flags,
     //
     TSVIOReenable(sm->write_vio);
 
-    req->delta_window_size = 0;
+    stream->delta_window_size = 0;
   }
 
   return;
@@ -438,7 +352,13 @@ void
 spdy_on_stream_close_callback(spdylay_session *session, int32_t stream_id,
                               spdylay_status_code status_code, void *user_data)
 {
-  //TODO
+  SpdySM *sm = (SpdySM *)user_data;
+  SpdyClientStream *stream = sm->find_stream(stream_id);
+
+  if (stream) {
+    sm->stream_map.erase(stream_id);
+    stream->detach();
+  }
   return;
 }
 
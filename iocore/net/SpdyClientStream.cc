@@ -0,0 +1,762 @@
+/** @file
+
+  SpdyClientStream
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_SpdyClientStream.h"
+#include "P_SpdySM.h"
+
+#define SPDY_STREAM_TIMEOUT_PERIOD HRTIME_SECONDS(1)
+
+ClassAllocator<SpdyClientStream> spdyClientStreamAllocator("spdyClientStreamAllocator");
+
+static ssize_t
+spdy_stream_read_callback(spdylay_session *session, int32_t stream_id,
+                          uint8_t *buf, size_t length, int *eof,
+                          spdylay_data_source *source, void *user_data)
+{
+  SpdyClientStream *stream = (SpdyClientStream *)source->ptr;
+  return stream->send_data(buf, length, eof);
+}
+
+//
+// According SPDY v3 spec, these hop by hop headers are not valid
+// in a SPDY stream, they are dropped in both directions.
+//
+static bool
+spdy_skip_header(const char *name, int len)
+{
+  switch (len) {
+  case 10:
+    return !strncasecmp(name, "Connection", 10) || !strncasecmp(name, "Keep-Alive", 10);
+  case 16:
+    return !strncasecmp(name, "Proxy-Connection", 16);
+  case 17:
+    return !strncasecmp(name, "Transfer-Encoding", 17);
+  default:
+    return false;
+  }
+}
+
+SpdyClientStream::SpdyClientStream():
+  NetVConnection(), spdy_sm(NULL), stream_id(-1), delta_window_size(0),
+  req_buffer(NULL), req_reader(NULL), resp_buffer(NULL), resp_reader(NULL),
+  req_chunked(false), req_fin(false), resp_header_done(false), resp_submitted(false),
+  resp_eof(false), data_deferred(false), write_ready(false), write_shutdown(false),
+  closed(false), close_processed(false), attached(false), in_handler(false),
+  process_event(NULL), timeout_event(NULL), active_timeout(0), inactive_timeout(0),
+  active_deadline(0), inactive_deadline(0)
+{
+  SET_HANDLER(&SpdyClientStream::main_handler);
+}
+
+void
+SpdyClientStream::init(SpdySM *sm, int32_t id)
+{
+  NetVConnection *netvc = (NetVConnection *)sm->net_vc;
+
+  spdy_sm = sm;
+  stream_id = id;
+  delta_window_size = 0;
+  attached = true;
+
+  mutex = ((Continuation *)sm->contp)->mutex;
+  thread = this_ethread();
+  proto_type = netvc->proto_type;
+  ats_ip_copy(&remote_addr, netvc->get_remote_addr());
+  got_remote_addr = true;
+  ats_ip_copy(&local_addr, netvc->get_local_addr());
+  got_local_addr = true;
+
+  req_buffer = new_MIOBuffer(BUFFER_SIZE_INDEX_4K);
+  req_reader = req_buffer->alloc_reader();
+
+  http_parser_init(&resp_parser);
+  resp_hdr.create(HTTP_TYPE_RESPONSE);
+}
+
+bool
+SpdyClientStream::recv_headers(char **nv, bool fin)
+{
+  const char *method = NULL, *path = NULL, *scheme = NULL;
+  const char *version = NULL, *host = NULL;
+  bool has_length = false;
+
+  for (int i = 0; nv[i]; i += 2) {
+    const char *name = nv[i];
+
+    if (*name == ':') {
+      if (!strcmp(name, ":method"))
+        method = nv[i + 1];
+      else if (!strcmp(name, ":path"))
+        path = nv[i + 1];
+      else if (!strcmp(name, ":scheme"))
+        scheme = nv[i + 1];
+      else if (!strcmp(name, ":version"))
+        version = nv[i + 1];
+      else if (!strcmp(name, ":host"))
+        host = nv[i + 1];
+    } else if (!strcasecmp(name, "content-length")) {
+      has_length = true;
+    }
+  }
+
+  if (!method || !path || !scheme || !version || !host)
+    return false;
+
+  //
+  // The request header is built from the name/value block, the HttpSM
+  // takes it from get_request_header() instead of parsing text.
+  //
+  int scheme_len = strlen(scheme);
+  int host_len = strlen(host);
+  int path_len = strlen(path);
+  int url_len = scheme_len + 3 + host_len + path_len;
+  char *url_str = (char *)ats_malloc(url_len);
+  URL url;
+  MIMEParseResult r;
+
+  memcpy(url_str, scheme, scheme_len);
+  memcpy(url_str + scheme_len, "://", 3);
+  memcpy(url_str + scheme_len + 3, host, host_len);
+  memcpy(url_str + scheme_len + 3 + host_len, path, path_len);
+
+  req_hdr.create(HTTP_TYPE_REQUEST);
+  req_hdr.method_set(method, strlen(method));
+  req_hdr.version_set(HTTPVersion(http_parse_version(version, version + strlen(version))));
+  r = req_hdr.url_get(&url)->parse(url_str, url_len);
+  ats_free(url_str);
+  if (r == PARSE_ERROR) {
+    req_hdr.destroy();
+    return false;
+  }
+
+  for (int i = 0; nv[i]; i += 2) {
+    int len = strlen(nv[i]);
+
+    if (*nv[i] == ':' || spdy_skip_header(nv[i], len) || !strcasecmp(nv[i], "host"))
+      continue;
+
+    MIMEField *field = req_hdr.field_create(nv[i], len);
+    req_hdr.field_value_set(field, nv[i + 1], strlen(nv[i + 1]));
+    req_hdr.field_attach(field);
+  }
+
+  //
+  // A request body without Content-Length is chunked into req_buffer,
+  // the HttpSM would not read it otherwise.
+  //
+  req_fin = fin;
+  req_chunked = !fin && !has_length;
+
+  req_hdr.value_set(MIME_FIELD_HOST, MIME_LEN_HOST, host, host_len);
+  if (req_chunked)
+    req_hdr.value_set(MIME_FIELD_TRANSFER_ENCODING, MIME_LEN_TRANSFER_ENCODING, HTTP_VALUE_CHUNKED, HTTP_LEN_CHUNKED);
+
+  //
+  // One transaction per stream: the HttpSM must not keep the stream
+  // alive, and does not chunk the response for a closing client.
+  //
+  req_hdr.value_set(MIME_FIELD_CONNECTION, MIME_LEN_CONNECTION, HTTP_VALUE_CLOSE, HTTP_LEN_CLOSE);
+
+  Debug("spdy", "++++Stream[%" PRIu64 ":%d] %s %s://%s%s", spdy_sm->sm_id, stream_id,
+        method, scheme, host, path);
+  schedule_process();
+  return true;
+}
+
+void
+SpdyClientStream::recv_data(const uint8_t *data, size_t len)
+{
+  if (closed || req_fin)
+    return;
+
+  if (req_chunked) {
+    char chunk_size[32];
+    int n = snprintf(chunk_size, sizeof(chunk_size), "%zx\r\n", len);
+    req_buffer->write(chunk_size, n);
+    req_buffer->write(data, len);
+    req_buffer->write("\r\n", 2);
+  } else {
+    req_buffer->write(data, len);
+  }
+  schedule_process();
+}
+
+void
+SpdyClientStream::recv_fin()
+{
+  if (closed || req_fin)
+    return;
+
+  req_fin = true;
+  if (req_chunked) {
+    req_buffer->write("0\r\n\r\n", 5);
+    schedule_process();
+  }
+}
+
+void
+SpdyClientStream::detach()
+{
+  attached = false;
+  spdy_sm = NULL;
+
+  if (close_processed)
+    free_stream();
+  else
+    schedule_process();
+}
+
+ssize_t
+SpdyClientStream::send_data(uint8_t *buf, size_t length, int *eof)
+{
+  IOBufferReader *reader = NULL;
+  int64_t n = 0;
+  bool done;
+
+  if (resp_reader)
+    reader = resp_reader;
+  else if (!closed && write_vio.op == VIO::WRITE)
+    reader = write_vio.get_reader();
+
+  if (reader) {
+    n = reader->read_avail();
+    if (n > (int64_t)length)
+      n = length;
+    if (n > 0) {
+      reader->read(buf, n);
+      if (reader != resp_reader) {
+        write_vio.ndone += n;
+        write_ready = true;
+        schedule_process();
+      }
+    }
+  }
+
+  if (resp_reader)
+    done = resp_reader->read_avail() == 0;
+  else
+    done = reader == NULL || write_vio.ntodo() == 0 || (write_shutdown && reader->read_avail() == 0);
+
+  if (done) {
+    *eof = 1;
+    resp_eof = true;
+    return n;
+  }
+
+  if (n == 0) {
+    data_deferred = true;
+    return SPDYLAY_ERR_DEFERRED;
+  }
+
+  if (inactive_timeout)
+    inactive_deadline = ink_get_hrtime() + inactive_timeout;
+  return n;
+}
+
+int
+SpdyClientStream::main_handler(int event, void *data)
+{
+  if (data == process_event)
+    process_event = NULL;
+
+  if (close_processed)
+    return EVENT_DONE;
+
+  in_handler = true;
+
+  if (data == timeout_event && timeout_event) {
+    ink_hrtime now = ink_get_hrtime();
+
+    if (active_deadline && now >= active_deadline) {
+      active_deadline = 0;
+      process_timeout(VC_EVENT_ACTIVE_TIMEOUT);
+    } else if (inactive_deadline && now >= inactive_deadline) {
+      inactive_deadline = 0;
+      process_timeout(VC_EVENT_INACTIVITY_TIMEOUT);
+    }
+  }
+
+  //
+  // The write side goes first: once the response is complete the HttpSM
+  // closes the stream, it must not see the EOS of a finished stream.
+  //
+  if (!closed)
+    process_write();
+  if (!closed)
+    process_read();
+
+  in_handler = false;
+  if (closed)
+    process_close();
+
+  return EVENT_DONE;
+}
+
+void
+SpdyClientStream::signal(VIO *vio, int event)
+{
+  vio->_cont->handleEvent(event, vio);
+}
+
+void
+SpdyClientStream::schedule_process()
+{
+  if (!process_event && !close_processed)
+    process_event = this_ethread()->schedule_imm(this);
+}
+
+void
+SpdyClientStream::schedule_timeout()
+{
+  if (!timeout_event && (active_deadline || inactive_deadline))
+    timeout_event = this_ethread()->schedule_every(this, SPDY_STREAM_TIMEOUT_PERIOD);
+}
+
+void
+SpdyClientStream::process_read()
+{
+  int64_t n;
+
+  if (read_vio.op != VIO::READ || !read_vio.buffer.writer() || read_vio.ntodo() <= 0)
+    return;
+
+  n = req_reader->read_avail();
+  if (n > read_vio.ntodo())
+    n = read_vio.ntodo();
+
+  if (n > 0) {
+    read_vio.buffer.writer()->write(req_reader, n);
+    req_reader->consume(n);
+    read_vio.ndone += n;
+    if (inactive_timeout)
+      inactive_deadline = ink_get_hrtime() + inactive_timeout;
+    signal(&read_vio, read_vio.ntodo() == 0 ? VC_EVENT_READ_COMPLETE : VC_EVENT_READ_READY);
+  } else if (!attached && !resp_eof) {
+    // the session went away before the response was sent
+    signal(&read_vio, VC_EVENT_EOS);
+  }
+}
+
+void
+SpdyClientStream::process_write()
+{
+  if (write_vio.op != VIO::WRITE || !write_vio.buffer.reader())
+    return;
+
+  if (!attached) {
+    if (!resp_eof)
+      signal(&write_vio, VC_EVENT_ERROR);
+    return;
+  }
+
+  if (!resp_header_done && !process_response_header())
+    return;
+
+  if (write_ready) {
+    write_ready = false;
+    signal(&write_vio, write_vio.ntodo() == 0 ? VC_EVENT_WRITE_COMPLETE : VC_EVENT_WRITE_READY);
+    if (closed || !attached)
+      return;
+  }
+
+  if (data_deferred && (write_vio.get_reader()->read_avail() > 0 || write_vio.ntodo() == 0)) {
+    data_deferred = false;
+    spdylay_session_resume_data(spdy_sm->session, stream_id);
+    TSVIOReenable(spdy_sm->write_vio);
+  }
+}
+
+bool
+SpdyClientStream::process_response_header()
+{
+  IOBufferReader *reader = write_vio.get_reader();
+  int bytes_used;
+
+  while (reader->read_avail() > 0) {
+    MIMEParseResult r = resp_hdr.parse_resp(&resp_parser, reader, &bytes_used, false);
+    write_vio.ndone += bytes_used;
+
+    if (r == PARSE_CONT)
+      return false;
+
+    if (r == PARSE_ERROR) {
+      Debug("spdy", "----Stream[%" PRIu64 ":%d] bad response header", spdy_sm->sm_id, stream_id);
+      resp_header_done = true;
+      resp_submitted = true;
+      resp_eof = true;
+      spdy_prepare_status_response(spdy_sm, stream_id, STATUS_500);
+      signal(&write_vio, VC_EVENT_ERROR);
+      return false;
+    }
+
+    // interim responses are not forwarded
+    if (resp_hdr.status_get() < 200) {
+      resp_hdr.destroy();
+      resp_hdr.create(HTTP_TYPE_RESPONSE);
+      http_parser_clear(&resp_parser);
+      http_parser_init(&resp_parser);
+      continue;
+    }
+
+    submit_response();
+    resp_header_done = true;
+    write_ready = true;
+    return true;
+  }
+
+  return false;
+}
+
+void
+SpdyClientStream::submit_response()
+{
+  MIMEFieldIter iter;
+  MIMEField *field;
+  char status[64];
+  char version[32];
+  int nr_fields = 0;
+  int len;
+
+  for (field = resp_hdr.iter_get_first(&iter); field; field = resp_hdr.iter_get_next(&iter))
+    nr_fields++;
+
+  //
+  // spdylay copies the name/value block, so it is built on one
+  // temporary buffer of the size of the printed header.
+  //
+  const char **nv = (const char **)ats_malloc((2 * nr_fields + 5) * sizeof(char *));
+  char *strings = (char *)ats_malloc(resp_hdr.length_get() + 2 * nr_fields);
+  char *p = strings;
+  int i = 0;
+
+  HTTPVersion v = resp_hdr.version_get();
+  snprintf(version, sizeof(version), "HTTP/%d.%d", HTTP_MAJOR(v.m_version), HTTP_MINOR(v.m_version));
+  const char *reason = resp_hdr.reason_get(&len);
+  snprintf(status, sizeof(status), "%d %.*s", (int)resp_hdr.status_get(), reason ? len : 0, reason ? reason : "");
+
+  nv[i++] = ":version";
+  nv[i++] = version;
+  nv[i++] = ":status";
+  nv[i++] = status;
+
+  for (field = resp_hdr.iter_get_first(&iter); field; field = resp_hdr.iter_get_next(&iter)) {
+    const char *name = field->name_get(&len);
+
+    if (spdy_skip_header(name, len))
+      continue;
+
+    memcpy(p, name, len);
+    nv[i++] = p;
+    p += len;
+    *p++ = '\0';
+
+    const char *value = field->value_get(&len);
+    memcpy(p, value, len);
+    nv[i++] = p;
+    p += len;
+    *p++ = '\0';
+  }
+  nv[i] = NULL;
+
+  spdylay_data_provider data_prd;
+  data_prd.source.ptr = (void *)this;
+  data_prd.read_callback = spdy_stream_read_callback;
+
+  Debug("spdy", "----Stream[%" PRIu64 ":%d] spdylay_submit_response %s", spdy_sm->sm_id, stream_id, status);
+  int r = spdylay_submit_response(spdy_sm->session, stream_id, nv, &data_prd);
+  TSAssert(r == 0);
+  resp_submitted = true;
+
+  ats_free(strings);
+  ats_free(nv);
+
+  TSVIOReenable(spdy_sm->write_vio);
+}
+
+void
+SpdyClientStream::process_timeout(int event)
+{
+  if (read_vio.op == VIO::READ && read_vio.ntodo() > 0)
+    signal(&read_vio, event);
+  else if (write_vio.op == VIO::WRITE)
+    signal(&write_vio, event);
+}
+
+void
+SpdyClientStream::process_close()
+{
+  close_processed = true;
+
+  if (timeout_event) {
+    timeout_event->cancel();
+    timeout_event = NULL;
+  }
+  if (process_event) {
+    process_event->cancel();
+    process_event = NULL;
+  }
+
+  if (!attached) {
+    free_stream();
+    return;
+  }
+
+  //
+  // The stream stays in the SpdySM until spdylay closes it, the
+  // response is finished (or failed) here.
+  //
+  if (!resp_submitted) {
+    resp_submitted = true;
+    resp_eof = true;
+    spdy_prepare_status_response(spdy_sm, stream_id, STATUS_500);
+  } else if (!resp_eof && data_deferred) {
+    data_deferred = false;
+    spdylay_session_resume_data(spdy_sm->session, stream_id);
+  }
+  TSVIOReenable(spdy_sm->write_vio);
+}
+
+void
+SpdyClientStream::free_stream()
+{
+  if (req_buffer) {
+    free_MIOBuffer(req_buffer);
+    req_buffer = NULL;
+    req_reader = NULL;
+  }
+  if (resp_buffer) {
+    free_MIOBuffer(resp_buffer);
+    resp_buffer = NULL;
+    resp_reader = NULL;
+  }
+  req_hdr.destroy();
+  resp_hdr.destroy();
+  http_parser_clear(&resp_parser);
+
+  read_vio.mutex.clear();
+  write_vio.mutex.clear();
+  mutex.clear();
+  spdyClientStreamAllocator.free(this);
+}
+
+VIO *
+SpdyClientStream::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
+{
+  ink_assert(!closed);
+
+  if (buf) {
+    read_vio.buffer.writer_for(buf);
+  } else {
+    read_vio.buffer.clear();
+  }
+
+  read_vio.mutex = c ? c->mutex : mutex;
+  read_vio._cont = c;
+  read_vio.nbytes = nbytes;
+  read_vio.ndone = 0;
+  read_vio.vc_server = (VConnection *)this;
+  read_vio.op = VIO::READ;
+
+  // no reentrant callbacks from do_io
+  schedule_process();
+  return &read_vio;
+}
+
+VIO *
+SpdyClientStream::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *buf, bool owner)
+{
+  ink_assert(!closed);
+  ink_assert(!owner);
+
+  if (buf) {
+    write_vio.buffer.reader_for(buf);
+  } else {
+    write_vio.buffer.clear();
+  }
+
+  write_vio.mutex = c ? c->mutex : mutex;
+  write_vio._cont = c;
+  write_vio.nbytes = nbytes;
+  write_vio.ndone = 0;
+  write_vio.vc_server = (VConnection *)this;
+  write_vio.op = VIO::WRITE;
+
+  schedule_process();
+  return &write_vio;
+}
+
+void
+SpdyClientStream::do_io_close(int lerrno)
+{
+  ink_assert(!closed);
+
+  //
+  // The buffers of the write VIO belong to the HttpSM, the unsent part
+  // of the body is kept by reference until spdylay has sent it.
+  //
+  if (write_vio.op == VIO::WRITE && resp_header_done && !resp_eof && lerrno == -1) {
+    IOBufferReader *reader = write_vio.get_reader();
+    if (reader && reader->read_avail() > 0) {
+      resp_buffer = new_empty_MIOBuffer();
+      resp_reader = resp_buffer->alloc_reader();
+      resp_buffer->write(reader, reader->read_avail());
+    }
+  }
+
+  // an aborted transaction resets the stream instead of ending it
+  if (lerrno != -1 && attached && resp_submitted && !resp_eof) {
+    resp_eof = true;
+    spdylay_submit_rst_stream(spdy_sm->session, stream_id, SPDYLAY_INTERNAL_ERROR);
+  }
+
+  closed = true;
+  read_vio.op = VIO::NONE;
+  read_vio.buffer.clear();
+  write_vio.op = VIO::NONE;
+  write_vio.buffer.clear();
+
+  if (!in_handler)
+    process_close();
+}
+
+void
+SpdyClientStream::do_io_shutdown(ShutdownHowTo_t howto)
+{
+  switch (howto) {
+  case IO_SHUTDOWN_READ:
+    read_vio.op = VIO::NONE;
+    break;
+  case IO_SHUTDOWN_WRITE:
+    write_shutdown = true;
+    schedule_process();
+    break;
+  case IO_SHUTDOWN_READWRITE:
+    read_vio.op = VIO::NONE;
+    write_shutdown = true;
+    schedule_process();
+    break;
+  }
+}
+
+void
+SpdyClientStream::reenable(VIO *vio)
+{
+  ink_assert(!closed);
+  schedule_process();
+}
+
+void
+SpdyClientStream::reenable_re(VIO *vio)
+{
+  reenable(vio);
+}
+
+void
+SpdyClientStream::set_active_timeout(ink_hrtime timeout_in)
+{
+  active_timeout = timeout_in;
+  active_deadline = timeout_in ? ink_get_hrtime() + timeout_in : 0;
+  schedule_timeout();
+}
+
+void
+SpdyClientStream::set_inactivity_timeout(ink_hrtime timeout_in)
+{
+  inactive_timeout = timeout_in;
+  inactive_deadline = timeout_in ? ink_get_hrtime() + timeout_in : 0;
+  schedule_timeout();
+}
+
+void
+SpdyClientStream::cancel_active_timeout()
+{
+  active_timeout = 0;
+  active_deadline = 0;
+}
+
+void
+SpdyClientStream::cancel_inactivity_timeout()
+{
+  inactive_timeout = 0;
+  inactive_deadline = 0;
+}
+
+ink_hrtime
+SpdyClientStream::get_active_timeout()
+{
+  return active_timeout;
+}
+
+ink_hrtime
+SpdyClientStream::get_inactivity_timeout()
+{
+  return inactive_timeout;
+}
+
+HTTPHdr *
+SpdyClientStream::get_request_header()
+{
+  return req_hdr.valid() ? &req_hdr : NULL;
+}
+
+SOCKET
+SpdyClientStream::get_socket()
+{
+  // the socket is shared by all the streams of the session, socket
+  // options set through one stream would apply to every other one
+  return NO_FD;
+}
+
+void
+SpdyClientStream::set_local_addr()
+{
+  // copied from the session in init()
+}
+
+void
+SpdyClientStream::set_remote_addr()
+{
+  // copied from the session in init()
+}
+
+int
+SpdyClientStream::set_tcp_init_cwnd(int init_cwnd)
+{
+  return -1;
+}
+
+void
+SpdyClientStream::apply_options()
+{
+  // the options belong to the session connection
+}
+
+void
+SpdyClientStream::set_flow_ctl(int64_t limit_rate, int64_t limit_rate_after)
+{
+}
+
+void
+SpdyClientStream::cancel_flow_ctl()
+{
+}
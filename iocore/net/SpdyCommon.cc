@@ -36,102 +36,3 @@ spdy_config_load()
 
   return 0;
 }
-
-SpdyNV::SpdyNV(TSFetchSM fetch_sm)
-{
-  int i, len;
-  char *p;
-  const char *name, *value;
-  int name_len, value_len, hdr_len, nr_fields;
-  TSMLoc loc, field_loc, next_loc;
-  TSMBuffer bufp;
-
-  bufp = TSFetchRespHdrMBufGet(fetch_sm);
-  loc = TSFetchRespHdrMLocGet(fetch_sm);
-
-  hdr_len = TSMimeHdrLengthGet(bufp, loc);
-  mime_hdr = malloc(hdr_len);
-  TSReleaseAssert(mime_hdr);
-
-  nr_fields = TSMimeHdrFieldsCount(bufp, loc);
-  nv = (const char **)malloc((2*nr_fields + 5) * sizeof(char *));
-  TSReleaseAssert(nv);
-
-  //
-  // Process Status and Version
-  //
-  i = TSHttpHdrVersionGet(bufp, loc);
-  snprintf(version, sizeof(version), "HTTP/%d.%d", TS_HTTP_MAJOR(i), TS_HTTP_MINOR(i));
-
-  i = TSHttpHdrStatusGet(bufp, loc);
-  value = (char *)TSHttpHdrReasonGet(bufp, loc, &value_len);
-  snprintf(status, sizeof(version), "%d ", i);
-  i = strlen(status);
-  len = sizeof(status) - i;
-  len = value_len > len ? len : value_len;
-  strncpy(&status[i], value, len);
-  status[len + i] = '\0';;
-
-  i = 0;
-  nv[i++] = ":version";
-  nv[i++] = version;
-  nv[i++] = ":status";
-  nv[i++] = status;
-
-  //
-  // Process HTTP headers
-  //
-  p = (char *)mime_hdr;
-  field_loc = TSMimeHdrFieldGet(bufp, loc, 0);
-  while (field_loc) {
-    name = TSMimeHdrFieldNameGet(bufp, loc, field_loc, &name_len);
-    TSReleaseAssert(name && name_len);
-
-    //
-    // According SPDY v3 spec, in RESPONSE:
-    // The Connection, Keep-Alive, Proxy-Connection, and
-    // Transfer-Encoding headers are not valid and MUST not be sent.
-    //
-    if (!strncasecmp(name, "Connection", name_len))
-      goto next;
-
-    if (!strncasecmp(name, "Keep-Alive", name_len))
-      goto next;
-
-    if (!strncasecmp(name, "Proxy-Connection", name_len))
-      goto next;
-
-    if (!strncasecmp(name, "Transfer-Encoding", name_len))
-      goto next;
-
-    strncpy(p, name, name_len);
-    nv[i++] = p;
-    p += name_len;
-    *p++ = '\0';
-
-    value = TSMimeHdrFieldValueStringGet(bufp, loc, field_loc, -1, &value_len);
-    TSReleaseAssert(value && value_len);
-    strncpy(p, value, value_len);
-    nv[i++] = p;
-    p += value_len;
-    *p++ = '\0';
-
-next:
-    next_loc = TSMimeHdrFieldNext(bufp, loc, field_loc);
-    TSHandleMLocRelease(bufp, loc, field_loc);
-    field_loc = next_loc;
-  }
-  nv[i] = NULL;
-
-  if (field_loc)
-    TSHandleMLocRelease(bufp, loc, field_loc);
-}
-
-SpdyNV::~SpdyNV()
-{
-  if (nv)
-    free(nv);
-
-  if (mime_hdr)
-    free(mime_hdr);
-}
@@ -360,6 +360,7 @@ Connection::apply_options(NetVCOptions const& opt)
       Debug("socket", "::open: setsockopt() SO_KEEPALIVE on socket");
     }
   }
+  net_set_sock_busy_poll(fd);
 
 #if TS_HAS_SO_MARK
   uint32_t mark = opt.packet_mark;
@@ -34,6 +34,24 @@ ink_hrtime last_transient_accept_error;
 
 extern "C" void fd_reify(struct ev_loop *);
 
+// Upper bounds of the loop histogram buckets, the last bucket counts
+// everything above the bound before it
+static const int64_t epoll_batch_bounds[NET_LOOP_HIST_BUCKETS - 1] = { 0, 1, 4, 16, 64, 256, 1024 };
+static const int64_t loop_usec_bounds[NET_LOOP_HIST_BUCKETS - 1] = { 10, 50, 100, 500, 1000, 5000, 10000 };
+
+// The loop histograms of the first NET_LOOP_HIST_THREADS ET_NET threads,
+// see start_net_loop_stats()
+static RecRawStatBlock *net_loop_rsb = NULL;
+
+static inline int
+net_loop_hist_bucket(int64_t value, const int64_t *bounds)
+{
+  int b = 0;
+  while (b < NET_LOOP_HIST_BUCKETS - 1 && value > bounds[b])
+    b++;
+  return b;
+}
+
 
 #ifndef INACTIVITY_TIMEOUT
 // INKqa10496
@@ -48,14 +66,28 @@ struct InactivityCop : public Continuation {
     ink_hrtime now = ink_get_hrtime();
     NetHandler *nh = get_NetHandler(this_ethread());
     // Copy the list and use pop() to catch any closes caused by callbacks.
-    forl_LL(UnixNetVConnection, vc, nh->open_list)
-      nh->cop_list.push(vc);
+    if (net_inactivity_wheel) {
+      // only the slots of the seconds passed since the last run
+      while (nh->cop_wheel_sec < now / HRTIME_SECOND) {
+        nh->cop_wheel_sec++;
+        DList(UnixNetVConnection, cop_link) &slot = nh->cop_wheel[nh->cop_wheel_sec % NET_COP_WHEEL_SLOTS];
+        while (UnixNetVConnection *vc = slot.pop()) {
+          vc->cop_slot = -1;
+          nh->cop_list.push(vc);
+        }
+      }
+    } else {
+      forl_LL(UnixNetVConnection, vc, nh->open_list)
+        nh->cop_list.push(vc);
+    }
 
     while (UnixNetVConnection *vc = nh->cop_list.pop()) {
       if (vc->closed) {
         close_UnixNetVConnection(vc, e->ethread);
         continue;
       } 
+      if (net_inactivity_wheel)
+        nh->cop_schedule(vc, now);
       if (vc->next_inactivity_timeout_at && vc->next_inactivity_timeout_at < now)
         vc->handleEvent(EVENT_IMMEDIATE, e);
     }
@@ -210,6 +242,41 @@ initialize_thread_for_net(EThread *thread, int thread_index)
 NetHandler::NetHandler():Continuation(NULL), trigger_event(0)
 {
   SET_HANDLER((NetContHandler) & NetHandler::startNetEvent);
+  cop_wheel_sec = ink_get_hrtime() / HRTIME_SECOND;
+  busy_poll_until = 0;
+  loop_stat_base = -1;
+}
+
+//
+// Put the VC in the slot of the second its inactivity timeout is due.
+// Without a timeout it is still visited now and then, to close it
+// if it was closed from another thread.
+//
+void
+NetHandler::cop_schedule(UnixNetVConnection *vc, ink_hrtime now)
+{
+  if (!net_inactivity_wheel)
+    return;
+  int64_t secs = NET_COP_WHEEL_SLOTS - 1;
+  if (vc->next_inactivity_timeout_at) {
+    secs = (vc->next_inactivity_timeout_at - now) / HRTIME_SECOND + 1;
+    if (secs < 1)
+      secs = 1;
+    else if (secs > NET_COP_WHEEL_SLOTS - 1)
+      secs = NET_COP_WHEEL_SLOTS - 1;
+  }
+  cop_remove(vc);
+  vc->cop_slot = (cop_wheel_sec + secs) % NET_COP_WHEEL_SLOTS;
+  cop_wheel[vc->cop_slot].push(vc);
+}
+
+void
+NetHandler::cop_remove(UnixNetVConnection *vc)
+{
+  if (vc->cop_slot >= 0) {
+    cop_wheel[vc->cop_slot].remove(vc);
+    vc->cop_slot = -1;
+  }
 }
 
 //
@@ -274,7 +341,10 @@ NetHandler::mainNetEvent(int event, Event *e)
   process_enabled_list(this, e->ethread);
   if (likely(!read_ready_list.empty() || !write_ready_list.empty() || !read_enable_list.empty() || !write_enable_list.empty()))
     poll_timeout = 0; // poll immediately returns -- we have triggered stuff to process right now
-  else
+  else if (busy_poll_until && ink_get_hrtime_internal() < busy_poll_until) {
+    poll_timeout = 0; // spin, more I/O is likely to follow shortly
+    NET_INCREMENT_DYN_STAT(net_busy_polls_stat);
+  } else
     poll_timeout = net_config_poll_timeout;
 
   PollDescriptor *pd = get_PollDescriptor(trigger_event->ethread);
@@ -320,6 +390,15 @@ NetHandler::mainNetEvent(int event, Event *e)
 #error port me
 #endif
 
+  ink_hrtime loop_start = 0;
+  if (loop_stat_base >= 0) {
+    loop_start = ink_get_hrtime_internal();
+    RecIncrRawStat(net_loop_rsb, trigger_event->ethread,
+                   loop_stat_base + net_loop_hist_bucket(pd->result, epoll_batch_bounds), 1);
+  }
+  if (net_poll_busy_time > 0 && pd->result > 0)
+    busy_poll_until = (loop_start ? loop_start : ink_get_hrtime_internal()) + HRTIME_USECONDS(net_poll_busy_time);
+
   vc = NULL;
   for (int x = 0; x < pd->result; x++) {
     epd = (EventIO*) get_ev_data(pd,x);
@@ -416,6 +495,52 @@ NetHandler::mainNetEvent(int event, Event *e)
   }
 #endif /* !USE_EDGE_TRIGGER */
 
+  if (loop_start)
+    RecIncrRawStat(net_loop_rsb, trigger_event->ethread, loop_stat_base + NET_LOOP_HIST_BUCKETS +
+                   net_loop_hist_bucket((ink_get_hrtime_internal() - loop_start) / HRTIME_USECOND, loop_usec_bounds), 1);
+
   return EVENT_CONT;
 }
 
+static void
+net_loop_stat_name(char *name, int len, int thread, const char *hist, const int64_t *bounds, int b)
+{
+  if (b < NET_LOOP_HIST_BUCKETS - 1)
+    snprintf(name, len, "proxy.process.net.thread.%d.%s.le_%" PRId64, thread, hist, bounds[b]);
+  else
+    snprintf(name, len, "proxy.process.net.thread.%d.%s.gt_%" PRId64, thread, hist, bounds[b - 1]);
+}
+
+//
+// Registers the loop histograms of the ET_NET threads, once, as one raw
+// stat block the threads count into.
+//
+void
+start_net_loop_stats(int n_threads)
+{
+  static bool started = false;
+  char name[128];
+
+  if (started || !net_loop_histograms)
+    return;
+  started = true;
+  if (n_threads > NET_LOOP_HIST_THREADS)
+    n_threads = NET_LOOP_HIST_THREADS;
+  net_loop_rsb = RecAllocateRawStatBlock(n_threads * 2 * NET_LOOP_HIST_BUCKETS);
+  if (!net_loop_rsb) {
+    Warning("could not allocate the net loop histograms");
+    return;
+  }
+  for (int i = 0; i < n_threads; i++) {
+    int base = i * 2 * NET_LOOP_HIST_BUCKETS;
+    for (int b = 0; b < NET_LOOP_HIST_BUCKETS; b++) {
+      net_loop_stat_name(name, sizeof(name), i, "epoll_batch", epoll_batch_bounds, b);
+      RecRegisterRawStat(net_loop_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL, base + b, RecRawStatSyncCount);
+      net_loop_stat_name(name, sizeof(name), i, "loop_usec", loop_usec_bounds, b);
+      RecRegisterRawStat(net_loop_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL, base + NET_LOOP_HIST_BUCKETS + b,
+                         RecRawStatSyncCount);
+    }
+    get_NetHandler(eventProcessor.eventthread[ET_NET][i])->loop_stat_base = base;
+  }
+}
+
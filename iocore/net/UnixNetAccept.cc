@@ -118,6 +118,8 @@ net_accept(NetAccept * na, void *ep, bool blockable)
     }
     count++;
     na->alloc_cache = NULL;
+    if (na->accept_stat_id >= 0)
+      RecIncrRawStat(net_accept_rsb, e->ethread, na->accept_stat_id, 1);
 
     vc->submit_time = ink_get_hrtime();
     ats_ip_copy(&vc->server_addr, &vc->con.addr);
@@ -235,6 +237,69 @@ NetAccept::init_accept_per_thread()
   }
 }
 
+//
+// Give every thread of the etype a listen socket of its own, bound with
+// SO_REUSEPORT. The kernel spreads the connections over the sockets and
+// each connection is accepted on, and stays on, the thread polling its
+// socket, with no hand-off between threads.
+//
+void
+NetAccept::init_accept_reuseport()
+{
+  int i, n;
+
+  if (do_listen(NON_BLOCKING, server.f_inbound_transparent, true))
+    return;
+  if (accept_fn == net_accept)
+    SET_HANDLER((NetAcceptHandler) & NetAccept::acceptFastEvent);
+  else
+    SET_HANDLER((NetAcceptHandler) & NetAccept::acceptEvent);
+  period = ACCEPT_PERIOD;
+
+#ifdef TCP_DEFER_ACCEPT
+  // accept_internal() sets this on the template socket only
+  int defer_accept = 0;
+  IOCORE_ReadConfigInteger(defer_accept, "proxy.config.net.defer_accept");
+#endif
+
+  NetAccept *a;
+  n = eventProcessor.n_threads_for_type[etype];
+  if (etype == ET_NET)
+    register_net_accept_thread_stats(n);
+  for (i = 0; i < n; i++) {
+    EThread *t = eventProcessor.eventthread[etype][i];
+    if (i < n - 1) {
+      a = clone();
+      a->server.fd = NO_FD;
+      if (a->server.listen(NON_BLOCKING, recv_bufsize, send_bufsize, server.f_inbound_transparent, true) == 0) {
+        a->own_listen_fd = true;
+#ifdef TCP_DEFER_ACCEPT
+        if (defer_accept > 0)
+          setsockopt(a->server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &defer_accept, sizeof(int));
+#endif
+#ifdef SO_INCOMING_CPU
+        // Prefer this socket for connections whose NIC queue interrupts the cpu of the thread
+        if (t->affinity_cpu >= 0)
+          setsockopt(a->server.fd, SOL_SOCKET, SO_INCOMING_CPU, &t->affinity_cpu, sizeof(int));
+#endif
+        net_set_sock_busy_poll(a->server.fd);
+      } else {
+        // The port was bound without SO_REUSEPORT, or by another user
+        Warning("unable to listen with SO_REUSEPORT on port %d, thread %d shares the listen socket",
+                ats_ip_port_host_order(&server.accept_addr), i);
+        a->server.fd = server.fd;
+      }
+    } else
+      a = this;
+    a->accept_stat_id = (etype == ET_NET && i < NET_MAX_ACCEPT_THREAD_STATS) ? i : -1;
+    PollDescriptor *pd = get_PollDescriptor(t);
+    if (a->ep.start(pd, a, EVENTIO_READ) < 0)
+      Warning("[NetAccept::init_accept_reuseport]:error starting EventIO");
+    a->mutex = get_NetHandler(t)->mutex;
+    t->schedule_every(a, period, etype);
+  }
+}
+
 NetAccept *
 NetAccept::clone()
 {
@@ -245,7 +310,7 @@ NetAccept::clone()
 }
 
 int
-NetAccept::do_listen(bool non_blocking, bool transparent)
+NetAccept::do_listen(bool non_blocking, bool transparent, bool reuseport)
 {
   int res = 0;
 
@@ -257,7 +322,7 @@ NetAccept::do_listen(bool non_blocking, bool transparent)
     }
   } else {
   Lretry:
-    if ((res = server.listen(non_blocking, recv_bufsize, send_bufsize, transparent)))
+    if ((res = server.listen(non_blocking, recv_bufsize, send_bufsize, transparent, reuseport)))
       Warning("unable to listen on port %d: %d %d, %s", ntohs(server.accept_addr.port()), res, errno, strerror(errno));
   }
   if (callback_on_open && !action_->cancelled) {
@@ -368,6 +433,11 @@ NetAccept::acceptEvent(int event, void *ep)
   MUTEX_TRY_LOCK(lock, m, e->ethread);
   if (lock) {
     if (action_->cancelled) {
+      // NetAcceptAction::cancel() only closes the socket of the template
+      if (own_listen_fd) {
+        this->ep.stop();
+        server.close();
+      }
       e->cancel();
       NET_DECREMENT_DYN_STAT(net_accepts_currently_open_stat);
       delete this;
@@ -410,6 +480,15 @@ NetAccept::acceptFastEvent(int event, void *ep)
   UnixNetVConnection *vc = NULL;
   int loop = accept_till_done;
 
+  // NetAcceptAction::cancel() only closes the socket of the template
+  if (unlikely(own_listen_fd && action_->cancelled)) {
+    this->ep.stop();
+    server.close();
+    e->cancel();
+    delete this;
+    return EVENT_DONE;
+  }
+
   do {
     if (!backdoor && check_net_throttle(ACCEPT, ink_get_hrtime())) {
       ifd = -1;
@@ -490,6 +569,8 @@ NetAccept::acceptFastEvent(int event, void *ep)
     }
 
     NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
+    if (accept_stat_id >= 0)
+      RecIncrRawStat(net_accept_rsb, e->ethread, accept_stat_id, 1);
     vc->id = net_next_connection_number();
 
     vc->submit_time = ink_get_hrtime();
@@ -509,6 +590,9 @@ NetAccept::acceptFastEvent(int event, void *ep)
     }
 
     vc->nh->open_list.enqueue(vc);
+#ifndef INACTIVITY_TIMEOUT
+    vc->nh->cop_schedule(vc, ink_get_hrtime());
+#endif
 
 #ifdef USE_EDGE_TRIGGER
     // Set the vc as triggered and place it in the read ready queue in case there is already data on the socket.
@@ -570,7 +654,9 @@ NetAccept::NetAccept()
     sockopt_flags(0),
     packet_mark(0),
     packet_tos(0),
-    etype(0)
+    etype(0),
+    accept_stat_id(-1),
+    own_listen_fd(false)
 { }
 
 
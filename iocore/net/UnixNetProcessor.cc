@@ -159,7 +159,9 @@ UnixNetProcessor::accept_internal(
   if (na->callback_on_open)
     na->mutex = cont->mutex;
   if (opt.frequent_accept) { // true
-    if (accept_threads > 0)  {
+    if (net_listen_reuseport) {
+      na->init_accept_reuseport();
+    } else if (accept_threads > 0)  {
       if (0 == na->do_listen(BLOCKING, opt.f_inbound_transparent)) {
         NetAccept *a;
 
@@ -189,6 +191,7 @@ UnixNetProcessor::accept_internal(
     setsockopt(na->server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &should_filter_int, sizeof(int));
   }
 #endif
+  net_set_sock_busy_poll(na->server.fd);
 #ifdef TCP_INIT_CWND
  int tcp_init_cwnd = 0;
  IOCORE_ReadConfigInteger(tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
@@ -437,6 +440,8 @@ UnixNetProcessor::start(int)
     initialize_thread_for_http_sessions(netthreads[i], i);
 #endif
   }
+  if (etype == ET_NET)
+    start_net_loop_stats(n_netthreads);
 
   RecData d;
   d.rec_int = 0;
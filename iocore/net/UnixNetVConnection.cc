@@ -165,6 +165,12 @@ net_activity(UnixNetVConnection *vc, EThread *thread)
 
 }
 
+void
+net_cop_schedule(UnixNetVConnection *vc)
+{
+  vc->nh->cop_schedule(vc, ink_get_hrtime());
+}
+
 //
 // Function used to close a UnixNetVConnection and free the vc
 //
@@ -191,6 +197,9 @@ close_UnixNetVConnection(UnixNetVConnection *vc, EThread *t)
   vc->active_timeout_in = 0;
   nh->open_list.remove(vc);
   nh->cop_list.remove(vc);
+#ifndef INACTIVITY_TIMEOUT
+  nh->cop_remove(vc);
+#endif
   nh->read_ready_list.remove(vc);
   nh->write_ready_list.remove(vc);
   if (vc->read.in_enabled_list) {
@@ -276,6 +285,87 @@ write_signal_error(NetHandler *nh, UnixNetVConnection *vc, int lerrno)
   return write_signal_done(VC_EVENT_ERROR, nh, vc);
 }
 
+#ifdef SPLICE_F_MOVE
+// Read the data of a spliced source straight into the pipe. The read
+// VIO counts the bytes, its buffer is not touched.
+static void
+read_splice_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread, ProxyMutex *lock_mutex)
+{
+  NetState *s = &vc->read;
+  NetSplice *sp = vc->read_splice;
+  ProxyMutex *mutex = thread->mutex;
+
+  int64_t toread = sp->pipe_size - sp->in_pipe;
+  if (toread > s->vio.ntodo())
+    toread = s->vio.ntodo();
+  if (toread <= 0) {
+    // the destination reenables us once the pipe drains
+    sp->src_blocked = true;
+    read_disable(nh, vc);
+    return;
+  }
+
+  int64_t r = splice(vc->con.fd, NULL, sp->pipe_fd[1], NULL, toread, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  if (r < 0)
+    r = -errno;
+  NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_stat, 1);
+
+  if (r <= 0) {
+    if (r == -EAGAIN && sp->in_pipe > 0) {
+      // the pipe may run out of buffers before it runs out of bytes
+      sp->src_blocked = true;
+      read_disable(nh, vc);
+      return;
+    }
+    if (r == -EAGAIN || r == -ENOTCONN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_nodata_stat, 1);
+      vc->read.triggered = 0;
+      nh->read_ready_list.remove(vc);
+      return;
+    }
+    if (!r || r == -ECONNRESET) {
+      vc->read.triggered = 0;
+      nh->read_ready_list.remove(vc);
+      read_signal_done(VC_EVENT_EOS, nh, vc);
+      return;
+    }
+    vc->read.triggered = 0;
+    read_signal_error(nh, vc, (int)-r);
+    return;
+  }
+  NET_SUM_DYN_STAT(net_read_bytes_stat, r);
+  sp->in_pipe += r;
+  s->vio.ndone += r;
+  net_activity(vc, thread);
+
+  UnixNetVConnection *dst = sp->dst;
+  if (dst->write.vio.op == VIO::WRITE && dst->write.vio.mutex.m_ptr == lock_mutex)
+    dst->reenable(&dst->write.vio);
+
+  if (s->vio.ntodo() <= 0) {
+    read_signal_done(VC_EVENT_READ_COMPLETE, nh, vc);
+    return;
+  }
+  if (read_signal_and_update(VC_EVENT_READ_READY, vc) != EVENT_CONT)
+    return;
+  // change of lock... don't look at shared variables!
+  if (lock_mutex != s->vio.mutex.m_ptr) {
+    read_reschedule(nh, vc);
+    return;
+  }
+  if (s->vio.ntodo() <= 0 || !s->enabled) {
+    read_disable(nh, vc);
+    return;
+  }
+  if (vc->read_splice && vc->read_splice->in_pipe >= vc->read_splice->pipe_size) {
+    vc->read_splice->src_blocked = true;
+    read_disable(nh, vc);
+    return;
+  }
+  read_reschedule(nh, vc);
+}
+#endif
+
 // Read the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection by moving the VC
 // onto or off of the ready_list.
@@ -300,14 +390,20 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     return;
   }
 
-  ink_debug_assert(buf.writer());
-
   // if there is nothing to do, disable connection
   int64_t ntodo = s->vio.ntodo();
   if (ntodo <= 0) {
     read_disable(nh, vc);
     return;
   }
+#ifdef SPLICE_F_MOVE
+  if (vc->read_splice) {
+    read_splice_from_net(nh, vc, thread, lock.m.m_ptr);
+    return;
+  }
+#endif
+
+  ink_debug_assert(buf.writer());
   int64_t toread = buf.writer()->write_avail();
   if (toread > ntodo)
     toread = ntodo;
@@ -434,6 +530,89 @@ write_to_net(NetHandler *nh, UnixNetVConnection *vc, PollDescriptor *pd, EThread
 }
 
 
+#ifdef SPLICE_F_MOVE
+// Write a spliced destination, the bytes in the buffer of the write VIO
+// go out first, then the pipe. WRITE_READY is never signalled: the
+// source drives the transfer and the user would take the empty buffer
+// of a finished producer for the end of the data.
+static void
+write_splice_to_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
+{
+  NetState *s = &vc->write;
+  NetSplice *sp = vc->write_splice;
+  ProxyMutex *mutex = thread->mutex;
+  MIOBufferAccessor & buf = s->vio.buffer;
+  int64_t ntodo = s->vio.ntodo();
+  int64_t r;
+
+  int64_t towrite = buf.reader()->read_avail();
+  if (towrite > ntodo)
+    towrite = ntodo;
+  if (towrite > 0) {
+    int64_t total_wrote = 0, wattempted = 0;
+    r = vc->load_buffer_and_write(towrite, wattempted, total_wrote, buf);
+    if (total_wrote != wattempted) {
+      if (r <= 0)
+        r = total_wrote - wattempted;
+      else
+        r = total_wrote - wattempted + r;
+    }
+    if (r > 0)
+      buf.reader()->consume(r);
+  } else if (sp->in_pipe > 0) {
+    towrite = sp->in_pipe;
+    if (towrite > ntodo)
+      towrite = ntodo;
+    r = splice(sp->pipe_fd[0], NULL, vc->con.fd, NULL, towrite, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (r < 0)
+      r = -errno;
+    NET_DEBUG_COUNT_DYN_STAT(net_calls_to_write_stat, 1);
+    if (r > 0) {
+      NET_SUM_DYN_STAT(net_splice_bytes_stat, r);
+      sp->in_pipe -= r;
+    }
+  } else {
+    // nothing until the source fills the pipe
+    write_disable(nh, vc);
+    return;
+  }
+
+  if (r <= 0) {
+    if (r == -EAGAIN || r == -ENOTCONN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_write_nodata_stat, 1);
+      vc->write.triggered = 0;
+      nh->write_ready_list.remove(vc);
+      return;
+    }
+    if (!r || r == -ECONNRESET) {
+      vc->write.triggered = 0;
+      write_signal_done(VC_EVENT_EOS, nh, vc);
+      return;
+    }
+    vc->write.triggered = 0;
+    write_signal_error(nh, vc, (int)-r);
+    return;
+  }
+  NET_SUM_DYN_STAT(net_write_bytes_stat, r);
+  s->vio.ndone += r;
+  net_activity(vc, thread);
+
+  UnixNetVConnection *src = sp->src;
+  if (src && sp->src_blocked) {
+    sp->src_blocked = false;
+    if (src->read.vio.op == VIO::READ && src->read.vio.mutex.m_ptr == s->vio.mutex.m_ptr)
+      src->reenable(&src->read.vio);
+  } else if (!src && !sp->in_pipe)
+    vc->splice_detach(IO_SHUTDOWN_WRITE);
+
+  if (s->vio.ntodo() <= 0) {
+    write_signal_done(VC_EVENT_WRITE_COMPLETE, nh, vc);
+    return;
+  }
+  write_reschedule(nh, vc);
+}
+#endif
+
 void
 write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
 {
@@ -485,6 +664,12 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     write_disable(nh, vc);
     return;
   }
+#ifdef SPLICE_F_MOVE
+  if (vc->write_splice) {
+    write_splice_to_net(nh, vc, thread);
+    return;
+  }
+#endif
 
   MIOBufferAccessor & buf = s->vio.buffer;
   ink_debug_assert(buf.writer());
@@ -643,6 +828,8 @@ VIO *
 UnixNetVConnection::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
 {
   ink_assert(!closed);
+  if (read_splice)
+    splice_detach(IO_SHUTDOWN_READ);
   read.vio.op = VIO::READ;
   read.vio.mutex = c->mutex;
   read.vio._cont = c;
@@ -664,6 +851,8 @@ VIO *
 UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *reader, bool owner)
 {
   ink_assert(!closed);
+  if (write_splice)
+    splice_detach(IO_SHUTDOWN_WRITE);
   write.vio.op = VIO::WRITE;
   write.vio.mutex = c->mutex;
   write.vio._cont = c;
@@ -684,6 +873,7 @@ UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader
 void
 UnixNetVConnection::do_io_close(int alerrno /* = -1 */ )
 {
+  splice_detach(IO_SHUTDOWN_READWRITE);
   disable_read(this);
   disable_write(this);
   read.vio.buffer.clear();
@@ -706,6 +896,13 @@ UnixNetVConnection::do_io_close(int alerrno /* = -1 */ )
 
   if (close_inline)
     close_UnixNetVConnection(this, t);
+#ifndef INACTIVITY_TIMEOUT
+  else if (net_inactivity_wheel && !read.in_enabled_list) {
+    // the cop may not visit this VC for a while, the NetHandler closes it
+    read.in_enabled_list = 1;
+    nh->read_enable_list.push(this);
+  }
+#endif
 }
 
 void
@@ -906,11 +1103,11 @@ UnixNetVConnection::UnixNetVConnection()
 #ifdef INACTIVITY_TIMEOUT
     inactivity_timeout(NULL),
 #else
-    next_inactivity_timeout_at(0),
+    next_inactivity_timeout_at(0), cop_slot(-1),
 #endif
     active_timeout(NULL), nh(NULL),
     id(0), flags(0), recursion(0), submit_time(0), oob_ptr(0),
-    from_accept_thread(false), pt(PROBE_NONE)
+    from_accept_thread(false), pt(PROBE_NONE), read_splice(NULL), write_splice(NULL)
 {
   memset(&local_addr, 0, sizeof local_addr);
   memset(&server_addr, 0, sizeof server_addr);
@@ -1090,6 +1287,9 @@ UnixNetVConnection::acceptEvent(int event, Event *e)
   }
 
   nh->open_list.enqueue(this);
+#ifndef INACTIVITY_TIMEOUT
+  nh->cop_schedule(this, ink_get_hrtime());
+#endif
 
   if (inactivity_timeout_in)
     UnixNetVConnection::set_inactivity_timeout(inactivity_timeout_in);
@@ -1254,6 +1454,9 @@ UnixNetVConnection::connectUp(EThread *t)
 
   nh = get_NetHandler(t);
   nh->open_list.enqueue(this);
+#ifndef INACTIVITY_TIMEOUT
+  nh->cop_schedule(this, ink_get_hrtime());
+#endif
 
   ink_assert(!inactivity_timeout_in);
   ink_assert(!active_timeout_in);
@@ -1266,6 +1469,7 @@ void
 UnixNetVConnection::free(EThread *t)
 {
   NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, -1);
+  splice_detach(IO_SHUTDOWN_READWRITE);
   // clear variables for reuse
   this->mutex.clear();
   action_.mutex.clear();
@@ -1296,6 +1500,88 @@ UnixNetVConnection::free(EThread *t)
   }
 }
 
+#ifdef SPLICE_F_MOVE
+static void
+free_net_splice(NetSplice *sp)
+{
+  close(sp->pipe_fd[0]);
+  close(sp->pipe_fd[1]);
+  delete sp;
+}
+#endif
+
+bool
+UnixNetVConnection::splice_to(NetVConnection *dst_vc)
+{
+#ifdef SPLICE_F_MOVE
+  if (!is_splice_capable() || !dst_vc->is_splice_capable())
+    return false;
+  UnixNetVConnection *dst = (UnixNetVConnection *) dst_vc;
+
+  // both sides run on the same thread under the same mutex, so neither
+  // side needs a lock to look at the pipe
+  if (dst == this || closed || dst->closed || !thread || thread != dst->thread || thread != this_ethread())
+    return false;
+  if (read_splice || dst->write_splice || pt != PROBE_NONE || dst->fct.limit_rate)
+    return false;
+  if (read.vio.op != VIO::READ || dst->write.vio.op != VIO::WRITE || read.vio.mutex.m_ptr != dst->write.vio.mutex.m_ptr)
+    return false;
+
+  NetSplice *sp = new NetSplice;
+  if (pipe2(sp->pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+    Debug("iocore_net", "splice_to, pipe2 failed: %d", errno);
+    delete sp;
+    return false;
+  }
+  int size = 0;
+#if defined(F_SETPIPE_SZ) && defined(F_GETPIPE_SZ)
+  fcntl(sp->pipe_fd[1], F_SETPIPE_SZ, NET_SPLICE_PIPE_SIZE);
+  size = fcntl(sp->pipe_fd[1], F_GETPIPE_SZ);
+#endif
+  sp->pipe_size = size > 0 ? size : 65536;
+  sp->src = this;
+  sp->dst = dst;
+  read_splice = sp;
+  dst->write_splice = sp;
+
+  ProxyMutex *mutex = thread->mutex;
+  NET_INCREMENT_DYN_STAT(net_splices_stat);
+  Debug("iocore_net", "splice_to, fd %d to fd %d, pipe size %" PRId64, con.fd, dst->con.fd, sp->pipe_size);
+  return true;
+#else
+  NOWARN_UNUSED(dst_vc);
+  return false;
+#endif
+}
+
+//
+// Take this VC out of its splices. A source leaving a pipe that still
+// holds data leaves it to the destination to drain.
+//
+void
+UnixNetVConnection::splice_detach(ShutdownHowTo_t howto)
+{
+#ifdef SPLICE_F_MOVE
+  NetSplice *sp;
+  if (howto != IO_SHUTDOWN_WRITE && (sp = read_splice)) {
+    read_splice = NULL;
+    sp->src = NULL;
+    if (!sp->in_pipe) {
+      sp->dst->write_splice = NULL;
+      free_net_splice(sp);
+    }
+  }
+  if (howto != IO_SHUTDOWN_READ && (sp = write_splice)) {
+    write_splice = NULL;
+    if (sp->src)
+      sp->src->read_splice = NULL;
+    free_net_splice(sp);
+  }
+#else
+  NOWARN_UNUSED(howto);
+#endif
+}
+
 void
 UnixNetVConnection::apply_options()
 {
@@ -24,6 +24,8 @@
 #include "P_SSLCertLookup.h"
 #include "ts/TestBox.h"
 #include <fstream>
+#include <string>
+#include <vector>
 
 static IpEndpoint
 make_endpoint(const char * address)
@@ -74,6 +76,10 @@ REGRESSION_TEST(SSLCertificateLookup)(RegressionTest* t, int atype, int * pstatu
   box.check(lookup.findInfoInHash("notwild.com") == notwild, "wildcard lookup for notwild.com");
   box.check(lookup.findInfoInHash("c.b.notwild.com") == b_notwild, "wildcard lookup for c.b.notwild.com");
 
+  // Verify that wildcards only match on label boundaries.
+  box.check(lookup.findInfoInHash("wildcard.com") == NULL, "wildcard lookup for wildcard.com");
+  box.check(lookup.findInfoInHash("a.bnotwild.com") == NULL, "wildcard lookup for a.bnotwild.com");
+
   // Basic hostname cases.
   box.check(lookup.findInfoInHash("www.foo.com") == foo, "host lookup for www.foo.com");
   box.check(lookup.findInfoInHash("www.bar.com") == NULL, "host lookup for www.bar.com");
@@ -130,17 +136,60 @@ REGRESSION_TEST(SSLAddressLookup)(RegressionTest* t, int atype, int * pstatus)
   box.check(lookup.findInfoInHash(endpoint.ip4p) == context.ip4p, "IPv4 longest match lookup w/ port");
 }
 
+static unsigned test_context_loads = 0;
+
+static SSL_CTX *
+load_test_context(SSLCertLookup * /* lookup */, const SSLCertContext * /* cc */)
+{
+  ++test_context_loads;
+  return SSL_CTX_new(SSLv23_server_method());
+}
+
+REGRESSION_TEST(SSLLazyContextLookup)(RegressionTest* t, int atype, int * pstatus)
+{
+  TestBox       box(t, pstatus);
+  SSLCertLookup lookup;
+
+  SSLCertContext * a = new SSLCertContext("a.pem", NULL, NULL, -1, NULL);
+  SSLCertContext * b = new SSLCertContext("b.pem", NULL, NULL, -1, NULL);
+  SSLCertContext * c = new SSLCertContext("c.pem", NULL, NULL, -1, NULL);
+  SSL_CTX * ctx;
+
+  lookup.loader = load_test_context;
+  lookup.context_max = 2;
+  test_context_loads = 0;
+
+  box = REGRESSION_TEST_PASSED;
+
+  box.check(lookup.insert(a, "a.com"), "insert lazy host context");
+  box.check(lookup.insert(b, "*.b.com"), "insert lazy wildcard context");
+  box.check(lookup.insert(c, "c.com"), "insert lazy host context");
+  box.check(lookup.count() == 3 && lookup.loaded() == 0, "indexing loads no context");
+
+  ctx = lookup.findInfoInHash("a.com");
+  box.check(ctx != NULL && test_context_loads == 1, "a.com is loaded on first use");
+  box.check(lookup.findInfoInHash("a.com") == ctx && test_context_loads == 1, "a.com is loaded once");
+  box.check(lookup.findInfoInHash("x.b.com") != NULL && test_context_loads == 2, "x.b.com is loaded on first use");
+
+  // a.com is now the most recently used, loading c.com drops b.com.
+  lookup.findInfoInHash("a.com");
+  box.check(lookup.findInfoInHash("c.com") != NULL && lookup.loaded() == 2, "at most 2 contexts are loaded");
+  box.check(a->ctx == ctx && b->ctx == NULL, "the least recently used context is dropped");
+  box.check(lookup.findInfoInHash("x.b.com") != NULL && test_context_loads == 4, "x.b.com is loaded again");
+}
+
 static unsigned
-load_hostnames_csv(const char * fname, SSLCertLookup& lookup)
+load_hostnames_csv(const char * fname, SSLCertLookup& lookup, std::vector<std::string>& names)
 {
   std::fstream infile(fname, std::ios_base::in);
   unsigned count = 0;
 
   // SSLCertLookup correctly handles indexing the same certificate
   // with multiple names, an it's way faster to load a lot of names
-  // if we don't need a new context every time.
+  // if we don't need a new context every time. With a context cache,
+  // every name gets a lazy certificate of its own.
 
-  SSL_CTX * ctx = SSL_CTX_new(SSLv23_server_method());
+  SSL_CTX * ctx = lookup.context_max ? NULL : SSL_CTX_new(SSLv23_server_method());
 
   // The input should have 2 comma-separated fields; this is the format that you get when
   // you download the top 1M sites from alexa.
@@ -163,12 +212,19 @@ load_hostnames_csv(const char * fname, SSLCertLookup& lookup)
 
     pos = line.find_first_of(',');
     if (pos != std::string::npos) {
-      std::string host(line.substr(pos + 1));
-      lookup.insert(ctx, host.c_str());
-    } else {
-      // No comma? Assume the whole line is the hostname
+      line = line.substr(pos + 1);
+    }
+    // No comma? Assume the whole line is the hostname
+
+    if (ctx) {
       lookup.insert(ctx, line.c_str());
+    } else {
+      SSLCertContext * cc = new SSLCertContext(line.c_str(), NULL, NULL, -1, NULL);
+      if (!lookup.insert(cc, line.c_str())) {
+        delete cc;
+      }
     }
+    names.push_back(line);
 
     ++count;
   }
@@ -193,14 +249,38 @@ int main(int argc, const char ** argv)
   ink_freelists_snap_baseline();
 
   if (argc > 1) {
+    // test_certlookup [-c context_max] hostnames.csv ...
+    //
+    // Index the host names and time the load and the lookups of all of them. With -c, every host
+    // name is a lazy certificate and at most context_max contexts are loaded at a time.
     SSLCertLookup lookup;
+    std::vector<std::string> names;
     unsigned count = 0;
+    unsigned found = 0;
+    ink_hrtime start, loaded, looked;
+    int i = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+      lookup.loader = load_test_context;
+      lookup.context_max = atoi(argv[2]);
+      i = 3;
+    }
+
+    start = ink_get_hrtime_internal();
+    for (; i < argc; ++i) {
+      count += load_hostnames_csv(argv[i], lookup, names);
+    }
+    loaded = ink_get_hrtime_internal();
 
-    for (int i = 1; i < argc; ++i) {
-      count += load_hostnames_csv(argv[i], lookup);
+    for (unsigned j = 0; j < names.size(); ++j) {
+      found += lookup.findInfoInHash(names[j].c_str()) != NULL;
     }
+    looked = ink_get_hrtime_internal();
 
-    printf("loaded %u host names\n", count);
+    printf("loaded %u host names in %.3f msec\n", count, (double)(loaded - start) / HRTIME_MSECOND);
+    printf("found %u of them in %.3f msec, %.1f nsec per lookup, %u contexts loaded\n", found,
+        (double)(looked - loaded) / HRTIME_MSECOND, names.empty() ? 0.0 : (double)(looked - loaded) / names.size(),
+        test_context_loads);
 
   } else {
     // Standard regression tests.
@@ -97,6 +97,13 @@ public:
     ink_freelist_init(&this->fl, name, element_size, chunk_size, alignment);
   }
 
+  /** Allocate the blocks from huge pages, see ink_hugepage.h. */
+  void
+  use_huge_pages()
+  {
+    ink_freelist_huge_pages(this->fl);
+  }
+
 protected:
   InkFreeList *fl;
 };
@@ -145,3 +145,384 @@ DFA::match(const char *str, int length) const
   return -1;
 }
 
+
+// Shorter factors are in almost every string and only cost scan time.
+#define REGEX_SET_MIN_FACTOR 3
+#define REGEX_SET_MAX_FACTOR 256
+
+RegexSet::RegexSet()
+  : _factors(NULL), _factor_lens(NULL), _npatterns(0), _capacity(0), _nwords(0), _always(NULL),
+    _nclasses(0), _nstates(0), _delta(NULL), _fail(NULL), _report(NULL), _terminal(NULL), _next_same(NULL)
+{
+  memset(_classes, 0, sizeof(_classes));
+}
+
+RegexSet::~RegexSet()
+{
+  for (int i = 0; i < _npatterns; i++) {
+    ats_free(_factors[i]);
+  }
+  ats_free(_factors);
+  ats_free(_factor_lens);
+  ats_free(_always);
+  ats_free(_delta);
+  ats_free(_fail);
+  ats_free(_report);
+  ats_free(_terminal);
+  ats_free(_next_same);
+}
+
+// Skip a character class, p is on the '['. Return the char after the ']'.
+static const char *
+regex_skip_class(const char *p)
+{
+  p++;
+  if (*p == '^')
+    p++;
+  if (*p == ']')
+    p++;
+  while (*p && *p != ']') {
+    if (*p == '\\' && p[1]) {
+      p += 2;
+    } else if (*p == '[' && p[1] == ':') {
+      const char *end = strstr(p + 2, ":]");
+      p = end ? end + 2 : p + 1;
+    } else {
+      p++;
+    }
+  }
+  return *p ? p + 1 : NULL;
+}
+
+// Skip a group, p is on the '('. Return the char after the ')'.
+static const char *
+regex_skip_group(const char *p)
+{
+  int depth = 0;
+
+  while (*p) {
+    if (*p == '\\') {
+      if (!p[1])
+        return NULL;
+      p += 2;
+      continue;
+    }
+    if (*p == '[') {
+      if ((p = regex_skip_class(p)) == NULL)
+        return NULL;
+      continue;
+    }
+    if (*p == '(') {
+      depth++;
+    } else if (*p == ')' && --depth == 0) {
+      return p + 1;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+// Parse a {n}, {n,} or {n,m} quantifier, p is on the '{'.
+static const char *
+regex_parse_repeat(const char *p, int *min)
+{
+  const char *q = p + 1;
+
+  if (!ParseRules::is_digit(*q))
+    return NULL;
+  *min = 0;
+  while (ParseRules::is_digit(*q))
+    *min = *min * 10 + (*q++ - '0');
+  if (*q == ',') {
+    q++;
+    while (ParseRules::is_digit(*q))
+      q++;
+  }
+  return *q == '}' ? q + 1 : NULL;
+}
+
+int
+RegexSet::literal_factor(const char *pattern, char *buf, int size)
+{
+  char run[REGEX_SET_MAX_FACTOR];
+  int run_len = 0;
+  int best_len = 0;
+  bool last_literal = false;
+  const char *p = pattern;
+
+  if (size > REGEX_SET_MAX_FACTOR)
+    size = REGEX_SET_MAX_FACTOR;
+
+  while (true) {
+    char literal = 0;
+    bool is_literal = false;
+    bool done = false;
+    int min;
+    const char *q;
+
+    switch (*p) {
+    case '\\':
+      switch (p[1]) {
+      case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+      case 'b': case 'B': case 'h': case 'H': case 'v': case 'V':
+      case 'A': case 'z': case 'Z': case 'G': case 'R': case 'X':
+        p += 2;
+        break;
+      case 't':
+        literal = '\t';
+        is_literal = true;
+        p += 2;
+        break;
+      case 'n':
+        literal = '\n';
+        is_literal = true;
+        p += 2;
+        break;
+      case 'r':
+        literal = '\r';
+        is_literal = true;
+        p += 2;
+        break;
+      default:
+        // \x.., \Q..\E, back references: not worth following
+        if (!p[1] || ParseRules::is_alnum(p[1]))
+          return 0;
+        literal = p[1];
+        is_literal = true;
+        p += 2;
+        break;
+      }
+      break;
+    case '[':
+      if ((p = regex_skip_class(p)) == NULL)
+        return 0;
+      break;
+    case '(':
+      // (?x) and the other option settings change what follows
+      if (p[1] == '?' && p[2] != ':' && p[2] != '=' && p[2] != '!' && p[2] != '<')
+        return 0;
+      if (p[1] == '*' || (p = regex_skip_group(p)) == NULL)
+        return 0;
+      break;
+    case ')':
+    case '|':
+      return 0;
+    case '*':
+    case '?':
+      if (last_literal)
+        run_len--;
+      p++;
+      if (*p == '?' || *p == '+')
+        p++;
+      break;
+    case '+':
+      p++;
+      if (*p == '?' || *p == '+')
+        p++;
+      break;
+    case '{':
+      if ((q = regex_parse_repeat(p, &min)) == NULL) {
+        literal = '{';
+        is_literal = true;
+        p++;
+        break;
+      }
+      if (min == 0 && last_literal)
+        run_len--;
+      p = q;
+      if (*p == '?' || *p == '+')
+        p++;
+      break;
+    case '.':
+    case '^':
+    case '$':
+      p++;
+      break;
+    case '\0':
+      done = true;
+      break;
+    default:
+      literal = *p++;
+      is_literal = true;
+      break;
+    }
+
+    if (is_literal && run_len < size) {
+      run[run_len++] = ParseRules::ink_tolower(literal);
+      last_literal = true;
+      continue;
+    }
+
+    // the run of literals ends here
+    if (run_len > best_len) {
+      best_len = run_len;
+      memcpy(buf, run, best_len);
+    }
+    run_len = 0;
+    last_literal = false;
+    if (is_literal) {
+      run[run_len++] = ParseRules::ink_tolower(literal);
+      last_literal = true;
+    }
+    if (done)
+      break;
+  }
+
+  return best_len >= REGEX_SET_MIN_FACTOR ? best_len : 0;
+}
+
+int
+RegexSet::add(const char *pattern)
+{
+  char buf[REGEX_SET_MAX_FACTOR];
+  int len;
+
+  ink_assert(_delta == NULL);
+  if (_npatterns == _capacity) {
+    _capacity = _capacity ? _capacity * 2 : 16;
+    _factors = (char **)ats_realloc(_factors, _capacity * sizeof(char *));
+    _factor_lens = (int *)ats_realloc(_factor_lens, _capacity * sizeof(int));
+  }
+
+  len = literal_factor(pattern, buf, sizeof(buf));
+  _factors[_npatterns] = len > 0 ? ats_strndup(buf, len) : NULL;
+  _factor_lens[_npatterns] = len;
+  return _npatterns++;
+}
+
+void
+RegexSet::compile()
+{
+  int max_states = 1;
+  int *queue;
+  int head, tail;
+
+  ink_assert(_delta == NULL);
+  _nwords = (_npatterns + 63) / 64;
+  if (_nwords == 0)
+    _nwords = 1;
+  _always = (uint64_t *)ats_malloc(_nwords * sizeof(uint64_t));
+  memset(_always, 0, _nwords * sizeof(uint64_t));
+
+  // the alphabet is the bytes of the factors, class 0 is any other byte
+  _nclasses = 1;
+  for (int i = 0; i < _npatterns; i++) {
+    if (_factors[i] == NULL) {
+      _always[i >> 6] |= 1ULL << (i & 63);
+      continue;
+    }
+    for (int j = 0; j < _factor_lens[i]; j++) {
+      unsigned char c = (unsigned char)_factors[i][j];
+      if (_classes[c] == 0)
+        _classes[c] = _nclasses++;
+    }
+    max_states += _factor_lens[i];
+  }
+  for (int c = 'A'; c <= 'Z'; c++)
+    _classes[c] = _classes[c - 'A' + 'a'];
+
+  _delta = (int *)ats_malloc(max_states * _nclasses * sizeof(int));
+  _fail = (int *)ats_malloc(max_states * sizeof(int));
+  _report = (int *)ats_malloc(max_states * sizeof(int));
+  _terminal = (int *)ats_malloc(max_states * sizeof(int));
+  _next_same = (int *)ats_malloc((_npatterns ? _npatterns : 1) * sizeof(int));
+  memset(_delta, 0xff, max_states * _nclasses * sizeof(int));
+  memset(_terminal, 0xff, max_states * sizeof(int));
+
+  // the trie of the factors
+  _nstates = 1;
+  for (int i = 0; i < _npatterns; i++) {
+    int s = 0;
+
+    if (_factors[i] == NULL)
+      continue;
+    for (int j = 0; j < _factor_lens[i]; j++) {
+      int *t = _delta + s * _nclasses + _classes[(unsigned char)_factors[i][j]];
+      if (*t < 0)
+        *t = _nstates++;
+      s = *t;
+    }
+    _next_same[i] = _terminal[s];
+    _terminal[s] = i;
+  }
+
+  // breadth first, turn the trie into the automaton
+  queue = (int *)ats_malloc(_nstates * sizeof(int));
+  head = tail = 0;
+  _fail[0] = 0;
+  _report[0] = -1;
+  for (int c = 0; c < _nclasses; c++) {
+    int t = _delta[c];
+    if (t < 0) {
+      _delta[c] = 0;
+    } else {
+      _fail[t] = 0;
+      queue[tail++] = t;
+    }
+  }
+  while (head < tail) {
+    int s = queue[head++];
+    int *row = _delta + s * _nclasses;
+    int *fail_row = _delta + _fail[s] * _nclasses;
+
+    _report[s] = _terminal[s] >= 0 ? s : _report[_fail[s]];
+    for (int c = 0; c < _nclasses; c++) {
+      if (row[c] < 0) {
+        row[c] = fail_row[c];
+      } else {
+        _fail[row[c]] = fail_row[c];
+        queue[tail++] = row[c];
+      }
+    }
+  }
+  ats_free(queue);
+}
+
+void
+RegexSet::reset(uint64_t *bitmap) const
+{
+  memcpy(bitmap, _always, _nwords * sizeof(uint64_t));
+}
+
+void
+RegexSet::scan(const char *str, int length, uint64_t *bitmap) const
+{
+  const unsigned char *p = (const unsigned char *)str;
+  const unsigned char *end = p + length;
+  int s = 0;
+
+  if (_nstates <= 1)
+    return;
+  for (; p < end; p++) {
+    s = _delta[s * _nclasses + _classes[*p]];
+    for (int r = _report[s]; r >= 0; r = _report[_fail[r]]) {
+      for (int i = _terminal[r]; i >= 0; i = _next_same[i])
+        bitmap[i >> 6] |= 1ULL << (i & 63);
+    }
+  }
+}
+
+int
+RegexSet::next(const uint64_t *bitmap, int prev) const
+{
+  int i = prev + 1;
+  int w = i >> 6;
+  uint64_t bits;
+
+  if (w >= _nwords)
+    return -1;
+  bits = bitmap[w] & (~0ULL << (i & 63));
+  while (bits == 0) {
+    if (++w >= _nwords)
+      return -1;
+    bits = bitmap[w];
+  }
+  return (w << 6) + __builtin_ctzll(bits);
+}
+
+const char *
+RegexSet::factor(int index, int *length) const
+{
+  *length = _factor_lens[index];
+  return _factors[index];
+}
@@ -63,5 +63,72 @@ private:
   dfa_pattern * _my_patterns;
 };
 
+/**
+  Multi pattern prefilter of a regex list.
+
+  Every match of a pattern contains the longest literal factor that the
+  pattern requires, e.g. ".example.com/img/" for
+  "http://(.*)\.example\.com/img/(.*)". The factors of all the patterns
+  are searched at once with an Aho-Corasick automaton over the case
+  folded bytes, which gives the candidate patterns of a string in a
+  bitmap. The caller confirms the candidates with pcre_exec() in the
+  order the patterns were added, which keeps the rank of a list. A
+  pattern without a factor (alternatives, back references, ...) is a
+  candidate for every string.
+*/
+class RegexSet
+{
+public:
+  RegexSet();
+  ~RegexSet();
+
+  /// Add the next pattern, return its index.
+  int add(const char *pattern);
+
+  /// Build the automaton, after the last add() and before the first scan().
+  void compile();
+
+  int count() const { return _npatterns; }
+
+  /// Size in bytes of a candidate bitmap.
+  int bitmap_size() const { return _nwords * sizeof(uint64_t); }
+
+  /// Start a candidate bitmap with the patterns that have no factor.
+  void reset(uint64_t *bitmap) const;
+
+  /// Add the candidates of str to bitmap, a pattern matched against
+  /// several strings needs each of them scanned.
+  void scan(const char *str, int length, uint64_t *bitmap) const;
+
+  /// Index of the first candidate after prev, -1 to start, -1 at the end.
+  int next(const uint64_t *bitmap, int prev) const;
+
+  /// Literal factor of a pattern, NULL if it has none.
+  const char *factor(int index, int *length) const;
+
+  /// Copy the longest literal factor of pattern, lower cased, into buf.
+  /// Return its length, 0 when the pattern has no usable factor.
+  static int literal_factor(const char *pattern, char *buf, int size);
+
+private:
+  char **_factors;
+  int *_factor_lens;
+  int _npatterns;
+  int _capacity;
+  int _nwords;
+  uint64_t *_always;
+
+  unsigned char _classes[256];
+  int _nclasses;
+  int _nstates;
+  int *_delta;     // full transition table, _nstates rows of _nclasses
+  int *_fail;
+  int *_report;    // nearest state on the fail path ending a factor
+  int *_terminal;  // first pattern whose factor ends at the state
+  int *_next_same; // next pattern with the same factor
+
+  RegexSet(const RegexSet &);
+  RegexSet & operator =(const RegexSet &);
+};
 
 #endif /* __TS_REGEX_H__ */
@@ -44,22 +44,7 @@ int off = 0;
 int on = 1;
 
 #if TS_USE_HWLOC
-#include <hwloc.h>
-static hwloc_topology_t gTopology;
-static bool hwloc_setup = false;
-
-// Little helper to initialize the hwloc topology, once.
-void static inline
-setup_hwloc()
-{
-  if (hwloc_setup)
-    return;
-
-  hwloc_topology_init(&gTopology);
-  hwloc_topology_load(gTopology);
-
-  hwloc_setup = true;
-}
+#include "ink_numa.h"
 #endif
 
 int
@@ -116,9 +101,8 @@ ink_number_of_processors()
   int cu;
   int pu;
 
-  setup_hwloc();
-  cu = hwloc_get_nbobjs_by_type(gTopology, HWLOC_OBJ_CORE);
-  pu = hwloc_get_nbobjs_by_type(gTopology, HWLOC_OBJ_PU);
+  cu = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_CORE);
+  pu = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_PU);
   if (pu > cu)
     return cu + (pu - cu)/4;
   else
@@ -0,0 +1,93 @@
+/** @file
+
+  Huge page backed memory for the freelists
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ink_hugepage.h"
+#include "ink_numa.h"
+#include "ink_platform.h"
+#include "ink_defs.h"
+#include "ink_atomic.h"
+#include "ink_error.h"
+#include <sys/mman.h>
+
+volatile int64_t ink_huge_page_bytes = 0;
+volatile int64_t ink_huge_page_fallback_bytes = 0;
+
+static int huge_mode = INK_HUGE_PAGES_OFF;
+static char *arena = NULL;
+static int64_t arena_size = 0;
+static volatile int64_t arena_used = 0;
+
+int
+ink_huge_pages_init(int mode, int64_t size)
+{
+  huge_mode = mode;
+  if (mode != INK_HUGE_PAGES_ARENA)
+    return huge_mode;
+
+  huge_mode = INK_HUGE_PAGES_THP;
+  size = (size + INK_HUGE_PAGE_SIZE - 1) & ~((int64_t)INK_HUGE_PAGE_SIZE - 1);
+  if (size <= 0)
+    return huge_mode;
+#ifdef MAP_HUGETLB
+  // Without MAP_NORESERVE the pages are taken from the pool now, so a
+  // short pool fails here rather than with a SIGBUS later
+  void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    arena = (char *) p;
+    arena_size = size;
+    huge_mode = INK_HUGE_PAGES_ARENA;
+  } else
+    ink_warning("unable to reserve %" PRId64 " bytes of huge pages, see vm.nr_hugepages: %s", size, strerror(errno));
+#else
+  ink_warning("huge page arenas are not supported on this platform");
+#endif
+  return huge_mode;
+}
+
+int
+ink_huge_pages_mode()
+{
+  return huge_mode;
+}
+
+void *
+ink_huge_memalign(size_t size, int node)
+{
+  if (arena) {
+    int64_t offset = ink_atomic_increment64(&arena_used, (int64_t) size);
+    if (offset + (int64_t) size <= arena_size) {
+      ink_atomic_increment64(&ink_huge_page_bytes, (int64_t) size);
+      return arena + offset;
+    }
+  }
+
+  void *p = ink_numa_memalign(INK_HUGE_PAGE_SIZE, size, node);
+#ifdef MADV_HUGEPAGE
+  if (madvise(p, size, MADV_HUGEPAGE) == 0) {
+    ink_atomic_increment64(&ink_huge_page_bytes, (int64_t) size);
+    return p;
+  }
+#endif
+  ink_atomic_increment64(&ink_huge_page_fallback_bytes, (int64_t) size);
+  return p;
+}
@@ -0,0 +1,65 @@
+/** @file
+
+  Huge page backed memory for the freelists
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _INK_HUGEPAGE_H
+#define _INK_HUGEPAGE_H
+
+#include "ink_config.h"
+#include <sys/types.h>
+
+#define INK_HUGE_PAGE_SIZE  (2 * 1024 * 1024)
+
+/* Values of proxy.config.iobuffer.huge_pages */
+enum
+{
+  INK_HUGE_PAGES_OFF = 0,
+  INK_HUGE_PAGES_THP,           // chunks are madvised for transparent huge pages
+  INK_HUGE_PAGES_ARENA          // chunks come from a reserved MAP_HUGETLB arena first
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif                          /* __cplusplus */
+
+/* Bytes of chunks placed on huge pages, and of chunks that wanted them
+   but got ordinary pages */
+extern volatile int64_t ink_huge_page_bytes;
+extern volatile int64_t ink_huge_page_fallback_bytes;
+
+/* Select the mode, reserving arena_size bytes of huge pages for
+   INK_HUGE_PAGES_ARENA. Falls back to INK_HUGE_PAGES_THP if they can not
+   be reserved. Call once before the freelists allocate. Returns the mode
+   in effect */
+int ink_huge_pages_init(int mode, int64_t arena_size);
+int ink_huge_pages_mode();
+
+/* Allocate size bytes, a multiple of INK_HUGE_PAGE_SIZE, aligned to a
+   huge page. Like ink_numa_memalign() the memory can not be freed */
+void *ink_huge_memalign(size_t size, int node);
+
+#ifdef __cplusplus
+}
+#endif                          /* __cplusplus */
+
+#endif /*_INK_HUGEPAGE_H*/
@@ -0,0 +1,281 @@
+/** @file
+
+  NUMA topology helpers: thread placement and node local memory
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "ink_numa.h"
+#include "ink_platform.h"
+#include "ink_defs.h"
+#include "ink_memory.h"
+#include "ink_assert.h"
+#include "ink_mutex.h"
+#include "ink_atomic.h"
+
+__thread int ink_numa_thread_node = 0;
+
+#if TS_USE_HWLOC
+
+#if HWLOC_API_VERSION < 0x00010b00
+#define HWLOC_OBJ_NUMANODE HWLOC_OBJ_NODE
+#define HWLOC_OBJ_PACKAGE HWLOC_OBJ_SOCKET
+#endif
+
+static hwloc_topology_t gTopology;
+static bool hwloc_setup = false;
+
+hwloc_topology_t
+ink_get_topology()
+{
+  if (!hwloc_setup) {
+    hwloc_topology_init(&gTopology);
+    hwloc_topology_load(gTopology);
+    hwloc_setup = true;
+  }
+  return gTopology;
+}
+
+static hwloc_obj_t
+affinity_obj(int affinity, int index)
+{
+  hwloc_obj_type_t type;
+
+  switch (affinity) {
+  case INK_AFFINITY_NODE:
+    type = HWLOC_OBJ_NUMANODE;
+    break;
+  case INK_AFFINITY_SOCKET:
+    type = HWLOC_OBJ_PACKAGE;
+    break;
+  case INK_AFFINITY_CORE:
+    type = HWLOC_OBJ_CORE;
+    break;
+  case INK_AFFINITY_PU:
+    type = HWLOC_OBJ_PU;
+    break;
+  default:
+    return NULL;
+  }
+
+  int n = hwloc_get_nbobjs_by_type(ink_get_topology(), type);
+  if (n <= 0)
+    return NULL;
+  return hwloc_get_obj_by_type(ink_get_topology(), type, index % n);
+}
+
+// The node whose cpus the object runs on, as a freelist index
+static int
+affinity_node(hwloc_obj_t obj)
+{
+  int n = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_NUMANODE);
+
+  for (int i = 0; i < n; i++) {
+    hwloc_obj_t node = hwloc_get_obj_by_type(ink_get_topology(), HWLOC_OBJ_NUMANODE, i);
+    if (node->cpuset && hwloc_bitmap_intersects(node->cpuset, obj->cpuset))
+      return i % INK_NUMA_MAX_NODES;
+  }
+  return 0;
+}
+#endif
+
+int
+ink_numa_nodes()
+{
+#if TS_USE_HWLOC
+  int n = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_NUMANODE);
+  if (n > 1)
+    return n;
+#endif
+  return 1;
+}
+
+int
+ink_affinity_cpu(int affinity, int index)
+{
+#if TS_USE_HWLOC
+  hwloc_obj_t obj = affinity_obj(affinity, index);
+  if (obj && obj->cpuset)
+    return hwloc_bitmap_first(obj->cpuset);
+#else
+  NOWARN_UNUSED(affinity);
+  NOWARN_UNUSED(index);
+#endif
+  return -1;
+}
+
+int
+ink_affinity_bind(int affinity, int index)
+{
+#if TS_USE_HWLOC
+  hwloc_obj_t obj = affinity_obj(affinity, index);
+  if (!obj || !obj->cpuset)
+    return -1;
+  if (hwloc_set_cpubind(ink_get_topology(), obj->cpuset, HWLOC_CPUBIND_THREAD) < 0)
+    return -1;
+  ink_numa_thread_node = affinity_node(obj);
+  return ink_numa_thread_node;
+#else
+  NOWARN_UNUSED(affinity);
+  NOWARN_UNUSED(index);
+  return -1;
+#endif
+}
+
+#if TS_USE_HWLOC
+// Node bound memory is handed out from 2MB regions which belong to one
+// node each, so the home node of any address in them is found from a
+// table of the regions.
+#define NUMA_REGION_SHIFT   21
+#define NUMA_REGION_SIZE    ((size_t) 1 << NUMA_REGION_SHIFT)
+#define NUMA_ARENA_BYTES    (16 * NUMA_REGION_SIZE)
+#define NUMA_REGION_BITS    18  // up to 512GB of node bound memory
+#define NUMA_REGION_TABLE   (1 << NUMA_REGION_BITS)
+
+static volatile uintptr_t region_key[NUMA_REGION_TABLE];       // region number + 1, 0 if empty
+static volatile int8_t region_node[NUMA_REGION_TABLE];
+static int region_count = 0;
+static char *arena_pos[INK_NUMA_MAX_NODES];
+static size_t arena_left[INK_NUMA_MAX_NODES];
+static ink_mutex arena_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+volatile int ink_numa_bound_regions = 0;
+
+#if TS_USE_HWLOC
+static inline uint32_t
+region_slot(uintptr_t key)
+{
+  return (uint32_t) ((key * 0x9e3779b97f4a7c15ULL) >> (64 - NUMA_REGION_BITS));
+}
+
+static void
+numa_bind(void *p, size_t size, int node)
+{
+  int n = hwloc_get_nbobjs_by_type(ink_get_topology(), HWLOC_OBJ_NUMANODE);
+
+  for (int i = node; i < n; i += INK_NUMA_MAX_NODES) {
+    hwloc_obj_t obj = hwloc_get_obj_by_type(ink_get_topology(), HWLOC_OBJ_NUMANODE, i);
+#if HWLOC_API_VERSION >= 0x00020000
+    if (hwloc_set_area_membind(ink_get_topology(), p, size, obj->nodeset, HWLOC_MEMBIND_BIND,
+                               HWLOC_MEMBIND_MIGRATE | HWLOC_MEMBIND_BYNODESET) == 0)
+#else
+    if (hwloc_set_area_membind_nodeset(ink_get_topology(), p, size, obj->nodeset, HWLOC_MEMBIND_BIND,
+                                       HWLOC_MEMBIND_MIGRATE) == 0)
+#endif
+      break;
+  }
+}
+
+// Called with arena_lock held, readers go without the lock so the node
+// is stored before the key. Returns false when the table is full.
+static bool
+register_regions(char *p, size_t size, int node)
+{
+  uintptr_t first = (uintptr_t) p >> NUMA_REGION_SHIFT;
+  uintptr_t last = ((uintptr_t) p + size - 1) >> NUMA_REGION_SHIFT;
+
+  if (region_count + (int) (last - first + 1) > NUMA_REGION_TABLE / 2)
+    return false;
+  for (uintptr_t r = first; r <= last; r++) {
+    uint32_t i = region_slot(r + 1);
+    while (region_key[i])
+      i = (i + 1) & (NUMA_REGION_TABLE - 1);
+    region_node[i] = (int8_t) node;
+    INK_WRITE_MEMORY_BARRIER;
+    region_key[i] = r + 1;
+    region_count++;
+  }
+  ink_numa_bound_regions = region_count;
+  return true;
+}
+
+// Carves node bound memory out of the current arena of the node
+static void *
+arena_alloc(size_t alignment, size_t size, int node)
+{
+  void *p = NULL;
+
+  ink_mutex_acquire(&arena_lock);
+  uintptr_t pos = ((uintptr_t) arena_pos[node] + alignment - 1) & ~((uintptr_t) alignment - 1);
+  if (!arena_pos[node] || pos + size > (uintptr_t) arena_pos[node] + arena_left[node]) {
+    size_t bytes = (size + NUMA_REGION_SIZE - 1) & ~(NUMA_REGION_SIZE - 1);
+    if (bytes < NUMA_ARENA_BYTES)
+      bytes = NUMA_ARENA_BYTES;
+    char *a = (char *) ats_memalign(NUMA_REGION_SIZE, bytes);
+    numa_bind(a, bytes, node);
+    if (!register_regions(a, bytes, node)) {
+      // No room to remember more regions, the chunk is still bound
+      ink_mutex_release(&arena_lock);
+      return a;
+    }
+    arena_pos[node] = a;
+    arena_left[node] = bytes;
+    pos = (uintptr_t) a;
+  }
+  p = (void *) pos;
+  arena_left[node] -= pos + size - (uintptr_t) arena_pos[node];
+  arena_pos[node] = (char *) (pos + size);
+  ink_mutex_release(&arena_lock);
+  return p;
+}
+#endif
+
+int
+ink_numa_node_of(const void *p)
+{
+#if TS_USE_HWLOC
+  uintptr_t key = ((uintptr_t) p >> NUMA_REGION_SHIFT) + 1;
+
+  for (uint32_t i = region_slot(key);; i = (i + 1) & (NUMA_REGION_TABLE - 1)) {
+    uintptr_t k = region_key[i];
+    if (k == key)
+      return region_node[i];
+    if (!k)
+      return -1;
+  }
+#else
+  NOWARN_UNUSED(p);
+  return -1;
+#endif
+}
+
+void *
+ink_numa_memalign(size_t alignment, size_t size, int node)
+{
+#if TS_USE_HWLOC
+  size_t page_size = sysconf(_SC_PAGESIZE);
+
+  // Binding works on whole pages, small chunks stay where they are put
+  if (size >= page_size && ink_numa_nodes() > 1) {
+    if (alignment < page_size)
+      alignment = page_size;
+    if (alignment <= NUMA_REGION_SIZE)
+      return arena_alloc(alignment, size, node);
+    void *p = ats_memalign(alignment, size);
+    numa_bind(p, size, node);
+    return p;
+  }
+#else
+  NOWARN_UNUSED(node);
+#endif
+  if (alignment)
+    return ats_memalign(alignment, size);
+  return ats_malloc(size);
+}
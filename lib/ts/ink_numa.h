@@ -0,0 +1,84 @@
+/** @file
+
+  NUMA topology helpers: thread placement and node local memory
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _INK_NUMA_H
+#define _INK_NUMA_H
+
+#include "ink_config.h"
+#include <sys/types.h>
+
+#if TS_USE_HWLOC
+#include <hwloc.h>
+#endif
+
+/* The freelists keep one list per node, nodes beyond this share lists */
+#define INK_NUMA_MAX_NODES  4
+
+/* Values of proxy.config.exec_thread.affinity */
+enum
+{
+  INK_AFFINITY_NONE = 0,
+  INK_AFFINITY_NODE,            // thread may run on any cpu of a NUMA node
+  INK_AFFINITY_SOCKET,          // ... of a socket
+  INK_AFFINITY_CORE,            // ... of a core, i.e. its hyper threads
+  INK_AFFINITY_PU               // thread is pinned to one processing unit
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif                          /* __cplusplus */
+
+/* Index of the node whose freelists the calling thread uses, 0 unless
+   the thread was bound with ink_affinity_bind() */
+extern __thread int ink_numa_thread_node;
+
+/* Number of NUMA nodes, 1 without hwloc */
+int ink_numa_nodes();
+
+/* First cpu of the index-th object of the affinity type, objects are
+   used round robin. -1 when no binding is done */
+int ink_affinity_cpu(int affinity, int index);
+
+/* Bind the calling thread like ink_affinity_cpu() and set its freelist
+   node. Returns the node, or -1 if the thread was left unbound */
+int ink_affinity_bind(int affinity, int index);
+
+/* Allocate memory bound to a node, like ats_memalign(), alignment may
+   be 0. The memory can not be freed */
+void *ink_numa_memalign(size_t alignment, size_t size, int node);
+
+/* Node that ink_numa_memalign() bound the memory at p to, -1 if it was
+   not bound. Only worth asking while ink_numa_bound_regions is not 0 */
+int ink_numa_node_of(const void *p);
+extern volatile int ink_numa_bound_regions;
+
+#if TS_USE_HWLOC
+hwloc_topology_t ink_get_topology();
+#endif
+
+#ifdef __cplusplus
+}
+#endif                          /* __cplusplus */
+
+#endif /*_INK_NUMA_H*/
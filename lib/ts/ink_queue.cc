@@ -50,6 +50,7 @@
 #include "ink_assert.h"
 #include "ink_resource.h"
 #include "ink_queue_ext.h"
+#include "ink_hugepage.h"
 
 
 inkcoreapi volatile int64_t fastalloc_mem_in_use = 0;
@@ -81,6 +82,153 @@ inkcoreapi volatile int64_t freelist_allocated_mem = 0;
 #define fl_memadd(_x_) \
    ink_atomic_increment64(&freelist_allocated_mem, (int64_t) (_x_));
 
+int64_t cfg_thread_magazines = 1;
+
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+typedef struct
+{
+  InkMagazine *loaded;
+  InkMagazine *previous;
+} InkThreadMagazines;
+
+static volatile int n_cached_freelists = 0;
+static InkFreeList *cached_freelists[INK_FREELIST_MAX_CACHED];
+static __thread InkThreadMagazines thread_mags[INK_FREELIST_MAX_CACHED];
+static __thread bool thread_mags_registered = false;
+static pthread_key_t thread_mags_key;
+static pthread_once_t thread_mags_once = PTHREAD_ONCE_INIT;
+
+static void freelist_free(InkFreeList * f, void *item, int node);
+
+static void
+thread_mags_exit(void *)
+{
+  ink_freelists_thread_flush();
+}
+
+static void
+thread_mags_key_create()
+{
+  pthread_key_create(&thread_mags_key, thread_mags_exit);
+}
+
+static InkMagazine *
+magazine_new()
+{
+  InkMagazine *m = (InkMagazine *)ats_malloc(sizeof(InkMagazine));
+  m->next = NULL;
+  m->count = 0;
+  return m;
+}
+
+static void
+depot_put_full(InkFreeList * f, InkMagazine * m)
+{
+  ink_atomic_increment((int *) &f->used, -(int) m->count);
+  ink_atomic_increment64(&fastalloc_mem_in_use, -(int64_t) m->count * f->type_size);
+  ink_atomiclist_push(&f->depot_full[ink_numa_thread_node], m);
+}
+
+static void
+freelist_magazines_init(InkFreeList * f)
+{
+  uint32_t size = INK_MAGAZINE_BYTES / (f->type_size ? f->type_size : 1);
+
+  if (size > INK_MAGAZINE_ROUNDS)
+    size = INK_MAGAZINE_ROUNDS;
+  f->magazine_size = size;
+  for (int i = 0; i < INK_NUMA_MAX_NODES; i++)
+    ink_atomiclist_init(&f->depot_full[i], f->name, offsetof(InkMagazine, next));
+  ink_atomiclist_init(&f->depot_empty, f->name, offsetof(InkMagazine, next));
+
+  // an item of more than half INK_MAGAZINE_BYTES is not cached per thread
+  f->cache_index = -1;
+  if (size >= 2) {
+    int index = ink_atomic_increment((int *) &n_cached_freelists, 1);
+    if (index < INK_FREELIST_MAX_CACHED) {
+      cached_freelists[index] = f;
+      f->cache_index = index;
+    }
+  }
+}
+
+// The magazines of the calling thread for f, NULL to use the shared list
+static inline InkThreadMagazines *
+thread_magazines(InkFreeList * f)
+{
+  if (!cfg_thread_magazines || f->cache_index < 0)
+    return NULL;
+  InkThreadMagazines *tm = &thread_mags[f->cache_index];
+  if (unlikely(!tm->loaded)) {
+    if (!thread_mags_registered) {
+      pthread_once(&thread_mags_once, thread_mags_key_create);
+      pthread_setspecific(thread_mags_key, thread_mags);
+      thread_mags_registered = true;
+    }
+    tm->loaded = magazine_new();
+    tm->previous = magazine_new();
+  }
+  return tm;
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
+void
+ink_freelists_thread_flush(void)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  int n = n_cached_freelists;
+
+  if (n > INK_FREELIST_MAX_CACHED)
+    n = INK_FREELIST_MAX_CACHED;
+  for (int i = 0; i < n; i++) {
+    InkThreadMagazines *tm = &thread_mags[i];
+    if (!tm->loaded)
+      continue;
+    InkFreeList *f = cached_freelists[i];
+    InkMagazine *mags[2] = { tm->loaded, tm->previous };
+    for (int j = 0; j < 2; j++) {
+      if (mags[j]->count)
+        depot_put_full(f, mags[j]);
+      else
+        ink_atomiclist_push(&f->depot_empty, mags[j]);
+    }
+    tm->loaded = tm->previous = NULL;
+  }
+#endif
+}
+
+void
+ink_freelists_thread_magazines(int enable)
+{
+  cfg_thread_magazines = enable;
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  if (enable)
+    return;
+
+  // Nothing takes from the magazines or the depots any more. The other
+  // threads still flush theirs to the depots when they exit, call this
+  // before they start.
+  ink_freelists_thread_flush();
+  int n = n_cached_freelists;
+  if (n > INK_FREELIST_MAX_CACHED)
+    n = INK_FREELIST_MAX_CACHED;
+  for (int i = 0; i < n; i++) {
+    InkFreeList *f = cached_freelists[i];
+    for (int node = 0; node < INK_NUMA_MAX_NODES; node++) {
+      InkMagazine *m;
+      while ((m = (InkMagazine *) ink_atomiclist_pop(&f->depot_full[node]))) {
+        // the depot items are not counted as used, freelist_free uncounts them
+        ink_atomic_increment((int *) &f->used, (int) m->count);
+        ink_atomic_increment64(&fastalloc_mem_in_use, (int64_t) m->count * f->type_size);
+        while (m->count)
+          freelist_free(f, m->rounds[--m->count], node);
+        ink_atomiclist_push(&f->depot_empty, m);
+      }
+    }
+  }
+#endif
+}
+
 void
 ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
                   uint32_t chunk_size, uint32_t alignment)
@@ -93,7 +241,8 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
 
   /* its safe to add to this global list because ink_freelist_init()
      is only called from single-threaded initialization code. */
-  f = (InkFreeList *)ats_memalign(alignment, sizeof(InkFreeList));
+  f = (InkFreeList *)ats_memalign(alignment > INK_FREELIST_HEAD_ALIGN ? alignment : INK_FREELIST_HEAD_ALIGN,
+                                  sizeof(InkFreeList));
   fll = (ink_freelist_list *)ats_malloc(sizeof(ink_freelist_list));
   fll->fl = f;
   fll->next = freelists;
@@ -105,16 +254,36 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
   f->alignment = alignment;
   f->chunk_size = chunk_size;
   f->type_size = type_size;
-  SET_FREELIST_POINTER_VERSION(f->head, FROM_PTR(0), 0);
+  for (int i = 0; i < INK_NUMA_MAX_NODES; i++) {
+    SET_FREELIST_POINTER_VERSION(f->node_head[i].head, FROM_PTR(0), 0);
+    f->node_allocated[i] = 0;
+  }
 
   f->used = 0;
   f->allocated = 0;
   f->allocated_base = 0;
   f->used_base = 0;
+  f->huge_pages = 0;
+  freelist_magazines_init(f);
   *fl = f;
 #endif
 }
 
+void
+ink_freelist_huge_pages(InkFreeList * f)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  if (ink_huge_pages_mode() == INK_HUGE_PAGES_OFF)
+    return;
+  uint64_t bytes = (uint64_t) f->chunk_size * f->type_size;
+  bytes = (bytes + INK_HUGE_PAGE_SIZE - 1) & ~((uint64_t) INK_HUGE_PAGE_SIZE - 1);
+  f->chunk_size = bytes / f->type_size;
+  f->huge_pages = 1;
+#else
+  NOWARN_UNUSED(f);
+#endif
+}
+
 InkFreeList *
 ink_freelist_create(const char *name, uint32_t type_size, uint32_t chunk_size,
                     uint32_t alignment)
@@ -133,19 +302,19 @@ int fake_global_for_ink_queue = 0;
 
 int fastmemtotal = 0;
 
-void *
-ink_freelist_new(InkFreeList * f)
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static void freelist_free(InkFreeList * f, void *item, int node);
+
+static void *
+freelist_new(InkFreeList * f)
 {
-#if TS_USE_FREELIST
-#if TS_USE_RECLAIMABLE_FREELIST
-  return reclaimable_freelist_new(f);
-#else
   head_p item;
   head_p next;
   int result = 0;
+  int node = ink_numa_thread_node;
 
   do {
-    INK_QUEUE_LD64(item, f->head);
+    INK_QUEUE_LD64(item, f->node_head[node].head);
     if (TO_PTR(FREELIST_POINTER(item)) == NULL) {
       uint32_t type_size = f->type_size;
       uint32_t i;
@@ -162,10 +331,10 @@ ink_freelist_new(InkFreeList * f)
 #ifdef DEBUG
       char *oldsbrk = (char *) sbrk(0), *newsbrk = NULL;
 #endif
-      if (f->alignment)
-        newp = ats_memalign(f->alignment, f->chunk_size * type_size);
+      if (f->huge_pages)
+        newp = ink_huge_memalign(f->chunk_size * type_size, node);
       else
-        newp = ats_malloc(f->chunk_size * type_size);
+        newp = ink_numa_memalign(f->alignment, f->chunk_size * type_size, node);
       fl_memadd(f->chunk_size * type_size);
 #ifdef DEBUG
       newsbrk = (char *) sbrk(0);
@@ -176,6 +345,7 @@ ink_freelist_new(InkFreeList * f)
       SET_FREELIST_POINTER_VERSION(item, newp, 0);
 
       ink_atomic_increment((int *) &f->allocated, f->chunk_size);
+      ink_atomic_increment((int *) &f->node_allocated[node], f->chunk_size);
       ink_atomic_increment64(&fastalloc_mem_total, (int64_t) f->chunk_size * f->type_size);
 
       /* free each of the new elements */
@@ -186,7 +356,7 @@ ink_freelist_new(InkFreeList * f)
         for (int j = 0; j < (int)type_size; j++)
           a[j] = str[j % 4];
 #endif
-        ink_freelist_free(f, a);
+        freelist_free(f, a, node);
 #ifdef MEMPROTECT
         if (f->type_size >= MEMPROTECT_SIZE) {
           a += type_size - page_size;
@@ -202,7 +372,7 @@ ink_freelist_new(InkFreeList * f)
     } else {
       SET_FREELIST_POINTER_VERSION(next, *ADDRESS_OF_NEXT(TO_PTR(FREELIST_POINTER(item)), 0),
                                    FREELIST_VERSION(item) + 1);
-      result = ink_atomic_cas64((int64_t *) & f->head.data, item.data, next.data);
+      result = ink_atomic_cas64((int64_t *) & f->node_head[node].head.data, item.data, next.data);
 
 #ifdef SANITY
       if (result) {
@@ -224,6 +394,37 @@ ink_freelist_new(InkFreeList * f)
   ink_atomic_increment64(&fastalloc_mem_in_use, (int64_t) f->type_size);
 
   return TO_PTR(FREELIST_POINTER(item));
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
+void *
+ink_freelist_new(InkFreeList * f)
+{
+#if TS_USE_FREELIST
+#if TS_USE_RECLAIMABLE_FREELIST
+  return reclaimable_freelist_new(f);
+#else
+  InkThreadMagazines *tm = thread_magazines(f);
+  if (tm) {
+    InkMagazine *m = tm->loaded;
+    if (m->count > 0)
+      return m->rounds[--m->count];
+    if (tm->previous->count > 0) {
+      tm->loaded = tm->previous;
+      tm->previous = m;
+      return tm->loaded->rounds[--tm->loaded->count];
+    }
+    InkMagazine *full = (InkMagazine *) ink_atomiclist_pop(&f->depot_full[ink_numa_thread_node]);
+    if (full) {
+      ink_atomic_increment((int *) &f->used, (int) full->count);
+      ink_atomic_increment64(&fastalloc_mem_in_use, (int64_t) full->count * f->type_size);
+      ink_atomiclist_push(&f->depot_empty, tm->previous);
+      tm->previous = m;
+      tm->loaded = full;
+      return full->rounds[--full->count];
+    }
+  }
+  return freelist_new(f);
 #endif /* TS_USE_RECLAIMABLE_FREELIST */
 #else // ! TS_USE_FREELIST
   void *newp = NULL;
@@ -237,13 +438,10 @@ ink_freelist_new(InkFreeList * f)
 }
 typedef volatile void *volatile_void_p;
 
-void
-ink_freelist_free(InkFreeList * f, void *item)
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static void
+freelist_free(InkFreeList * f, void *item, int node)
 {
-#if TS_USE_FREELIST
-#if TS_USE_RECLAIMABLE_FREELIST
-  return reclaimable_freelist_free(f, item);
-#else
   volatile_void_p *adr_of_next = (volatile_void_p *) ADDRESS_OF_NEXT(item, 0);
   head_p h;
   head_p item_pair;
@@ -263,7 +461,7 @@ ink_freelist_free(InkFreeList * f, void *item)
 
   result = 0;
   do {
-    INK_QUEUE_LD64(h, f->head);
+    INK_QUEUE_LD64(h, f->node_head[node].head);
 #ifdef SANITY
     if (TO_PTR(FREELIST_POINTER(h)) == item)
       ink_fatal(1, "ink_freelist_free: trying to free item twice");
@@ -275,12 +473,59 @@ ink_freelist_free(InkFreeList * f, void *item)
     *adr_of_next = FREELIST_POINTER(h);
     SET_FREELIST_POINTER_VERSION(item_pair, FROM_PTR(item), FREELIST_VERSION(h));
     INK_MEMORY_BARRIER;
-    result = ink_atomic_cas64((int64_t *) & f->head, h.data, item_pair.data);
+    result = ink_atomic_cas64((int64_t *) & f->node_head[node].head, h.data, item_pair.data);
   }
   while (result == 0);
 
   ink_atomic_increment((int *) &f->used, -1);
   ink_atomic_increment64(&fastalloc_mem_in_use, -(int64_t) f->type_size);
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
+void
+ink_freelist_free(InkFreeList * f, void *item)
+{
+#if TS_USE_FREELIST
+#if TS_USE_RECLAIMABLE_FREELIST
+  return reclaimable_freelist_free(f, item);
+#else
+  // An item of another node goes straight back to the list of that node,
+  //  so the magazines and the depot of a node only hold its own memory
+  if (unlikely(ink_numa_bound_regions)) {
+    int home = ink_numa_node_of(item);
+    if (home >= 0 && home != ink_numa_thread_node) {
+      freelist_free(f, item, home);
+      return;
+    }
+  }
+  InkThreadMagazines *tm = thread_magazines(f);
+  if (tm) {
+#ifdef DEADBEEF
+    static const char str[4] = { (char) 0xde, (char) 0xad, (char) 0xbe, (char) 0xef };
+    for (int j = 0; j < (int)f->type_size; j++)
+      ((char*)item)[j] = str[j % 4];
+#endif /* DEADBEEF */
+    InkMagazine *m = tm->loaded;
+    if (m->count < f->magazine_size) {
+      m->rounds[m->count++] = item;
+      return;
+    }
+    if (tm->previous->count == 0) {
+      tm->loaded = tm->previous;
+      tm->previous = m;
+      tm->loaded->rounds[tm->loaded->count++] = item;
+      return;
+    }
+    InkMagazine *empty = (InkMagazine *) ink_atomiclist_pop(&f->depot_empty);
+    if (!empty)
+      empty = magazine_new();
+    depot_put_full(f, tm->previous);
+    tm->previous = m;
+    tm->loaded = empty;
+    empty->rounds[empty->count++] = item;
+    return;
+  }
+  freelist_free(f, item, ink_numa_thread_node);
 #endif /* TS_USE_RECLAIMABLE_FREELIST */
 #else
   if (f->alignment)
@@ -352,6 +597,25 @@ ink_freelists_dump(FILE * f)
             (uint64_t)fll->fl->used * (uint64_t)fll->fl->type_size, fll->fl->type_size, fll->fl->name ? fll->fl->name : "<unknown>");
     fll = fll->next;
   }
+
+  int nodes = ink_numa_nodes();
+  if (nodes > INK_NUMA_MAX_NODES)
+    nodes = INK_NUMA_MAX_NODES;
+  if (nodes > 1) {
+    fprintf(f, "\n");
+    for (int i = 0; i < nodes; i++)
+      fprintf(f, "  allocated node %d  |", i);
+    fprintf(f, "   free list name\n");
+    for (int i = 0; i < nodes; i++)
+      fprintf(f, "--------------------|");
+    fprintf(f, "----------------------------------\n");
+
+    for (fll = freelists; fll; fll = fll->next) {
+      for (int i = 0; i < nodes; i++)
+        fprintf(f, " %18" PRIu64 " |", (uint64_t)fll->fl->node_allocated[i] * (uint64_t)fll->fl->type_size);
+      fprintf(f, " memory/%s\n", fll->fl->name ? fll->fl->name : "<unknown>");
+    }
+  }
 #else // ! TS_USE_FREELIST
   // TODO?
 #endif
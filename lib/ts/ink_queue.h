@@ -38,6 +38,7 @@
 #include "ink_port.h"
 #include "ink_apidefs.h"
 #include "ink_unused.h"
+#include "ink_numa.h"
 
 /*
   For information on the structure of the x86_64 memory map:
@@ -124,18 +125,65 @@ extern "C"
 
   typedef void *void_p;
 
+  typedef struct
+  {
+#if defined(INK_USE_MUTEX_FOR_ATOMICLISTS)
+    ink_mutex inkatomiclist_mutex;
+#endif
+    volatile head_p head;
+    const char *name;
+    uint32_t offset;
+  } InkAtomicList;
+
 #if TS_USE_RECLAIMABLE_FREELIST
   extern float cfg_reclaim_factor;
   extern int64_t cfg_max_overage;
   extern int64_t cfg_enable_reclaim;
   extern int64_t cfg_debug_filter;
 #else
-  struct _InkFreeList
+  /*
+   * Each thread keeps a loaded and a previous magazine of free items per
+   * freelist and trades full and empty magazines with the depot of the
+   * freelist, so the shared heads are only touched once per magazine.
+   * The items of a magazine are only counted as free once it is in the
+   * depot. A magazine holds about INK_MAGAZINE_BYTES of items, at most
+   * INK_MAGAZINE_ROUNDS.
+   */
+#define INK_MAGAZINE_ROUNDS        64
+#define INK_MAGAZINE_BYTES         (64 * 1024)
+#define INK_FREELIST_MAX_CACHED    512
+
+  typedef struct _InkMagazine
+  {
+    struct _InkMagazine *next;
+    uint32_t count;
+    void *rounds[INK_MAGAZINE_ROUNDS];
+  } InkMagazine;
+
+  extern int64_t cfg_thread_magazines;
+
+  /* The head of the list of one node, alone on its cache line */
+#define INK_FREELIST_HEAD_ALIGN    64
+  typedef struct
   {
     volatile head_p head;
+    char pad[INK_FREELIST_HEAD_ALIGN - sizeof(head_p)];
+  } InkFreeListHead;
+
+  /* Threads pop from the list of their NUMA node, see ink_numa.h, and
+     items go back to the list of the node their chunk is bound to */
+  struct _InkFreeList
+  {
+    InkFreeListHead node_head[INK_NUMA_MAX_NODES];
     const char *name;
     uint32_t type_size, chunk_size, used, allocated, alignment;
     uint32_t allocated_base, used_base;
+    uint32_t node_allocated[INK_NUMA_MAX_NODES];
+    int huge_pages;             /* chunks come from ink_huge_memalign() */
+    int cache_index;            /* of the thread magazines, -1 if none */
+    uint32_t magazine_size;
+    InkAtomicList depot_full[INK_NUMA_MAX_NODES];
+    InkAtomicList depot_empty;
   };
 
   inkcoreapi extern volatile int64_t fastalloc_mem_in_use;
@@ -160,22 +208,20 @@ extern "C"
   inkcoreapi void ink_freelist_init(InkFreeList **fl, const char *name,
                                     uint32_t type_size, uint32_t chunk_size,
                                     uint32_t alignment);
+  /* put the chunks of f on huge pages if ink_huge_pages_init() enabled
+     them, chunks grow to a multiple of a huge page */
+  void ink_freelist_huge_pages(InkFreeList * f);
   inkcoreapi void *ink_freelist_new(InkFreeList * f);
   inkcoreapi void ink_freelist_free(InkFreeList * f, void *item);
+  /* return the magazines of the calling thread to the depots */
+  void ink_freelists_thread_flush(void);
+  /* turn the thread magazines on or off, off puts the cached items of the
+     calling thread and of the depots back on the lists */
+  void ink_freelists_thread_magazines(int enable);
   void ink_freelists_dump(FILE * f);
   void ink_freelists_dump_baselinerel(FILE * f);
   void ink_freelists_snap_baseline();
 
-  typedef struct
-  {
-#if defined(INK_USE_MUTEX_FOR_ATOMICLISTS)
-    ink_mutex inkatomiclist_mutex;
-#endif
-    volatile head_p head;
-    const char *name;
-    uint32_t offset;
-  } InkAtomicList;
-
 #if !defined(INK_QUEUE_NT)
 #define INK_ATOMICLIST_EMPTY(_x) (!(TO_PTR(FREELIST_POINTER((_x.head)))))
 #else
@@ -59,6 +59,7 @@
 #include "ink_file.h"
 #include "ink_hash_table.h"
 #include "ink_hrtime.h"
+#include "ink_hugepage.h"
 #include "ink_inout.h"
 #include "ink_killall.h"
 #include "ink_llqueue.h"
@@ -66,6 +67,7 @@
 #include "ink_memory.h"
 #include "ink_memory_pool.h"
 #include "ink_mutex.h"
+#include "ink_numa.h"
 #include "ink_spinlock.h"
 #include "ink_queue.h"
 #include "ink_rand.h"
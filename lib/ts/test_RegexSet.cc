@@ -0,0 +1,306 @@
+/** @file
+
+  Test and benchmark of the RegexSet prefilter
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/*
+  test_RegexSet [rule_count]
+  test_RegexSet -f rules_file -u urls_file
+
+  Checks the literal factors of a few patterns, then matches a list of
+  urls against a rule list, first rule wins, once pcre_exec() rule after
+  rule and once through the RegexSet candidates, and compares the rule
+  found and the time taken. The rules are generated in the shapes of
+  remap.config and regex_remap rules, or read from rules_file, one
+  pattern per line, the first field of a regex_remap line.
+*/
+
+#include "libts.h"
+#include <sys/time.h>
+
+#define DEFAULT_RULE_COUNT 2000
+#define URL_COUNT 20000
+
+struct FactorCase
+{
+  const char *pattern;
+  const char *factor;
+};
+
+static const FactorCase factor_cases[] = {
+  {"http://(.*)\\.example\\.com/img/(.*)", ".example.com/img/"},
+  {"^/images/([0-9]+)/(.*)\\.jpg$", "/images/"},
+  {"^/static/v[0-9]+/app\\.js", "/static/v"},
+  {"abcd*ef", "abc"},
+  {"abcd?ef", "abc"},
+  {"abcd{0,3}efg", "abc"},
+  {"abcd{2}ef", "abcd"},
+  {"ABCD+e", "abcd"},
+  {"^/(foo|bar)/baz\\.html", "/baz.html"},
+  {"^/foo|/bar/baz", NULL},
+  {"(?i)/foo/bar", NULL},
+  {"\\x41BCDEF", NULL},
+  {"^/a[b]]cd/", "]cd/"},
+  {"^/(.*)/(.*)/$", NULL},
+  {".", NULL},
+};
+
+static double
+now_usec()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+static int
+check_factors()
+{
+  char buf[256];
+  int errors = 0;
+
+  for (unsigned i = 0; i < sizeof(factor_cases) / sizeof(factor_cases[0]); i++) {
+    const FactorCase *fc = factor_cases + i;
+    int len = RegexSet::literal_factor(fc->pattern, buf, sizeof(buf));
+
+    if (fc->factor == NULL ? len != 0 : (len != (int)strlen(fc->factor) || memcmp(buf, fc->factor, len) != 0)) {
+      printf("factor of %s is \"%.*s\", expected \"%s\"\n", fc->pattern, len, buf, fc->factor ? fc->factor : "");
+      errors++;
+    }
+  }
+  return errors;
+}
+
+// Rules in the shapes of remap.config full url regexes and regex_remap
+// path rules, with a catch all rule at the end.
+static char **
+generate_rules(int count)
+{
+  char **rules = (char **)ats_malloc(count * sizeof(char *));
+  char buf[256];
+
+  for (int i = 0; i < count - 1; i++) {
+    switch (i % 5) {
+    case 0:
+      snprintf(buf, sizeof(buf), "http://(.*)\\.shop%d\\.example\\.com/(.*)", i);
+      break;
+    case 1:
+      snprintf(buf, sizeof(buf), "^/img/c%d/([0-9]+)/(.*)\\.jpg$", i);
+      break;
+    case 2:
+      snprintf(buf, sizeof(buf), "^/api/v%d/item-%d/(.*)", i % 3, i);
+      break;
+    case 3:
+      snprintf(buf, sizeof(buf), "^/(css|js)/site-%d/(.*)", i);
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "http://www\\.brand%d\\.com:8080/(.*)", i);
+      break;
+    }
+    rules[i] = ats_strdup(buf);
+  }
+  rules[count - 1] = ats_strdup("^.*\\.(gif|png)$");
+  return rules;
+}
+
+static char **
+generate_urls(int rule_count, int count)
+{
+  char **urls = (char **)ats_malloc(count * sizeof(char *));
+  char buf[256];
+
+  for (int i = 0; i < count; i++) {
+    int r = (i * 7919) % rule_count;
+
+    switch (i % 6) {
+    case 0:
+      snprintf(buf, sizeof(buf), "http://www.shop%d.example.com/index.html", r - r % 5);
+      break;
+    case 1:
+      snprintf(buf, sizeof(buf), "/img/c%d/%d/photo.jpg", r - r % 5 + 1, i);
+      break;
+    case 2:
+      snprintf(buf, sizeof(buf), "/api/v%d/item-%d/detail?id=%d", (r - r % 5 + 2) % 3, r - r % 5 + 2, i);
+      break;
+    case 3:
+      snprintf(buf, sizeof(buf), "/img/logo%d.png", i);
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "http://www.unknown%d.org/path/to/page%d.html", i, r);
+      break;
+    }
+    urls[i] = ats_strdup(buf);
+  }
+  return urls;
+}
+
+static char **
+read_lines(const char *filename, int *count)
+{
+  char **lines = NULL;
+  char buf[4096];
+  int capacity = 0;
+  FILE *fp = fopen(filename, "r");
+
+  *count = 0;
+  if (fp == NULL) {
+    printf("open %s fail: %s\n", filename, strerror(errno));
+    return NULL;
+  }
+  while (fgets(buf, sizeof(buf), fp) != NULL) {
+    char *p = buf + strspn(buf, " \t");
+    int len = strcspn(p, " \t\r\n");
+
+    if (len == 0 || *p == '#')
+      continue;
+    if (*count == capacity) {
+      capacity = capacity ? capacity * 2 : 1024;
+      lines = (char **)ats_realloc(lines, capacity * sizeof(char *));
+    }
+    lines[(*count)++] = ats_strndup(p, len);
+  }
+  fclose(fp);
+  return lines;
+}
+
+int
+main(int argc, char **argv)
+{
+  int rule_count = DEFAULT_RULE_COUNT;
+  int url_count = URL_COUNT;
+  const char *rules_file = NULL;
+  const char *urls_file = NULL;
+  char **rules;
+  char **urls;
+  pcre **res;
+  pcre_extra **extras;
+  int *linear_found;
+  int errors;
+  int candidates = 0;
+  int ovector[30];
+  double linear_usec, set_usec;
+  RegexSet set;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+      rules_file = argv[++i];
+    } else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+      urls_file = argv[++i];
+    } else {
+      rule_count = atoi(argv[i]);
+    }
+  }
+
+  if ((errors = check_factors()) != 0) {
+    printf("test_RegexSet FAILED\n");
+    return 1;
+  }
+
+  if (rules_file) {
+    rules = read_lines(rules_file, &rule_count);
+  } else {
+    rules = rule_count > 1 ? generate_rules(rule_count) : NULL;
+  }
+  if (urls_file) {
+    urls = read_lines(urls_file, &url_count);
+  } else {
+    urls = rules ? generate_urls(rule_count, url_count) : NULL;
+  }
+  if (rules == NULL || urls == NULL) {
+    printf("usage: %s [rule_count] | -f rules_file -u urls_file\n", argv[0]);
+    return 1;
+  }
+
+  res = (pcre **)ats_malloc(rule_count * sizeof(pcre *));
+  extras = (pcre_extra **)ats_malloc(rule_count * sizeof(pcre_extra *));
+  for (int i = 0; i < rule_count; i++) {
+    const char *error;
+    int erroffset;
+
+    if ((res[i] = pcre_compile(rules[i], 0, &error, &erroffset, NULL)) == NULL) {
+      printf("pcre_compile %s fail: %s\n", rules[i], error);
+      return 1;
+    }
+    extras[i] = pcre_study(res[i], 0, &error);
+    set.add(rules[i]);
+  }
+  set.compile();
+
+  linear_found = (int *)ats_malloc(url_count * sizeof(int));
+  linear_usec = now_usec();
+  for (int u = 0; u < url_count; u++) {
+    int len = strlen(urls[u]);
+
+    linear_found[u] = -1;
+    for (int i = 0; i < rule_count; i++) {
+      if (pcre_exec(res[i], extras[i], urls[u], len, 0, 0, ovector, 30) >= 0) {
+        linear_found[u] = i;
+        break;
+      }
+    }
+  }
+  linear_usec = now_usec() - linear_usec;
+
+  uint64_t *bitmap = (uint64_t *)ats_malloc(set.bitmap_size());
+  set_usec = now_usec();
+  for (int u = 0; u < url_count; u++) {
+    int len = strlen(urls[u]);
+    int found = -1;
+
+    set.reset(bitmap);
+    set.scan(urls[u], len, bitmap);
+    for (int i = set.next(bitmap, -1); i >= 0; i = set.next(bitmap, i)) {
+      candidates++;
+      if (pcre_exec(res[i], extras[i], urls[u], len, 0, 0, ovector, 30) >= 0) {
+        found = i;
+        break;
+      }
+    }
+    if (found != linear_found[u]) {
+      printf("%s matches rule %d, RegexSet found %d\n", urls[u], linear_found[u], found);
+      errors++;
+    }
+  }
+  set_usec = now_usec() - set_usec;
+
+  printf("%d rules, %d urls: pcre_exec() in order %.2f us per url, RegexSet %.2f us per url, "
+         "%.1f candidates per url\n", rule_count, url_count, linear_usec / url_count,
+         set_usec / url_count, (double)candidates / url_count);
+
+  for (int i = 0; i < rule_count; i++) {
+    pcre_free(res[i]);
+    if (extras[i])
+      pcre_free(extras[i]);
+    ats_free(rules[i]);
+  }
+  for (int u = 0; u < url_count; u++)
+    ats_free(urls[u]);
+  ats_free(res);
+  ats_free(extras);
+  ats_free(rules);
+  ats_free(urls);
+  ats_free(linear_found);
+  ats_free(bitmap);
+
+  printf("test_RegexSet %s\n", errors ? "FAILED" : "PASSED");
+  return errors ? 1 : 0;
+}
@@ -30,22 +30,24 @@
 
 
 #define NTHREADS 32
+#define RUN_SECONDS 1
 
 
 InkFreeList *flist = NULL;
-static int num_test_calls = 0;
+static volatile int running = 0;
 
+// Allocates and frees three items at a time until the run is over,
+// returns the number of items allocated
 void *
 test(void *d)
 {
   int id;
   void *m1, *m2, *m3;
+  int64_t count = 0;
 
   id = *((int *) &d);
 
-  time_t start = time(NULL);
-  int count = 0;
-  for (;;) {
+  while (running) {
     m1 = ink_freelist_new(flist);
     m2 = ink_freelist_new(flist);
     m3 = ink_freelist_new(flist);
@@ -64,29 +66,54 @@ test(void *d)
     ink_freelist_free(flist, m2);
     ink_freelist_free(flist, m3);
 
-		ink_atomic_increment(&num_test_calls, 1);
-    // break out of the test if we have run more then 60 seconds
-    if (++count % 1000 == 0 && (start + 60) < time(NULL)) {
-      return NULL;
-    }
+    count += 3;
   }
+  return (void *)(intptr_t)count;
+}
 
+// Alloc/free throughput of n threads, with or without thread magazines
+static void
+run(int n, int magazines)
+{
+  ink_thread t[NTHREADS];
+  int64_t total = 0;
+
+  cfg_thread_magazines = magazines;
+  running = 1;
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < n; i++)
+    t[i] = ink_thread_create(test, (void *)((intptr_t)i));
+  sleep(RUN_SECONDS);
+  running = 0;
+  for (int i = 0; i < n; i++) {
+    void *r;
+    pthread_join(t[i], &r);
+    total += (intptr_t)r;
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+  // the exiting threads have given their magazines back
+  if (flist->used != 0) {
+    fprintf(stderr, "%u items still in use after %d threads exited\n", flist->used, n);
+    exit(1);
+  }
+  printf("%7d | %9s | %10.2f\n", n, magazines ? "yes" : "no", (double)total * HRTIME_SECOND / elapsed / 1e6);
 }
 
 
 int
 main(int argc, char *argv[])
 {
-  int i;
+  NOWARN_UNUSED(argc);
+  NOWARN_UNUSED(argv);
 
   flist = ink_freelist_create("woof", 64, 256, 8);
 
-  for (i = 0; i < NTHREADS; i++) {
-    fprintf(stderr, "Create thread %d\n", i);
-    ink_thread_create(test, (void *)((intptr_t)i));
+  printf("threads | magazines | M allocs+frees/sec\n");
+  printf("--------|-----------|-------------------\n");
+  for (int n = 1; n <= NTHREADS; n *= 2) {
+    run(n, 0);
+    run(n, 1);
   }
-
-  test((void *) NTHREADS);
-	fprintf(stderr, "total test calls is %d\n", num_test_calls);
   return 0;
 }
@@ -133,6 +133,9 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.exec_thread.limit", RECD_INT, "2", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-1024]", RECA_READ_ONLY}
   ,
+  //       # bind the event threads: 0 = no, 1 = NUMA node, 2 = socket, 3 = core, 4 = processing unit
+  {RECT_CONFIG, "proxy.config.exec_thread.affinity", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-4]", RECA_READ_ONLY}
+  ,
   {RECT_CONFIG, "proxy.config.accept_threads", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_READ_ONLY}
   ,
   {RECT_CONFIG, "proxy.config.task_threads", RECD_INT, "2", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-99999]", RECA_READ_ONLY}
@@ -489,6 +492,16 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.share_server_sessions", RECD_INT, "2", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //       #  server_session_sharing.match:
+  //       #    0 = origin ip and port
+  //       #    1 = origin ip, port and hostname
+  //       #    2 = hostname and port, any origin ip
+  {RECT_CONFIG, "proxy.config.http.server_session_sharing.match", RECD_INT, "1", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.server_session_sharing.pool_overflow", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.server_session_sharing.thread_pool_max", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_STR, "^[0-9]+$", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.http.wuts_enabled", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.http.log_spider_codes", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
@@ -642,6 +655,9 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.normalize_ae_gzip", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
   ,
+  //       # splice the pass-through tunnels of plain TCP connections
+  {RECT_CONFIG, "proxy.config.http.splice_tunnel", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 
   //        ####################################################
   //        # Global User-Agent header                         #
@@ -826,6 +842,11 @@ RecordElement RecordsConfig[] = {
   //##############################################################################
   {RECT_CONFIG, "proxy.config.io.max_buffer_size", RECD_INT, "32768", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //       # 0 = ordinary pages, 1 = transparent huge pages, 2 = reserved huge page arena
+  {RECT_CONFIG, "proxy.config.iobuffer.huge_pages", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.iobuffer.huge_pages_arena_mb", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
 
   //##############################################################################
   //#
@@ -838,6 +859,21 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.net.listen_backlog", RECD_INT, "1024", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //       # every net thread listens on its own SO_REUSEPORT socket, overrides accept_threads
+  {RECT_CONFIG, "proxy.config.net.listen_reuseport", RECD_INT, "0", RECU_RESTART_TM, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  //       # check the inactivity timeouts from a wheel of seconds rather than scanning every connection each second
+  {RECT_CONFIG, "proxy.config.net.inactivity_wheel", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  //       # usecs the net threads keep polling without sleeping after the last I/O, 0 = off
+  {RECT_CONFIG, "proxy.config.net.poll_busy_time", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-100000]", RECA_NULL}
+  ,
+  //       # SO_BUSY_POLL usecs on client and origin sockets, 0 = off
+  {RECT_CONFIG, "proxy.config.net.sock_busy_poll", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-100000]", RECA_NULL}
+  ,
+  //       # per net thread histograms of the epoll batch size and the loop time
+  {RECT_CONFIG, "proxy.config.net.loop_histograms", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.net.accept_throttle", RECD_INT, "0", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   // This option takes different defaults depending on features / platform. TODO: This should use the
@@ -901,6 +937,23 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.cluster.flow_ctrl.max_loop_interval", RECD_INT, "1000", RECU_RESTART_TS, RR_REQUIRED, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # spin on epoll without sleep for this time (us) after the last IO, 0 for disable
+  {RECT_CONFIG, "proxy.config.cluster.busy_poll_time", RECD_INT, "50", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-100000]", RECA_NULL}
+  ,
+  //  # send the IOBufferBlocks with MSG_ZEROCOPY when a writev carries at least
+  //  # this many object bytes, 0 for disable
+  {RECT_CONFIG, "proxy.config.cluster.zerocopy_min_bytes", RECD_INT, "16384", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  //  # deficit round robin of the send queues of a connection, each visit
+  //  # of a queue may send up to send_weight * send_quantum bytes
+  {RECT_CONFIG, "proxy.config.cluster.send_quantum", RECD_INT, "16384", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1024-1048576]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.cluster.send_weight.control", RECD_INT, "8", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-1000]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.cluster.send_weight.lookup", RECD_INT, "4", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-1000]", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.cluster.send_weight.data", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-1000]", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.cluster.max_sessions_per_machine", RECD_INT, "1000000", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1000-4000000]", RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cluster.session_locks_per_machine", RECD_INT, "10949", RECU_RESTART_TS, RR_NULL, RECC_INT, "[1-100000]", RECA_NULL}
@@ -993,7 +1046,7 @@ RecordElement RecordsConfig[] = {
   //  # alternatively: 20971520 (20MB)
   {RECT_CONFIG, "proxy.config.cache.ram_cache.size", RECD_INT, "-1", RECU_RESTART_TS, RR_NULL, RECC_STR, "^-?[0-9]+$", RECA_NULL}
   ,
-  {RECT_CONFIG, "proxy.config.cache.ram_cache.algorithm", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  {RECT_CONFIG, "proxy.config.cache.ram_cache.algorithm", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cache.ram_cache.compress", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
   ,
@@ -1026,12 +1079,17 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.cache.ssd.transistor_range_threshold", RECD_INT, "1073741824", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  //  # number of accesses after which the ssd admission frequencies are halved
+  {RECT_CONFIG, "proxy.config.cache.ssd.admission_sample_size", RECD_INT, "1048576", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
   //  # The maximum size of a document that will be stored in the cache.
   //  # (0 disables the maximum document size check)
   {RECT_CONFIG, "proxy.config.cache.max_doc_size", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_STR, "^[0-9]+$", RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cache.min_average_object_size", RECD_INT, "8000", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.cache.dir.layout", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.cache.threads_per_disk", RECD_INT, "8", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.cache.agg_write_backlog", RECD_INT, "5242880", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
@@ -1170,6 +1228,15 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.healthcheck.serve_stale_for", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_INT, NULL, RECA_NULL}
   ,
+  //       # percent each check interval is randomly moved by
+  {RECT_CONFIG, "proxy.config.http.healthcheck.jitter", RECD_INT, "10", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-100]", RECA_NULL}
+  ,
+  //       # per origin RTT histograms, proxy.process.http.healthcheck.<hostname>.rtt.*
+  {RECT_CONFIG, "proxy.config.http.healthcheck.rtt_stats", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
+  //       # origins that get a RTT histogram, each takes 12 records
+  {RECT_CONFIG, "proxy.config.http.healthcheck.rtt_stats_max_origins", RECD_INT, "100", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1000]", RECA_NULL}
+  ,
 
   //##########################################################################
   //#
@@ -1362,6 +1429,9 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.url_remap.handle_backdoor_urls", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, NULL, RECA_NULL}
   ,
+  // # reuse the unchanged lookup stores of the previous table on reload
+  {RECT_CONFIG, "proxy.config.url_remap.incremental_reload", RECD_INT, "1", RECU_DYNAMIC, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 
   //##############################################################################
   //#
@@ -1414,12 +1484,26 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.ssl.client.CA.cert.path", RECD_STRING, NULL, RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
-  {RECT_CONFIG, "proxy.config.ssl.session_cache", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  //       # 0 - none, 1 - OpenSSL cache per certificate, 2 - one shared cache in buckets
+  {RECT_CONFIG, "proxy.config.ssl.session_cache", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-2]", RECA_NULL}
   ,
   {RECT_CONFIG, "proxy.config.ssl.session_cache.size", RECD_INT, "20480", RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.ssl.session_cache.num_buckets", RECD_INT, "256", RECU_RESTART_TS, RR_NULL, RECC_STR, "^[1-9][0-9]*$", RECA_NULL}
+  ,
+  //       # certificate files with resumption stats, two records each
+  {RECT_CONFIG, "proxy.config.ssl.cert_stats.max", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_STR, "^[0-9]+$", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.ssl.server.context_cache.size", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_STR, "^[0-9]+$", RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.ssl.server.ticket_key.filename", RECD_STRING, NULL, RECU_RESTART_TS, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.ssl.server.ticket_key.reload_interval", RECD_INT, "60", RECU_RESTART_TS, RR_NULL, RECC_STR, "^[0-9]+$", RECA_NULL}
+  ,
   {RECT_CONFIG, "proxy.config.ssl.max_record_size", RECD_INT, "0", RECU_DYNAMIC, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.ssl.ktls.enabled", RECD_INT, "0", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 
   //##############################################################################
   //# ICP Configuration
@@ -2113,6 +2197,10 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.allocator.reclaim_factor", RECD_FLOAT, "0.3", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
   ,
+#else
+  //       # per thread magazines of free items in front of the shared freelists
+  {RECT_CONFIG, "proxy.config.allocator.thread_magazines", RECD_INT, "1", RECU_RESTART_TS, RR_NULL, RECC_INT, "[0-1]", RECA_NULL}
+  ,
 #endif /* TS_USE_RECLAIMABLE_FREELIST */
 
   //############
@@ -2146,6 +2234,12 @@ RecordElement RecordsConfig[] = {
   ,
   {RECT_CONFIG, "proxy.config.http.hoturls.keep_days", RECD_INT, "1", RECU_NULL, RR_NULL, RECC_INT, "[1-31]", RECA_NULL}
   ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.sketch_epsilon", RECD_FLOAT, "0.002", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.sketch_delta", RECD_FLOAT, "0.01", RECU_NULL, RR_NULL, RECC_NULL, NULL, RECA_NULL}
+  ,
+  {RECT_CONFIG, "proxy.config.http.hoturls.top_size", RECD_INT, "64", RECU_NULL, RR_NULL, RECC_INT, "[1-1024]", RECA_NULL}
+  ,
 
   //##############################################################################
   //#
@@ -50,6 +50,7 @@ static char UNUSED rcsId__regex_remap_cc[] = "@(#) $Id$ built on " __DATE__ " "
 #include "ink_platform.h"
 #include "ink_atomic.h"
 #include "ink_time.h"
+#include "Regex.h"
 
 static const char* PLUGIN_NAME = "regex_remap";
 
@@ -501,13 +502,15 @@ class RemapRegex
 struct RemapInstance
 {
   RemapInstance() :
-    first(NULL), last(NULL), profile(false), method(false), query_string(true),
+    first(NULL), last(NULL), rules(NULL), profile(false), method(false), query_string(true),
     matrix_params(false), hits(0), misses(0),
     filename("unknown")
   { };
 
   RemapRegex* first;
   RemapRegex* last;
+  RegexSet set;      // Literal factor prefilter of the rules
+  RemapRegex** rules; // The rules by their index in the set
   bool profile;
   bool method;
   bool query_string;
@@ -680,6 +683,7 @@ TSRemapNewInstance(int argc, char* argv[], void** ih, char* errbuf, int errbuf_s
           else
             ri->last->set_next(cur);
           ri->last = cur;
+          ri->set.add(cur->regex());
         }
       }
     }
@@ -691,6 +695,13 @@ TSRemapNewInstance(int argc, char* argv[], void** ih, char* errbuf, int errbuf_s
     return TS_ERROR;
   }
 
+  // Index the rules in order, the candidates of a request are tried in that order
+  ri->rules = new RemapRegex*[ri->set.count()];
+  count = 0;
+  for (RemapRegex* re = ri->first; re; re = re->next())
+    ri->rules[count++] = re;
+  ri->set.compile();
+
   return TS_SUCCESS;
 }
 
@@ -736,6 +747,7 @@ TSRemapDeleteInstance(void* ih)
     delete tmp;
   }
 
+  delete[] ri->rules;
   delete ri;
 }
 
@@ -760,9 +772,11 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
   int lengths[OVECCOUNT/2 + 1];
   int dest_len;
   TSRemapStatus retval = TSREMAP_DID_REMAP;
-  RemapRegex* re = ri->first;
+  RemapRegex* re;
+  int ix;
   int match_len = 0;
   char *match_buf;
+  uint64_t *candidates;
 
   match_buf = (char*)alloca(req_url.url_len + 32);
 
@@ -802,8 +816,14 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
   match_buf[match_len] = '\0'; // NULL terminate the match string
   TSDebug(PLUGIN_NAME, "Target match string is `%s'", match_buf);
 
+  // Only the rules with their literal factor in the match string can match
+  candidates = (uint64_t*)alloca(ri->set.bitmap_size());
+  ri->set.reset(candidates);
+  ri->set.scan(match_buf, match_len, candidates);
+
   // Apply the regular expressions, in order. First one wins.
-  while (re) {
+  for (ix = ri->set.next(candidates, -1); ix >= 0; ix = ri->set.next(candidates, ix)) {
+    re = ri->rules[ix];
     // Since we check substitutions on parse time, we don't need to reset ovector
     if (re->is_simple() || (re->match(match_buf, match_len, ovector) != -1)) {
       int new_len = re->get_lengths(ovector, lengths, rri, &req_url);
@@ -870,14 +890,12 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
         break;
       }
     }
+  }
 
-    // Try the next regex
-    re = re->next();
-    if (re == NULL) {
-      retval = TSREMAP_NO_REMAP; // No match
-      if (ri->profile)
-        ink_atomic_increment(&(ri->misses), 1);
-    }
+  if (ix < 0) {
+    retval = TSREMAP_NO_REMAP; // No match
+    if (ri->profile)
+      ink_atomic_increment(&(ri->misses), 1);
   }
 
   return retval;
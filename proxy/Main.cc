@@ -550,6 +550,22 @@ struct CmdCacheCont: public Continuation
     return EVENT_CONT;
   }
 
+  int MigrateEvent(int event, Event * e)
+  {
+    (void) event;
+    (void) e;
+    if (cacheProcessor.IsCacheEnabled() == CACHE_INITIALIZED) {
+      // the directories were migrated when they were read, write them back
+      sync_cache_dir_on_shutdown(false);
+      Note("MIGRATE_DIR, succeeded");
+      _exit(0);
+    } else if (cacheProcessor.IsCacheEnabled() == CACHE_INIT_FAILED) {
+      Note("unable to open Cache, MIGRATE_DIR failed");
+      _exit(1);
+    }
+    return EVENT_CONT;
+  }
+
 CmdCacheCont(bool check, bool fix = false):Continuation(new_ProxyMutex()) {
     cache_fix = fix;
     if (check)
@@ -674,6 +690,28 @@ cmd_clear(char *cmd)
   return CMD_OK;
 }
 
+static int
+cmd_migrate_dir(char *cmd)
+{
+  NOWARN_UNUSED(cmd);
+  Note("MIGRATE_DIR");
+
+  const char *err = NULL;
+  theStore.delete_all();
+  if ((err = theStore.read_config())) {
+    printf("%s, MIGRATE_DIR failed\n", err);
+    return CMD_FAILED;
+  }
+  if (cacheProcessor.start() < 0) {
+    printf("\nbad cache configuration, MIGRATE_DIR failed\n");
+    return CMD_FAILED;
+  }
+  CmdCacheCont *c = NEW(new CmdCacheCont(false));
+  SET_CONTINUATION_HANDLER(c, &CmdCacheCont::MigrateEvent);
+  eventProcessor.schedule_every(c, HRTIME_SECONDS(1));
+  return CMD_IN_PROGRESS;
+}
+
 static int cmd_help(char *cmd);
 
 static struct CMD
@@ -726,6 +764,16 @@ commands[] = {
       "\n"
       "FORMAT: clear_hostdb\n"
       "\n" "Clear the entire hostdb cache.  All host name resolution\n" "information is lost.\n", cmd_clear}, {
+  "migrate_dir",
+      "Convert the cache directories to the configured layout",
+      "MIGRATE_DIR\n"
+      "\n"
+      "FORMAT: migrate_dir\n"
+      "\n"
+      "Convert the directory of every cache volume to the layout\n"
+      "set by proxy.config.cache.dir.layout and write it back.\n"
+      "The documents are kept, entries which do not fit in the\n"
+      "new layout are dropped.\n", cmd_migrate_dir}, {
 "help",
       "Obtain a short description of a command (e.g. 'help clear')",
       "HELP\n"
@@ -33,6 +33,7 @@
 #include "ProxyConfig.h"
 #include "HTTP.h"
 #include "HttpTransact.h"
+#include "HCUtil.h"
 
 #define PARENT_RegisterConfigUpdateFunc REC_RegisterConfigUpdateFunc
 #define PARENT_ReadConfigInteger REC_ReadConfigInteger
@@ -548,7 +549,11 @@ ParentRecord::FindParent(bool first_call, ParentResult * result, RD * rdata, Par
   //   should be retried
   do {
     // DNS ParentOnly inhibits bypassing the parent so always return that t
-    if ((parents[cur_index].failedAt == 0) || (parents[cur_index].failCount < config->FailThreshold)) {
+    if (healthcheck_enabled && !result->wrap_around &&
+        healthcheck_origin_down(parents[cur_index].hostname, parents[cur_index].port)) {
+      Debug("parent_select", "Parent %s:%d failed its health check", parents[cur_index].hostname, parents[cur_index].port);
+      parentUp = false;
+    } else if ((parents[cur_index].failedAt == 0) || (parents[cur_index].failCount < config->FailThreshold)) {
       Debug("parent_select", "config->FailThreshold = %d", config->FailThreshold);
       Debug("parent_select", "Selecting a down parent due to little failCount"
             "(faileAt: %u failCount: %d)", parents[cur_index].failedAt, parents[cur_index].failCount);
@@ -45,13 +45,152 @@
 #include "UrlMapping.h"
 #include "ink_unused.h"      /* MAGIC_EDITING_TAG */
 
-/** Time till we free the old stuff after a reconfiguration. */
-#define URL_REWRITE_TIMEOUT            (HRTIME_SECOND * 4 * 3600)
+/** How often the tables retired by a reconfiguration are checked for
+    transactions still using them. */
+#define URL_REWRITE_RECLAIM_INTERVAL   HRTIME_SECONDS(5)
+
+/** Pin counters per thread, the epochs are hashed on them. A retired
+    table waits for the pins of the epochs hashed with it too. */
+#define URL_REWRITE_PIN_EPOCHS         16
+
+/** Threads with a pin counter of their own, the others share the last one. */
+#define URL_REWRITE_PIN_SLOTS          512
 
 // Global Ptrs
 static Ptr<ProxyMutex> reconfig_mutex = NULL;
 UrlRewrite *rewrite_table = NULL;
 
+/**
+  Epoch based reclamation of the remap tables. Each table gets the next
+  epoch when published, and a transaction pins the epoch it uses in the
+  counters of its own thread, so the lookups write no shared line. A
+  retired table is freed once the counters of its epoch sum to zero, in
+  any order: a table freed before an older one first hands it what they
+  share, see UrlRewrite::handOver().
+
+*/
+struct UrlRewritePins
+{
+  volatile int count[URL_REWRITE_PIN_EPOCHS];     // one cache line per thread
+};
+
+static UrlRewritePins url_rewrite_pins[URL_REWRITE_PIN_SLOTS + 1];
+static volatile int url_rewrite_pin_slots = 0;
+static __thread int url_rewrite_pin_slot = -1;
+
+static UrlRewrite *url_rewrite_tables[URL_REWRITE_PIN_EPOCHS];   // by published epoch
+static volatile int url_rewrite_epoch = 0;     // epoch of rewrite_table
+static Vec<UrlRewrite *> url_rewrite_retired;  // not freed yet, the oldest first
+
+static inline UrlRewritePins *
+url_rewrite_thread_pins()
+{
+  if (unlikely(url_rewrite_pin_slot < 0)) {
+    url_rewrite_pin_slot = ink_atomic_increment(&url_rewrite_pin_slots, 1);
+    if (url_rewrite_pin_slot >= URL_REWRITE_PIN_SLOTS) {
+      url_rewrite_pin_slot = URL_REWRITE_PIN_SLOTS;
+    }
+  }
+  return &url_rewrite_pins[url_rewrite_pin_slot];
+}
+
+/**
+  Returns the current remap table, pinned until releaseUrlRewrite().
+  The epoch is pinned before it is checked again, so a reload either
+  sees the pin or makes the check fail; the table itself is not read
+  before the check succeeds.
+
+*/
+UrlRewrite *
+acquireUrlRewrite()
+{
+  UrlRewritePins *pins = url_rewrite_thread_pins();
+  int epoch;
+
+  for (;;) {
+    epoch = url_rewrite_epoch;
+    // a full barrier, on a line no other thread writes to
+    ink_atomic_increment(&pins->count[epoch % URL_REWRITE_PIN_EPOCHS], 1);
+    if (likely(epoch == url_rewrite_epoch)) {
+      UrlRewrite *table = url_rewrite_tables[epoch % URL_REWRITE_PIN_EPOCHS];
+      if (unlikely(table == NULL)) {   // not loaded yet
+        ink_atomic_increment(&pins->count[epoch % URL_REWRITE_PIN_EPOCHS], -1);
+        return NULL;
+      }
+      if (likely(table->epoch == epoch)) {
+        return table;
+      }
+      // the slot was published again since epoch was read
+    }
+    ink_atomic_increment(&pins->count[epoch % URL_REWRITE_PIN_EPOCHS], -1);
+  }
+}
+
+/** Unpins a table, on any thread; only the sum of the counters matters. */
+void
+releaseUrlRewrite(UrlRewrite *table)
+{
+  UrlRewritePins *pins = url_rewrite_thread_pins();
+
+  ink_atomic_increment(&pins->count[table->epoch % URL_REWRITE_PIN_EPOCHS], -1);
+}
+
+/** Frees the retired tables not pinned anymore, whatever their age. */
+static void
+reclaimUrlRewrite()
+{
+  int slots = url_rewrite_pin_slots;
+  int n = 0;
+
+  if (slots > URL_REWRITE_PIN_SLOTS) {
+    slots = URL_REWRITE_PIN_SLOTS + 1;
+  }
+  for (int i = 0; i < url_rewrite_retired.length(); i++) {
+    UrlRewrite *table = url_rewrite_retired[i];
+    int index = table->epoch % URL_REWRITE_PIN_EPOCHS;
+    int pinned = 0;
+
+    for (int j = 0; j < slots; j++) {
+      pinned += url_rewrite_pins[j].count[index];
+    }
+    if (pinned != 0) {
+      Debug("url_rewrite", "remap.config table of epoch %d may still be used by %d transactions", table->epoch, pinned);
+      url_rewrite_retired[n++] = table;
+      continue;
+    }
+
+    Debug("url_rewrite", "Deleting old remap.config table of epoch %d", table->epoch);
+    if (n > 0) {
+      table->handOver(url_rewrite_retired[n - 1]);
+    }
+    if (url_rewrite_tables[index] == table) {
+      url_rewrite_tables[index] = NULL;
+    }
+    delete table;
+  }
+  url_rewrite_retired.n = n;
+}
+
+struct UR_ReclaimContinuation;
+typedef int (UR_ReclaimContinuation::*UR_ReclaimContHandler) (int, void *);
+
+/** Used to free the retired url rewrite tables. */
+struct UR_ReclaimContinuation: public Continuation
+{
+  int reclaimEvent(int event, Event * e)
+  {
+    NOWARN_UNUSED(event);
+    NOWARN_UNUSED(e);
+    reclaimUrlRewrite();
+    return EVENT_CONT;
+  }
+  UR_ReclaimContinuation(ProxyMutex * m)
+    : Continuation(m)
+  {
+    SET_HANDLER((UR_ReclaimContHandler) & UR_ReclaimContinuation::reclaimEvent);
+  }
+};
+
 // Tokens for the Callback function
 #define FILE_CHANGED 0
 #define REVERSE_CHANGED 1
@@ -82,6 +221,9 @@ init_reverse_proxy()
     // core files (if enabled) when starting up with a bad remap.config file.
     _exit(-1);
   }
+  url_rewrite_tables[url_rewrite_epoch % URL_REWRITE_PIN_EPOCHS] = rewrite_table;
+  eventProcessor.schedule_every(NEW(new UR_ReclaimContinuation(reconfig_mutex)),
+                                URL_REWRITE_RECLAIM_INTERVAL, ET_TASK);
 
   REVERSE_RegisterConfigUpdateFunc("proxy.config.url_remap.filename", url_rewrite_CB, (void *) FILE_CHANGED);
   REVERSE_RegisterConfigUpdateFunc("proxy.config.proxy_name", url_rewrite_CB, (void *) TSNAME_CHANGED);
@@ -116,15 +258,28 @@ request_url_remap(HttpTransact::State * s, HTTPHdr * request_header, char **redi
 mapping_type
 request_url_remap_redirect(HTTPHdr *request_header, URL *redirect_url)
 {
-  return rewrite_table ? rewrite_table->Remap_redirect(request_header, redirect_url) : NONE;
+  UrlRewrite *table = acquireUrlRewrite();
+  mapping_type type = NONE;
+
+  if (table) {
+    type = table->Remap_redirect(request_header, redirect_url);
+    releaseUrlRewrite(table);
+  }
+  return type;
 }
 
 bool
 response_url_remap(HTTPHdr *response_header)
 {
-  return rewrite_table ? rewrite_table->ReverseMap(response_header) : false;
+  UrlRewrite *table = acquireUrlRewrite();
+  bool result = false;
+
+  if (table) {
+    result = table->ReverseMap(response_header);
+    releaseUrlRewrite(table);
+  }
+  return result;
 }
- 
 
 //
 //
@@ -152,28 +307,6 @@ struct UR_UpdateContinuation: public Continuation
   }
 };
 
-struct UR_FreerContinuation;
-typedef int (UR_FreerContinuation::*UR_FreerContHandler) (int, void *);
-
-/** Used to free url rewrite class. */
-struct UR_FreerContinuation: public Continuation
-{
-  UrlRewrite *p;
-  int freeEvent(int event, Event * e)
-  {
-    NOWARN_UNUSED(event);
-    NOWARN_UNUSED(e);
-    Debug("url_rewrite", "Deleting old remap.config table");
-    delete p;
-    delete this;
-    return EVENT_DONE;
-  }
-  UR_FreerContinuation(UrlRewrite * ap):Continuation(new_ProxyMutex()), p(ap)
-  {
-    SET_HANDLER((UR_FreerContHandler) & UR_FreerContinuation::freeEvent);
-  }
-};
-
 /**
   Called when the remap.config file changes. Since it called infrequently,
   we do the load of new file as blocking I/O and lock aquire is also
@@ -184,13 +317,20 @@ void
 reloadUrlRewrite()
 {
   UrlRewrite *newTable;
+  int epoch = url_rewrite_epoch + 1;
 
   Debug("url_rewrite", "remap.config updated, reloading...");
-  newTable = new UrlRewrite("proxy.config.url_remap.filename");
+  reclaimUrlRewrite();
+
+  newTable = new UrlRewrite("proxy.config.url_remap.filename", rewrite_table);
   if (newTable->is_valid()) {
-    eventProcessor.schedule_in(new UR_FreerContinuation(rewrite_table), URL_REWRITE_TIMEOUT, ET_TASK);
-    Debug("url_rewrite", "remap.config done reloading!");
+    newTable->epoch = epoch;
+    url_rewrite_tables[epoch % URL_REWRITE_PIN_EPOCHS] = newTable;
+    url_rewrite_retired.push_back(rewrite_table);
     ink_atomic_swap_ptr(&rewrite_table, newTable);
+    // a full barrier: the reclaimer reads the pins after this
+    ink_atomic_swap(&url_rewrite_epoch, epoch);
+    Debug("url_rewrite", "remap.config done reloading!");
   } else {
     static const char* msg = "failed to reload remap.config, not replacing!";
     delete newTable;
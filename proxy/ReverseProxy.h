@@ -63,6 +63,11 @@ bool request_url_remap(HttpTransact::State *s, HTTPHdr *request_header, char **r
 mapping_type request_url_remap_redirect(HTTPHdr *request_header, URL *redirect_url);
 bool response_url_remap(HTTPHdr *response_header);
 
+// The table a transaction uses, pinned until released. Lock free, the
+// table of a reload is freed once no transaction pins it anymore.
+UrlRewrite *acquireUrlRewrite();
+void releaseUrlRewrite(UrlRewrite *table);
+
 // Reload Functions
 void reloadUrlRewrite();
 
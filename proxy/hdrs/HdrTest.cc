@@ -77,6 +77,8 @@ HdrTest::go(RegressionTest * t, int atype)
   status = status & test_arena();
   status = status & test_regex();
   status = status & test_http_parser_eos_boundary_cases();
+  status = status & test_http_parse_throughput();
+  status = status & test_hdrtoken_tokenize();
   status = status & test_http_mutation();
   status = status & test_mime();
   status = status & test_http();
@@ -706,6 +708,235 @@ HdrTest::test_http_parser_eos_boundary_cases()
   return (failures_to_status("test_http_parser_eos_boundary_cases", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+static const char *comp_http_hdr(HTTPHdr * h1, HTTPHdr * h2);
+
+// parse msg in one piece, or a few bytes at a time so that the scanner
+// has to buffer the lines and the parser finds the colons itself
+static MIMEParseResult
+parse_hdr(HTTPParser * parser, HTTPHdr * hdr, const char *msg, int len, int piece)
+{
+  MIMEParseResult err;
+  const char *start = msg;
+  const char *end = msg;
+
+  http_parser_clear(parser);
+  do {
+    end = (msg + len - end > piece) ? end + piece : msg + len;
+    if (hdr->type_get() == HTTP_TYPE_REQUEST)
+      err = hdr->parse_req(parser, &start, end, end == msg + len);
+    else
+      err = hdr->parse_resp(parser, &start, end, end == msg + len);
+  } while (err == PARSE_CONT && end < msg + len);
+
+  return err;
+}
+
+int
+HdrTest::test_http_parse_throughput()
+{
+  // request and response headers captured from browser, app and api
+  // traffic, cookies and tokens replaced by values of the same length
+  static const char *msgs[] = {
+    "GET /s?wd=traffic+server&rsv_spt=1&issp=1&f=8&rsv_bp=0&ie=utf-8&tn=baiduhome_pg HTTP/1.1\r\n"
+      "Host: www.baidu.com\r\n"
+      "Connection: keep-alive\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n"
+      "User-Agent: Mozilla/5.0 (Windows NT 6.1; WOW64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/30.0.1599.101 Safari/537.36\r\n"
+      "Referer: http://www.baidu.com/\r\n"
+      "Accept-Encoding: gzip,deflate,sdch\r\n"
+      "Accept-Language: zh-CN,zh;q=0.8,en;q=0.6\r\n"
+      "Cookie: BAIDUID=0123456789ABCDEF0123456789ABCDEF:FG=1; BDUSS=0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghij; H_PS_PSSID=1428_3911_4261_4209; BDSVRTM=0\r\n"
+      "\r\n",
+    "GET /tfs/TB1xyzAbCdEfGhIjKlMn_!!0-item_pic.jpg_310x310.jpg HTTP/1.1\r\n"
+      "Host: img01.taobaocdn.com\r\n"
+      "Connection: keep-alive\r\n"
+      "Accept: image/webp,*/*;q=0.8\r\n"
+      "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_8_5) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/30.0.1599.101 Safari/537.36\r\n"
+      "Referer: http://item.taobao.com/item.htm?id=12345678901\r\n"
+      "Accept-Encoding: gzip,deflate,sdch\r\n"
+      "Accept-Language: zh-CN,zh;q=0.8\r\n"
+      "If-Modified-Since: Tue, 22 Oct 2013 08:12:31 GMT\r\n"
+      "\r\n",
+    "POST /rest/api3.do HTTP/1.1\r\n"
+      "Content-Type: application/x-www-form-urlencoded; charset=UTF-8\r\n"
+      "Content-Length: 245\r\n"
+      "Host: api.m.taobao.com\r\n"
+      "Connection: Keep-Alive\r\n"
+      "User-Agent: MTOPSDK/1.0.0 (Android;4.2.2;samsung;GT-I9500)\r\n"
+      "x-ttid: 700145@taobao_android_4.0.2\r\n"
+      "x-appkey: 12278902\r\n"
+      "x-t: 1382500000\r\n"
+      "x-sign: 0123456789abcdef0123456789abcdef\r\n"
+      "\r\n",
+    "GET /favicon.ico HTTP/1.1\r\n"
+      "Host: www.tmall.com\r\n"
+      "User-Agent: curl/7.29.0\r\n"
+      "Accept: */*\r\n"
+      "\r\n",
+    "GET /index.html HTTP/1.0\r\n"
+      "Host: www.example.com\r\n"
+      "X-Folded: part1\r\n"
+      "  part2: still the value\r\n"
+      "no colon on this line\r\n"
+      "X-Empty:\r\n"
+      "X-Spaces  :   value with trailing spaces   \r\n"
+      "X-Bare-LF: value\n"
+      "\r\n",
+    "HTTP/1.1 200 OK\r\n"
+      "Server: Tengine\r\n"
+      "Date: Wed, 23 Oct 2013 03:46:40 GMT\r\n"
+      "Content-Type: image/jpeg\r\n"
+      "Content-Length: 19523\r\n"
+      "Connection: keep-alive\r\n"
+      "Expires: Fri, 22 Nov 2013 03:46:40 GMT\r\n"
+      "Cache-Control: max-age=2592000\r\n"
+      "Last-Modified: Tue, 22 Oct 2013 08:12:31 GMT\r\n"
+      "Accept-Ranges: bytes\r\n"
+      "Via: cache12.l2et2[0,200-0,H], cache45.cn42[0,200-0,H]\r\n"
+      "Age: 7391\r\n"
+      "\r\n",
+    NULL
+  };
+#define PARSE_ROUNDS 20000
+
+  int i, round, failures = 0;
+  int64_t bytes = 0;
+  ink_hrtime t;
+  HTTPParser parser;
+  const char *cmp;
+
+  bri_box("test_http_parse_throughput");
+
+  http_parser_init(&parser);
+
+  // the piecewise parse must give the same header as the one piece parse
+  for (i = 0; msgs[i] != NULL; i++) {
+    HTTPType type = (msgs[i][0] == 'H') ? HTTP_TYPE_RESPONSE : HTTP_TYPE_REQUEST;
+    int len = (int) strlen(msgs[i]);
+    HTTPHdr whole, pieces;
+
+    whole.create(type);
+    pieces.create(type);
+    if (parse_hdr(&parser, &whole, msgs[i], len, len) != PARSE_DONE ||
+        parse_hdr(&parser, &pieces, msgs[i], len, 7) != PARSE_DONE) {
+      printf("FAILED: msg %d does not parse\n", i);
+      ++failures;
+    } else if ((cmp = comp_http_hdr(&whole, &pieces)) != NULL) {
+      printf("FAILED: msg %d parsed in pieces: %s\n", i, cmp);
+      ++failures;
+    }
+    whole.destroy();
+    pieces.destroy();
+  }
+
+  t = ink_get_hrtime_internal();
+  for (round = 0; round < PARSE_ROUNDS; round++) {
+    for (i = 0; msgs[i] != NULL; i++) {
+      HTTPHdr hdr;
+      int len = (int) strlen(msgs[i]);
+
+      hdr.create((msgs[i][0] == 'H') ? HTTP_TYPE_RESPONSE : HTTP_TYPE_REQUEST);
+      parse_hdr(&parser, &hdr, msgs[i], len, len);
+      hdr.destroy();
+      bytes += len;
+    }
+  }
+  t = ink_get_hrtime_internal() - t;
+
+  printf("%d headers, %" PRId64 " bytes: %.1f MB/s, %.0f ns per header\n", PARSE_ROUNDS * i, bytes,
+         (double) bytes * 1000.0 / (t ? t : 1), (double) t / (PARSE_ROUNDS * i));
+
+  http_parser_clear(&parser);
+
+  return (failures_to_status("test_http_parse_throughput", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+int
+HdrTest::test_hdrtoken_tokenize()
+{
+  // strings that hash like a well-known string once case folded, or
+  // differ from one by a byte
+  static const char *not_wks[] = {
+    "", "Accept-", "Acceptx", "X-Forwarded-Fo", "Content-Lengthx", "Content\rLength", "Host ", "X-Requested-With", NULL
+  };
+  // field names in the proportions of request and response headers,
+  // most of them well-known
+  static const char *mix[] = {
+    "Host", "Connection", "Accept", "User-Agent", "Referer", "Accept-Encoding", "Accept-Language", "Cookie",
+    "If-Modified-Since", "If-None-Match", "Cache-Control", "X-Forwarded-For", "Content-Type", "Content-Length",
+    "x-ttid", "X-Requested-With", "Server", "Date", "Expires", "Last-Modified", "ETag", "Accept-Ranges",
+    "Via", "Age", "Set-Cookie", "Transfer-Encoding", "Vary", "X-Cache", "content-length", "CONNECTION",
+    NULL
+  };
+#define TOKENIZE_ROUNDS 100000
+
+  char buf[256];
+  char copies[sizeof(mix) / sizeof(mix[0])][32];
+  int lengths[sizeof(mix) / sizeof(mix[0])];
+  int i, j, round, failures = 0;
+  const char *wks;
+  int64_t found = 0;
+  ink_hrtime t, t_dfa;
+
+  bri_box("test_hdrtoken_tokenize");
+
+  for (i = 0; i < hdrtoken_num_wks; i++) {
+    int len = hdrtoken_index_to_length(i);
+
+    for (j = 0; j < 3; j++) {
+      ink_strlcpy(buf, hdrtoken_index_to_wks(i), sizeof(buf));
+      for (int c = 0; j > 0 && c < len; c++)
+        buf[c] = (j == 1) ? ParseRules::ink_tolower(buf[c]) : ParseRules::ink_toupper(buf[c]);
+      if (hdrtoken_tokenize(buf, len, &wks) != i || wks != hdrtoken_index_to_wks(i)) {
+        printf("FAILED: '%s' is not tokenized to %d\n", buf, i);
+        ++failures;
+      }
+    }
+  }
+
+  for (i = 0; not_wks[i] != NULL; i++) {
+    if (hdrtoken_tokenize(not_wks[i], (int) strlen(not_wks[i])) >= 0) {
+      printf("FAILED: '%s' is tokenized\n", not_wks[i]);
+      ++failures;
+    }
+  }
+
+  // copies, so that hdrtoken_tokenize() does not see the wks pointers
+  for (i = 0; mix[i] != NULL; i++) {
+    lengths[i] = ink_strlcpy(copies[i], mix[i], sizeof(copies[i]));
+  }
+
+  t = ink_get_hrtime_internal();
+  for (round = 0; round < TOKENIZE_ROUNDS; round++) {
+    for (j = 0; j < i; j++)
+      found += hdrtoken_tokenize(copies[j], lengths[j]) >= 0;
+  }
+  t = ink_get_hrtime_internal() - t;
+
+  t_dfa = ink_get_hrtime_internal();
+  for (round = 0; round < TOKENIZE_ROUNDS; round++) {
+    for (j = 0; j < i; j++)
+      found -= hdrtoken_tokenize_dfa(copies[j], lengths[j]) >= 0;
+  }
+  t_dfa = ink_get_hrtime_internal() - t_dfa;
+
+  if (found != 0) {
+    printf("FAILED: hdrtoken_tokenize() and hdrtoken_tokenize_dfa() found %" PRId64 " different tokens\n", found);
+    ++failures;
+  }
+
+  printf("%d tokenizes: %.1f ns per op, %.1f ns per op with the dfa\n", TOKENIZE_ROUNDS * i,
+         (double) t / (TOKENIZE_ROUNDS * i), (double) t_dfa / (TOKENIZE_ROUNDS * i));
+
+  return (failures_to_status("test_hdrtoken_tokenize", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
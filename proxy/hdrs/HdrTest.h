@@ -57,6 +57,8 @@ private:
   int test_format_date();
   int test_url();
   int test_http_parser_eos_boundary_cases();
+  int test_http_parse_throughput();
+  int test_hdrtoken_tokenize();
   int test_arena();
   int test_regex();
   int test_accept_language_match();
@@ -32,8 +32,7 @@
 #include "URL.h"
 
 /* 
- You SHOULD add to _hdrtoken_commonly_tokenized_strs, with the same ordering
- ** important, ordering matters **
+ ** important, ordering matters for hdrtoken_strs_dfa **
  
  You want a regexp like 'Accept' after "greedier" choices so it doesn't match 'Accept-Ranges' earlier than
  it should. The regexp are anchored (^Accept), but I dont see a way with the current system to 
@@ -341,189 +340,58 @@ DFA *hdrtoken_strs_dfa = NULL;
  *                                                                     *
  ***********************************************************************/
 
-#define	HDRTOKEN_HASH_TABLE_SIZE	65536
-#define	HDRTOKEN_HASH_TABLE_MASK	HDRTOKEN_HASH_TABLE_SIZE-1
+/*
+  hdrtoken_tokenize() looks strings up in a minimal perfect hash of all
+  the well-known strings, built by hdrtoken_hash_init(). The low bits of
+  the hash pick a bucket, and the displacement found for the bucket maps
+  the high bits to the only slot a well-known string with that hash can
+  be in, so a lookup is one hash, one length compare and one case
+  insensitive compare.
+*/
 
-struct HdrTokenHashBucket
-{
-  const char *wks;
-  uint32_t hash;
-};
+#define HDRTOKEN_HASH_BUCKETS		64      // power of 2, about half the wks count
+#define HDRTOKEN_HASH_MAX_DISPLACEMENT	65535
 
-HdrTokenHashBucket hdrtoken_hash_table[HDRTOKEN_HASH_TABLE_SIZE];
+static uint16_t hdrtoken_hash_displacements[HDRTOKEN_HASH_BUCKETS];
+static const char *hdrtoken_hash_table[SIZEOF(_hdrtoken_strs)];
 
 /**
-  basic FNV hash
+  FNV-1a over the case folded bytes, with a final mix for the low bits.
+  Or'ing 0x20 folds the letters, it also folds some punctuation together
+  but the strings are compared after.
 **/
-#define TINY_MASK(x) (((u_int32_t)1<<(x))-1)
-
-inline uint32_t
-hash_to_slot(uint32_t hash)
-{
-  return ((hash>>15) ^ hash) & TINY_MASK(15);
-}
-
-inline uint32_t
+static inline uint64_t
 hdrtoken_hash(const unsigned char *string, unsigned int length)
 {
-  static const uint32_t InitialFNV = 2166136261U;
-  static const int32_t FNVMultiple = 16777619;
-
-  uint32_t hash = InitialFNV;
+  uint64_t hash = 14695981039346656037ULL;
 
-  for (size_t i = 0; i < length; i++)  {
-      hash = hash ^ (toupper(string[i])); 
-      hash = hash * FNVMultiple;          
+  for (unsigned int i = 0; i < length; i++) {
+    hash ^= string[i] | 0x20;
+    hash *= 1099511628211ULL;
   }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
 
   return hash;
 }
 
-/*-------------------------------------------------------------------------
-  -------------------------------------------------------------------------*/
+static inline uint32_t
+hdrtoken_hash_to_bucket(uint64_t hash)
+{
+  return (uint32_t) hash & (HDRTOKEN_HASH_BUCKETS - 1);
+}
 
-const char *_hdrtoken_commonly_tokenized_strs[] = {
-  // MIME Field names
-  "Accept-Charset",
-  "Accept-Encoding",
-  "Accept-Language",
-  "Accept-Ranges",
-  "Accept",
-  "Age",
-  "Allow",
-  "Approved",                   // NNTP
-  "Authorization",
-  "Bytes",                      // NNTP
-  "Cache-Control",
-  "Client-ip",
-  "Connection",
-  "Content-Base",
-  "Content-Encoding",
-  "Content-Language",
-  "Content-Length",
-  "Content-Location",
-  "Content-MD5",
-  "Content-Range",
-  "Content-Type",
-  "Control",                    // NNTP
-  "Cookie",
-  "Date",
-  "Distribution",               // NNTP
-  "Etag",
-  "Expect",
-  "Expires",
-  "Followup-To",                // NNTP
-  "From",
-  "Host",
-  "If-Match",
-  "If-Modified-Since",
-  "If-None-Match",
-  "If-Range",
-  "If-Unmodified-Since",
-  "Keep-Alive",
-  "Keywords",                   // NNTP
-  "Last-Modified",
-  "Lines",                      // NNTP
-  "Location",
-  "Max-Forwards",
-  "Message-ID",                 // NNTP
-  "MIME-Version",
-  "Newsgroups",                 // NNTP
-  "Organization",               // NNTP
-  "Path",                       // NNTP
-  "Pragma",
-  "Proxy-Authenticate",
-  "Proxy-Authorization",
-  "Proxy-Connection",
-  "Public",
-  "Range",
-  "References",                 // NNTP
-  "Referer",
-  "Reply-To",                   // NNTP
-  "Retry-After",
-  "Sender",                     // NNTP
-  "Server",
-  "Set-Cookie",
-  "Subject",                    // NNTP
-  "Summary",                    // NNTP
-  "Transfer-Encoding",
-  "Upgrade",
-  "User-Agent",
-  "Vary",
-  "Via",
-  "Warning",
-  "Www-Authenticate",
-  "Xref",                       // NNTP
-  "@DataInfo",                  // Internal Hack
-  
-  // Accept-Encoding
-  "compress",
-  "deflate",
-  "gzip",
-  "identity",
-  
-  // Cache-Control flags
-  "max-age",
-  "max-stale",
-  "min-fresh",
-  "must-revalidate",
-  "no-cache",
-  "no-store",
-  "no-transform",
-  "only-if-cached",
-  "private",
-  "proxy-revalidate",
-  "s-maxage",
-  "need-revalidate-once",
-  
-  // HTTP miscellaneous
-  "none",
-  "chunked",
-  "close",
-  
-  // URL schemes
-  "file",
-  "ftp",
-  "gopher",
-  "https",
-  "http",
-  "mailto",
-  "news",
-  "nntp",
-  "prospero",
-  "telnet",
-  "tunnel",
-  "wais",
-  "pnm",
-  "rtspu",
-  "rtsp",
-  "mmsu",
-  "mmst",
-  "mms",
-  
-  // HTTP methods
-  "CONNECT",
-  "DELETE",
-  "GET",
-  "POST",
-  "HEAD",
-  "ICP_QUERY",
-  "OPTIONS",
-  "PURGE",
-  "PUT",
-  "TRACE",
-  "PUSH",
-  "X-ID",
-  "PRI",
-  "PROPFIND",
-  "REPORT",
-  "SEARCH",
-  
-  // Header extensions
-  "Owner-Left-Time",
-  "X-Forwarded-For",
-  "TE",
-};
+static inline uint32_t
+hdrtoken_hash_to_slot(uint64_t hash, uint32_t displacement)
+{
+  uint32_t h = (uint32_t) (hash >> 32) ^ (displacement * 0x9e3779b9U);
+
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  return (uint32_t) (((uint64_t) h * SIZEOF(_hdrtoken_strs)) >> 32);
+}
 
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
@@ -531,34 +399,63 @@ const char *_hdrtoken_commonly_tokenized_strs[] = {
 void
 hdrtoken_hash_init()
 {
-  uint32_t i;
-  int num_collisions;
+  uint64_t hashes[SIZEOF(_hdrtoken_strs)];
+  int order[SIZEOF(_hdrtoken_strs)];
+  int bucket_sizes[HDRTOKEN_HASH_BUCKETS];
+  uint32_t slots[SIZEOF(_hdrtoken_strs)];
+  int i, j, k, n;
 
   memset(hdrtoken_hash_table, 0, sizeof(hdrtoken_hash_table));
-  num_collisions = 0;
-
-  for (i = 0; i < (int) SIZEOF(_hdrtoken_commonly_tokenized_strs); i++) {
-    // convert the common string to the well-known token
-    unsigned const char *wks;
-    int wks_idx = hdrtoken_tokenize_dfa(_hdrtoken_commonly_tokenized_strs[i],
-                                        (int) strlen(_hdrtoken_commonly_tokenized_strs[i]),
-                                        (const char **) &wks);
-    ink_release_assert(wks_idx >= 0);
-
-    uint32_t hash = hdrtoken_hash(wks, hdrtoken_str_lengths[wks_idx]);
-    uint32_t slot = hash_to_slot(hash);
-
-    if (hdrtoken_hash_table[slot].wks) {
-      printf("ERROR: hdrtoken_hash_table[%u] collision: '%s' replacing '%s'\n",
-             slot, (const char*)wks, hdrtoken_hash_table[slot].wks);
-      ++num_collisions;
+  memset(bucket_sizes, 0, sizeof(bucket_sizes));
+
+  for (i = 0; i < (int) SIZEOF(_hdrtoken_strs); i++) {
+    hashes[i] = hdrtoken_hash((const unsigned char *) hdrtoken_strs[i], hdrtoken_str_lengths[i]);
+    bucket_sizes[hdrtoken_hash_to_bucket(hashes[i])]++;
+  }
+
+  // place the strings bucket by bucket, the largest buckets first while
+  // most of the slots are free
+  n = 0;
+  for (int size = SIZEOF(_hdrtoken_strs); size > 0; size--) {
+    for (uint32_t b = 0; b < HDRTOKEN_HASH_BUCKETS; b++) {
+      if (bucket_sizes[b] != size)
+        continue;
+
+      for (i = 0, k = 0; i < (int) SIZEOF(_hdrtoken_strs); i++) {
+        if (hdrtoken_hash_to_bucket(hashes[i]) == b)
+          order[k++] = i;
+      }
+
+      uint32_t d;
+      for (d = 0; d <= HDRTOKEN_HASH_MAX_DISPLACEMENT; d++) {
+        for (j = 0; j < size; j++) {
+          slots[j] = hdrtoken_hash_to_slot(hashes[order[j]], d);
+          if (hdrtoken_hash_table[slots[j]])
+            break;
+          for (k = 0; k < j; k++) {
+            if (slots[k] == slots[j])
+              break;
+          }
+          if (k < j)
+            break;
+        }
+        if (j == size)
+          break;
+      }
+      if (d > HDRTOKEN_HASH_MAX_DISPLACEMENT) {
+        printf("ERROR: no hdrtoken_hash_table displacement for '%s' and %d other strings\n",
+               hdrtoken_strs[order[0]], size - 1);
+        abort();
+      }
+
+      hdrtoken_hash_displacements[b] = (uint16_t) d;
+      for (j = 0; j < size; j++)
+        hdrtoken_hash_table[slots[j]] = hdrtoken_strs[order[j]];
+      n += size;
     }
-    hdrtoken_hash_table[slot].wks = (const char *)wks;
-    hdrtoken_hash_table[slot].hash = hash;
   }
 
-  if (num_collisions > 0)
-    abort();
+  ink_release_assert(n == (int) SIZEOF(_hdrtoken_strs));
 }
 
 
@@ -709,7 +606,6 @@ int
 hdrtoken_tokenize(const char *string, int string_len, const char **wks_string_out)
 {
   int wks_idx;
-  HdrTokenHashBucket *bucket;
 
   ink_debug_assert(string != NULL);
 
@@ -720,16 +616,14 @@ hdrtoken_tokenize(const char *string, int string_len, const char **wks_string_ou
     return wks_idx;
   }
 
-  uint32_t hash = hdrtoken_hash((const unsigned char *) string, (unsigned int) string_len);
-  uint32_t slot = hash_to_slot(hash);
+  uint64_t hash = hdrtoken_hash((const unsigned char *) string, (unsigned int) string_len);
+  const char *wks = hdrtoken_hash_table[hdrtoken_hash_to_slot(hash, hdrtoken_hash_displacements[hdrtoken_hash_to_bucket(hash)])];
 
-  bucket = &(hdrtoken_hash_table[slot]);
-  if ((bucket->wks != NULL) &&
-      (bucket->hash == hash) &&
-      (hdrtoken_wks_to_length(bucket->wks) == string_len)) {
-    wks_idx = hdrtoken_wks_to_index(bucket->wks);
+  if ((hdrtoken_wks_to_length(wks) == string_len) &&
+      ((memcmp(wks, string, string_len) == 0) || (strncasecmp(wks, string, string_len) == 0))) {
+    wks_idx = hdrtoken_wks_to_index(wks);
     if (wks_string_out)
-      *wks_string_out = bucket->wks;
+      *wks_string_out = wks;
     return wks_idx;
   }
 
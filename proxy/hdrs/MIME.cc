@@ -31,6 +31,11 @@
 #include "HdrToken.h"
 #include "HdrUtils.h"
 #include "HttpCompat.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /***********************************************************************
  *                                                                     *
@@ -2189,7 +2194,7 @@ _mime_scanner_init(MIMEScanner *scanner)
   scanner->m_line_size = 0;
   scanner->m_line_length = 0;
   scanner->m_state = MIME_PARSE_BEFORE;
-
+  scanner->m_colon = MIME_SCANNER_COLON_UNKNOWN;
 }
 
 //////////////////////////////////////////////////////
@@ -2241,6 +2246,64 @@ mime_scanner_append(MIMEScanner *scanner, const char *data, int data_size)
   scanner->m_line_length += data_size;
 }
 
+// masks of the LF and ':' bytes in the MIME_SCAN_BLOCK bytes at s
+#if defined(__AVX2__)
+#define MIME_SCAN_BLOCK 32
+
+static inline void
+mime_scan_block(const char *s, uint32_t *lf, uint32_t *colon)
+{
+  __m256i v = _mm256_loadu_si256((const __m256i *) s);
+  *lf = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(ParseRules::CHAR_LF)));
+  *colon = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+}
+#elif defined(__SSE2__)
+#define MIME_SCAN_BLOCK 16
+
+static inline void
+mime_scan_block(const char *s, uint32_t *lf, uint32_t *colon)
+{
+  __m128i v = _mm_loadu_si128((const __m128i *) s);
+  *lf = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(ParseRules::CHAR_LF)));
+  *colon = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+}
+#endif
+
+// Returns the first LF in [s, e), or NULL, and sets *colon to the first
+// ':' before it, if any. Both are looked for in the same pass so that
+// the parser does not read the field line again to split it, the LF
+// alone is looked for with memchr() once the colon is found.
+static inline const char *
+mime_scan_field(const char *s, const char *e, const char **colon)
+{
+#ifdef MIME_SCAN_BLOCK
+  uint32_t lf, c;
+
+  for (; e - s >= MIME_SCAN_BLOCK; s += MIME_SCAN_BLOCK) {
+    mime_scan_block(s, &lf, &c);
+    if (lf) {
+      c &= (lf & -lf) - 1;
+      if (c)
+        *colon = s + __builtin_ctz(c);
+      return s + __builtin_ctz(lf);
+    }
+    if (c) {
+      *colon = s + __builtin_ctz(c);
+      return static_cast<char const*>(memchr(s + MIME_SCAN_BLOCK, ParseRules::CHAR_LF, e - s - MIME_SCAN_BLOCK));
+    }
+  }
+#endif
+  for (; s < e; ++s) {
+    if (ParseRules::is_lf(*s))
+      return s;
+    if (*s == ':') {
+      *colon = s;
+      return static_cast<char const*>(memchr(s + 1, ParseRules::CHAR_LF, e - s - 1));
+    }
+  }
+  return NULL;
+}
+
 MIMEParseResult
 mime_scanner_get(MIMEScanner *S,
                  const char **raw_input_s,
@@ -2252,6 +2315,7 @@ mime_scanner_get(MIMEScanner *S,
                  int raw_input_scan_type)
 {
   const char *raw_input_c, *lf_ptr;
+  const char *colon_ptr = NULL;
   MIMEParseResult zret = PARSE_CONT;
   // Need this for handling dangling CR.
   static char const RAW_CR = ParseRules::CHAR_CR;
@@ -2298,7 +2362,11 @@ mime_scanner_get(MIMEScanner *S,
       }
       break;
     case MIME_PARSE_INSIDE:
-      lf_ptr = static_cast<char const*>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
+      if (MIME_SCANNER_TYPE_FIELD == raw_input_scan_type && NULL == colon_ptr) {
+        lf_ptr = mime_scan_field(raw_input_c, raw_input_e, &colon_ptr);
+      } else {
+        lf_ptr = static_cast<char const*>(memchr(raw_input_c, ParseRules::CHAR_LF, runway));
+      }
       if (lf_ptr) {
         raw_input_c = lf_ptr + 1;
         if (MIME_SCANNER_TYPE_LINE == raw_input_scan_type) {
@@ -2370,10 +2438,16 @@ mime_scanner_get(MIMEScanner *S,
       *output_e = *output_s + S->m_line_length;
       *output_shares_raw_input = false;
       S->m_line_length = 0;
+      S->m_colon = MIME_SCANNER_COLON_UNKNOWN;
     } else {
       *output_s = *raw_input_s;
       *output_e = raw_input_c;
       *output_shares_raw_input = true;
+      // The whole field was scanned in this call, so colon_ptr is exact.
+      if (MIME_SCANNER_TYPE_FIELD == raw_input_scan_type)
+        S->m_colon = colon_ptr ? (int) (colon_ptr - *raw_input_s) : MIME_SCANNER_COLON_NONE;
+      else
+        S->m_colon = MIME_SCANNER_COLON_UNKNOWN;
     }
   }
   
@@ -2465,8 +2539,13 @@ mime_parser_parse(MIMEParser *parser, HdrHeap *heap, MIMEHdrImpl *mh, const char
     if ((!ParseRules::is_token(*field_name_first)) && (*field_name_first != '@'))
       continue;                 // toss away garbage line
 
-    // find name last
-    colon = (char *) memchr(line_c, ':', (line_e - line_c));
+    // find name last, the scanner has usually found the colon already
+    if (scanner->m_colon >= 0)
+      colon = line_c + scanner->m_colon;
+    else if (scanner->m_colon == MIME_SCANNER_COLON_NONE)
+      colon = NULL;
+    else
+      colon = (char *) memchr(line_c, ':', (line_e - line_c));
     if (!colon)
       continue;                 // toss away garbage line
     field_name_last = colon - 1;
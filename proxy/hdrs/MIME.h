@@ -63,6 +63,10 @@ enum MimeParseState {
 #define MIME_SCANNER_TYPE_LINE				0
 #define MIME_SCANNER_TYPE_FIELD				1
 
+// MIMEScanner::m_colon when it is not an offset
+#define MIME_SCANNER_COLON_NONE				-1
+#define MIME_SCANNER_COLON_UNKNOWN			-2
+
 /***********************************************************************
  *                                                                     *
  *                              Assertions                             *
@@ -265,6 +269,7 @@ struct MIMEScanner
   int m_line_size;              // total allocated size of buffer
 //  int m_state;                  // state of scanning state machine
   MimeParseState m_state; ///< Parsing machine state.
+  int m_colon; ///< Offset of the first ':' in the last field line, or MIME_SCANNER_COLON_*.
 };
 
 
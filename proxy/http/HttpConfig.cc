@@ -1141,6 +1141,21 @@ register_stat_callbacks()
                      RECD_FLOAT, RECP_NULL,
                      (int) http_server_first_response_time_stat, RecRawStatSyncIntMsecsToFloatSeconds);
 
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.hits",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_hits_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.misses",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_misses_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.migrations",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_migrations_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.overflows",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_overflows_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.lock_misses",
+                     RECD_COUNTER, RECP_NULL, (int) http_server_session_pool_lock_misses_stat, RecRawStatSyncCount);
 }
 
 
@@ -1184,6 +1199,9 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.server_tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigByte(c.server_session_match, "proxy.config.http.server_session_sharing.match");
+  HttpEstablishStaticConfigByte(c.server_session_pool_overflow, "proxy.config.http.server_session_sharing.pool_overflow");
+  HttpEstablishStaticConfigLongLong(c.server_session_thread_pool_max, "proxy.config.http.server_session_sharing.thread_pool_max");
 
   HttpEstablishStaticConfigByte(c.parent_proxy_routing_enable, "proxy.config.http.parent_proxy_routing_enable");
 
@@ -1289,6 +1307,7 @@ HttpConfig::startup()
   HttpEstablishStaticConfigByte(c.enable_http_stats, "proxy.config.http.enable_http_stats");
 
   HttpEstablishStaticConfigByte(c.normalize_ae_gzip, "proxy.config.http.normalize_ae_gzip");
+  HttpEstablishStaticConfigByte(c.splice_tunnel, "proxy.config.http.splice_tunnel");
 
   HttpEstablishStaticConfigByte(c.icp_enabled, "proxy.config.icp.enabled");
   HttpEstablishStaticConfigByte(c.stale_icp_enabled, "proxy.config.icp.stale_icp_enabled");
@@ -1482,6 +1501,9 @@ HttpConfig::reconfigure()
   params->oride.server_tcp_init_cwnd = m_master.oride.server_tcp_init_cwnd;
   params->oride.origin_max_connections = m_master.oride.origin_max_connections;
   params->origin_min_keep_alive_connections = m_master.origin_min_keep_alive_connections;
+  params->server_session_match = m_master.server_session_match;
+  params->server_session_pool_overflow = m_master.server_session_pool_overflow;
+  params->server_session_thread_pool_max = m_master.server_session_thread_pool_max;
 
   if (params->oride.origin_max_connections &&
       params->oride.origin_max_connections < params->origin_min_keep_alive_connections ) {
@@ -1570,6 +1592,7 @@ HttpConfig::reconfigure()
   params->avoid_content_spoofing = INT_TO_BOOL(m_master.avoid_content_spoofing);
   params->enable_http_stats = INT_TO_BOOL(m_master.enable_http_stats);
   params->normalize_ae_gzip = INT_TO_BOOL(m_master.normalize_ae_gzip);
+  params->splice_tunnel = INT_TO_BOOL(m_master.splice_tunnel);
 
   params->icp_enabled = (m_master.icp_enabled == ICP_MODE_SEND_RECEIVE ? 1 : 0); // INT_TO_BOOL
   params->stale_icp_enabled = INT_TO_BOOL(m_master.stale_icp_enabled);
@@ -348,6 +348,13 @@ enum
   http_response_status_505_count_stat,
   http_response_status_5xx_count_stat,
 
+  // Keep-alive server session pool
+  http_server_session_pool_hits_stat,
+  http_server_session_pool_misses_stat,
+  http_server_session_pool_migrations_stat,
+  http_server_session_pool_overflows_stat,
+  http_server_session_pool_lock_misses_stat,
+
   http_stat_count
 };
 
@@ -642,6 +649,10 @@ public:
   MgmtInt server_max_connections;
   MgmtInt origin_min_keep_alive_connections; // TODO: This one really ought to be overridable, but difficult right now.
 
+  MgmtByte server_session_match;
+  MgmtByte server_session_pool_overflow;
+  MgmtInt server_session_thread_pool_max;
+
   MgmtByte parent_proxy_routing_enable;
   MgmtByte disable_ssl_parenting;
 
@@ -831,6 +842,11 @@ public:
   ////////////////////////////////
   MgmtByte normalize_ae_gzip;
 
+  //////////////////////////////////////////////
+  // Splice the body of pass-through tunnels  //
+  //////////////////////////////////////////////
+  MgmtByte splice_tunnel;
+
   // for <= 0, not read from writer
   // > 0, the max time that the read to wait for writer`s response
   MgmtInt cache_max_rww_delay;
@@ -941,6 +957,9 @@ HttpConfigParams::HttpConfigParams()
     max_active_client_connections(0),
     server_max_connections(0),
     origin_min_keep_alive_connections(0),
+    server_session_match(1),
+    server_session_pool_overflow(0),
+    server_session_thread_pool_max(0),
     parent_proxy_routing_enable(0),
     disable_ssl_parenting(0),
     enable_url_expandomatic(0),
@@ -1016,6 +1035,7 @@ HttpConfigParams::HttpConfigParams()
     ignore_accept_encoding_mismatch(0),
     ignore_accept_charset_mismatch(0),
     normalize_ae_gzip(1),
+    splice_tunnel(0),
     cache_max_rww_delay(0),
     node_no(-1),
     autoconf_port(0),
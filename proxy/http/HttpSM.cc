@@ -420,6 +420,10 @@ HttpSM::cleanup()
   // t_state.content_control.cleanup();
 
   HttpConfig::release(t_state.http_config_param);
+  if (t_state.url_rewrite) {
+    releaseUrlRewrite(t_state.url_rewrite);
+    t_state.url_rewrite = NULL;
+  }
 
   mutex.clear();
   tunnel.mutex.clear();
@@ -714,8 +718,9 @@ HttpSM::setup_client_read_request_header()
   ua_entry->read_vio = ua_session->do_io_read(this, INT64_MAX, ua_buffer_reader->mbuf);
 
   // The header may already be in the buffer if this
-  //  a request from a keep-alive connection
-  if (ua_buffer_reader->read_avail() > 0)
+  //  a request from a keep-alive connection, or already
+  //  decoded by the netvc
+  if (ua_buffer_reader->read_avail() > 0 || ua_session->get_netvc()->get_request_header())
     handleEvent(VC_EVENT_READ_READY, ua_entry->read_vio);
 }
 
@@ -778,10 +783,20 @@ HttpSM::state_read_client_request_header(int event, void *data)
   // tokenize header //
   /////////////////////
 
-  int state = t_state.hdr_info.client_request.parse_req(&http_parser,
-                                                        ua_buffer_reader,
-                                                        &bytes_used,
-                                                        ua_entry->eos);
+  int state;
+  HTTPHdr *decoded_request = ua_session->get_netvc()->get_request_header();
+
+  if (decoded_request) {
+    // the netvc decoded the header from its own framing
+    t_state.hdr_info.client_request.copy(decoded_request);
+    bytes_used = decoded_request->length_get();
+    state = PARSE_DONE;
+  } else {
+    state = t_state.hdr_info.client_request.parse_req(&http_parser,
+                                                      ua_buffer_reader,
+                                                      &bytes_used,
+                                                      ua_entry->eos);
+  }
 
   client_request_hdr_bytes += bytes_used;
 
@@ -2160,8 +2175,8 @@ HttpSM::process_hostdb_info(HostDBInfo * r)
           if ((entry = find_entry(hostname)) != NULL) {
             for (int i = 0; i < rr->good; ++i) {
               HCSM *hcsm = HCSM::allocate();
-              hcsm->init(entry, &rr->info[i]);
-              eventProcessor.schedule_imm(hcsm, ET_TASK);
+              hcsm->init(entry, rr->info[i].ip(), true);
+              eventProcessor.schedule_imm(hcsm, ET_TASK, HC_EVENT_CHECK, &rr->info[i]);
             }
           }
         }
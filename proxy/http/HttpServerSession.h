@@ -72,7 +72,7 @@ public:
       hostname_hash(),
       host_hash_computed(false), con_id(0), transact_count(0),
       state(HSS_INIT), to_parent_proxy(false), server_trans_stat(0),
-      private_session(false), share_session(0),
+      private_session(false), share_session(0), pool_hash(0),
       enable_origin_connection_limiting(false), read_buffer(NULL),
       server_vc(NULL), magic(HTTP_SS_MAGIC_DEAD), buf_reader(NULL)
     {
@@ -158,6 +158,9 @@ public:
   // Copy of the owning SM's share_server_session setting
   int share_session;
 
+  // Bucket key the session was pooled under, see HttpSessionManager
+  uint32_t pool_hash;
+
   LINK(HttpServerSession, lru_link);
   LINK(HttpServerSession, hash_link);
 
@@ -36,10 +36,36 @@
 #include "HttpSM.h"
 #include "HttpDebugNames.h"
 
-#include "HCSM.h"
+#define FIRST_LEVEL_HASH(x)   ((x) % HSM_LEVEL1_BUCKETS)
+#define SECOND_LEVEL_HASH(x)  ((x) % HSM_LEVEL2_BUCKETS)
 
-#define FIRST_LEVEL_HASH(x)   ats_ip_hash(x) % HSM_LEVEL1_BUCKETS
-#define SECOND_LEVEL_HASH(x)  ats_ip_hash(x) % HSM_LEVEL2_BUCKETS
+#define HSM_INCREMENT_STAT(t, x) RecIncrRawStat(http_rsb, t, (int) x, 1)
+
+// The key a session is pooled under: the origin address, or the
+//  hostname and port when any address of the host will do
+static inline uint32_t
+session_pool_key(sockaddr const* ip, INK_MD5 &hostname_hash, int match)
+{
+  if (HSM_MATCH_HOST == match)
+    return (uint32_t) hostname_hash.fold() ^ ats_ip_port_cast(ip);
+  return ats_ip_hash(ip);
+}
+
+static inline bool
+session_matches(HttpServerSession *s, sockaddr const* ip, INK_MD5 &hostname_hash, int match)
+{
+  if (ats_ip_port_cast(ip) != ats_ip_port_cast(&s->server_ip))
+    return false;
+
+  switch (match) {
+  case HSM_MATCH_IP:
+    return ats_ip_addr_eq(&s->server_ip.sa, ip);
+  case HSM_MATCH_HOST:
+    return hostname_hash == s->hostname_hash;
+  default:
+    return ats_ip_addr_eq(&s->server_ip.sa, ip) && hostname_hash == s->hostname_hash;
+  }
+}
 
 // Initialize a thread to handle HTTP session management
 void
@@ -48,8 +74,11 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index)
   NOWARN_UNUSED(thread_index);
 
   thread->l1_hash = NEW(new SessionBucket[HSM_LEVEL1_BUCKETS]);
-  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i)
+  volatile int32_t *pool_count = NEW(new int32_t(0));
+  for (int i = 0; i < HSM_LEVEL1_BUCKETS; ++i) {
     thread->l1_hash[i].mutex = new_ProxyMutex();
+    thread->l1_hash[i].pool_count = pool_count;
+  }
   //thread->l1_hash[i].mutex = thread->mutex;
 }
 
@@ -57,11 +86,31 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index)
 HttpSessionManager httpSessionManager;
 
 SessionBucket::SessionBucket()
-  : Continuation(NULL)
+  : Continuation(NULL), count(0), pool_count(NULL)
 {
   SET_HANDLER(&SessionBucket::session_handler);
 }
 
+void
+SessionBucket::insert(HttpServerSession *s)
+{
+  lru_list.enqueue(s);
+  l2_hash[SECOND_LEVEL_HASH(s->pool_hash)].push(s);
+  count++;
+  if (pool_count)
+    ink_atomic_increment(pool_count, 1);
+}
+
+void
+SessionBucket::remove(HttpServerSession *s)
+{
+  lru_list.remove(s);
+  l2_hash[SECOND_LEVEL_HASH(s->pool_hash)].remove(s);
+  count--;
+  if (pool_count)
+    ink_atomic_increment(pool_count, -1);
+}
+
 // int SessionBucket::session_handler(int event, void* data)
 //
 //   Called from the NetProcessor to left us know that a
@@ -90,13 +139,12 @@ SessionBucket::session_handler(int event, void *data)
     return 0;
   }
 
-  // Search the 2nd level bucket for appropriate netvc
-  int l2_index = SECOND_LEVEL_HASH(net_vc->get_remote_addr());
+  // Search the bucket for appropriate netvc. Sessions pooled by
+  //  hostname are not keyed on the remote address, so walk the lru
   HttpConfigParams *http_config_params = HttpConfig::acquire();
   bool found = false;
 
-  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
-  s = l2_hash[l2_index].head;
+  s = lru_list.head;
 
   while (s != NULL) {
     if (s->get_netvc() == net_vc) {
@@ -126,13 +174,12 @@ SessionBucket::session_handler(int event, void *data)
       Debug("http_ss", "[%" PRId64 "] [session_bucket] session received io notice [%s]",
             s->con_id, HttpDebugNames::get_event_name(event));
       ink_assert(s->state == HSS_KA_SHARED);
-      lru_list.remove(s);
-      l2_hash[l2_index].remove(s);
+      remove(s);
       s->do_io_close();
       found = true;
       break;
     } else {
-      s = s->hash_link.next;
+      s = s->lru_link.next;
     }
   }
 
@@ -147,47 +194,6 @@ SessionBucket::session_handler(int event, void *data)
   return 0;
 }
 
-HttpServerSession*
-HttpSessionManager::acquire_session_hc(sockaddr const* ip, const char *hostname, HCSM *hcsm)
-{
-  int l1_index = FIRST_LEVEL_HASH(ip);
-  ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
-
-  EThread *ethread = this_ethread();
-  SessionBucket *bucket;
-  bool condition = false;
-
-  if (2 == hcsm->txn_conf.share_server_sessions) {
-    ink_assert(ethread->l1_hash);
-    bucket = ethread->l1_hash + l1_index;
-    condition = true;
-  } else {
-    bucket = g_l1_hash + l1_index;
-    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
-    if (lock)
-      condition = true;
-  }
-  if (!condition)
-    return NULL;
-  INK_MD5 hostname_hash;
-  ink_code_MMH((unsigned char *) hostname, strlen(hostname), (unsigned char *) &hostname_hash);
-  int l2_index = SECOND_LEVEL_HASH(ip);
-  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
-  HttpServerSession *b = bucket->l2_hash[l2_index].head;
-  while (b != NULL) {
-    if (memcmp(&b->server_ip.sa, ip, sizeof(sockaddr)) && hostname_hash == b->hostname_hash) {
-      bucket->lru_list.remove(b);
-      bucket->l2_hash[l2_index].remove(b);
-      b->state = HSS_ACTIVE;
-      Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", b->con_id);
-      return b;
-    }
-    b = b->hash_link.next;
-  }
-
-  return NULL;
-}
-
 void
 HttpSessionManager::init()
 {
@@ -209,9 +215,7 @@ HttpSessionManager::purge_keepalives()
     if (lock) {
       while (b->lru_list.head) {
         HttpServerSession *sess = b->lru_list.head;
-        b->lru_list.remove(sess);
-        int l2_index = SECOND_LEVEL_HASH(&sess->server_ip.sa);
-        b->l2_hash[l2_index].remove(sess);
+        b->remove(sess);
         sess->do_io_close();
       }
     } else {
@@ -220,36 +224,79 @@ HttpSessionManager::purge_keepalives()
   }
 }
 
-HSMresult_t
-_acquire_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_hash, HttpSM *sm)
+HttpServerSession *
+HttpSessionManager::match_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_hash,
+                                  uint32_t key, int match)
 {
-  HttpServerSession *b;
-  HttpServerSession *to_return = NULL;
-  int l2_index = SECOND_LEVEL_HASH(ip);
-
-  ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
+  HttpServerSession *b = bucket->l2_hash[SECOND_LEVEL_HASH(key)].head;
 
   // Check to see if an appropriate connection is in
   //  the 2nd level bucket
-  b = bucket->l2_hash[l2_index].head;
   while (b != NULL) {
-    if (ats_ip_addr_eq(&b->server_ip.sa, ip) &&
-      ats_ip_port_cast(ip) == ats_ip_port_cast(&b->server_ip)
-    ) {
-      if (hostname_hash == b->hostname_hash) {
-        bucket->lru_list.remove(b);
-        bucket->l2_hash[l2_index].remove(b);
-        b->state = HSS_ACTIVE;
-        to_return = b;
-        Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
-        sm->attach_server_session(to_return);
-        return HSM_DONE;
-      }
+    if (session_matches(b, ip, hostname_hash, match)) {
+      bucket->remove(b);
+      b->state = HSS_ACTIVE;
+      Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", b->con_id);
+      return b;
     }
-
     b = b->hash_link.next;
   }
 
+  return NULL;
+}
+
+// Look in the pool of this thread first, then in the global pool when
+//  there is a single global pool or the thread pools overflow into it
+HSMresult_t
+HttpSessionManager::find_session(sockaddr const* ip, INK_MD5 &hostname_hash, int share,
+                                 HttpConfigParams *params, HttpServerSession **found)
+{
+  EThread *ethread = this_ethread();
+  int match = params->server_session_match;
+  uint32_t key = session_pool_key(ip, hostname_hash, match);
+  int l1_index = FIRST_LEVEL_HASH(key);
+  bool contended = false;
+
+  ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
+  *found = NULL;
+
+  if (2 == share) {
+    ink_assert(ethread->l1_hash);
+    SessionBucket *bucket = ethread->l1_hash + l1_index;
+
+    // Sessions released on other threads are pooled here too, so the
+    //  thread bucket is locked like the global one
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (lock)
+      *found = match_session(bucket, ip, hostname_hash, key, match);
+    else
+      contended = true;
+  }
+
+  if (*found == NULL && (2 != share || params->server_session_pool_overflow)) {
+    SessionBucket *bucket = g_l1_hash + l1_index;
+
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (lock)
+      *found = match_session(bucket, ip, hostname_hash, key, match);
+    else
+      contended = true;
+  }
+
+  if (*found != NULL) {
+    HSM_INCREMENT_STAT(ethread, http_server_session_pool_hits_stat);
+    if ((*found)->get_netvc()->thread != ethread)
+      HSM_INCREMENT_STAT(ethread, http_server_session_pool_migrations_stat);
+    return HSM_DONE;
+  }
+
+  if (contended) {
+    Debug("http_ss", "[acquire session] could not acquire session due to lock contention");
+    HSM_INCREMENT_STAT(ethread, http_server_session_pool_lock_misses_stat);
+    return HSM_RETRY;
+  }
+
+  HSM_INCREMENT_STAT(ethread, http_server_session_pool_misses_stat);
   return HSM_NOT_FOUND;
 }
 
@@ -259,6 +306,7 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
 {
   NOWARN_UNUSED(cont);
   HttpServerSession *to_return = NULL;
+  int match = sm->t_state.http_config_param->server_session_match;
 
   //  We compute the mmh for matching the hostname as the last
   //  check for a match between the session the HttpSM is looking
@@ -269,9 +317,11 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
   // 
   //  Also, note the ip is required as well to maintain client
   //  to server affinity so that we don't break certain types
-  //  of authentication.
+  //  of authentication. Either half of the match can be dropped
+  //  with proxy.config.http.server_session_sharing.match.
   INK_MD5 hostname_hash;
-  bool hash_computed = false;
+
+  ink_code_MMH((unsigned char *) hostname, strlen(hostname), (unsigned char *) &hostname_hash);
 
   // First check to see if there is a server session bound
   //   to the user agent session
@@ -279,20 +329,11 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
   if (to_return != NULL) {
     ua_session->attach_server_session(NULL);
 
-    if (ats_ip_addr_eq(&to_return->server_ip.sa, ip) &&
-      ats_ip_port_cast(&to_return->server_ip) == ats_ip_port_cast(ip)
-    ) {
-      if (!hash_computed) {
-        ink_code_MMH((unsigned char *) hostname, strlen(hostname), (unsigned char *) &hostname_hash);
-        hash_computed = true;
-      }
-
-      if (hostname_hash == to_return->hostname_hash) {
-        Debug("http_ss", "[%" PRId64 "] [acquire session] returning attached session ", to_return->con_id);
-        to_return->state = HSS_ACTIVE;
-        sm->attach_server_session(to_return);
-        return HSM_DONE;
-      }
+    if (session_matches(to_return, ip, hostname_hash, match)) {
+      Debug("http_ss", "[%" PRId64 "] [acquire session] returning attached session ", to_return->con_id);
+      to_return->state = HSS_ACTIVE;
+      sm->attach_server_session(to_return);
+      return HSM_DONE;
     }
     // Release this session back to the main session pool and
     //   then continue looking for one from the shared pool
@@ -303,76 +344,107 @@ HttpSessionManager::acquire_session(Continuation *cont, sockaddr const* ip,
 
   // Now check to see if we have a connection is our
   //  shared connection pool
-  int l1_index = FIRST_LEVEL_HASH(ip);
-  EThread *ethread = this_ethread();
-
-  ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
-
-  // Will need the hash for this lookup for sure.
-  if (!hash_computed)
-    ink_code_MMH((unsigned char *) hostname, strlen(hostname), (unsigned char *) &hostname_hash);
-
-  if (2 == sm->t_state.txn_conf->share_server_sessions) {
-    ink_assert(ethread->l1_hash);
-    return _acquire_session(ethread->l1_hash + l1_index, ip, hostname_hash, sm);
-  } else {
-    SessionBucket *bucket = g_l1_hash + l1_index;
+  HSMresult_t r = find_session(ip, hostname_hash, sm->t_state.txn_conf->share_server_sessions,
+                               sm->t_state.http_config_param, &to_return);
 
-    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
-    if (lock) {
-      return _acquire_session(bucket, ip, hostname_hash, sm);
-    } else {
-      Debug("http_ss", "[acquire session] could not acquire session due to lock contention");
-    }
-  }
+  if (r == HSM_DONE)
+    sm->attach_server_session(to_return);
+  return r;
+}
 
-  return HSM_RETRY;
+void
+HttpSessionManager::pool_session(SessionBucket *bucket, HttpServerSession *to_release)
+{
+  // First insert the session on to our lists
+  bucket->insert(to_release);
+  to_release->state = HSS_KA_SHARED;
+
+  // Now we need to issue a read on the connection to detect
+  //  if it closes on us.  We will get called back in the
+  //  continuation for this bucket, ensuring we have the lock
+  //  to remove the connection from our lists
+  to_release->do_io_read(bucket, INT64_MAX, to_release->read_buffer);
+
+  // Transfer control of the write side as well
+  to_release->do_io_write(bucket, 0, NULL);
+
+  // we probably don't need the active timeout set, but will leave it for now
+  to_release->get_netvc()->set_inactivity_timeout(to_release->get_netvc()->get_inactivity_timeout());
+  to_release->get_netvc()->set_active_timeout(to_release->get_netvc()->get_active_timeout());
+  Debug("http_ss", "[%" PRId64 "] [release session] " "session placed into shared pool", to_release->con_id);
 }
 
 HSMresult_t
 HttpSessionManager::release_session(HttpServerSession *to_release)
 {
   EThread *ethread = this_ethread();
-  int l1_index = FIRST_LEVEL_HASH(&to_release->server_ip.sa);
-  SessionBucket *bucket;
+  HttpConfigParams *params = HttpConfig::acquire();
+  HSMresult_t r = HSM_RETRY;
+
+  to_release->pool_hash = session_pool_key(&to_release->server_ip.sa, to_release->hostname_hash,
+                                           params->server_session_match);
+  int l1_index = FIRST_LEVEL_HASH(to_release->pool_hash);
 
   ink_assert(l1_index < HSM_LEVEL1_BUCKETS);
 
   if (2 == to_release->share_session) {
-    bucket = ethread->l1_hash + l1_index;
-  } else {
-    bucket = g_l1_hash + l1_index;
-  }
-
-  MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
-  if (lock) {
-    int l2_index = SECOND_LEVEL_HASH(&to_release->server_ip.sa);
+    // Pool the session on the thread its connection lives on, so the
+    //  bucket is called back on the same thread that acquires from it
+    EThread *owner = to_release->get_netvc()->thread;
+    if (owner == NULL || owner->l1_hash == NULL)
+      owner = ethread;
+    SessionBucket *bucket = owner->l1_hash + l1_index;
+    bool overflow = false;
 
-    ink_assert(l2_index < HSM_LEVEL2_BUCKETS);
-
-    // First insert the session on to our lists
-    bucket->lru_list.enqueue(to_release);
-    bucket->l2_hash[l2_index].push(to_release);
-    to_release->state = HSS_KA_SHARED;
-
-    // Now we need to issue a read on the connection to detect
-    //  if it closes on us.  We will get called back in the
-    //  continuation for this bucket, ensuring we have the lock
-    //  to remove the connection from our lists
-    to_release->do_io_read(bucket, INT64_MAX, to_release->read_buffer);
+    MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+    if (lock) {
+      // The limit is on the sessions pooled by the thread over all its buckets
+      MgmtInt thread_max = params->server_session_thread_pool_max;
+      bool full = thread_max > 0 && *bucket->pool_count >= thread_max;
+
+      if (full) {
+        if (params->server_session_pool_overflow) {
+          overflow = true;
+        } else if (bucket->lru_list.head) {
+          // Make room by closing the least recently used session of this bucket
+          HttpServerSession *lru = bucket->lru_list.head;
+          Debug("http_ss", "[%" PRId64 "] [release session] " "thread pool full, closing session", lru->con_id);
+          bucket->remove(lru);
+          lru->do_io_close();
+          full = false;
+        } else {
+          // Only the other buckets hold sessions, whose locks we do not have
+          Debug("http_ss", "[%" PRId64 "] [release session] " "thread pool full, not pooling session",
+                to_release->con_id);
+        }
+      }
+      if (!full) {
+        pool_session(bucket, to_release);
+        r = HSM_DONE;
+      }
+    } else {
+      Debug("http_ss", "[%" PRId64 "] [release session] could not release session due to lock contention", to_release->con_id);
+      HSM_INCREMENT_STAT(ethread, http_server_session_pool_lock_misses_stat);
+    }
 
-    // Transfer control of the write side as well
-    to_release->do_io_write(bucket, 0, NULL);
+    if (!overflow) {
+      HttpConfig::release(params);
+      return r;
+    }
+    HSM_INCREMENT_STAT(ethread, http_server_session_pool_overflows_stat);
+  }
 
-    // we probably don't need the active timeout set, but will leave it for now
-    to_release->get_netvc()->set_inactivity_timeout(to_release->get_netvc()->get_inactivity_timeout());
-    to_release->get_netvc()->set_active_timeout(to_release->get_netvc()->get_active_timeout());
-    Debug("http_ss", "[%" PRId64 "] [release session] " "session placed into shared pool", to_release->con_id);
+  SessionBucket *bucket = g_l1_hash + l1_index;
 
-    return HSM_DONE;
+  MUTEX_TRY_LOCK(lock, bucket->mutex, ethread);
+  if (lock) {
+    pool_session(bucket, to_release);
+    r = HSM_DONE;
   } else {
     Debug("http_ss", "[%" PRId64 "] [release session] could not release session due to lock contention", to_release->con_id);
+    HSM_INCREMENT_STAT(ethread, http_server_session_pool_lock_misses_stat);
   }
 
-  return HSM_RETRY;
+  HttpConfig::release(params);
+  return r;
 }
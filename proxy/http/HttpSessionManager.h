@@ -39,7 +39,7 @@
 
 class HttpClientSession;
 class HttpSM;
-class HCSM;
+struct HttpConfigParams;
 
 void
 initialize_thread_for_http_sessions(EThread *thread, int thread_index);
@@ -52,13 +52,22 @@ initialize_thread_for_http_sessions(EThread *thread, int thread_index);
 #define  HSM_LEVEL2_BUCKETS   3
 #endif
 
+// How a pooled session is matched, proxy.config.http.server_session_sharing.match
+enum HSMmatch_t
+{ HSM_MATCH_IP, HSM_MATCH_BOTH, HSM_MATCH_HOST };
+
 class SessionBucket: public Continuation
 {
 public:
   SessionBucket();
   int session_handler(int event, void *data);
+  void insert(HttpServerSession *s);
+  void remove(HttpServerSession *s);
   Que(HttpServerSession, lru_link) lru_list;
   DList(HttpServerSession, hash_link) l2_hash[HSM_LEVEL2_BUCKETS];
+  int count;
+  // sessions in all the buckets of the owning thread, NULL for the global buckets
+  volatile int32_t *pool_count;
 };
 
 enum HSMresult_t
@@ -76,14 +85,20 @@ public:
   HSMresult_t acquire_session(Continuation *cont,
                               sockaddr const* addr,
                               const char *hostname, HttpClientSession *ua_session, HttpSM *sm);
-  HttpServerSession* acquire_session_hc(sockaddr const* ip, const char *hostname, HCSM *hcsm);
   HSMresult_t release_session(HttpServerSession *to_release);
   void purge_keepalives();
   void init();
   int main_handler(int event, void *data);
 
 private:
+  HttpServerSession *match_session(SessionBucket *bucket, sockaddr const* ip, INK_MD5 &hostname_hash,
+                                   uint32_t key, int match);
+  HSMresult_t find_session(sockaddr const* ip, INK_MD5 &hostname_hash, int share,
+                           HttpConfigParams *params, HttpServerSession **found);
+  void pool_session(SessionBucket *bucket, HttpServerSession *to_release);
+
   //    Global l1 hash, used when there is no per-thread buckets
+  //    and for the overflow of the per-thread buckets
   SessionBucket g_l1_hash[HSM_LEVEL1_BUCKETS];
 };
 
@@ -102,6 +102,7 @@ typedef time_t ink_time_t;
 struct HttpConfigParams;
 struct MimeTableEntry;
 class HttpSM;
+class UrlRewrite;
 
 #include "InkErrno.h"
 #define UNKNOWN_INTERNAL_ERROR           (INK_START_ERRNO - 1)
@@ -1068,6 +1069,7 @@ public:
     CacheAction_t saved_update_cache_action;
 
     // Remap plugin processor support
+    UrlRewrite *url_rewrite;    // remap table pinned for url_map
     UrlMappingContainer url_map;
     host_hdr_info hh_info;
 
@@ -1174,6 +1176,7 @@ public:
         api_lock_url(LOCK_URL_FIRST),
         saved_update_next_action(STATE_MACHINE_ACTION_UNDEFINED),
         saved_update_cache_action(CACHE_DO_UNDEFINED),
+        url_rewrite(NULL),
         url_map(),
         pCongestionEntry(NULL),
         congest_saved_next_action(STATE_MACHINE_ACTION_UNDEFINED),
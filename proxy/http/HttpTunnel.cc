@@ -969,6 +969,9 @@ HttpTunnel::producer_run(HttpTunnelProducer * p)
             sm->t_state.single_range._start);
       } else
         p->read_vio = p->vc->do_io_read(this, producer_n, p->read_buffer);
+
+      if (sm->t_state.http_config_param->splice_tunnel)
+        producer_splice(p);
     }
 
     // Now that the tunnel has started, we must remove producer's reader so
@@ -1070,6 +1073,40 @@ HttpTunnel::producer_handler_chunked(int event, HttpTunnelProducer * p)
   return event;
 }
 
+// void HttpTunnel::producer_splice(HttpTunnelProducer* p)
+//
+//   A producer and a single consumer that are both network
+//    connections and do nothing to the data in between hand
+//    the body to the net processor, which moves it with
+//    splice(2). The VIOs keep counting the bytes, so the
+//    tunnel sees the usual events. The net processor turns it
+//    down for anything but two plain TCP connections.
+//
+void
+HttpTunnel::producer_splice(HttpTunnelProducer * p)
+{
+  if (p->num_consumers != 1 || p->do_chunking || p->do_dechunking || p->do_chunked_passthru)
+    return;
+  if (p->vc_type != HT_HTTP_SERVER && p->vc_type != HT_HTTP_CLIENT)
+    return;
+
+  HttpTunnelConsumer *c = p->consumer_list.head;
+  if (!c->alive || !c->write_vio || (c->vc_type != HT_HTTP_CLIENT && c->vc_type != HT_HTTP_SERVER))
+    return;
+
+  // The POST data is copied for the redirect
+  if (p->vc_type == HT_HTTP_CLIENT && sm->t_state.method == HTTP_WKSIDX_POST && sm->enable_redirection)
+    return;
+
+  // The VIOs belong to the NetVConnections, even if the producer
+  //  and the consumer are sessions
+  NetVConnection *src = (NetVConnection *) p->read_vio->vc_server;
+  NetVConnection *dst = (NetVConnection *) c->write_vio->vc_server;
+  if (src->splice_to(dst)) {
+    Debug("http_tunnel", "[%" PRId64 "] splice [%s] to [%s]", sm->sm_id, p->name, c->name);
+  }
+}
+
 //
 // bool HttpTunnel::producer_handler(int event, HttpTunnelProducer* p)
 //
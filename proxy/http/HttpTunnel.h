@@ -277,6 +277,7 @@ private:
   void finish_all_internal(HttpTunnelProducer * p, bool chain);
   void update_stats_after_abort(HttpTunnelType_t t);
   void producer_run(HttpTunnelProducer * p);
+  void producer_splice(HttpTunnelProducer * p);
 
   HttpTunnelProducer *get_producer(VIO * vio);
   HttpTunnelConsumer *get_consumer(VIO * vio);
@@ -34,6 +34,8 @@ HCHandler::init(HCEntry *entry)
   id = (int64_t) ink_atomic_increment((&next_id), 1);
   HC_STATE_ENTER(&HCHandler::init);
   hc_entry = entry;
+  due_tick = 0;
+  generation = 0;
   mutex = new_ProxyMutex();
   SET_HANDLER(&HCHandler::main_event);
 }
@@ -85,6 +87,7 @@ HCHandler::process_hostdb_info(HostDBInfo *r)
   HC_STATE_ENTER(&HCHandler::process_hostdb_info);
   SET_HANDLER(&HCHandler::main_event);
   if (r) {
+    ++generation;
     if (r->round_robin) {
       HostDBRoundRobin *rr = r->rr();
       if (NULL == rr) {
@@ -92,16 +95,69 @@ HCHandler::process_hostdb_info(HostDBInfo *r)
         return;
       }
       for (int i = 0; i < rr->good; ++i) {
-        HCSM *hcsm = HCSM::allocate();
-        hcsm->init(hc_entry, &rr->info[i]);
-        eventProcessor.schedule_imm(hcsm, ET_TASK);
+        check_target(&rr->info[i]);
       }
     } else {
-      HCSM *hcsm = HCSM::allocate();
-      hcsm->init(hc_entry, r);
-      eventProcessor.schedule_imm(hcsm, ET_TASK);
+      check_target(r);
     }
+    retire_targets();
   } else {
     Debug("healthcheck", "[%" PRId64 "DNS lookup faild for %s", id, hc_entry->hostname);
   }
 }
+
+// Checks one address of the origin with the state machine, and the
+//  connection, kept for it since the last round
+void
+HCHandler::check_target(HostDBInfo *r)
+{
+  HCSM *hcsm;
+  for (hcsm = sms.head; hcsm; hcsm = hcsm->link.next) {
+    if (ats_ip_addr_eq(&hcsm->target.sa, r->ip()))
+      break;
+  }
+  if (NULL == hcsm) {
+    hcsm = HCSM::allocate();
+    hcsm->init(hc_entry, r->ip());
+    sms.push(hcsm);
+  }
+  hcsm->generation = generation;
+
+  // A check of the previous round still waiting for a thread carries a
+  //  stale HostDBInfo, replace it
+  MUTEX_LOCK(lock, hcsm->mutex, this_ethread());
+  if (hcsm->check_event)
+    hcsm->check_event->cancel();
+  hcsm->check_event = eventProcessor.schedule_imm(hcsm, ET_TASK, HC_EVENT_CHECK, r);
+}
+
+// Drops the addresses DNS no longer returns and feeds the liveness of
+//  the origin, as of the previous round, to parent selection
+void
+HCHandler::retire_targets()
+{
+  int n_targets = 0, n_up = 0;
+  HCSM *hcsm = sms.head;
+  while (hcsm) {
+    HCSM *next = hcsm->link.next;
+    if (hcsm->generation != generation) {
+      sms.remove(hcsm);
+      {
+        // The state machine is gone once it sees the retire, so the
+        //  check must not fire after it
+        MUTEX_LOCK(lock, hcsm->mutex, this_ethread());
+        if (hcsm->check_event) {
+          hcsm->check_event->cancel();
+          hcsm->check_event = NULL;
+        }
+      }
+      eventProcessor.schedule_imm(hcsm, ET_TASK, HC_EVENT_RETIRE);
+    } else {
+      ++n_targets;
+      if (hcsm->up)
+        ++n_up;
+    }
+    hcsm = next;
+  }
+  hc_entry->hc_down = (n_targets > 0 && 0 == n_up);
+}
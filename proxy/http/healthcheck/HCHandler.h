@@ -25,6 +25,7 @@
 
 #include "I_HC.h"
 #include "HCUtil.h"
+#include "HCSM.h"
 
 class HCHandler;
 extern ClassAllocator<HCHandler> hcHandlerAllocator;
@@ -42,9 +43,19 @@ public:
   int state_dns_lookup(int event, void *data);
   void handle_dns_lookup();
   void process_hostdb_info(HostDBInfo *r);
-private:
+
+  // Owned by the HCScheduler
   HCEntry *hc_entry;
+  uint64_t due_tick;
+  LINK(HCHandler, wheel_link);
+
+private:
+  void check_target(HostDBInfo *r);
+  void retire_targets();
+
   int64_t id;
+  int generation;
+  DLL<HCSM> sms;                // one per address of the origin
 
   HCHandler(const HCHandler& hc_handler);
   HCHandler& operator=(const HCHandler& hc_handler);
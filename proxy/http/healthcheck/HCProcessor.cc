@@ -22,7 +22,7 @@
  */
 
 #include "HCProcessor.h"
-#include "HCHandler.h"
+#include "HCScheduler.h"
 
 HCProcessor hcProcessor;
 
@@ -58,15 +58,11 @@ HCProcessor::start(int n_healthcheck_threads)
     Error("syntax error in %s\n", file_path);
     return EXIT_FAILURE;
   }
+  register_stats();
+
   Vec<HCEntry *> entry_vec;
   entry_map.get_values(entry_vec);
-  int entry_vec_len = entry_vec.length();
-  for (int i = 0; i < entry_vec_len; ++i) {
-    HCEntry *hc_entry = entry_vec[i];
-    HCHandler *hc_handler = HCHandler::allocate();
-    hc_handler->init(hc_entry);
-    eventProcessor.schedule_every(hc_handler, HRTIME_SECONDS(healthcheck_default_ttl), ET_TASK);
-  }
+  hcScheduler.start(entry_vec);
 
   return EXIT_SUCCESS;
 }
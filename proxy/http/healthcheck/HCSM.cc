@@ -53,22 +53,30 @@ write_header(HTTPHdr * h, MIOBuffer * b)
   return dumpoffset;
 }
 
+#define HC_INCREMENT_DYN_STAT(x) RecIncrRawStat(hc_rsb, mutex->thread_holding, (int) x, 1)
+
 void
-HCSM::init(HCEntry *entry, HostDBInfo *r)
+HCSM::init(HCEntry *entry, sockaddr const *ip, bool one_shot)
 {
   id = (int64_t) ink_atomic_increment((&next_id), 1);
   HC_STATE_ENTER(&HCSM::init);
   hc_entry = entry;
-  hostdb_info = r;
+  hostdb_info = NULL;
+  ats_ip_copy(&target.sa, ip);
+  ats_ip_port_cast(&target) = htons(entry->port);
+  generation = 0;
+  up = true;
+  check_event = NULL;
   server_session = NULL;
   buffer_reader = NULL;
+  http_config_param = NULL;
   mutex = new_ProxyMutex();
-  http_config_param = HttpConfig::acquire();
-  memcpy(&txn_conf, &(http_config_param->oride), sizeof(txn_conf));
-  http_parser_init(&http_parser);
-  res_hdr.create(HTTP_TYPE_RESPONSE);
   vc_entry = VCEntry::allocate();
-  server_response_hdr_bytes = 0;
+  response_hdr_done = false;
+  body_left = 0;
+  send_time = 0;
+  in_check = false;
+  retired = one_shot;
   SET_HANDLER(&HCSM::main_event);
 }
 
@@ -76,28 +84,68 @@ void
 HCSM::destroy()
 {
   HC_STATE_ENTER(&HCSM::destroy);
+  ink_assert(NULL == server_session && NULL == http_config_param);
   mutex.clear();
-  HttpConfig::release(http_config_param);
-  http_parser_clear(&http_parser);
-  res_hdr.destroy();
   vc_entry->destroy();
   hcsmAllocator.free(this);
 }
 
+// Runs a check on HC_EVENT_CHECK, the HostDBInfo of the target is the
+// cookie. Between checks it also gets the events of the idle connection.
 int
 HCSM::main_event(int event, void *data)
 {
   HC_STATE_ENTER(&HCSM::main_event);
-  Debug("healthcheck", "[%" PRId64 "send url to os %s with port %d:\n%s", id, hc_entry->hostname, hc_entry->port, hc_entry->req_hdr.url_string_get());
+  switch (event) {
+  case HC_EVENT_CHECK:
+    check_event = NULL;
+    break;
+  case HC_EVENT_RETIRE:
+    retired = true;
+    if (!in_check) {
+      close_server_session();
+      destroy();
+    }
+    return 0;
+  case VC_EVENT_READ_READY:
+  case VC_EVENT_EOS:
+  case VC_EVENT_ERROR:
+  case VC_EVENT_ACTIVE_TIMEOUT:
+  case VC_EVENT_INACTIVITY_TIMEOUT:
+  default:
+    // The origin sent data on, or closed, the idle connection
+    close_server_session();
+    return 0;
+  }
+
+  if (in_check) {
+    // The previous check has not finished yet
+    HC_INCREMENT_DYN_STAT(hc_skipped_stat);
+    return 0;
+  }
+
+  hostdb_info = (HostDBInfo *) ((Event *) data)->cookie;
+  Debug("healthcheck", "[%" PRId64 "] send url to os %s with port %d:\n%s", id, hc_entry->hostname, hc_entry->port, hc_entry->req_hdr.url_string_get());
   hostdb_info->hc_switch = hc_entry->hc_switch;
-  if (true == hostdb_info->hc_switch) {
-    handle_con2os();
-  } else {
-    if (NULL != server_session) {
-      server_session->do_io_close();
-      server_session = NULL;
+  if (true != hostdb_info->hc_switch) {
+    close_server_session();
+    if (retired) {
+      destroy();
     }
-    destroy();
+    return 0;
+  }
+
+  in_check = true;
+  http_config_param = HttpConfig::acquire();
+  memcpy(&txn_conf, &(http_config_param->oride), sizeof(txn_conf));
+  HC_INCREMENT_DYN_STAT(hc_checks_stat);
+
+  if (NULL != server_session) {
+    HC_INCREMENT_DYN_STAT(hc_reused_stat);
+    attach_server_session(server_session);
+    handle_send_req();
+  } else {
+    handle_con2os();
   }
   return 0;
 }
@@ -106,17 +154,19 @@ int
 HCSM::state_con2os(int event, void *data)
 {
   HC_STATE_ENTER(&HCSM::state_con2os);
+  if (HC_EVENT_CHECK == event || HC_EVENT_RETIRE == event)
+    return main_event(event, data);
   NetVConnection *new_vc = (NetVConnection *) data;
-  HttpServerSession *session = THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding);
+  HttpServerSession *session;
   switch (event) {
   case NET_EVENT_OPEN:
+    session = THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding);
     if (txn_conf.origin_max_connections > 0 || http_config_param->origin_min_keep_alive_connections > 0) {
       session->enable_origin_connection_limiting = true;
     }
-    session->server_ip.sa = *hostdb_info->ip();
+    ats_ip_copy(&session->server_ip.sa, &target.sa);
     session->new_connection(new_vc);
-    //session->server_port = hc_entry->port;
-    session->state = HSS_ACTIVE;
+    HC_INCREMENT_DYN_STAT(hc_connects_stat);
     attach_server_session(session);
     handle_send_req();
     break;
@@ -124,11 +174,7 @@ HCSM::state_con2os(int event, void *data)
     handle_con2os();
     break;
   default:
-    if (NULL != server_session) {
-      server_session->do_io_close();
-      server_session = NULL;
-    }
-    destroy();
+    check_done(false);
     break;
   }
   return 0;
@@ -138,6 +184,8 @@ int
 HCSM::state_send_req(int event, void *data)
 {
   HC_STATE_ENTER(&HCSM::state_send_req);
+  if (HC_EVENT_CHECK == event || HC_EVENT_RETIRE == event)
+    return main_event(event, data);
   switch (event) {
   case VC_EVENT_WRITE_READY:
     vc_entry->write_vio->reenable();
@@ -153,11 +201,7 @@ HCSM::state_send_req(int event, void *data)
   case VC_EVENT_ACTIVE_TIMEOUT:
   case VC_EVENT_INACTIVITY_TIMEOUT:
   default:
-    if (NULL != server_session) {
-      server_session->do_io_close();
-      server_session = NULL;
-    }
-    destroy();
+    check_done(false);
     break;
   }
 
@@ -168,6 +212,8 @@ int
 HCSM::state_read_res(int event, void *data)
 {
   HC_STATE_ENTER(&HCSM::state_read_res);
+  if (HC_EVENT_CHECK == event || HC_EVENT_RETIRE == event)
+    return main_event(event, data);
   switch(event){
   case VC_EVENT_READ_READY:
   case VC_EVENT_READ_COMPLETE:
@@ -177,65 +223,41 @@ HCSM::state_read_res(int event, void *data)
   case VC_EVENT_INACTIVITY_TIMEOUT:
   case VC_EVENT_ACTIVE_TIMEOUT:
   default:
-    if (NULL != server_session) {
-      server_session->do_io_close();
-      server_session = NULL;
-    }
-    destroy();
+    check_done(false);
     return 0;
   }
 
-  if (0 == server_response_hdr_bytes) {
-    server_session->get_netvc()->set_inactivity_timeout(HRTIME_SECONDS(txn_conf.transaction_no_activity_timeout_out));
-  }
-  int bytes_used = 0;
-  int state = res_hdr.parse_resp(&http_parser, buffer_reader, &bytes_used, false);
-  server_response_hdr_bytes += bytes_used;
-  if (PARSE_DONE == state && res_hdr.version_get() == HTTPVersion(0, 9) && server_session->transact_count > 1) {
-    state = PARSE_ERROR;
-  }
-  if (server_response_hdr_bytes > http_config_param->response_hdr_max_size) {
-    state = PARSE_ERROR;
-  }
-  if (state != PARSE_CONT) {
-    vc_entry->read_vio->nbytes = vc_entry->read_vio->ndone;
-    http_parser_clear(&http_parser);
-  }
+  // Only the status line and the framing headers are looked at,
+  //  the response is not parsed into an HTTPHdr
+  if (!response_hdr_done) {
+    char buf[HC_MAX_RESPONSE_HDR];
+    int avail = (int) MIN(buffer_reader->read_avail(), (int64_t) sizeof(buf));
+    buffer_reader->memcpy(buf, avail);
+    int state = parse_response(buf, avail, &response);
 
-  HTTPStatus ret = res_hdr.status_get();
-  switch (state) {
-  case PARSE_DONE:
-    if (HTTP_STATUS_OK <= ret  && ret <= HTTP_STATUS_PARTIAL_CONTENT) {
-      hostdb_info->hc_state = true;
-      hostdb_info->hc_ttl = hc_entry->ttl;
-      hostdb_info->refresh_hc();
-      char hostname[MAXDNAME];
-      strncpy(hostname, hc_entry->hostname, MAXDNAME);
-      hostname[MAXDNAME -1] = '\0';
-      --server_session->server_trans_stat;
-      server_session->attach_hostname(hostname);
-      server_session->release();
-      server_session = NULL;
-    } else {
-      hostdb_info->hc_state = false;
-      server_session->do_io_close();
-      server_session = NULL;
+    if (PARSE_CONT == state) {
+      vc_entry->read_vio->reenable();
+      return 0;
+    } else if (PARSE_DONE != state) {
+      check_done(false);
+      return 0;
     }
-    destroy();
-    break;
-  case PARSE_CONT:
+    record_rtt(mutex->thread_holding, hc_entry, ink_get_hrtime() - send_time);
+    buffer_reader->consume(response.hdr_len);
+    response_hdr_done = true;
+    body_left = (hc_entry->head_request || !response.keep_alive) ? 0 : MAX(response.content_length, 0);
+  }
+
+  // Drain the body so the connection can carry the next check
+  int64_t n = MIN(buffer_reader->read_avail(), body_left);
+  buffer_reader->consume(n);
+  body_left -= n;
+  if (body_left > 0) {
     vc_entry->read_vio->reenable();
-    return VC_EVENT_CONT;
-  case PARSE_ERROR:
-  default:
-    if (NULL != server_session) {
-      server_session->do_io_close();
-      server_session = NULL;
-    }
-    destroy();
-    break;
+    return 0;
   }
 
+  check_done(HTTP_STATUS_OK <= response.status && response.status <= HTTP_STATUS_PARTIAL_CONTENT);
   return 0;
 }
 
@@ -244,46 +266,19 @@ HCSM::handle_con2os()
 {
   HC_STATE_ENTER(&HCSM::handle_con2os);
   SET_HANDLER(&HCSM::state_con2os);
-  HttpServerSession *session = NULL;
-  //sockaddr const* ip = hostdb_info->ip();
-  IpEndpoint ip;
-  ip.sa = *hostdb_info->ip();
-  int port = hc_entry->port;
-  ats_ip_port_cast(&ip) = htons(port);
-  char hostname[MAXDNAME];
-  strncpy(hostname, hc_entry->hostname, MAXDNAME);
-  if (http_config_param->oride.share_server_sessions) {
-    session = httpSessionManager.acquire_session_hc(&ip.sa, hostname, this);
-  }
-  if (NULL != session) {
-    attach_server_session(session);
-    handle_send_req();
-  } else {
-    if (http_config_param->server_max_connections > 0) {
-      int64_t sum;
-      HTTP_READ_GLOBAL_DYN_SUM(http_current_server_connections_stat, sum);
-      if (sum >= http_config_param->server_max_connections) {
-        SET_HANDLER(&HCSM::main_event);
-        eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
-        httpSessionManager.purge_keepalives();
-        return ;
-      }
+  if (http_config_param->server_max_connections > 0) {
+    int64_t sum;
+    HTTP_READ_GLOBAL_DYN_SUM(http_current_server_connections_stat, sum);
+    if (sum >= http_config_param->server_max_connections) {
+      eventProcessor.schedule_in(this, HRTIME_MSECONDS(100), ET_TASK);
+      httpSessionManager.purge_keepalives();
+      return ;
     }
-    /*
-    if (txn_conf.origin_max_connections > 0) {
-      ConnectionCount *connections = ConnectionCount::getInstance();
-      if (connections->getCount(ip) >= txn_conf.origin_max_connections) {
-        SET_HANDLER(&HCSM::main_event);
-        eventProcessor.schedule_in(this, HRTIME_MSECONDS(100));
-        return ;
-      }
-    }
-    */
-    NetVCOptions opt;
-    opt.f_blocking_connect = false;
-    opt.set_sock_param(txn_conf.sock_recv_buffer_size_out, txn_conf.sock_send_buffer_size_out, txn_conf.sock_option_flag_out);
-    netProcessor.connect_re(this, &ip.sa, &opt);
   }
+  NetVCOptions opt;
+  opt.f_blocking_connect = false;
+  opt.set_sock_param(txn_conf.sock_recv_buffer_size_out, txn_conf.sock_send_buffer_size_out, txn_conf.sock_option_flag_out);
+  netProcessor.connect_re(this, &target.sa, &opt);
 }
 
 void
@@ -295,6 +290,7 @@ HCSM::handle_send_req()
   vc_entry->write_buffer = new_MIOBuffer(buffer_size_to_index(HTTP_HEADER_BUFFER_SIZE));
   IOBufferReader *buf_start = vc_entry->write_buffer->alloc_reader();
   hdr_length = write_header(&hc_entry->req_hdr, vc_entry->write_buffer);
+  send_time = ink_get_hrtime();
   vc_entry->write_vio = vc_entry->vc->do_io_write(this, hdr_length, buf_start);
 }
 
@@ -303,17 +299,63 @@ HCSM::handle_read_res()
 {
   HC_STATE_ENTER(&HCSM::handle_read_res);
   SET_HANDLER(&HCSM::state_read_res);
-  server_response_hdr_bytes = 0;
-  res_hdr.destroy();
-  res_hdr.create(HTTP_TYPE_RESPONSE);
-  http_parser_clear(&http_parser);
+  response_hdr_done = false;
+  body_left = 0;
+  server_session->get_netvc()->set_inactivity_timeout(HRTIME_SECONDS(txn_conf.transaction_no_activity_timeout_out));
   if (buffer_reader->read_avail() > 0) {
     state_read_res(VC_EVENT_READ_READY, vc_entry->read_vio);
   }
+}
+
+void
+HCSM::check_done(bool ok)
+{
+  HC_STATE_ENTER(&HCSM::check_done);
+  hostdb_info->hc_state = ok;
+  if (ok) {
+    hostdb_info->hc_ttl = hc_entry->ttl;
+    hostdb_info->refresh_hc();
+  } else {
+    HC_INCREMENT_DYN_STAT(hc_failures_stat);
+  }
+  up = ok;
 
-  if ((NULL != vc_entry) && (vc_entry->read_vio->nbytes == vc_entry->read_vio->ndone)) {
-    vc_entry->read_vio = server_session->do_io_read(this, INT64_MAX, buffer_reader->mbuf);
+  if (NULL != server_session && response_hdr_done && response.keep_alive && 0 == body_left && !retired) {
+    // Park the connection until the next check, main_event closes it
+    //  if the origin does
+    HTTP_DECREMENT_DYN_STAT(http_current_server_transactions_stat);
+    --server_session->server_trans_stat;
+    server_session->state = HSS_KA_SHARED;
+    if (vc_entry->write_buffer) {
+      free_MIOBuffer(vc_entry->write_buffer);
+      vc_entry->write_buffer = NULL;
+    }
+    server_session->do_io_write(this, 0, NULL);
+    server_session->get_netvc()->set_inactivity_timeout(HRTIME_SECONDS(txn_conf.keep_alive_no_activity_timeout_out));
+    server_session->get_netvc()->cancel_active_timeout();
+  } else {
+    close_server_session();
   }
+  response_hdr_done = false;
+
+  HttpConfig::release(http_config_param);
+  http_config_param = NULL;
+  in_check = false;
+  SET_HANDLER(&HCSM::main_event);
+  if (retired) {
+    destroy();
+  }
+}
+
+void
+HCSM::close_server_session()
+{
+  if (NULL != server_session) {
+    server_session->do_io_close();
+    server_session = NULL;
+  }
+  vc_entry->clear();
+  buffer_reader = NULL;
 }
 
 void
@@ -324,6 +366,7 @@ HCSM::attach_server_session(HttpServerSession *session)
   buffer_reader = NULL;
 
   server_session = session;
+  server_session->state = HSS_ACTIVE;
   ++server_session->transact_count;
   HTTP_INCREMENT_DYN_STAT(http_current_server_transactions_stat);
   ++server_session->server_trans_stat;
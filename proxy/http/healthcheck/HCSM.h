@@ -29,6 +29,10 @@
 
 class HCSM;
 extern ClassAllocator<HCSM> hcsmAllocator;
+
+// One state machine per checked origin address. It lives across the
+// checks of its HCHandler and keeps the connection to the origin open
+// between them when the origin allows it.
 class HCSM: public Continuation
 {
 public:
@@ -38,9 +42,9 @@ public:
   {
     return hcsmAllocator.alloc();
   }
-  void init(HCEntry *entry, HostDBInfo *r);
+  // A one_shot state machine frees itself after its first check
+  void init(HCEntry *entry, sockaddr const *ip, bool one_shot = false);
   void destroy();
-
   int main_event(int event, void *data);
   int state_con2os(int event, void *data);
   int state_send_req(int event, void *data);
@@ -48,24 +52,34 @@ public:
   void handle_con2os();
   void handle_send_req();
   void handle_read_res();
-
   OverridableHttpConfigParams txn_conf;
+
+  // Owned by the HCHandler
+  IpEndpoint target;
+  int generation;
+  volatile bool up;             // result of the last check
+  Event *check_event;           // pending HC_EVENT_CHECK, under the mutex
+  LINK(HCSM, link);
+
 private:
   void attach_server_session(HttpServerSession *s);
+  void close_server_session();
+  void check_done(bool ok);
 
   int64_t id;
-  int server_response_hdr_bytes;
-
   HCEntry *hc_entry;
   HostDBInfo *hostdb_info;
-
   VCEntry *vc_entry;
   HttpServerSession *server_session;
   IOBufferReader *buffer_reader;
-
   HttpConfigParams *http_config_param;
-  HTTPHdr res_hdr;
-  HTTPParser http_parser;
+  HCResponse response;
+  bool response_hdr_done;
+  int64_t body_left;
+  ink_hrtime send_time;
+  bool in_check;
+  bool retired;
+
 private:
   HCSM(const HCSM &hcsm);
   HCSM& operator=(const HCSM &hcsm);
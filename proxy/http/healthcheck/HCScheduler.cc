@@ -0,0 +1,97 @@
+/** @file
+
+  Timing wheel driving the health checks
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "HCScheduler.h"
+
+HCScheduler hcScheduler;
+
+void
+HCScheduler::start(Vec<HCEntry *> &entries)
+{
+  mutex = new_ProxyMutex();
+  SET_HANDLER(&HCScheduler::tick_event);
+  start_time = ink_get_hrtime();
+
+  InkRand generator((uint64_t) start_time);
+  for (int i = 0; i < entries.length(); ++i) {
+    HCHandler *hc_handler = HCHandler::allocate();
+    hc_handler->init(entries[i]);
+    add(hc_handler, (ink_hrtime) (generator.random() % (uint64_t) HRTIME_SECONDS(MAX(entries[i]->ttl, 1))));
+  }
+  eventProcessor.schedule_every(this, HC_WHEEL_TICK, ET_TASK);
+}
+
+void
+HCScheduler::add(HCHandler *hc_handler, ink_hrtime delay)
+{
+  uint64_t ticks = delay / HC_WHEEL_TICK;
+  hc_handler->due_tick = current_tick + MAX(ticks, (uint64_t) 1);
+  wheel[hc_handler->due_tick % HC_WHEEL_SLOTS].enqueue(hc_handler);
+}
+
+ink_hrtime
+HCScheduler::next_round(HCEntry *entry)
+{
+  ink_hrtime interval = HRTIME_SECONDS(MAX(entry->ttl, 1));
+  ink_hrtime spread = interval * MIN(MAX(healthcheck_jitter, 0), 100) / 100;
+
+  if (0 == spread)
+    return interval;
+  return interval - spread + (ink_hrtime) (this_ethread()->generator.random() % (uint64_t) (2 * spread + 1));
+}
+
+int
+HCScheduler::tick_event(int event, void *data)
+{
+  NOWARN_UNUSED(event);
+  NOWARN_UNUSED(data);
+  EThread *t = this_ethread();
+  ink_hrtime now = ink_get_hrtime();
+  uint64_t target = (now - start_time) / HC_WHEEL_TICK;
+
+  while (current_tick < target) {
+    ++current_tick;
+    Que(HCHandler, wheel_link) &slot = wheel[current_tick % HC_WHEEL_SLOTS];
+    Que(HCHandler, wheel_link) due;
+    HCHandler *hc_handler;
+
+    while ((hc_handler = slot.dequeue()))
+      due.enqueue(hc_handler);
+
+    while ((hc_handler = due.dequeue())) {
+      // Still some turns of the wheel away
+      if (hc_handler->due_tick > current_tick) {
+        slot.enqueue(hc_handler);
+        continue;
+      }
+      MUTEX_TRY_LOCK(lock, hc_handler->mutex, t);
+      if (lock) {
+        hc_handler->handleEvent(EVENT_INTERVAL, NULL);
+        add(hc_handler, next_round(hc_handler->hc_entry));
+      } else {
+        add(hc_handler, HC_WHEEL_TICK);
+      }
+    }
+  }
+  return EVENT_CONT;
+}
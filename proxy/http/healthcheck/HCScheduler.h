@@ -0,0 +1,62 @@
+/** @file
+
+  Timing wheel driving the health checks
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HEALTHCHECK_SCHEDULER_H_
+#define _HEALTHCHECK_SCHEDULER_H_
+
+#include "I_HC.h"
+#include "HCUtil.h"
+#include "HCHandler.h"
+
+#define HC_WHEEL_SLOTS      1024
+#define HC_WHEEL_TICK       HRTIME_MSECONDS(100)
+
+// A single timing wheel on ET_TASK runs the HCHandler of every origin,
+// instead of one periodic event each. Every round of an origin is
+// placed at its interval plus or minus proxy.config.http.healthcheck.jitter
+// percent, and the first round at a random point of the interval, so the
+// checks of many origins spread out instead of firing together.
+class HCScheduler: public Continuation
+{
+public:
+  HCScheduler() : Continuation(NULL), start_time(0), current_tick(0) {}
+  ~HCScheduler() {}
+
+  void start(Vec<HCEntry *> &entries);
+  int tick_event(int event, void *data);
+
+private:
+  void add(HCHandler *hc_handler, ink_hrtime delay);
+  ink_hrtime next_round(HCEntry *entry);
+
+  Que(HCHandler, wheel_link) wheel[HC_WHEEL_SLOTS];
+  ink_hrtime start_time;
+  uint64_t current_tick;
+
+  HCScheduler(const HCScheduler &);
+  HCScheduler& operator=(const HCScheduler &);
+};
+
+extern HCScheduler hcScheduler;
+
+#endif
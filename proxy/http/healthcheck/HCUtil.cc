@@ -45,8 +45,14 @@ static const char* DEFAULT_REQUEST_METHOD = "GET";
 
 int32_t healthcheck_default_ttl = 0;
 int32_t healthcheck_serve_stale_but_revalidate = 0;
+int32_t healthcheck_jitter = 10;
 int healthcheck_enabled = false;
+int healthcheck_rtt_stats = 0;
+int healthcheck_rtt_stats_max_origins = 100;
 char *healthcheck_filename = NULL;
+RecRawStatBlock *hc_rsb = NULL;
+RecRawStatBlock *hc_rtt_rsb = NULL;
+const int hc_rtt_bucket_msec[HC_RTT_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000 };
 ClassAllocator<HCEntry> hcEntryAllocator("HCEntryAllocator");
 ClassAllocator<VCEntry> vcEntryAllocator("VCEntryAllocator");
 EntryMap entry_map;
@@ -59,6 +65,9 @@ HCEntry::init()
 #define DEFAULT_PORT 80
   port = DEFAULT_PORT;
   ttl = healthcheck_default_ttl;
+  head_request = false;
+  hc_down = false;
+  rtt_stat_base = -1;
 }
 
 void
@@ -92,8 +101,11 @@ start_read_config_values()
 {
   IOCORE_EstablishStaticConfigInt32(healthcheck_default_ttl, "proxy.config.http.healthcheck.default_interval");
   IOCORE_EstablishStaticConfigInt32(healthcheck_serve_stale_but_revalidate, "proxy.config.http.healthcheck.serve_stale_for");
+  IOCORE_EstablishStaticConfigInt32(healthcheck_jitter, "proxy.config.http.healthcheck.jitter");
 
   IOCORE_ReadConfigInt32(healthcheck_enabled, "proxy.config.http.healthcheck.enabled");
+  IOCORE_ReadConfigInt32(healthcheck_rtt_stats, "proxy.config.http.healthcheck.rtt_stats");
+  IOCORE_ReadConfigInt32(healthcheck_rtt_stats_max_origins, "proxy.config.http.healthcheck.rtt_stats_max_origins");
   IOCORE_ReadConfigStringAlloc(healthcheck_filename, "proxy.config.http.healthcheck.filename");
 }
 
@@ -148,6 +160,7 @@ read_entry(int fd)
             return false;
           }
           http_parser_clear(&http_parser);
+          entry->head_request = (entry->req_hdr.method_get_wksidx() == HTTP_WKSIDX_HEAD);
           entry_map.put(key_hostname, entry);
 
           key_hostname = NULL;
@@ -194,6 +207,7 @@ read_entry(int fd)
         return false;
       }
       http_parser_clear(&http_parser);
+      entry->head_request = (entry->req_hdr.method_get_wksidx() == HTTP_WKSIDX_HEAD);
       entry_map.put(key_hostname, entry);
     }
     return true;
@@ -206,3 +220,140 @@ find_entry(const char *hostname)
   HCEntry *iter = entry_map.get(hostname);
   return iter;
 }
+
+bool
+healthcheck_origin_down(const char *hostname, int port)
+{
+  // entry_map is only written while the config is read at startup
+  HCEntry *entry = find_entry(hostname);
+  return NULL != entry && entry->port == port && entry->hc_down;
+}
+
+static void
+rtt_stat_name(char *name, int len, HCEntry *entry, int bucket)
+{
+  if (bucket < HC_RTT_BUCKETS - 1)
+    snprintf(name, len, "proxy.process.http.healthcheck.%s.rtt.le_%dms", entry->hostname, hc_rtt_bucket_msec[bucket]);
+  else
+    snprintf(name, len, "proxy.process.http.healthcheck.%s.rtt.gt_%dms", entry->hostname,
+             hc_rtt_bucket_msec[HC_RTT_BUCKETS - 2]);
+}
+
+void
+register_stats()
+{
+  hc_rsb = RecAllocateRawStatBlock((int) hc_stat_count);
+
+  RecRegisterRawStat(hc_rsb, RECT_PROCESS, "proxy.process.http.healthcheck.checks",
+                     RECD_COUNTER, RECP_NULL, (int) hc_checks_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(hc_rsb, RECT_PROCESS, "proxy.process.http.healthcheck.failures",
+                     RECD_COUNTER, RECP_NULL, (int) hc_failures_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(hc_rsb, RECT_PROCESS, "proxy.process.http.healthcheck.connects",
+                     RECD_COUNTER, RECP_NULL, (int) hc_connects_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(hc_rsb, RECT_PROCESS, "proxy.process.http.healthcheck.reused",
+                     RECD_COUNTER, RECP_NULL, (int) hc_reused_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(hc_rsb, RECT_PROCESS, "proxy.process.http.healthcheck.skipped",
+                     RECD_COUNTER, RECP_NULL, (int) hc_skipped_stat, RecRawStatSyncCount);
+
+  if (!healthcheck_rtt_stats || healthcheck_rtt_stats_max_origins <= 0)
+    return;
+
+  // Every histogram takes HC_RTT_BUCKETS records out of REC_MAX_RECORDS,
+  //  so only the first rtt_stats_max_origins origins get one
+  char name[MAXDNAME + 64];
+  Vec<HCEntry *> entry_vec;
+  entry_map.get_values(entry_vec);
+  int n_origins = MIN(entry_vec.length(), healthcheck_rtt_stats_max_origins);
+  if (n_origins < entry_vec.length())
+    Warning("healthcheck RTT stats kept for %d of %d origins, see proxy.config.http.healthcheck.rtt_stats_max_origins",
+            n_origins, entry_vec.length());
+  if (0 == n_origins)
+    return;
+
+  hc_rtt_rsb = RecAllocateRawStatBlock(n_origins * HC_RTT_BUCKETS);
+  for (int i = 0; i < n_origins; ++i) {
+    entry_vec[i]->rtt_stat_base = i * HC_RTT_BUCKETS;
+    for (int b = 0; b < HC_RTT_BUCKETS; ++b) {
+      rtt_stat_name(name, sizeof(name), entry_vec[i], b);
+      RecRegisterRawStat(hc_rtt_rsb, RECT_PROCESS, name, RECD_COUNTER, RECP_NULL,
+                         entry_vec[i]->rtt_stat_base + b, RecRawStatSyncCount);
+    }
+  }
+}
+
+void
+record_rtt(EThread *thread, HCEntry *entry, ink_hrtime rtt)
+{
+  if (entry->rtt_stat_base < 0)
+    return;
+
+  int64_t msec = rtt / HRTIME_MSECOND;
+  int b = 0;
+
+  while (b < HC_RTT_BUCKETS - 1 && msec > hc_rtt_bucket_msec[b])
+    ++b;
+  RecIncrRawStat(hc_rtt_rsb, thread, entry->rtt_stat_base + b, 1);
+}
+
+static inline bool
+header_is(const char *line, const char *eol, const char *name, int name_len)
+{
+  return eol - line > name_len && 0 == strncasecmp(line, name, name_len);
+}
+
+static bool
+value_has(const char *value, const char *eol, const char *token, int token_len)
+{
+  for (; eol - value >= token_len; ++value) {
+    if (0 == strncasecmp(value, token, token_len))
+      return true;
+  }
+  return false;
+}
+
+int
+parse_response(const char *buf, int len, HCResponse *res)
+{
+  const char *end = buf + len;
+  const char *eol = (const char *) memchr(buf, '\n', len);
+  bool chunked = false;
+
+  if (NULL == eol)
+    return len < HC_MAX_RESPONSE_HDR ? PARSE_CONT : PARSE_ERROR;
+
+  // HTTP/1.x NNN
+  if (eol - buf < 12 || 0 != strncmp(buf, "HTTP/1.", 7) || ' ' != buf[8] ||
+      !ParseRules::is_digit(buf[9]) || !ParseRules::is_digit(buf[10]) || !ParseRules::is_digit(buf[11]))
+    return PARSE_ERROR;
+  res->status = (buf[9] - '0') * 100 + (buf[10] - '0') * 10 + (buf[11] - '0');
+  res->content_length = -1;
+  res->keep_alive = ('1' == buf[7]);
+
+  // Only the headers framing the body are looked at
+  for (const char *line = eol + 1; line < end; line = eol + 1) {
+    eol = (const char *) memchr(line, '\n', end - line);
+    if (NULL == eol)
+      break;
+    if (eol == line || (eol == line + 1 && '\r' == *line)) {
+      res->hdr_len = eol + 1 - buf;
+      // A body delimited by the close, or chunked, is not read
+      //  through, so the connection can not be kept
+      if (chunked || (res->content_length < 0 && HTTP_STATUS_NO_CONTENT != res->status &&
+                      HTTP_STATUS_NOT_MODIFIED != res->status))
+        res->keep_alive = false;
+      return PARSE_DONE;
+    }
+    if (header_is(line, eol, "Content-Length:", 15)) {
+      res->content_length = strtoll(line + 15, NULL, 10);
+    } else if (header_is(line, eol, "Connection:", 11)) {
+      if (value_has(line + 11, eol, "close", 5))
+        res->keep_alive = false;
+      else if (value_has(line + 11, eol, "keep-alive", 10))
+        res->keep_alive = true;
+    } else if (header_is(line, eol, "Transfer-Encoding:", 18)) {
+      chunked = true;
+    }
+  }
+
+  return len < HC_MAX_RESPONSE_HDR ? PARSE_CONT : PARSE_ERROR;
+}
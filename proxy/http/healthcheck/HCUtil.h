@@ -34,9 +34,38 @@
 
 #define HC_STATE_ENTER(state_name) { Debug("healthcheck", "[%" PRId64 "] [%s]", id, #state_name); }
 
+#define HC_EVENT_CHECK    (HEALTHCHECK_EVENTS_START + 0)
+#define HC_EVENT_RETIRE   (HEALTHCHECK_EVENTS_START + 1)
+
+// Largest response header a check reads, the status line and the
+// framing headers have to fit in it
+#define HC_MAX_RESPONSE_HDR   4096
+
+// RTT histogram buckets of an origin, upper bounds in msec; the last
+// bucket counts everything slower. The histograms live in hc_rtt_rsb,
+// for at most proxy.config.http.healthcheck.rtt_stats_max_origins origins.
+#define HC_RTT_BUCKETS  12
+extern const int hc_rtt_bucket_msec[HC_RTT_BUCKETS - 1];
+
+enum HC_Stats
+{
+  hc_checks_stat,
+  hc_failures_stat,
+  hc_connects_stat,
+  hc_reused_stat,
+  hc_skipped_stat,
+  hc_stat_count
+};
+
+extern RecRawStatBlock *hc_rsb;
+extern RecRawStatBlock *hc_rtt_rsb;
+
 extern int32_t healthcheck_default_ttl;
 extern int32_t healthcheck_serve_stale_but_revalidate;
+extern int32_t healthcheck_jitter;
 extern int healthcheck_enabled;
+extern int healthcheck_rtt_stats;
+extern int healthcheck_rtt_stats_max_origins;
 extern char *healthcheck_filename;
 
 struct HCEntry;
@@ -50,6 +79,26 @@ extern EntryMap entry_map;
 void start_read_config_values();
 bool read_entry(int fd);
 HCEntry* find_entry(const char *hostname);
+void register_stats();
+void record_rtt(EThread *thread, HCEntry *entry, ink_hrtime rtt);
+
+// True when every address of a checked origin failed its last check.
+// Parent selection skips such parents.
+bool healthcheck_origin_down(const char *hostname, int port);
+
+// What a check needs to know about a response: the status, and how the
+// body is delimited so the connection can be kept for the next check
+struct HCResponse
+{
+  int status;
+  int hdr_len;
+  int64_t content_length;       // -1 when not given
+  bool keep_alive;
+};
+
+// Scans the status line and the framing headers in buf, without
+// building an HTTPHdr. Returns PARSE_DONE, PARSE_CONT or PARSE_ERROR.
+int parse_response(const char *buf, int len, HCResponse *res);
 
 struct HCEntry : RefCountObj
 {
@@ -60,6 +109,12 @@ struct HCEntry : RefCountObj
   char *hostname;
   int port;
   unsigned int ttl;
+  bool head_request;
+  volatile bool hc_down;        // no address of the origin passed its last check
+
+  // First of the HC_RTT_BUCKETS stats in hc_rtt_rsb behind the
+  // proxy.process.http.healthcheck.<hostname>.rtt.* records, -1 if none
+  int rtt_stat_base;
 
   static HCEntry *allocate()
   {
@@ -22,214 +22,128 @@
  */
 
 #include "HotUrlMap.h"
+#include "HotUrlSketch.h"
 #include "HotUrlStats.h"
 
-#define CLEAR_INTERVAL (100 * HRTIME_MSECOND)
-
-inline int64_t HotUrlMap::UrlMapEntry::getOrderBy()
+inline int64_t HotUrlMap::UrlMapEntry::getOrderBy() const
 {
   return (HotUrlStats::getDetecType() & HOT_URLS_DETECT_TYPE_BYTES) ?
     _bytes : _count;
 }
 
-HotUrlMap::PriorityQueue::PriorityQueue()
-  : _maxCount(0), _count(0), _head(NULL), _tail(NULL), _min(0)
-{
-  ink_mutex_init(&_mutex, "HotUrlPriorityQueue");
-}
-
-HotUrlMap::PriorityQueue::~PriorityQueue()
+static int compareByHash(const void *p1, const void *p2)
 {
-  ink_mutex_destroy(&_mutex);
+  const HotUrlMap::UrlMapEntry *e1 = (const HotUrlMap::UrlMapEntry *)p1;
+  const HotUrlMap::UrlMapEntry *e2 = (const HotUrlMap::UrlMapEntry *)p2;
+  if (e1->_hash != e2->_hash) {
+    return e1->_hash < e2->_hash ? -1 : 1;
+  }
+  if (e1->_url->length != e2->_url->length) {
+    return e1->_url->length - e2->_url->length;
+  }
+  return memcmp(e1->_url->url, e2->_url->url, e1->_url->length);
 }
 
-void HotUrlMap::PriorityQueue::add(UrlMapEntry *entry)
+static int compareByOrder(const void *p1, const void *p2)
 {
-  if (entry->getOrderBy() <= _min) {
-    return;
+  int64_t v1 = ((const HotUrlMap::UrlMapEntry *)p1)->getOrderBy();
+  int64_t v2 = ((const HotUrlMap::UrlMapEntry *)p2)->getOrderBy();
+  if (v1 == v2) {
+    return 0;
   }
-
-  ink_mutex_acquire(&_mutex);
-  do {
-    if (entry->getOrderBy() <= _min) {
-      break;
-    }
-
-    if (!entry->_inQueue) {
-      entry->_inQueue = true;
-      if (_count < _maxCount) {
-        ++_count;
-      }
-      else if (_tail != NULL) {  //remove the tail node
-        _tail->_inQueue = false;
-        if (_tail->_prev != NULL) {
-          _tail->_prev->_next = NULL;
-          _tail = _tail->_prev;
-        }
-        else {
-          _head = NULL;
-          _tail = NULL;
-        }
-      }
-
-      entry->_prev = _tail;
-      entry->_next = NULL;
-      if (_tail == NULL) {
-        _head = entry;
-      }
-      else {
-        _tail->_next = entry;
-      }
-
-      _tail = entry;
-      _min = entry->getOrderBy();
-    }
-    else
-    {
-      if (entry->_next == NULL) {  //i am the tail node
-        _min = entry->getOrderBy();
-      }
-    }
-
-    if (entry->_prev == NULL) { //i am the largest, do NOT resort
-      break;
-    }
-
-    if (entry->getOrderBy() <= entry->_prev->getOrderBy()) { //order is OK
-      break;
-    }
-
-    //remove this entry first
-    if (entry->_next == NULL) { //i am the tail node
-      _tail = entry->_prev;
-      _tail->_next = NULL;
-      _min = _tail->getOrderBy();
-    }
-    else {
-      entry->_next->_prev = entry->_prev;
-      entry->_prev->_next = entry->_next;
-    }
-
-    //then insert this entry
-    UrlMapEntry *prev = entry->_prev->_prev;
-    while (prev != NULL && entry->getOrderBy() > prev->getOrderBy()) {
-      prev = prev->_prev;
-    }
-    if (prev == NULL) {
-      entry->_prev = NULL;
-      entry->_next = _head;
-      _head->_prev = entry;
-      _head = entry;
-    }
-    else {
-      prev->_next->_prev = entry;
-      entry->_next = prev->_next;
-      entry->_prev = prev;
-      prev->_next = entry;
-    }
-  } while (0);
-  ink_mutex_release(&_mutex);
+  return v1 > v2 ? -1 : 1;
 }
 
 HotUrlMap::HotUrlMap()
+  : _maxCount(0), _entries(NULL), _allocSize(0), _count(0), _head(NULL)
 {
-  int64_t bytes;
-  UrlHashBucket *pBucket;
-  UrlHashBucket *pEnd;
-
-  bytes = sizeof(UrlHashBucket) * URL_HASH_TABLE_SIZE;
-  _urlTable._buckets = (UrlHashBucket *)ats_malloc(bytes);
-
-  bytes = sizeof(int) * URL_HASH_TABLE_SIZE;
-  _urlTable._counts = (int *)ats_malloc(bytes);
-  memset(_urlTable._counts, 0, bytes);
+}
 
-  pEnd = _urlTable._buckets + URL_HASH_TABLE_SIZE;
-  for (pBucket=_urlTable._buckets; pBucket<pEnd; pBucket++) {
-    ink_mutex_init(&pBucket->_mutex, "HotUrlMapMutex");
-  }
+HotUrlMap::~HotUrlMap()
+{
+  ats_free(_entries);
 }
 
-const HotUrlMap::UrlMapEntry *HotUrlMap::get(const char *url, const int url_len)
+void HotUrlMap::addCandidate(const UrlEntry *url, const uint64_t hash,
+    const int64_t bytes, const int count)
 {
-  unsigned int index;
-  UrlMapEntry *found;
-
-  index = time33Hash(url, url_len) % URL_HASH_TABLE_SIZE;
-  ink_mutex_acquire(&(_urlTable._buckets[index]._mutex));
-  found = find(index, url, url_len);
-  ink_mutex_release(&(_urlTable._buckets[index]._mutex));
-  return found;
+  if (_count >= _allocSize) {
+    _allocSize = _allocSize == 0 ? 256 : 2 * _allocSize;
+    _entries = (UrlMapEntry *)ats_realloc(_entries, sizeof(UrlMapEntry) * _allocSize);
+  }
+
+  UrlMapEntry *entry = _entries + _count++;
+  entry->_url = url;
+  entry->_hash = hash;
+  entry->_bytes = bytes;
+  entry->_count = count;
 }
 
-void HotUrlMap::incrementBytes(const char *url, const int url_len, const int64_t bytes)
+void HotUrlMap::merge(const int gen)
 {
-  unsigned int index;
-  UrlMapEntry *found;
+  clear();
+
+  //collect the top-K urls of each thread
+  for (int i=0; i<eventProcessor.n_ethreads; i++) {
+    HotUrlSketch *sketch = HotUrlSketch::getSketch(eventProcessor.all_ethreads[i]);
+    if (sketch == NULL) {
+      continue;
+    }
 
-  if (url_len >= MAX_URL_SIZE) {
+    const HotUrlSketch::Generation *g = sketch->getGeneration(gen);
+    for (int k=0; k<g->_entryCount; k++) {
+      addCandidate(&g->_entries[k]._url, g->_hashes[k],
+          g->_entries[k]._bytes, g->_entries[k]._count);
+    }
+  }
+  if (_count == 0) {
     return;
   }
 
-  index = time33Hash(url, url_len) % URL_HASH_TABLE_SIZE;
-  ink_mutex_acquire(&(_urlTable._buckets[index]._mutex));
-  found = find(index, url, url_len);
-  if (found != NULL) {
-    found->_bytes += bytes;
-    found->_count += 1;
-  }
-  else {
-    if (_urlTable._counts[index] >= MAX_URL_COUNT_PER_BUCKET) {
-      ink_mutex_release(&(_urlTable._buckets[index]._mutex));
-      return;
+  //combine the same url from different threads
+  qsort(_entries, _count, sizeof(UrlMapEntry), compareByHash);
+  UrlMapEntry *dest = _entries;
+  UrlMapEntry *entryEnd = _entries + _count;
+  for (UrlMapEntry *entry=_entries + 1; entry<entryEnd; entry++) {
+    if (compareByHash(dest, entry) == 0) {
+      dest->_bytes += entry->_bytes;
+      dest->_count += entry->_count;
+    }
+    else if (++dest != entry) {
+      *dest = *entry;
     }
-
-    found = _urlTable._buckets[index]._urls + _urlTable._counts[index];
-    found->_inQueue = false;
-    found->_bytes = bytes;
-    found->_count = 1;
-    found->setUrl(url, url_len);
-    _urlTable._counts[index]++;
   }
-  ink_mutex_release(&(_urlTable._buckets[index]._mutex));
-
-  _urlQueue.add(found);
-  return;
-}
-
-void HotUrlMap::urlTableStat(int &urlCount, int &min, int &max, double &avg)
-{
-  int *pCount;
-  int *pEnd;
-  int usedCount;
-
-  urlCount = 0;
-  usedCount = 0;
-  min = -1;
-  max = 0;
-  pEnd = _urlTable._counts + URL_HASH_TABLE_SIZE;
-  for (pCount=_urlTable._counts; pCount<pEnd; pCount++) {
-    if (*pCount > 0) {
-      usedCount++;
-      urlCount += *pCount;
-
-      if (*pCount > max) {
-        max = *pCount;
+  _count = dest - _entries + 1;
+
+  //the order by value is the sum of the estimates of all the sketches,
+  //which counts the requests made before the url entered a heap too
+  bool byBytes = (HotUrlStats::getDetecType() & HOT_URLS_DETECT_TYPE_BYTES) != 0;
+  entryEnd = _entries + _count;
+  for (UrlMapEntry *entry=_entries; entry<entryEnd; entry++) {
+    int64_t total = 0;
+    for (int i=0; i<eventProcessor.n_ethreads; i++) {
+      HotUrlSketch *sketch = HotUrlSketch::getSketch(eventProcessor.all_ethreads[i]);
+      if (sketch != NULL) {
+        total += sketch->estimate(gen, entry->_hash);
       }
     }
 
-    if (min < 0) {
-      min = *pCount;
+    if (byBytes) {
+      entry->_bytes = total;
     }
-    else if (*pCount < min) {
-      min = *pCount;
+    else {
+      entry->_count = (int)total;
     }
   }
-  if (usedCount > 0) {
-    avg = (double)urlCount / (double)usedCount;
+
+  qsort(_entries, _count, sizeof(UrlMapEntry), compareByOrder);
+  if (_maxCount > 0 && _count > (int)_maxCount) {
+    _count = _maxCount;
   }
-  else {
-    avg = 0.00;
+
+  for (int i=0; i<_count; i++) {
+    _entries[i]._prev = i > 0 ? _entries + i - 1 : NULL;
+    _entries[i]._next = i < _count - 1 ? _entries + i + 1 : NULL;
   }
+  _head = _entries;
 }
-
@@ -0,0 +1,292 @@
+/** @file
+
+  Per thread count-min sketch and top-K heap for hot url detection
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <math.h>
+#include "HotUrlSketch.h"
+#include "HotUrlStats.h"
+
+volatile int HotUrlSketch::_generation = 0;
+off_t HotUrlSketch::_threadOffset = -1;
+int HotUrlSketch::_defaultWidth = 2048;
+int HotUrlSketch::_defaultDepth = 5;
+int HotUrlSketch::_defaultTopSize = 64;
+
+HotUrlSketch::HotUrlSketch(const int width, const int depth, const int topSize)
+  : _width(width), _depth(depth), _topSize(topSize), _writing(0),
+  _totalSendBytes(0), _totalQueryCount(0)
+{
+  for (int i=0; i<2; i++) {
+    Generation *g = _gens + i;
+    g->_counters = (int64_t *)ats_malloc(sizeof(int64_t) * _width * _depth);
+    g->_hashes = (uint64_t *)ats_malloc(sizeof(uint64_t) * _topSize);
+    g->_values = (int64_t *)ats_malloc(sizeof(int64_t) * _topSize);
+    g->_entries = (TopEntry *)ats_malloc(sizeof(TopEntry) * _topSize);
+    g->_heap = (int *)ats_malloc(sizeof(int) * _topSize);
+    clearGeneration(i);
+  }
+}
+
+HotUrlSketch::~HotUrlSketch()
+{
+  for (int i=0; i<2; i++) {
+    ats_free(_gens[i]._counters);
+    ats_free(_gens[i]._hashes);
+    ats_free(_gens[i]._values);
+    ats_free(_gens[i]._entries);
+    ats_free(_gens[i]._heap);
+  }
+}
+
+void HotUrlSketch::init(const double epsilon, const double delta, const int topSize)
+{
+  int width = 64;
+  if (epsilon > 0.0) {
+    while (width < M_E / epsilon && width < (1 << 20)) {
+      width <<= 1;
+    }
+  }
+  int depth = 1;
+  if (delta > 0.0 && delta < 1.0) {
+    depth = (int)ceil(log(1.0 / delta));
+    if (depth < 1) {
+      depth = 1;
+    }
+  }
+
+  _defaultWidth = width;
+  _defaultDepth = depth;
+  _defaultTopSize = topSize > 0 ? topSize : 1;
+  if (_threadOffset < 0) {
+    _threadOffset = eventProcessor.allocate(sizeof(HotUrlSketch *));
+    ink_release_assert(_threadOffset >= 0);
+  }
+
+  Debug(HOT_URLS_DEBUG_TAG, "hot url sketch width: %d, depth: %d, top size: %d",
+      _defaultWidth, _defaultDepth, _defaultTopSize);
+}
+
+HotUrlSketch *HotUrlSketch::get()
+{
+  EThread *t = this_ethread();
+  if (t == NULL || _threadOffset < 0) {
+    return NULL;
+  }
+
+  HotUrlSketch **slot = (HotUrlSketch **)ETHREAD_GET_PTR(t, _threadOffset);
+  if (*slot == NULL) {
+    HotUrlSketch *sketch = new HotUrlSketch(_defaultWidth, _defaultDepth,
+        _defaultTopSize);
+    INK_WRITE_MEMORY_BARRIER;
+    *slot = sketch;
+  }
+  return *slot;
+}
+
+uint64_t HotUrlSketch::hash(const char *url, const int url_len)
+{
+  //64 bits FNV-1a
+  uint64_t nHash = 14695981039346656037ULL;
+  const unsigned char *pKey = (const unsigned char *)url;
+  const unsigned char *pEnd = pKey + url_len;
+  for (; pKey < pEnd; pKey++) {
+    nHash ^= *pKey;
+    nHash *= 1099511628211ULL;
+  }
+  return nHash;
+}
+
+int64_t HotUrlSketch::estimate(const int gen, const uint64_t hash) const
+{
+  const uint32_t h1 = (uint32_t)hash;
+  const uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+  const int64_t *row = _gens[gen]._counters;
+  int64_t min = INT64_MAX;
+  for (int i=0; i<_depth; i++, row += _width) {
+    int64_t value = row[(h1 + i * h2) & (_width - 1)];
+    if (value < min) {
+      min = value;
+    }
+  }
+  return min;
+}
+
+void HotUrlSketch::heapUp(Generation *g, int pos)
+{
+  int index = g->_heap[pos];
+  while (pos > 0) {
+    int parent = (pos - 1) / 2;
+    if (g->_values[g->_heap[parent]] <= g->_values[index]) {
+      break;
+    }
+    g->_heap[pos] = g->_heap[parent];
+    g->_entries[g->_heap[pos]]._heapPos = pos;
+    pos = parent;
+  }
+  g->_heap[pos] = index;
+  g->_entries[index]._heapPos = pos;
+}
+
+void HotUrlSketch::heapDown(Generation *g, int pos)
+{
+  int index = g->_heap[pos];
+  for (;;) {
+    int child = 2 * pos + 1;
+    if (child >= g->_entryCount) {
+      break;
+    }
+    if (child + 1 < g->_entryCount &&
+        g->_values[g->_heap[child + 1]] < g->_values[g->_heap[child]])
+    {
+      child++;
+    }
+    if (g->_values[index] <= g->_values[g->_heap[child]]) {
+      break;
+    }
+    g->_heap[pos] = g->_heap[child];
+    g->_entries[g->_heap[pos]]._heapPos = pos;
+    pos = child;
+  }
+  g->_heap[pos] = index;
+  g->_entries[index]._heapPos = pos;
+}
+
+void HotUrlSketch::add(const char *url, const int url_len, const int64_t bytes,
+    const int64_t value, const bool detect)
+{
+  _totalSendBytes += bytes;
+  _totalQueryCount++;
+  if (!detect || url_len >= MAX_URL_SIZE) {
+    return;
+  }
+
+  //the swap is a full barrier: rotate() either sees us writing or we see
+  //the new generation
+  ink_atomic_swap(&_writing, 1);
+  Generation *g = _gens + (_generation & 1);
+
+  const uint64_t h = hash(url, url_len);
+  const uint32_t h1 = (uint32_t)h;
+  const uint32_t h2 = (uint32_t)(h >> 32) | 1;
+  int64_t *row = g->_counters;
+  int64_t est = INT64_MAX;
+  for (int i=0; i<_depth; i++, row += _width) {
+    int64_t *counter = row + ((h1 + i * h2) & (_width - 1));
+    *counter += value;
+    if (*counter < est) {
+      est = *counter;
+    }
+  }
+
+  int index;
+  for (index=0; index<g->_entryCount; index++) {
+    if (g->_hashes[index] == h && g->_entries[index]._url.equals(url, url_len)) {
+      break;
+    }
+  }
+
+  TopEntry *entry;
+  if (index < g->_entryCount) {
+    entry = g->_entries + index;
+    entry->_bytes += bytes;
+    entry->_count++;
+    g->_values[index] = est;
+    heapDown(g, entry->_heapPos);
+  }
+  else if (g->_entryCount < _topSize || est > g->_values[g->_heap[0]]) {
+    int pos;
+    if (g->_entryCount < _topSize) {
+      index = g->_entryCount;
+      pos = g->_entryCount++;
+      g->_heap[pos] = index;
+    }
+    else {  //replace the smallest one
+      index = g->_heap[0];
+      pos = 0;
+    }
+
+    entry = g->_entries + index;
+    memcpy(entry->_url.url, url, url_len);
+    entry->_url.url[url_len] = '\0';
+    entry->_url.length = url_len;
+    entry->_bytes = bytes;
+    entry->_count = 1;
+    g->_hashes[index] = h;
+    g->_values[index] = est;
+    if (pos == 0) {
+      heapDown(g, pos);
+    }
+    else {
+      heapUp(g, pos);
+    }
+  }
+
+  INK_WRITE_MEMORY_BARRIER;
+  _writing = 0;
+}
+
+void HotUrlSketch::clearGeneration(const int gen)
+{
+  Generation *g = _gens + gen;
+  memset(g->_counters, 0, sizeof(int64_t) * _width * _depth);
+  g->_entryCount = 0;
+}
+
+int HotUrlSketch::rotate()
+{
+  int oldGen = _generation & 1;
+  ink_atomic_increment(&_generation, 1);
+
+  for (int i=0; i<eventProcessor.n_ethreads; i++) {
+    HotUrlSketch *sketch = getSketch(eventProcessor.all_ethreads[i]);
+    if (sketch != NULL) {
+      while (sketch->_writing) {
+        sched_yield();
+      }
+    }
+  }
+  INK_MEMORY_BARRIER;
+  return oldGen;
+}
+
+void HotUrlSketch::clear(const int gen)
+{
+  for (int i=0; i<eventProcessor.n_ethreads; i++) {
+    HotUrlSketch *sketch = getSketch(eventProcessor.all_ethreads[i]);
+    if (sketch != NULL) {
+      sketch->clearGeneration(gen);
+    }
+  }
+}
+
+void HotUrlSketch::totals(int64_t &sendBytes, int64_t &queryCount)
+{
+  sendBytes = 0;
+  queryCount = 0;
+  for (int i=0; i<eventProcessor.n_ethreads; i++) {
+    HotUrlSketch *sketch = getSketch(eventProcessor.all_ethreads[i]);
+    if (sketch != NULL) {
+      sendBytes += sketch->getTotalSendBytes();
+      queryCount += sketch->getTotalQueryCount();
+    }
+  }
+}
@@ -0,0 +1,152 @@
+/** @file
+
+  Per thread count-min sketch and top-K heap for hot url detection
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HOT_URL_SKETCH_H_
+#define _HOT_URL_SKETCH_H_
+
+#include "I_HotUrls.h"
+
+/**
+ * Each EThread owns one HotUrlSketch and is its only writer, so the
+ * request path takes no lock and touches no shared cache line. A sketch
+ * has two generations: the request path writes the current one while
+ * the detect task merges and clears the other one after rotate().
+ *
+ * The count-min sketch gives an estimate that never undercounts and
+ * overcounts by at most epsilon * total with probability 1 - delta
+ * (width = e / epsilon, depth = ln(1 / delta)). The top-K heap keeps
+ * the K urls with the largest estimates seen by this thread.
+ */
+class HotUrlSketch
+{
+  public:
+    struct TopEntry {
+      UrlEntry _url;
+      int64_t _bytes;   //bytes seen since the url entered the heap
+      int _count;       //requests seen since the url entered the heap
+      int _heapPos;     //position of this entry in the heap
+    };
+
+    struct Generation {
+      int64_t *_counters;  //depth * width
+      uint64_t *_hashes;   //url hash of each top entry
+      int64_t *_values;    //estimate of each top entry
+      TopEntry *_entries;
+      int *_heap;          //min heap of entry indexes, ordered by _values
+      int _entryCount;
+    };
+
+    HotUrlSketch(const int width, const int depth, const int topSize);
+    ~HotUrlSketch();
+
+    /**
+     * Gets the sketch of the calling thread, creating it on first use
+     * @return the sketch, NULL if the calling thread is not an EThread
+     */
+    static HotUrlSketch *get();
+
+    /**
+     * Count a request, called from the owner thread only
+     * @param url the url
+     * @param url_len the url length
+     * @param bytes the send bytes
+     * @param value the order by value (bytes or 1)
+     * @param detect add the url to the sketch
+     */
+    void add(const char *url, const int url_len, const int64_t bytes,
+        const int64_t value, const bool detect);
+
+    inline int64_t getTotalSendBytes() const {
+      return _totalSendBytes;
+    }
+
+    inline int64_t getTotalQueryCount() const {
+      return _totalQueryCount;
+    }
+
+    inline const Generation *getGeneration(const int gen) const {
+      return _gens + gen;
+    }
+
+    int64_t estimate(const int gen, const uint64_t hash) const;
+
+    static uint64_t hash(const char *url, const int url_len);
+
+    /**
+     * Switch all the sketches to the other generation and wait until no
+     * writer is still using the old one
+     * @return the old generation, ready to be merged
+     */
+    static int rotate();
+
+    /**
+     * Clear the given generation of all the sketches, must be called
+     * after rotate() returned it
+     */
+    static void clear(const int gen);
+
+    /**
+     * Sum of the counters of all the sketches
+     */
+    static void totals(int64_t &sendBytes, int64_t &queryCount);
+
+    /**
+     * Size the sketches from the accuracy bounds, must be called before
+     * the first request is counted
+     * @param epsilon the max overcount as a ratio of the total
+     * @param delta the probability to exceed epsilon
+     * @param topSize the size of the top-K heap of each thread
+     */
+    static void init(const double epsilon, const double delta, const int topSize);
+
+    static inline HotUrlSketch *getSketch(EThread *t) {
+      if (_threadOffset < 0) {
+        return NULL;
+      }
+      return *(HotUrlSketch **)ETHREAD_GET_PTR(t, _threadOffset);
+    }
+
+  private:
+    // Hide the copy constructor
+    HotUrlSketch(const HotUrlSketch & x) { NOWARN_UNUSED(x); }
+
+    void heapUp(Generation *g, int pos);
+    void heapDown(Generation *g, int pos);
+    void clearGeneration(const int gen);
+
+    int _width;
+    int _depth;
+    int _topSize;
+    Generation _gens[2];
+    volatile int _writing;
+    int64_t _totalSendBytes;
+    int64_t _totalQueryCount;
+
+    static volatile int _generation;
+    static off_t _threadOffset;
+    static int _defaultWidth;
+    static int _defaultDepth;
+    static int _defaultTopSize;
+};
+
+#endif
@@ -9,12 +9,9 @@ HotUrlStats *HotUrlStats::instance = new HotUrlStats();
 
 HotUrlStats::HotUrlStats()
 : _detect(false),
-  _total_send_bytes(0),
-  _total_query_count(0),
   _current_send_bps(0),
   _current_qps(0.00)
 {
-  _currentHotUrlMap = _hotUrlMaps;
 }
 
 void HotUrlStats::doCalcSendBps()
@@ -27,6 +24,8 @@ void HotUrlStats::doCalcSendBps()
   static ink_hrtime last_calc_time = ink_get_hrtime();
   ink_hrtime current_time;
   double delta_time;
+  int64_t total_send_bytes;
+  int64_t total_query_count;
 
   current_time = ink_get_hrtime();
   delta_time = (double)(current_time - last_calc_time) / (double)HRTIME_SECOND;
@@ -34,12 +33,13 @@ void HotUrlStats::doCalcSendBps()
     return;
   }
 
-  _current_send_bps = (int64_t)(8 * (_total_send_bytes -
+  HotUrlSketch::totals(total_send_bytes, total_query_count);
+  _current_send_bps = (int64_t)(8 * (total_send_bytes -
         last_send_bytes) / delta_time);
-  last_send_bytes = _total_send_bytes;
+  last_send_bytes = total_send_bytes;
 
-  _current_qps = (_total_query_count - last_query_count) / delta_time;
-  last_query_count = _total_query_count;
+  _current_qps = (total_query_count - last_query_count) / delta_time;
+  last_query_count = total_query_count;
   last_calc_time = current_time;
 
   if (_config.max_count == 0) {
@@ -121,33 +121,22 @@ void HotUrlStats::doCalcHotUrls()
 
   int64_t current_send_bytes = _current_send_bps / 8;
   double current_qps  = _current_qps;
+  int gen = HotUrlSketch::rotate();
+  last_calc_time = current_time;
   if (current_send_bytes == 0 || current_qps < 0.0001) {
     HotUrlManager::clear();
-    last_calc_time = current_time;
+    HotUrlSketch::clear(gen);
     return;
   }
 
-  HotUrlMap *OldUrlMap;
-  HotUrlMap *newUrlMap;
-  OldUrlMap = _currentHotUrlMap;
-  if (_currentHotUrlMap == _hotUrlMaps) {
-    newUrlMap = _hotUrlMaps + 1;
-  }
-  else {
-    newUrlMap = _hotUrlMaps;
-  }
-  newUrlMap->clear();
-  _currentHotUrlMap = newUrlMap;
-  last_calc_time = current_time;
-
-  HotUrlMap::PriorityQueue *urlQueue = OldUrlMap->getUrlQueue();
+  _hotUrlMap.merge(gen);
   const HotUrlMap::UrlMapEntry *head;
   const HotUrlMap::UrlMapEntry *lastMatchEntry = NULL;
   bool matched;
   int i;
 
   i = 0;
-  head = urlQueue->head();
+  head = _hotUrlMap.head();
   while (head != NULL) {
     matched = false;
     if (_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) {
@@ -157,7 +146,7 @@ void HotUrlStats::doCalcHotUrls()
         lastMatchEntry = head;
         matched = true;
         Debug(HOT_URLS_DEBUG_TAG, "single %d. %.*s, bytes=%"PRId64", "
-            "ratio=%.2f, qps=%.2f", i + 1, head->_url.length, head->_url.url,
+            "ratio=%.2f, qps=%.2f", i + 1, head->_url->length, head->_url->url,
             head->_bytes, ((double)head->_bytes / delta_time) /
             (double)current_send_bytes, (double)head->_count / delta_time);
       }
@@ -167,7 +156,7 @@ void HotUrlStats::doCalcHotUrls()
         lastMatchEntry = head;
         matched = true;
         Debug(HOT_URLS_DEBUG_TAG, "single %d. %.*s, count=%d, "
-            "ratio=%.2f, qps=%.2f", i + 1, head->_url.length, head->_url.url,
+            "ratio=%.2f, qps=%.2f", i + 1, head->_url->length, head->_url->url,
             head->_count, ((double)head->_count / delta_time) / current_qps,
             (double)head->_count / delta_time);
       }
@@ -185,7 +174,7 @@ void HotUrlStats::doCalcHotUrls()
     int64_t bytes_sum = 0;
     int64_t count_sum = 0;
     i = 0;
-    head = urlQueue->head();
+    head = _hotUrlMap.head();
     while (head != NULL) {
       if (_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) {
         bytes_sum += head->_bytes;
@@ -193,7 +182,7 @@ void HotUrlStats::doCalcHotUrls()
             _config.multi_url_select_ratio) {
           lastMatchEntry = head;
           Debug(HOT_URLS_DEBUG_TAG, "multi %d. %.*s: %"PRId64"", i + 1,
-              head->_url.length, head->_url.url, head->_bytes);
+              head->_url->length, head->_url->url, head->_bytes);
           break;
         }
       }
@@ -202,7 +191,7 @@ void HotUrlStats::doCalcHotUrls()
         if ((double)count_sum / delta_time / current_qps >= _config.multi_url_select_ratio) {
           lastMatchEntry = head;
           Debug(HOT_URLS_DEBUG_TAG, "multi %d. %.*s: %d", i + 1,
-              head->_url.length, head->_url.url, head->_count);
+              head->_url->length, head->_url->url, head->_count);
           break;
         }
       }
@@ -216,8 +205,11 @@ void HotUrlStats::doCalcHotUrls()
     HotUrlManager::clear();
   }
   else {
-    HotUrlManager::replace(urlQueue->head(), lastMatchEntry);
+    HotUrlManager::replace(_hotUrlMap.head(), lastMatchEntry);
   }
+
+  _hotUrlMap.clear();
+  HotUrlSketch::clear(gen);
 }
 
 void HotUrlStats::setDetect(const bool detect)
@@ -228,6 +220,10 @@ void HotUrlStats::setDetect(const bool detect)
       Debug(HOT_URLS_DEBUG_TAG, "disable hot url detect.");
     }
     else {
+      //the request path does not write the sketches while detect is off,
+      //drop what is left from the last time it was on
+      HotUrlSketch::clear(0);
+      HotUrlSketch::clear(1);
       Debug(HOT_URLS_DEBUG_TAG, "enable hot url detect.");
     }
     _detect = detect;
@@ -236,9 +232,7 @@ void HotUrlStats::setDetect(const bool detect)
 
 void HotUrlStats::setMaxCount(const uint32_t maxCount)
 {
-  for (int i=0; i<2; i++) {
-    _hotUrlMaps[i].getUrlQueue()->setMaxCount(maxCount);
-  }
+  _hotUrlMap.setMaxCount(maxCount);
 
   int oldMaxCount = _config.max_count;
   _config.max_count = maxCount;
@@ -305,6 +299,12 @@ int32_t HotUrlStats::getKeepTime()
 
 void HotUrlStats::init()
 {
+  REC_EstablishStaticConfigFloat(instance->_config.sketch_epsilon, "proxy.config.http.hoturls.sketch_epsilon");
+  REC_EstablishStaticConfigFloat(instance->_config.sketch_delta, "proxy.config.http.hoturls.sketch_delta");
+  REC_EstablishStaticConfigInt32(instance->_config.top_size, "proxy.config.http.hoturls.top_size");
+  HotUrlSketch::init(instance->_config.sketch_epsilon, instance->_config.sketch_delta,
+      instance->_config.top_size);
+
   int interval = (int)REC_ConfigReadInteger("proxy.config.http.hoturls.detect_interval_secs");
   instance->setDetectInverval(interval);
   REC_RegisterConfigUpdateFunc("proxy.config.http.hoturls.detect_interval_secs", configChangeCallback, NULL);
@@ -3,6 +3,7 @@
 
 #include "I_HotUrls.h"
 #include "HotUrlMap.h"
+#include "HotUrlSketch.h"
 
 #define HOT_URLS_DEBUG_TAG "hoturls"
 
@@ -19,12 +20,16 @@ struct HotUrlConfig {
   float detect_on_bps_ratio;
   float single_url_select_ratio;
   float multi_url_select_ratio;
+  float sketch_epsilon;
+  float sketch_delta;
+  int top_size;
   
   HotUrlConfig()
     : detect_type(HOT_URLS_DETECT_TYPE_BYTES), keep_time(0), max_count(0),
     detect_interval(HRTIME_SECONDS(1)), detect_on_bps(0),
     detect_on_bps_ratio(0.00), single_url_select_ratio(0.00),
-    multi_url_select_ratio(0.00)
+    multi_url_select_ratio(0.00), sketch_epsilon(0.002), sketch_delta(0.01),
+    top_size(64)
   {
   }
 };
@@ -51,10 +56,11 @@ class HotUrlStats {
         const int64_t bytes)
     {
       if (instance->_config.max_count > 0) {
-        ink_atomic_increment64(&instance->_total_send_bytes, bytes);
-        ink_atomic_increment64(&instance->_total_query_count, 1);
-        if (instance->_detect) {
-          instance->_currentHotUrlMap->incrementBytes(url, url_len, bytes);
+        HotUrlSketch *sketch = HotUrlSketch::get();
+        if (sketch != NULL) {
+          sketch->add(url, url_len, bytes,
+              (instance->_config.detect_type & HOT_URLS_DETECT_TYPE_BYTES) ? bytes : 1,
+              instance->_detect);
         }
       }
     }
@@ -98,14 +104,11 @@ class HotUrlStats {
     void doCalcHotUrls();
 
   private:
-    bool _detect;
-    volatile int64_t _total_send_bytes;
-    volatile int64_t _total_query_count;
+    volatile bool _detect;
     volatile int64_t _current_send_bps;
     volatile double _current_qps;
     HotUrlConfig _config;
-    HotUrlMap _hotUrlMaps[2];
-    HotUrlMap *_currentHotUrlMap;
+    HotUrlMap _hotUrlMap;
 };
 
 #endif
@@ -6,6 +6,9 @@
 #define DOT_INDEX  1
 #define VALID_CHAR_NUM   39
 
+//a radix trie node of more children indexes them by character
+#define RADIX_DENSE_CHILD_NUM   8
+
 template<typename T>
 class HostnameTrie
 {
@@ -106,6 +109,23 @@ class HostnameTrie
       }
     }
 
+    //the bytes of the allocated nodes
+    size_t memoryUsage() const {
+      return memoryUsage(&_root) - sizeof(TrieNode);
+    }
+
+    size_t memoryUsage(const TrieNode * node) const
+    {
+      size_t bytes = sizeof(TrieNode);
+      for (int i=0; i<VALID_CHAR_NUM; i++) {
+        if (node->children[i] != NULL) {
+          bytes += memoryUsage(node->children[i]);
+        }
+      }
+
+      return bytes;
+    }
+
   protected:
     int allocTrieNode(TrieNode ** node);
     void freeTrieNode(TrieNode * node);
@@ -116,10 +136,136 @@ class HostnameTrie
     DynamicArray<T *> _nodes;  //for getNodes
 };
 
-class HostnameTrieSet : public HostnameTrie<int>
+/*
+ * A path compressed HostnameTrie. An edge holds all the (reversed)
+ * characters down to the next node with a value or more than one child,
+ * so a node is allocated per hostname and per branch instead of per
+ * character. A node keeps a small array of its children and switches to
+ * an array indexed by character once it has more than
+ * RADIX_DENSE_CHILD_NUM of them. The lookups match the same way as
+ * HostnameTrie.
+ */
+template<typename T>
+class HostnameRadixTrie
+{
+  public:
+    HostnameRadixTrie() : _matchDomain(true), _memory(0) {
+      memset(&_root, 0, sizeof(_root));
+    }
+
+    HostnameRadixTrie(const bool matchDomain) : _matchDomain(matchDomain),
+      _memory(0)
+    {
+      memset(&_root, 0, sizeof(_root));
+    }
+
+    virtual ~HostnameRadixTrie() {
+      freeChildren(&_root);
+    }
+
+    bool insert(const char *hostname, const int hostname_len, T *value);
+
+    struct RadixNode {
+      T *value;
+      struct RadixNode *parent;
+      struct RadixNode **children;
+      unsigned short length;     //of the edge
+      unsigned char child_count;
+      bool dense;                //children indexed by character
+      char edge[1];              //the characters from the parent, last first
+    };
+
+    struct LookupState {
+      const unsigned char *p;
+      RadixNode * current_node;
+      int offset;                //the edge characters matched
+    };
+
+    T *lookupFirst(const char *hostname, const int hostname_len,
+        LookupState * state);
+    T *lookupNext(const char *hostname, const int hostname_len,
+        LookupState * state);
+    void print();
+
+    inline T *lookup(const char *hostname, const int hostname_len)
+    {
+      LookupState state;
+      return this->lookupFirst(hostname, hostname_len, &state);
+    }
+
+    T *lookupLast(const char *hostname, const int hostname_len)
+    {
+      LookupState state;
+      T *value;
+      T *lastValue;
+      value = this->lookupFirst(hostname, hostname_len, &state);
+      if (value == NULL) {
+        return NULL;
+      }
+
+      lastValue = value;
+      while ((value=this->lookupNext(hostname, hostname_len,
+              &state)) != NULL)
+      {
+        lastValue = value;
+      }
+
+      return lastValue;
+    }
+
+    bool empty() const {
+      return _root.child_count == 0;
+    }
+
+    T **getNodes(int *count) {
+      if (_nodes.count > 0) {
+        _nodes.count = 0;
+      }
+
+      getNodes(&_root);
+      *count = _nodes.count;
+      return _nodes.items;
+    }
+
+    void getNodes(RadixNode * node)
+    {
+      if (node->value != NULL) {
+        _nodes.add(node->value);
+      }
+
+      int count = node->dense ? VALID_CHAR_NUM : node->child_count;
+      for (int i=0; i<count; i++) {
+        if (node->children[i] != NULL) {
+          getNodes(node->children[i]);
+        }
+      }
+    }
+
+    //the bytes of the allocated nodes and child arrays
+    size_t memoryUsage() const {
+      return _memory;
+    }
+
+  protected:
+    RadixNode *allocRadixNode(const int length);
+    void freeChildren(RadixNode * node);
+    RadixNode *findChild(const RadixNode * node, const int index) const;
+    bool addChild(RadixNode * node, RadixNode * child);
+    void replaceChild(RadixNode * node, RadixNode * oldChild,
+        RadixNode * newChild);
+    int getHostname(const RadixNode * node, char *buff, const int size);
+    void print(RadixNode * node);
+
+    RadixNode _root;
+    bool _matchDomain;  //if match domain, taobao.com matchs taobao.com and *.taobao.com
+    size_t _memory;
+    DynamicArray<T *> _nodes;  //for getNodes
+};
+
+class HostnameTrieSet : public HostnameRadixTrie<int>
 {
   public:
-    HostnameTrieSet() : HostnameTrie<int>()
+    HostnameTrieSet() : HostnameRadixTrie<int>()
     {
     }
 
@@ -135,7 +281,7 @@ class HostnameTrieSet : public HostnameTrie<int>
     //for trie set, value is a flag only
     inline bool insert(const char *hostname, const int hostname_len)
     {
-      return HostnameTrie<int>::insert(hostname, hostname_len, (int *)1);
+      return HostnameRadixTrie<int>::insert(hostname, hostname_len, (int *)1);
     }
 
     //for trie set, value is a flag only
@@ -163,26 +309,17 @@ class HostnameTrieSet : public HostnameTrie<int>
   protected:
     DynamicArray<char *> _hosts;
 
-    void getHostnames(TrieNode * node)
+    void getHostnames(RadixNode * node)
     {
-      int i;
       if (node->value != NULL) {
         char buff[256];
-        TrieNode * temp;
-        char *p;
-
-        p = buff;
-        temp = node;
-        while (temp != NULL) {
-          *p++ = temp->c;
-          temp = temp->parent;
+        if (getHostname(node, buff, sizeof(buff)) > 0) {
+          _hosts.add(strdup(buff));
         }
-        *p = '\0';
-
-        _hosts.add(strdup(buff));
       }
 
-      for (i=0; i<VALID_CHAR_NUM; i++) {
+      int count = node->dense ? VALID_CHAR_NUM : node->child_count;
+      for (int i=0; i<count; i++) {
         if (node->children[i] != NULL) {
           getHostnames(node->children[i]);
         }
@@ -401,5 +538,336 @@ T *HostnameTrie<T>::lookupNext(const char *hostname, const int hostname_len,
     return NULL;
 }
 
+template<typename T>
+typename HostnameRadixTrie<T>::RadixNode *
+HostnameRadixTrie<T>::allocRadixNode(const int length)
+{
+    RadixNode *node;
+    int bytes = sizeof(RadixNode) + length;
+
+    node = (RadixNode *)malloc(bytes);
+    if (node == NULL) {
+        int result = errno != 0 ? errno : ENOMEM;
+        fprintf(stderr, "file: "__FILE__", line: %d, " \
+                "malloc %d bytes fail, errno: %d, error info: %s\n",
+                __LINE__, bytes, result, strerror(result));
+        return NULL;
+    }
+
+    memset(node, 0, sizeof(RadixNode));
+    node->length = length;
+    _memory += bytes;
+    return node;
+}
+
+template<typename T>
+void HostnameRadixTrie<T>::freeChildren(RadixNode * node)
+{
+    int count = node->dense ? VALID_CHAR_NUM : node->child_count;
+
+    for (int i=0; i<count; i++) {
+        if (node->children[i] != NULL) {
+            freeChildren(node->children[i]);
+            free(node->children[i]);
+        }
+    }
+
+    free(node->children);
+    node->children = NULL;
+    node->child_count = 0;
+}
+
+template<typename T>
+inline typename HostnameRadixTrie<T>::RadixNode *
+HostnameRadixTrie<T>::findChild(const RadixNode * node, const int index) const
+{
+    if (node->dense) {
+        return node->children[index];
+    }
+
+    for (int i=0; i<node->child_count; i++) {
+        if (_ascii2table[(unsigned char)node->children[i]->edge[0]] == index) {
+            return node->children[i];
+        }
+    }
+
+    return NULL;
+}
+
+template<typename T>
+bool HostnameRadixTrie<T>::addChild(RadixNode * node, RadixNode * child)
+{
+    int index = _ascii2table[(unsigned char)child->edge[0]];
+    RadixNode **children;
+
+    if (node->dense) {
+        node->children[index] = child;
+        node->child_count++;
+        return true;
+    }
+
+    if (node->child_count < RADIX_DENSE_CHILD_NUM) {
+        children = (RadixNode **)realloc(node->children,
+                sizeof(RadixNode *) * (node->child_count + 1));
+        if (children == NULL) {
+            return false;
+        }
+
+        _memory += sizeof(RadixNode *);
+        children[node->child_count++] = child;
+        node->children = children;
+        return true;
+    }
+
+    children = (RadixNode **)calloc(VALID_CHAR_NUM, sizeof(RadixNode *));
+    if (children == NULL) {
+        return false;
+    }
+
+    for (int i=0; i<node->child_count; i++) {
+        children[_ascii2table[(unsigned char)node->children[i]->edge[0]]] =
+            node->children[i];
+    }
+    children[index] = child;
+
+    _memory += sizeof(RadixNode *) * (VALID_CHAR_NUM - node->child_count);
+    free(node->children);
+    node->children = children;
+    node->child_count++;
+    node->dense = true;
+    return true;
+}
+
+template<typename T>
+void HostnameRadixTrie<T>::replaceChild(RadixNode * node,
+        RadixNode * oldChild, RadixNode * newChild)
+{
+    if (node->dense) {
+        node->children[_ascii2table[(unsigned char)oldChild->edge[0]]] = newChild;
+        return;
+    }
+
+    for (int i=0; i<node->child_count; i++) {
+        if (node->children[i] == oldChild) {
+            node->children[i] = newChild;
+            return;
+        }
+    }
+}
+
+template<typename T>
+bool HostnameRadixTrie<T>::insert(const char *hostname, const int hostname_len, T *value)
+{
+    const unsigned char *p;
+    RadixNode *current_node;
+    RadixNode *child;
+    int k;
+
+    if (hostname_len <= 0) {
+      return false;
+    }
+
+    for (p=(const unsigned char *)hostname; p<(const unsigned char *)hostname + hostname_len; p++) {
+        if (_ascii2table[*p] < 0) {
+            fprintf(stderr, "file: "__FILE__", line: %d, " \
+                    "invalid hostname: %s\n", __LINE__, hostname);
+            return false;
+        }
+    }
+
+    current_node = &_root;
+    p = (const unsigned char *)hostname + hostname_len - 1;
+    while (p >= (const unsigned char *)hostname) {
+        child = findChild(current_node, _ascii2table[*p]);
+        if (child == NULL) {
+            //the rest of the hostname is the edge of a new leaf
+            k = p - (const unsigned char *)hostname + 1;
+            if ((child=allocRadixNode(k)) == NULL) {
+                return false;
+            }
+
+            for (int i=0; i<k; i++) {
+                child->edge[i] = *(p - i);
+            }
+            child->parent = current_node;
+            if (!addChild(current_node, child)) {
+                _memory -= sizeof(RadixNode) + k;
+                free(child);
+                return false;
+            }
+
+            current_node = child;
+            break;
+        }
+
+        for (k=0; k<child->length && p >= (const unsigned char *)hostname &&
+                _ascii2table[*p] == _ascii2table[(unsigned char)child->edge[k]]; k++)
+        {
+            --p;
+        }
+
+        if (k < child->length) {
+            //split the edge where the hostname leaves it
+            RadixNode *middle = allocRadixNode(k);
+            if (middle == NULL) {
+                return false;
+            }
+
+            memcpy(middle->edge, child->edge, k);
+            middle->parent = current_node;
+            replaceChild(current_node, child, middle);
+
+            memmove(child->edge, child->edge + k, child->length - k);
+            child->length -= k;
+            child->parent = middle;
+            addChild(middle, child);
+            child = middle;
+        }
+
+        current_node = child;
+    }
+
+    if (current_node->value == NULL) {
+      current_node->value = value;
+    }
+    else {
+      fprintf(stderr, "file: "__FILE__", line: %d, " \
+          "Can not insert duplicate: %.*s!\n", __LINE__, hostname_len, hostname);
+      return false;
+    }
+
+    return true;
+}
+
+template<typename T>
+int HostnameRadixTrie<T>::getHostname(const RadixNode * node, char *buff,
+        const int size)
+{
+    char *p = buff;
+
+    for (; node != NULL; node = node->parent) {
+        if (p + node->length >= buff + size) {
+            return -1;
+        }
+
+        for (int i=node->length - 1; i>=0; i--) {
+            *p++ = node->edge[i];
+        }
+    }
+    *p = '\0';
+
+    return p - buff;
+}
+
+template<typename T>
+void HostnameRadixTrie<T>::print(RadixNode * node)
+{
+    if (node->value != NULL) {
+        char buff[256];
+        if (getHostname(node, buff, sizeof(buff)) > 0) {
+            printf("%s\n", buff);
+        }
+    }
+
+    int count = node->dense ? VALID_CHAR_NUM : node->child_count;
+    for (int i=0; i<count; i++) {
+        if (node->children[i] != NULL) {
+            print(node->children[i]);
+        }
+    }
+}
+
+template<typename T>
+void HostnameRadixTrie<T>::print()
+{
+    print(&_root);
+    printf("\n");
+}
+
+template<typename T>
+T *HostnameRadixTrie<T>::lookupFirst(const char *hostname, const int hostname_len,
+    HostnameRadixTrie::LookupState * state)
+{
+    if (hostname == NULL || hostname_len == 0) {
+        return NULL;
+    }
+
+    state->p = (const unsigned char *)hostname + hostname_len - 1;
+    state->current_node = &_root;
+    state->offset = 0;
+    return this->lookupNext(hostname, hostname_len, state);
+}
+
+template<typename T>
+T *HostnameRadixTrie<T>::lookupNext(const char *hostname, const int hostname_len,
+    HostnameRadixTrie::LookupState * state)
+{
+    RadixNode *node;
+    int index;
+
+    if (hostname == NULL || hostname_len == 0 ||
+            state->p < (const unsigned char *)hostname) {
+        return NULL;
+    }
+
+    node = state->current_node;
+    while (state->p >= (const unsigned char *)hostname) {
+        index = _ascii2table[*(state->p)];
+        if (index < 0) {
+            return NULL;
+        }
+
+        if (state->offset == node->length) {
+            if ((node=findChild(node, index)) == NULL) {
+                return NULL;
+            }
+
+            state->current_node = node;
+            state->offset = 0;
+        }
+
+        if (_ascii2table[(unsigned char)node->edge[state->offset]] != index) {
+            return NULL;
+        }
+
+        state->offset++;
+        if (state->offset == node->length && node->value != NULL &&
+                *(state->p) == '.')
+        {
+            state->p--;
+            return node->value;
+        }
+
+        state->p--;
+    }
+
+    if (state->offset == node->length) {
+      if (node->value != NULL) {
+        return node->value;
+      }
+
+      if (!_matchDomain) {
+        return NULL;
+      }
+
+      node = findChild(node, DOT_INDEX);
+      if (node != NULL && node->length == 1 && node->value != NULL) {
+        return node->value;
+      }
+
+      return NULL;
+    }
+
+    //the hostname ends inside an edge, only .hostname may match
+    if (_matchDomain && node->length - state->offset == 1 &&
+        node->edge[state->offset] == '.' && node->value != NULL)
+    {
+      return node->value;
+    }
+
+    return NULL;
+}
+
+
 #endif
 
@@ -135,7 +135,7 @@ RemapPlugins::run_single_remap()
   if (TSREMAP_NO_REMAP == plugin_retcode || TSREMAP_NO_REMAP_STOP == plugin_retcode) {
     if (_cur == 1) {  //first time
       Debug("url_rewrite", "plugin did not change host, port or path, copying from mapping rule");
-      rewrite_table->doRemap(_s->url_map, _request_url, false);
+      _s->url_rewrite->doRemap(_s->url_map, _request_url, false);
     }
   }
 
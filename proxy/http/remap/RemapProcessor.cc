@@ -43,7 +43,8 @@ RemapProcessor::start(int num_threads)
   Most of this comes from UrlRewrite::Remap(). Generally, all this does
   is set "map" to the appropriate entry from the global rewrite_table
   such that we will then have access to the correct url_mapping inside
-  perform_remap.
+  perform_remap. The table is pinned by the transaction until it ends,
+  a reload does not free it under url_map.
 
 */
 bool
@@ -58,13 +59,18 @@ RemapProcessor::setup_for_remap(HttpTransact::State *s)
   int request_port;
   bool proxy_request = false;
 
-  s->reverse_proxy = rewrite_table->reverse_proxy;
+  if (s->url_rewrite == NULL) {
+    s->url_rewrite = acquireUrlRewrite();
+  }
+  UrlRewrite *table = s->url_rewrite;
+
+  s->reverse_proxy = table->reverse_proxy;
   s->url_map.set(s->hdr_info.client_request.m_heap);
 
-  if (unlikely((rewrite_table->num_rules_forward == 0) &&
-               (rewrite_table->num_rules_forward_with_recv_port == 0))) {
-    ink_assert(rewrite_table->forward_mappings.empty() &&
-               rewrite_table->forward_mappings_with_recv_port.empty());
+  if (unlikely((table->num_rules_forward == 0) &&
+               (table->num_rules_forward_with_recv_port == 0))) {
+    ink_assert(table->forward_mappings.empty() &&
+               table->forward_mappings_with_recv_port.empty());
     Debug("url_rewrite", "[lookup] No forward mappings found; Skipping...");
     return false;
   }
@@ -89,22 +95,22 @@ RemapProcessor::setup_for_remap(HttpTransact::State *s)
 
   Debug("url_rewrite", "[lookup] attempting %s lookup", proxy_request ? "proxy" : "normal");
 
-  if (rewrite_table->num_rules_forward_with_recv_port) {
+  if (table->num_rules_forward_with_recv_port) {
     Debug("url_rewrite", "[lookup] forward mappings with recv port found; Using recv port %d",
           ats_ip_port_host_order(&s->client_info.addr));
-    if (rewrite_table->forwardMappingWithRecvPortLookup(request_url, ats_ip_port_host_order(&s->client_info.addr),
+    if (table->forwardMappingWithRecvPortLookup(request_url, ats_ip_port_host_order(&s->client_info.addr),
                                                          request_host, request_host_len, s->url_map)) {
       Debug("url_rewrite", "Found forward mapping with recv port");
       mapping_found = true;
-    } else if (rewrite_table->num_rules_forward == 0) {
-      ink_assert(rewrite_table->forward_mappings.empty());
+    } else if (table->num_rules_forward == 0) {
+      ink_assert(table->forward_mappings.empty());
       Debug("url_rewrite", "No forward mappings left");
       return false;
     }
   }
 
   if (!mapping_found) {
-    mapping_found = rewrite_table->forwardMappingLookup(request_url, request_port, request_host, request_host_len, s->url_map);
+    mapping_found = table->forwardMappingLookup(request_url, request_port, request_host, request_host_len, s->url_map);
   }
 
   if (!proxy_request) { // do extra checks on a server request
@@ -118,9 +124,9 @@ RemapProcessor::setup_for_remap(HttpTransact::State *s)
     // If no rules match and we have a host, check empty host rules since
     // they function as default rules for server requests.
     // If there's no host, we've already done this.
-    if (!mapping_found && rewrite_table->nohost_rules && request_host_len) {
+    if (!mapping_found && table->nohost_rules && request_host_len) {
       Debug("url_rewrite", "[lookup] nothing matched");
-      mapping_found = rewrite_table->forwardMappingLookup(request_url, 0, "", 0, s->url_map);
+      mapping_found = table->forwardMappingLookup(request_url, 0, "", 0, s->url_map);
     }
 
     if (mapping_found) {
@@ -199,7 +205,7 @@ RemapProcessor::finish_remap(HttpTransact::State *s)
   }
 
   // Do fast ACL filtering (it is safe to check map here)
-  if (rewrite_table->PerformACLFiltering(s, map) == ACL_ACTION_DENY_INT) {
+  if (s->url_rewrite->PerformACLFiltering(s, map) == ACL_ACTION_DENY_INT) {
     return false;
   }
 
@@ -325,12 +331,12 @@ RemapProcessor::finish_remap(HttpTransact::State *s)
         if (*redirect_url != NULL) {
           ats_free(*redirect_url);
         }
-        *redirect_url = ats_strdup(rewrite_table->http_default_redirect_url);
+        *redirect_url = ats_strdup(s->url_rewrite->http_default_redirect_url);
       }
 
       if (*redirect_url == NULL) {
         *redirect_url = ats_strdup(map->filter_redirect_url ? map->filter_redirect_url :
-                                   rewrite_table->http_default_redirect_url);
+                                   s->url_rewrite->http_default_redirect_url);
       }
 
       return false;
@@ -452,11 +458,12 @@ RemapProcessor::perform_remap(Continuation *cont, HttpTransact::State *s)
   }
 }
 
-bool RemapProcessor::findMapping(URL *request_url, UrlMappingContainer &url_map)
+bool RemapProcessor::findMapping(UrlRewrite *table, URL *request_url,
+    UrlMappingContainer &url_map)
 {
   bool mapping_found = false;
 
-  if (unlikely(rewrite_table->num_rules_forward == 0)) {
+  if (unlikely(table->num_rules_forward == 0)) {
     return false;
   }
 
@@ -467,15 +474,15 @@ bool RemapProcessor::findMapping(URL *request_url, UrlMappingContainer &url_map)
     return false;
   }
 
-  mapping_found = rewrite_table->forwardMappingLookup(request_url, request_url->port_get_raw(),
+  mapping_found = table->forwardMappingLookup(request_url, request_url->port_get_raw(),
       host, host_len, url_map);
 
-  if (!mapping_found && rewrite_table->reverse_proxy) { // do extra checks on a server request
+  if (!mapping_found && table->reverse_proxy) { // do extra checks on a server request
     // If no rules match and we have a host, check empty host rules since
     // they function as default rules for server requests.
     // If there's no host, we've already done this.
-    if (rewrite_table->nohost_rules && host_len > 0) {
-      mapping_found = rewrite_table->forwardMappingLookup(request_url, 0, "", 0, url_map);
+    if (table->nohost_rules && host_len > 0) {
+      mapping_found = table->forwardMappingLookup(request_url, 0, "", 0, url_map);
     }
   }
 
@@ -559,6 +566,7 @@ bool RemapProcessor::convert_cache_url(const char *in_url, const int in_url_len,
   UrlMappingContainer url_map(hdrHeap);
   URL old_url;
   int tmp_flags;
+  UrlRewrite *table = acquireUrlRewrite();
 
   *flags = 0;
   old_url.create(hdrHeap);
@@ -568,7 +576,7 @@ bool RemapProcessor::convert_cache_url(const char *in_url, const int in_url_len,
       break;
     }
 
-    found = findMapping(&old_url, url_map);
+    found = findMapping(table, &old_url, url_map);
     if (!found) {
       break;
     }
@@ -597,7 +605,7 @@ bool RemapProcessor::convert_cache_url(const char *in_url, const int in_url_len,
     }
 
     newURL = &old_url;
-    rewrite_table->doRemap(url_map, newURL, maintain_pristine_host_hdr);
+    table->doRemap(url_map, newURL, maintain_pristine_host_hdr);
     if (mapping->cache_url_convert_plugin_count == 0) {
       newURL->string_get_buf(out_url, out_url_size, out_url_len);
       if (*out_url_len == out_url_size) {
@@ -669,6 +677,7 @@ bool RemapProcessor::convert_cache_url(const char *in_url, const int in_url_len,
 
   old_url.clear();
   hdrHeap->destroy();
+  releaseUrlRewrite(table);
 
   if (!found) {
     *out_url = '\0';
@@ -62,7 +62,8 @@ public:
 
   static void bindUrlBuffer(struct URLPartsBuffer *urlBuffer, RemapUrlInfo *urlInfo);
   static bool copyFromUrl(URL *srcUrl, RemapUrlInfo *destUrl);
-  static bool findMapping(URL *request_url, UrlMappingContainer &url_map);
+  static bool findMapping(UrlRewrite *table, URL *request_url,
+      UrlMappingContainer &url_map);
   static bool convert_cache_url(const char *in_url, const int in_url_len,
       char *out_url, const int out_url_size, int *out_url_len, int *flags);
 private:
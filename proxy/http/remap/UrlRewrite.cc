@@ -98,14 +98,14 @@ get_real_path(const char *lpath, char *buf, int bufsize)
 //
 // CTOR / DTOR for the UrlRewrite class.
 //
-UrlRewrite::UrlRewrite(const char *file_var_in)
- : nohost_rules(0), reverse_proxy(0), backdoor_enabled(0),
+UrlRewrite::UrlRewrite(const char *file_var_in, UrlRewrite *prev)
+ : epoch(0), nohost_rules(0), reverse_proxy(0), backdoor_enabled(0),
    mgmt_autoconf_port(0), default_to_pac(0), default_to_pac_port(0),
    file_var(NULL), ts_name(NULL), http_default_redirect_url(NULL),
    num_rules_forward(0), num_rules_reverse(0),
    num_rules_redirect_permanent(0), num_rules_redirect_temporary(0),
    num_rules_forward_with_recv_port(0), _valid(false),
-   _oldDefineCheckers(NULL)
+   _oldDefineCheckers(NULL), _defineCheckers(NULL), _prev(prev)
 {
   char *config_file = NULL;
 
@@ -149,7 +149,9 @@ UrlRewrite::UrlRewrite(const char *file_var_in)
   ink_strlcat(config_file_path, config_file, sizeof(config_file_path));
   ats_free(config_file);
 
-  if (0 == this->BuildTable()) {
+  int result = this->BuildTable();
+  _prev = NULL;
+  if (0 == result) {
     _valid = true;
     /*
     pcre_malloc = &ats_malloc;
@@ -179,6 +181,7 @@ UrlRewrite::~UrlRewrite()
   DestroyStore(forward_mappings_with_recv_port);
 
   ACLDefineManager::freeDefineCheckers(_oldDefineCheckers);
+  ACLDefineManager::freeDefineCheckers(_defineCheckers);
 
   _valid = false;
 }
@@ -324,8 +327,16 @@ UrlRewrite::PrintStore(MappingsStore &store)
   if (!store.regex_list.empty()) {
     printf("    regex_list_min_rank: %d, Regex mappings:\n",
         store.regex_list_min_rank);
+    int index = 0;
     forl_LL(UrlMappingRegexMatcher, list_iter, store.regex_list) {
+      const char *factor;
+      int factor_len;
+
       list_iter->getMapping()->Print();
+      factor = store.regex_set->factor(index++, &factor_len);
+      if (factor != NULL) {
+        printf("\tliteral factor: %.*s\n", factor_len, factor);
+      }
     }
   }
 }
@@ -775,7 +786,7 @@ bool UrlRewrite::_convertToSuffix(MappingsStore &store,
       request_host_key, sizeof(request_host_key));
 
   if (store.suffix_trie == NULL) {
-    store.suffix_trie = new HostnameTrie<SuffixMappings>(false);
+    store.suffix_trie = new HostnameRadixTrie<SuffixMappings>(false);
   }
   else {
     oldSuffixMappings = store.suffix_trie->lookupLast(
@@ -872,16 +883,20 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping,
     }
     if (!suffix) {
       UrlMappingRegexMatcher* reg_map;
+      const char *pattern;
+      int pattern_len;
       bool ok;
       reg_map = NEW(new UrlMappingRegexMatcher(new_mapping));
       if (new_mapping->isFullRegex() || (new_mapping->regex_type & REGEX_TYPE_PATH) != 0)
       {
         ok = _processUrlMappingFullRegex(reg_map);
+        pattern = new_mapping->getRawFromUrl(&pattern_len);
         Debug("url_rewrite_regex", "Configured regex rule for url [%.*s]",
             new_mapping->fromURL.length_get(), new_mapping->fromURL.string_get_ref());
       }
       else {
         ok = _processUrlMappingHostRegex(src_host, reg_map);
+        pattern = src_host;
         Debug("url_rewrite_regex", "Configured regex rule for host [%s]", src_host);
       }
 
@@ -892,6 +907,11 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping,
       }
       store.regex_list.enqueue(reg_map);
 
+      if (store.regex_set == NULL) {
+        store.regex_set = NEW(new RegexSet());
+      }
+      store.regex_set->add(pattern);
+
       if (store.regex_list_min_rank < 0) {
         store.regex_list_min_rank = new_mapping->getRank();
       }
@@ -907,6 +927,186 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping,
   return retval;
 }
 
+mapping_type
+UrlRewrite::_getMappingType(const MappingEntry *mappingEntry)
+{
+  int mappingFlags = mappingEntry->getFlags();
+
+  if (mappingEntry->getType() == MAPPING_TYPE_MAP) {
+    if ((mappingFlags & MAP_FLAG_REVERSE) != 0) {
+      Debug("url_rewrite", "[BuildTable] - REVERSE_MAP");
+      return REVERSE_MAP;
+    }
+    else if ((mappingFlags & MAP_FLAG_WITH_RECV_PORT) != 0) {
+      Debug("url_rewrite", "[BuildTable] - FORWARD_MAP_WITH_RECV_PORT");
+      return FORWARD_MAP_WITH_RECV_PORT;
+    }
+    else {
+      //Debug("url_rewrite", "[BuildTable] - FORWARD_MAP");
+      return FORWARD_MAP;
+    }
+  }
+  else {
+    if ((mappingFlags & REDIRECT_FALG_TEMPORARY) != 0) {
+      Debug("url_rewrite", "[BuildTable] - TEMPORARY_REDIRECT");
+      return TEMPORARY_REDIRECT;
+    }
+    else {
+      Debug("url_rewrite", "[BuildTable] - PERMANENT_REDIRECT");
+      return PERMANENT_REDIRECT;
+    }
+  }
+}
+
+UrlRewrite::MappingsStore *
+UrlRewrite::_getStore(const mapping_type maptype)
+{
+  switch (maptype) {
+    case REVERSE_MAP:
+      return &reverse_mappings;
+    case PERMANENT_REDIRECT:
+      return &permanent_redirects;
+    case TEMPORARY_REDIRECT:
+      return &temporary_redirects;
+    case FORWARD_MAP_WITH_RECV_PORT:
+      return &forward_mappings_with_recv_port;
+    default:
+      return &forward_mappings;
+  }
+}
+
+/**
+  Computes the md5 of the mapping entries of each store, in the order of
+  the config, and whether the store could be taken by the next table: its
+  entries must have no plugins, acls or configs, which are loaded for one
+  table, and no tunnel source, which is resolved at load time. The ranks
+  are left out since they only order the mappings of a store.
+
+*/
+void
+UrlRewrite::_digestStores(const DynamicArray<MappingEntry *> &mappings)
+{
+  MappingsStore *stores[] = {&forward_mappings, &reverse_mappings,
+    &permanent_redirects, &temporary_redirects, &forward_mappings_with_recv_port};
+  const int store_count = sizeof(stores) / sizeof(stores[0]);
+  INK_DIGEST_CTX contexts[store_count];
+  // the forward store gets the backdoor and PAC mappings from these
+  int globals[] = {backdoor_enabled, default_to_pac, default_to_pac_port, mgmt_autoconf_port};
+  MappingEntry *mappingEntry;
+  MappingsStore *store;
+  int fields[4];
+  int k;
+
+  for (k = 0; k < store_count; k++) {
+    ink_code_incr_md5_init(contexts + k);
+    ink_code_incr_md5_update(contexts + k, (const char *)globals, sizeof(globals));
+    stores[k]->reusable = true;
+  }
+
+  for (int i=0; i<mappings.count; i++) {
+    mappingEntry = mappings.items[i];
+    store = _getStore(_getMappingType(mappingEntry));
+    for (k = 0; stores[k] != store; k++);
+
+    fields[0] = mappingEntry->getType();
+    fields[1] = mappingEntry->getFlags();
+    fields[2] = mappingEntry->getFromUrl()->length;
+    fields[3] = mappingEntry->getToUrl()->length;
+    ink_code_incr_md5_update(contexts + k, (const char *)fields, sizeof(fields));
+    ink_code_incr_md5_update(contexts + k, mappingEntry->getFromUrl()->str, fields[2]);
+    ink_code_incr_md5_update(contexts + k, mappingEntry->getToUrl()->str, fields[3]);
+
+    if (mappingEntry->hasChildren() || (fields[2] >= URL_LEN_TUNNEL &&
+          strncasecmp(mappingEntry->getFromUrl()->str, URL_SCHEME_TUNNEL, URL_LEN_TUNNEL) == 0))
+    {
+      store->reusable = false;
+    }
+  }
+
+  for (k = 0; k < store_count; k++) {
+    ink_code_incr_md5_final((char *)stores[k]->digest, contexts + k);
+  }
+}
+
+/**
+  Marks store as adopted, its entries not to be built, when the store of
+  the previous table has the same entries and can be moved to this table.
+
+*/
+void
+UrlRewrite::_checkAdoptable(MappingsStore &store, MappingsStore &prevStore,
+    const int prevCount)
+{
+  if (store.reusable && prevStore.reusable && !prevStore.adopted && prevCount > 0 &&
+      memcmp(store.digest, prevStore.digest, sizeof(store.digest)) == 0)
+  {
+    store.adopted = true;
+    store.hash_lookup = ink_hash_table_destroy(store.hash_lookup);
+  }
+}
+
+/**
+  Moves the lookup structures of the previous table to an adopted store,
+  once the table is built. The url_mappings stay where they are, so the
+  requests still using the previous table see no change.
+
+*/
+void
+UrlRewrite::_adoptStore(MappingsStore &store, int &count,
+    MappingsStore &prevStore, const int prevCount)
+{
+  if (!store.adopted) {
+    return;
+  }
+
+  Debug("url_rewrite", "[BuildTable] taking %d unchanged rules from the previous table", prevCount);
+  store = prevStore;
+  store.adopted = false;
+  prevStore.adopted = true;
+  count = prevCount;
+}
+
+/**
+  Gives prev, the closest older table not freed yet, what it still uses
+  of this table, so that this table can be freed first: the stores this
+  table took from prev and, when prev is the table this one replaced,
+  the ACL defines of prev.
+
+*/
+void
+UrlRewrite::handOver(UrlRewrite *prev)
+{
+  _handOverStore(forward_mappings, prev->forward_mappings);
+  _handOverStore(reverse_mappings, prev->reverse_mappings);
+  _handOverStore(permanent_redirects, prev->permanent_redirects);
+  _handOverStore(temporary_redirects, prev->temporary_redirects);
+  _handOverStore(forward_mappings_with_recv_port, prev->forward_mappings_with_recv_port);
+
+  if (prev->epoch == epoch - 1) {
+    ink_assert(prev->_defineCheckers == NULL);
+    prev->_defineCheckers = _oldDefineCheckers;
+    _oldDefineCheckers = NULL;
+  }
+}
+
+/**
+  Moves the lookup structures of store back to prevStore when store took
+  them from prevStore, possibly through tables freed already.
+
+*/
+void
+UrlRewrite::_handOverStore(MappingsStore &store, MappingsStore &prevStore)
+{
+  if (!store.adopted && prevStore.adopted && !prevStore.empty() &&
+      store.hash_lookup == prevStore.hash_lookup &&
+      store.suffix_trie == prevStore.suffix_trie &&
+      store.regex_list.head == prevStore.regex_list.head)
+  {
+    store.adopted = true;
+    prevStore.adopted = false;
+  }
+}
+
 /**
   Reads the configuration file and creates a new hash table.
 
@@ -997,6 +1197,25 @@ UrlRewrite::BuildTable()
     printf("mapping count after regex range expand: %d\n", mappings.count);
   }
 
+  _digestStores(mappings);
+  if (_prev != NULL) {
+    int incremental_reload = 1;
+    REVERSE_ReadConfigInteger(incremental_reload, "proxy.config.url_remap.incremental_reload");
+    if (!incremental_reload) {
+      _prev = NULL;
+    }
+  }
+  if (_prev != NULL) {
+    _checkAdoptable(forward_mappings, _prev->forward_mappings, _prev->num_rules_forward);
+    _checkAdoptable(reverse_mappings, _prev->reverse_mappings, _prev->num_rules_reverse);
+    _checkAdoptable(permanent_redirects, _prev->permanent_redirects,
+        _prev->num_rules_redirect_permanent);
+    _checkAdoptable(temporary_redirects, _prev->temporary_redirects,
+        _prev->num_rules_redirect_temporary);
+    _checkAdoptable(forward_mappings_with_recv_port, _prev->forward_mappings_with_recv_port,
+        _prev->num_rules_forward_with_recv_port);
+  }
+
   HttpConfigParams *httpConfig = HttpConfig::acquire();
   if (httpConfig == NULL) {
     Warning("HttpConfig::acquire() fail");
@@ -1006,30 +1225,9 @@ UrlRewrite::BuildTable()
   for (int i=0; i<mappings.count; i++) {
     mappingEntry = mappings.items[i];
     mappingFlags = mappingEntry->getFlags();
-
-    if (mappingEntry->getType() == MAPPING_TYPE_MAP) {
-      if ((mappingFlags & MAP_FLAG_REVERSE) != 0) {
-        Debug("url_rewrite", "[BuildTable] - REVERSE_MAP");
-        maptype = REVERSE_MAP;
-      }
-      else if ((mappingFlags & MAP_FLAG_WITH_RECV_PORT) != 0) {
-        Debug("url_rewrite", "[BuildTable] - FORWARD_MAP_WITH_RECV_PORT");
-        maptype = FORWARD_MAP_WITH_RECV_PORT;
-      }
-      else {
-        //Debug("url_rewrite", "[BuildTable] - FORWARD_MAP");
-        maptype = FORWARD_MAP;
-      }
-    }
-    else {
-      if ((mappingFlags & REDIRECT_FALG_TEMPORARY) != 0) {
-        Debug("url_rewrite", "[BuildTable] - TEMPORARY_REDIRECT");
-        maptype = TEMPORARY_REDIRECT;
-      }
-      else {
-        Debug("url_rewrite", "[BuildTable] - PERMANENT_REDIRECT");
-        maptype = PERMANENT_REDIRECT;
-      }
+    maptype = _getMappingType(mappingEntry);
+    if (_getStore(maptype)->adopted) {
+      continue;  //the store of the previous table is taken as it is
     }
 
     new_mapping = NEW(new url_mapping(mappingEntry->getRank()));  // use line # for rank for now
@@ -1277,8 +1475,8 @@ UrlRewrite::BuildTable()
 
   // Add the mapping for backdoor urls if enabled.
   // This needs to be before the default PAC mapping for ""
-  // since this is more specific
-  if (unlikely(backdoor_enabled)) {
+  // since this is more specific. An adopted forward store has them already.
+  if (unlikely(backdoor_enabled) && !forward_mappings.adopted) {
     new_mapping = SetupBackdoorMapping();
     if (TableInsert(forward_mappings.hash_lookup, new_mapping, "")) {
       num_rules_forward++;
@@ -1289,7 +1487,7 @@ UrlRewrite::BuildTable()
   }
   // Add the default mapping to the manager PAC file
   //  if we need it
-  if (default_to_pac) {
+  if (default_to_pac && !forward_mappings.adopted) {
     new_mapping = SetupPacMapping();
     if (TableInsert(forward_mappings.hash_lookup, new_mapping, "")) {
       num_rules_forward++;
@@ -1299,6 +1497,19 @@ UrlRewrite::BuildTable()
     }
   }
 
+  if (_prev != NULL) {
+    _adoptStore(forward_mappings, num_rules_forward,
+        _prev->forward_mappings, _prev->num_rules_forward);
+    _adoptStore(reverse_mappings, num_rules_reverse,
+        _prev->reverse_mappings, _prev->num_rules_reverse);
+    _adoptStore(permanent_redirects, num_rules_redirect_permanent,
+        _prev->permanent_redirects, _prev->num_rules_redirect_permanent);
+    _adoptStore(temporary_redirects, num_rules_redirect_temporary,
+        _prev->temporary_redirects, _prev->num_rules_redirect_temporary);
+    _adoptStore(forward_mappings_with_recv_port, num_rules_forward_with_recv_port,
+        _prev->forward_mappings_with_recv_port, _prev->num_rules_forward_with_recv_port);
+  }
+
   // Destroy unused tables
   if (num_rules_forward == 0) {
     forward_mappings.hash_lookup = ink_hash_table_destroy(forward_mappings.hash_lookup);
@@ -1325,6 +1536,12 @@ UrlRewrite::BuildTable()
       forward_mappings_with_recv_port.hash_lookup);
   }
 
+  _compileRegexList(forward_mappings);
+  _compileRegexList(reverse_mappings);
+  _compileRegexList(permanent_redirects);
+  _compileRegexList(temporary_redirects);
+  _compileRegexList(forward_mappings_with_recv_port);
+
   return 0;
 }
 
@@ -1564,7 +1781,7 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
 
   if (!mappings.regex_list.empty() && (rank_ceiling < 0 ||
         rank_ceiling > mappings.regex_list_min_rank) &&
-      _regexMappingLookup(mappings.regex_list, request_url, request_port,
+      _regexMappingLookup(mappings, request_url, request_port,
         request_host_lower, request_host_len, rank_ceiling,
         mapping_container))
   {
@@ -1633,7 +1850,7 @@ bool UrlRewrite::_setToUrlHostname(const SuffixMappings *suffixMappings,
 }
 
 bool
-UrlRewrite::_suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
+UrlRewrite::_suffixMappingLookup(HostnameRadixTrie<SuffixMappings> *suffix_trie,
     URL *request_url, const char *request_host, const int request_host_len,
     const char *request_host_key, int host_key_len,
     UrlMappingContainer &mapping_container)
@@ -1641,7 +1858,7 @@ UrlRewrite::_suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
   url_mapping *um = NULL;
   url_mapping *found;
 
-  HostnameTrie<SuffixMappings>::LookupState state;
+  HostnameRadixTrie<SuffixMappings>::LookupState state;
   SuffixMappings *suffixMappings = NULL;
   SuffixMappings *suffixFound;
 
@@ -1667,7 +1884,7 @@ UrlRewrite::_suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
 }
 
 bool
-UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *request_url, int request_port,
+UrlRewrite::_regexMappingLookup(MappingsStore &store, URL *request_url, int request_port,
                                 const char *request_host, int request_host_len, int rank_ceiling,
                                 UrlMappingContainer &mapping_container)
 {
@@ -1703,8 +1920,42 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
   int match_result;
   int query_len = -1;
 
-  // Loop over the entire linked list, or until we're satisfied
-  forl_LL(UrlMappingRegexMatcher, list_iter, regex_mappings) {
+  // Only the regexes whose literal factor is in the request are candidates,
+  // the host is a part of both urls
+  RegexSet *regex_set = store.regex_set;
+  uint64_t *candidates = (uint64_t *)alloca(regex_set->bitmap_size());
+  regex_set->reset(candidates);
+  if (store.regex_match_url) {
+    req_url_without_port_len = snprintf(req_url_without_port,
+        sizeof(req_url_without_port), "%.*s://%.*s/%.*s",
+        request_scheme_len, request_scheme,
+        request_host_len, request_host,
+        request_path_len, request_path);
+    if (req_url_without_port_len >= (int)sizeof(req_url_without_port)) {
+      req_url_without_port_len = sizeof(req_url_without_port) - 1;
+    }
+    regex_set->scan(req_url_without_port, req_url_without_port_len, candidates);
+  }
+  if (store.regex_match_url_with_port) {
+    req_url_with_port_len = snprintf(req_url_with_port,
+        sizeof(req_url_with_port), "%.*s://%.*s:%d/%.*s",
+        request_scheme_len, request_scheme,
+        request_host_len, request_host, request_port,
+        request_path_len, request_path);
+    if (req_url_with_port_len >= (int)sizeof(req_url_with_port)) {
+      req_url_with_port_len = sizeof(req_url_with_port) - 1;
+    }
+    regex_set->scan(req_url_with_port, req_url_with_port_len, candidates);
+  }
+  if (!store.regex_match_url && !store.regex_match_url_with_port) {
+    regex_set->scan(request_host, request_host_len, candidates);
+  }
+
+  // Loop over the candidates in rank order, or until we're satisfied
+  for (int index = regex_set->next(candidates, -1); index >= 0;
+      index = regex_set->next(candidates, index))
+  {
+    UrlMappingRegexMatcher *list_iter = store.regex_matchers[index];
     url_mapping *mapping = list_iter->getMapping();
     int reg_map_rank = mapping->getRank();
 
@@ -1772,26 +2023,10 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
       }
 
       if (mapping->fromURL.port_get_raw() == 0) {
-        if (req_url_without_port_len < 0) { //lazy load
-          req_url_without_port_len = snprintf(req_url_without_port,
-              sizeof(req_url_without_port), "%.*s://%.*s/%.*s",
-              request_scheme_len, request_scheme,
-              request_host_len, request_host,
-              request_path_len, request_path);
-        }
-
         req_url_str = req_url_without_port;
         input_url_len = req_url_without_port_len;
       }
       else {
-        if (req_url_with_port_len < 0) {  //lazy load
-          req_url_with_port_len = snprintf(req_url_with_port,
-              sizeof(req_url_with_port), "%.*s://%.*s:%d/%.*s",
-              request_scheme_len, request_scheme,
-              request_host_len, request_host, request_port,
-              request_path_len, request_path);
-        }
-
         req_url_str = req_url_with_port;
         input_url_len = req_url_with_port_len;
       }
@@ -1830,6 +2065,39 @@ UrlRewrite::_regexMappingLookup(UrlMappingRegexList &regex_mappings, URL *reques
   return retval;
 }
 
+/** builds the literal factor prefilter of the regex list of store, once
+    all the regex mappings of the store are added. The url strings a
+    request is matched against are scanned only if some regex uses them.
+*/
+void
+UrlRewrite::_compileRegexList(MappingsStore &store)
+{
+  int index = 0;
+
+  if (store.regex_set == NULL || store.regex_matchers != NULL) {
+    return;  //no regex, or compiled in the table the store comes from
+  }
+
+  store.regex_matchers = (UrlMappingRegexMatcher **)ats_malloc(
+      sizeof(UrlMappingRegexMatcher *) * store.regex_set->count());
+  forl_LL(UrlMappingRegexMatcher, list_iter, store.regex_list) {
+    url_mapping *mapping = list_iter->getMapping();
+
+    store.regex_matchers[index++] = list_iter;
+    if (mapping->regex_type != REGEX_TYPE_HOST) {
+      if (mapping->fromURL.port_get_raw() == 0) {
+        store.regex_match_url = true;
+      }
+      else {
+        store.regex_match_url_with_port = true;
+      }
+    }
+  }
+  ink_release_assert(index == store.regex_set->count());
+
+  store.regex_set->compile();
+}
+
 void
 UrlRewrite::_destroyList(UrlMappingRegexList &mappings)
 {
@@ -64,7 +64,7 @@ enum mapping_type
 class UrlRewrite
 {
 public:
-  UrlRewrite(const char *file_var_in);
+  UrlRewrite(const char *file_var_in, UrlRewrite *prev = NULL);
   ~UrlRewrite();
   int BuildTable();
   mapping_type Remap_redirect(HTTPHdr * request_header, URL *redirect_url);
@@ -73,6 +73,7 @@ public:
   void Print();
   inline bool is_valid() const { return _valid; };
   void doRemap(UrlMappingContainer &mapping_container, URL *request_url, const bool pristine_host_hdr);
+  void handOver(UrlRewrite *prev);
 
 //  private:
 
@@ -91,14 +92,24 @@ public:
   struct MappingsStore
   {
     InkHashTable *hash_lookup; //key format is hostname:port:scheme
-    HostnameTrie<SuffixMappings> *suffix_trie;  //key format is hostname:port:scheme
+    HostnameRadixTrie<SuffixMappings> *suffix_trie;  //key format is hostname:port:scheme
     UrlMappingRegexList regex_list;
+    RegexSet *regex_set;  //literal factor prefilter of regex_list
+    UrlMappingRegexMatcher **regex_matchers;  //regex_list by index in regex_set
+    bool regex_match_url;            //some regex match the url without port
+    bool regex_match_url_with_port;  //some regex match the url with port
     int suffix_trie_min_rank;
     int regex_list_min_rank;
+    unsigned char digest[16];  //md5 of the mapping entries of the store
+    bool reusable;  //no entry has plugins, acls, configs or a tunnel source
+    bool adopted;   //the lookup structures belong to another table
 
     MappingsStore() : hash_lookup(NULL), suffix_trie(NULL),
-      suffix_trie_min_rank(-1), regex_list_min_rank(-1)
+      regex_set(NULL), regex_matchers(NULL), regex_match_url(false),
+      regex_match_url_with_port(false), suffix_trie_min_rank(-1),
+      regex_list_min_rank(-1), reusable(false), adopted(false)
     {
+      memset(digest, 0, sizeof(digest));
     }
 
     bool empty() {
@@ -114,9 +125,20 @@ public:
 
   void DestroyStore(MappingsStore &store)
   {
+    if (store.adopted) {
+      return;
+    }
+
     _destroyTable(store.hash_lookup);
     _destroyList(store.regex_list);
 
+    if (store.regex_set != NULL) {
+      delete store.regex_set;
+      store.regex_set = NULL;
+    }
+    ats_free(store.regex_matchers);
+    store.regex_matchers = NULL;
+
     if (store.suffix_trie != NULL) {
       int count;
       SuffixMappings **suffixMappings = store.suffix_trie->getNodes(&count);
@@ -171,6 +193,7 @@ public:
   int load_remap_plugin(const PluginInfo *plugin, const MappingEntry *mappingEntry,
       url_mapping *mp, char *errbuf, int errbufsize);
 
+  int epoch;  //generation of the table, see acquireUrlRewrite()
   int nohost_rules;
   int reverse_proxy;
   int backdoor_enabled;
@@ -195,6 +218,17 @@ public:
 private:
   bool _valid;
   DynamicArray<ACLDefineChecker *> *_oldDefineCheckers;  //for relay delete
+  DynamicArray<ACLDefineChecker *> *_defineCheckers;  //of this table, handed over by the next one
+  UrlRewrite *_prev;  //the table to take the unchanged stores from
+
+  mapping_type _getMappingType(const MappingEntry *mappingEntry);
+  MappingsStore *_getStore(const mapping_type maptype);
+  void _digestStores(const DynamicArray<MappingEntry *> &mappings);
+  void _checkAdoptable(MappingsStore &store, MappingsStore &prevStore,
+      const int prevCount);
+  void _adoptStore(MappingsStore &store, int &count,
+      MappingsStore &prevStore, const int prevCount);
+  void _handOverStore(MappingsStore &store, MappingsStore &prevStore);
 
   bool _mappingLookup(MappingsStore &mappings, URL *request_url,
       int request_port, const char *request_host,
@@ -203,13 +237,13 @@ private:
   url_mapping *_tableLookup(InkHashTable * h_table, URL * request_url,
     char *request_host_key, UrlMappingContainer &mapping_container);
 
-  bool _suffixMappingLookup(HostnameTrie<SuffixMappings> *suffix_trie,
+  bool _suffixMappingLookup(HostnameRadixTrie<SuffixMappings> *suffix_trie,
     URL *request_url, const char *request_host, const int request_host_len,
     const char *request_host_key, int host_key_len,
     UrlMappingContainer &mapping_container);
 
 
-  bool _regexMappingLookup(UrlMappingRegexList &regex_mappings,
+  bool _regexMappingLookup(MappingsStore &store,
       URL * request_url, int request_port, const char *request_host,
       int request_host_len, int rank_ceiling,
       UrlMappingContainer &mapping_container);
@@ -221,6 +255,7 @@ private:
 
   void _destroyTable(InkHashTable *h_table);
   void _destroyList(UrlMappingRegexList &regexes);
+  void _compileRegexList(MappingsStore &store);
 
   inline bool _addToStore(MappingsStore &store, url_mapping *new_mapping, char *src_host,
                           int &count);
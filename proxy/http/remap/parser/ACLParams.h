@@ -321,6 +321,13 @@ class ACLActionParams : public DirectiveParams {
     int parse(const char *blockStart, const char *blockEnd);
 
   public:
+    void shiftRank(const int inc) {
+      DirectiveParams::shiftRank(inc);
+      if (_actionParams != NULL) {
+        _actionParams->shiftRank(inc);
+      }
+    }
+
     inline int getAction() const {
       return _action;
     }
@@ -48,6 +48,36 @@ DirectiveParams::~DirectiveParams()
   }
 }
 
+void DirectiveParams::shiftRank(const int inc)
+{
+  DirectiveParams *child;
+
+  _rank += inc;
+  for (child=_children.head; child!=NULL; child=child->_next) {
+    child->shiftRank(inc);
+  }
+}
+
+void DirectiveParams::moveChildrenTo(DirectiveParams *parent,
+    const int rankOffset)
+{
+  DirectiveParams *child;
+  DirectiveParams *next;
+
+  child = _children.head;
+  while (child != NULL) {
+    next = child->_next;
+    child->_next = NULL;
+    child->_parent = parent;
+    child->shiftRank(rankOffset);
+    parent->addChild(child);
+    child = next;
+  }
+
+  _children.head = NULL;
+  _children.tail = NULL;
+}
+
 int DirectiveParams::init()
 {
   const char *p;
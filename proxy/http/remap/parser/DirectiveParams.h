@@ -122,6 +122,13 @@ class DirectiveParams {
       _rank += inc;
     }
 
+    //shift the rank of this params and all its descendants
+    virtual void shiftRank(const int inc);
+
+    //move the children to the end of parent's children, used to append
+    //a file parsed apart, its ranks shifted by rankOffset
+    void moveChildrenTo(DirectiveParams *parent, const int rankOffset);
+
     inline const LineInfo *getLineInfo() const {
       return &_lineInfo;
     }
@@ -12,17 +12,12 @@
 RemapDirective::RemapDirective(const char *name, const int type,
     const int minParamCount, const int maxParamCount) : _name(name),
   _type(type), _minParamCount(minParamCount), _maxParamCount(maxParamCount),
-  _childrenCount(0), _forSearchChild(NULL)
+  _childrenCount(0)
 {
 }
 
 RemapDirective::~RemapDirective()
 {
-  if (_forSearchChild != NULL) {
-    delete _forSearchChild;
-    _forSearchChild = NULL;
-  }
-
   //fprintf(stderr, "destroy directive: %s\n", _name);
 
   if (_childrenCount > 0) {
@@ -52,18 +47,23 @@ static int compare(const void *p1, const void *p2)
       (*((RemapDirective **)p2))->getName());
 }
 
-RemapDirective *RemapDirective::getChild(const char *name)
+//sort the whole directive tree once before parsing, so getChild does
+//not write anything and include files can be parsed in parallel
+void RemapDirective::sortChildren()
 {
-  if (_forSearchChild == NULL) {
-    _forSearchChild = new RemapDirective(name, DIRECTIVE_TYPE_NONE, 0, 0);
-    qsort(_children, _childrenCount, sizeof(RemapDirective *), compare);
-  }
-  else {
-    _forSearchChild->_name = name;
+  qsort(_children, _childrenCount, sizeof(RemapDirective *), compare);
+  for (int i=0; i<_childrenCount; i++) {
+    _children[i]->sortChildren();
   }
+}
+
+RemapDirective *RemapDirective::getChild(const char *name)
+{
+  RemapDirective forSearchChild(name, DIRECTIVE_TYPE_NONE, 0, 0);
+  RemapDirective *pForSearchChild = &forSearchChild;
 
   RemapDirective **found;
-  found = (RemapDirective **)bsearch(&_forSearchChild, _children,
+  found = (RemapDirective **)bsearch(&pForSearchChild, _children,
       _childrenCount, sizeof(RemapDirective *), compare);
   if (found != NULL) {
     return *found;
@@ -80,13 +80,13 @@ class RemapDirective {
 
   protected:
     RemapDirective *getChild(const char *name);
+    void sortChildren();
 
     const char *_name;
     int _type;
     int _minParamCount;
     int _maxParamCount;
     int _childrenCount;
-    RemapDirective *_forSearchChild;
     RemapDirective *_children[MAX_CHILD_NUM];  //sort by name
 };
 
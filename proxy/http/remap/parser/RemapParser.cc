@@ -10,6 +10,7 @@
 #include <errno.h>
 #include <sys/file.h>
 #include <dirent.h>
+#include <pthread.h>
 #include "RemapParser.h"
 #include "SchemeDirective.h"
 #include "PluginDirective.h"
@@ -49,6 +50,7 @@ void RemapParser::init()
   _rootDirective->_children[index++] = new RedirectDirective();
   _rootDirective->_children[index++] = new IncludeDirective();
   _rootDirective->_childrenCount = index;
+  _rootDirective->sortChildren();
 }
 
 int RemapParser::loadFromFile(const char *filename, DirectiveParams *rootParams)
@@ -88,17 +90,136 @@ int RemapParser::loadFromFile(const char *filename, DirectiveParams *rootParams)
   }
 
 
+#define MAX_INCLUDE_PARSE_THREADS  8
+
+//one include file parsed apart as a root of its own
+struct IncludeFileContext {
+  RemapParser *parser;
+  const char *filename;
+  char *content;
+  DirectiveParams *params;
+  int result;
+};
+
+struct IncludeParseThread {
+  pthread_t tid;
+  IncludeFileContext *contexts;
+  int start;  //the thread parses contexts start, start + step, ...
+  int step;
+  int count;
+};
+
+void *RemapParser::parseIncludeFiles(void *arg)
+{
+  IncludeParseThread *thread = (IncludeParseThread *)arg;
+  IncludeFileContext *ctx;
+  int fileSize;
+
+  for (int i=thread->start; i<thread->count; i+=thread->step) {
+    ctx = thread->contexts + i;
+    ctx->result = ctx->parser->getFileContent(ctx->filename,
+        ctx->content, &fileSize);
+    if (ctx->result != 0) {
+      continue;
+    }
+
+    ctx->result = ctx->parser->parse(ctx->params, ctx->content,
+        ctx->content + fileSize, false);
+  }
+
+  return NULL;
+}
+
+/**
+ * parse the include files on some threads, each one into a root params of
+ * its own, then append their children to the parent in the file order,
+ * with the ranks they would get from a serial parse
+ **/
+int RemapParser::dealIncludeParallel(DirectiveParams *parentParams,
+    IncludeParams *includeParams, int threadCount)
+{
+  const DynamicArray<char *> *filenames;
+  IncludeFileContext *contexts;
+  IncludeParseThread threads[MAX_INCLUDE_PARSE_THREADS];
+  int result;
+  int i;
+
+  filenames = includeParams->getFilenames();
+  contexts = new IncludeFileContext[filenames->count];
+  for (i=0; i<filenames->count; i++) {
+    contexts[i].parser = this;
+    contexts[i].filename = filenames->items[i];
+    contexts[i].content = NULL;
+    contexts[i].params = new DirectiveParams(0, filenames->items[i], 0,
+        NULL, 0, NULL, parentParams->_directive, NULL, 0, true);
+    contexts[i].result = 0;
+  }
+
+  for (i=0; i<threadCount; i++) {
+    threads[i].contexts = contexts;
+    threads[i].start = i;
+    threads[i].step = threadCount;
+    threads[i].count = filenames->count;
+    if (pthread_create(&threads[i].tid, NULL, parseIncludeFiles,
+          threads + i) != 0)
+    {
+      fprintf(stderr, "file: "__FILE__", line: %d, "
+          "create thread fail, errno: %d, error info: %s\n",
+          __LINE__, errno, strerror(errno));
+      break;
+    }
+  }
+
+  //the files of the threads not created are parsed by this one
+  for (int k=i; k<threadCount; k++) {
+    parseIncludeFiles(threads + k);
+  }
+  threadCount = i;
+  for (i=0; i<threadCount; i++) {
+    pthread_join(threads[i].tid, NULL);
+  }
+
+  result = 0;
+  for (i=0; i<filenames->count; i++) {
+    if (contexts[i].content != NULL) {
+      _fileContents.add(contexts[i].content);
+    }
+    if (result == 0 && (result=contexts[i].result) == 0) {
+      contexts[i].params->moveChildrenTo(parentParams,
+          parentParams->getRank());
+      parentParams->incRank(contexts[i].params->getRank());
+    }
+    delete contexts[i].params;
+  }
+
+  delete[] contexts;
+  return result;
+}
+
 int RemapParser::dealInclude(DirectiveParams *parentParams,
     IncludeParams *includeParams)
 {
   char *content;
   int result;
   int fileSize;
+  int threadCount;
   int i;
   const DynamicArray<char *> *filenames;
  
   parentParams->setLineNo(0);
   filenames = includeParams->getFilenames();
+  threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+  if (threadCount > MAX_INCLUDE_PARSE_THREADS) {
+    threadCount = MAX_INCLUDE_PARSE_THREADS;
+  }
+  if (threadCount > filenames->count) {
+    threadCount = filenames->count;
+  }
+  if (threadCount > 1) {
+    return this->dealIncludeParallel(parentParams, includeParams,
+        threadCount);
+  }
+
   for (i=0; i<filenames->count; i++) {
     result = this->getFileContent(filenames->items[i], content, &fileSize);
     if (result != 0) {
@@ -77,6 +77,11 @@ class RemapParser {
 
     int dealInclude(DirectiveParams *parentParams,
         IncludeParams *includeParams);
+
+    int dealIncludeParallel(DirectiveParams *parentParams,
+        IncludeParams *includeParams, int threadCount);
+
+    static void *parseIncludeFiles(void *arg);
 };
 
 #endif
@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "HostnameTrie.h"
+
+/*
+ * Check HostnameRadixTrie against HostnameTrie and compare their memory
+ * and lookup latency on a synthetic remap table of suffix keys, in the
+ * hostname.port.scheme format of UrlRewrite:
+ *
+ *   test_HostnameTrie [-r] [host_count]
+ *
+ * -r skips HostnameTrie, which needs some GB for a 1M host table.
+ */
+
+#define DEFAULT_HOST_COUNT  20000
+#define QUERY_ROUNDS        4
+
+static double now_usec()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec * 1000000.0 + tv.tv_usec;
+}
+
+//every fourth key is a domain, .sN.exampleM.com, the others are hosts
+static int make_key(char *buff, const int size, const int i)
+{
+  if (i % 4 == 0) {
+    return snprintf(buff, size, ".s%d.example%d.com.80.1", i / 4, i % 64);
+  }
+
+  return snprintf(buff, size, "w%d.s%d.example%d.com.80.1", i, i / 4, i % 64);
+}
+
+//hits on the hosts, on the subdomains of the domains, on the domains
+//themselves when matching domains and misses
+static int make_query(char *buff, const int size, const int i)
+{
+  switch (i % 4) {
+    case 0:
+      return make_key(buff, size, i | 1);
+    case 1:
+      return snprintf(buff, size, "img.s%d.example%d.com.80.1", i / 4, (i & ~3) % 64);
+    case 2:
+      return snprintf(buff, size, "s%d.example%d.com.80.1", i / 4, (i & ~3) % 64);
+    default:
+      return snprintf(buff, size, "w%d.s%d.example%d.com.443.2", i, i / 4, i % 64);
+  }
+}
+
+template<typename Trie>
+static double build(Trie *trie, const int count, int *values)
+{
+  char key[128];
+  double start = now_usec();
+
+  for (int i=0; i<count; i++) {
+    int len = make_key(key, sizeof(key), i);
+    if (!trie->insert(key, len, values + i)) {
+      fprintf(stderr, "insert %s fail\n", key);
+      exit(1);
+    }
+  }
+
+  return now_usec() - start;
+}
+
+template<typename Trie>
+static double query(Trie *trie, const int count, long *found)
+{
+  typename Trie::LookupState state;
+  char key[128];
+  double start = now_usec();
+
+  *found = 0;
+  for (int round=0; round<QUERY_ROUNDS; round++) {
+    for (int i=0; i<count; i++) {
+      int len = make_query(key, sizeof(key), i);
+      for (int *v=trie->lookupFirst(key, len, &state); v != NULL;
+          v=trie->lookupNext(key, len, &state))
+      {
+        *found += *v;
+      }
+    }
+  }
+
+  return now_usec() - start;
+}
+
+//the radix trie finds the same values in the same order
+static int check(const bool matchDomain, const int count, int *values)
+{
+  HostnameTrie<int> trie(matchDomain);
+  HostnameRadixTrie<int> radix(matchDomain);
+  HostnameTrie<int>::LookupState state;
+  HostnameRadixTrie<int>::LookupState radix_state;
+  char key[128];
+  int *v;
+  int *rv;
+
+  build(&trie, count, values);
+  build(&radix, count, values);
+  for (int i=0; i<count; i++) {
+    int len = make_query(key, sizeof(key), i);
+    v = trie.lookupFirst(key, len, &state);
+    rv = radix.lookupFirst(key, len, &radix_state);
+    while (v == rv && v != NULL) {
+      v = trie.lookupNext(key, len, &state);
+      rv = radix.lookupNext(key, len, &radix_state);
+    }
+
+    if (v != rv) {
+      fprintf(stderr, "lookup %s, match domain %d: HostnameTrie %p, "
+          "HostnameRadixTrie %p\n", key, matchDomain, v, rv);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int check_set()
+{
+  HostnameTrieSet set;
+  const char *names[] = {"taobao.com", ".tmall.com", "a.b.example.com", "b.example.com"};
+  int count;
+
+  for (int i=0; i<(int)(sizeof(names) / sizeof(names[0])); i++) {
+    if (!set.insert(names[i])) {
+      fprintf(stderr, "insert %s fail\n", names[i]);
+      return 1;
+    }
+  }
+
+  if (set.insert("TAOBAO.com") || !set.contains("TaoBao.com", 10) ||
+      !set.contains("tmall.com", 9) || !set.contains("www.tmall.com", 13) ||
+      set.contains("www.taobao.com", 14) || set.contains("example.com", 11) ||
+      !set.contains("b.example.com", 13) || set.contains("xb.example.com", 14))
+  {
+    fprintf(stderr, "HostnameTrieSet lookup fail\n");
+    return 1;
+  }
+
+  set.getHostnames(&count);
+  if (count != 4) {
+    fprintf(stderr, "HostnameTrieSet has %d hostnames instead of 4\n", count);
+    return 1;
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  int count = DEFAULT_HOST_COUNT;
+  bool radix_only = false;
+  double build_usec;
+  double query_usec;
+  long found;
+  long radix_found;
+
+  for (int i=1; i<argc; i++) {
+    if (strcmp(argv[i], "-r") == 0) {
+      radix_only = true;
+    }
+    else {
+      count = atoi(argv[i]);
+    }
+  }
+
+  if (count <= 0) {
+    fprintf(stderr, "Usage: %s [-r] [host_count]\n", argv[0]);
+    return EINVAL;
+  }
+
+  if (check_set() != 0) {
+    return 1;
+  }
+
+  int *values = (int *)malloc(sizeof(int) * count);
+  for (int i=0; i<count; i++) {
+    values[i] = 1;
+  }
+
+  HostnameRadixTrie<int> *radix = new HostnameRadixTrie<int>(false);
+  build_usec = build(radix, count, values);
+  query_usec = query(radix, count, &radix_found);
+  printf("HostnameRadixTrie: %d keys, %.1f MB, build %.3f s, "
+      "%.1f ns per lookup\n", count, radix->memoryUsage() / 1048576.0,
+      build_usec / 1000000.0, query_usec * 1000.0 / (count * QUERY_ROUNDS));
+
+  if (!radix_only) {
+    HostnameTrie<int> *trie = new HostnameTrie<int>(false);
+    build_usec = build(trie, count, values);
+    query_usec = query(trie, count, &found);
+    printf("HostnameTrie:      %d keys, %.1f MB, build %.3f s, "
+        "%.1f ns per lookup\n", count, trie->memoryUsage() / 1048576.0,
+        build_usec / 1000000.0, query_usec * 1000.0 / (count * QUERY_ROUNDS));
+
+    delete trie;
+
+    if (found != radix_found) {
+      fprintf(stderr, "HostnameTrie found %ld, HostnameRadixTrie found %ld\n",
+          found, radix_found);
+      return 1;
+    }
+
+    //values are pointers into values[], compare each lookup on a
+    //smaller table in both modes
+    int check_count = count < DEFAULT_HOST_COUNT ? count : DEFAULT_HOST_COUNT;
+    if (check(false, check_count, values) != 0 ||
+        check(true, check_count, values) != 0)
+    {
+      return 1;
+    }
+  }
+
+  delete radix;
+  free(values);
+  return 0;
+}